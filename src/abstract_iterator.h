@@ -18,6 +18,7 @@ typedef struct AbstractIterator
     void (*Close)(struct AbstractIterator *iter);
 
     struct AbstractIterator *input;
+    struct QueryArena *arena; // allocated from, NULL for the heap (see query_arena.h)
 } AbstractIterator;
 
 typedef struct AbstractSampleIterator
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+
+#include "async_read.h"
+
+#include "common.h"
+#include "module.h"
+#include "reply.h"
+#include "utils/blocked_client.h"
+#include "utils/thread_pool.h"
+
+#include "rmutil/alloc.h"
+
+// Number of series snapshotted per GIL acquisition, so writes can interleave with a large MRANGE
+#define SNAPSHOT_BATCH_SERIES 256
+
+static RTS_ThreadPool *readPool = NULL;
+
+typedef struct MRangeJob
+{
+    RedisModuleBlockedClient *bc;
+    MRangeArgs args;
+    RedisModuleString **keys;
+    size_t keysCount;
+} MRangeJob;
+
+typedef struct RangeJob
+{
+    RedisModuleBlockedClient *bc;
+    Series *snapshot;
+    RangeArgs args;
+    bool reverse;
+} RangeJob;
+
+bool AsyncRead_ShouldOffload(RedisModuleCtx *ctx, ReadOffloadCommand command) {
+    if (TSGlobalConfig.readThreads == 0 || !(TSGlobalConfig.readOffload & command)) {
+        return false;
+    }
+
+    const int ctxFlags = RedisModule_GetContextFlags(ctx);
+    if (ctxFlags & (REDISMODULE_CTX_FLAGS_LUA | REDISMODULE_CTX_FLAGS_MULTI |
+                    REDISMODULE_CTX_FLAGS_DENY_BLOCKING)) {
+        return false;
+    }
+
+    if (!readPool) {
+        readPool = RTS_ThreadPoolCreate(TSGlobalConfig.readThreads);
+        if (!readPool) {
+            RedisModule_Log(ctx, "warning", "Failed to start the read thread pool");
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t AsyncRead_PoolSize(void) {
+    return readPool ? RTS_ThreadPoolSize(readPool) : 0;
+}
+
+static void MRangeJob_Run(void *arg) {
+    MRangeJob *job = arg;
+    RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(job->bc);
+    const RangeArgs *rangeArgs = &job->args.rangeArgs;
+    Series **snapshots = calloc(job->keysCount, sizeof(Series *));
+    size_t count = 0;
+
+    for (size_t i = 0; i < job->keysCount; i += SNAPSHOT_BATCH_SERIES) {
+        const size_t end = min(i + SNAPSHOT_BATCH_SERIES, job->keysCount);
+        RedisModule_ThreadSafeContextLock(ctx);
+        for (size_t j = i; j < end; j++) {
+            RedisModuleKey *key;
+            Series *series;
+            // ACL permissions were already validated before blocking the client.
+            const GetSeriesResult status = GetSeries(
+                ctx, job->keys[j], &key, &series, REDISMODULE_READ, GetSeriesFlags_SilentOperation);
+            if (status == GetSeriesResult_Success) {
+                snapshots[count++] = SeriesSnapshot(
+                    series, rangeArgs->startTimestamp, rangeArgs->endTimestamp, rangeArgs->latest);
+                RedisModule_CloseKey(key);
+            }
+            RedisModule_FreeString(NULL, job->keys[j]);
+        }
+        RedisModule_ThreadSafeContextUnlock(ctx);
+    }
+
+    replyMultiRangeFromSeries(ctx, snapshots, count, &job->args);
+
+    for (size_t i = 0; i < count; i++) {
+        FreeSeries(snapshots[i]);
+    }
+    free(snapshots);
+    free(job->keys);
+    MRangeArgs_Free(&job->args);
+    RTS_UnblockClient(job->bc, ctx);
+    free(job);
+}
+
+int AsyncRead_MRange(RedisModuleCtx *ctx, MRangeArgs *args, RedisModuleDict *keys) {
+    if (CheckDictSeriesPermissions(
+            ctx, keys, GetSeriesFlags_CheckForAcls | GetSeriesFlags_SilentOperation) ==
+        GetSeriesResult_PermissionError) {
+        MRangeArgs_Free(args);
+        RTS_ReplyKeyPermissionsError(ctx);
+        return REDISMODULE_ERR;
+    }
+
+    MRangeJob *job = malloc(sizeof(*job));
+    job->args = *args;
+    job->keysCount = RedisModule_DictSize(keys);
+    job->keys = calloc(job->keysCount, sizeof(RedisModuleString *));
+
+    // QueryIndex returns the keys in lexicographic order, which is also the reply order
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(keys, "^", NULL, 0);
+    const char *currentKey;
+    size_t currentKeyLen;
+    size_t i = 0;
+    while ((currentKey = RedisModule_DictNextC(iter, &currentKeyLen, NULL)) != NULL) {
+        job->keys[i++] = RedisModule_CreateString(NULL, currentKey, currentKeyLen);
+    }
+    RedisModule_DictIteratorStop(iter);
+
+    job->bc = RTS_BlockClient(ctx, RTS_FreeThreadSafeCtx);
+    RTS_ThreadPoolAddJob(readPool, MRangeJob_Run, job);
+    return REDISMODULE_OK;
+}
+
+static void RangeJob_Run(void *arg) {
+    RangeJob *job = arg;
+    RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(job->bc);
+
+    ReplySeriesRange(ctx, job->snapshot, &job->args, job->reverse);
+
+    FreeSeries(job->snapshot);
+    RangeArgs_Free(&job->args);
+    RTS_UnblockClient(job->bc, ctx);
+    free(job);
+}
+
+int AsyncRead_Range(RedisModuleCtx *ctx, Series *snapshot, const RangeArgs *args, bool reverse) {
+    RangeJob *job = malloc(sizeof(*job));
+    job->snapshot = snapshot;
+    job->args = *args;
+    // the LATEST sample is already part of the snapshot
+    job->args.latest = false;
+    job->reverse = reverse;
+    job->bc = RTS_BlockClient(ctx, RTS_FreeThreadSafeCtx);
+    RTS_ThreadPoolAddJob(readPool, RangeJob_Run, job);
+    return REDISMODULE_OK;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef ASYNC_READ_H
+#define ASYNC_READ_H
+
+#include "config.h"
+#include "query_language.h"
+#include "tsdb.h"
+#include "RedisModulesSDK/redismodule.h"
+
+#include <stdbool.h>
+
+// Whether the command should block the client and run on the read thread pool (see
+// ts-read-threads and ts-read-offload). Starts the pool on first use.
+bool AsyncRead_ShouldOffload(RedisModuleCtx *ctx, ReadOffloadCommand command);
+
+// Number of threads of the read pool, 0 if it was not started yet
+size_t AsyncRead_PoolSize(void);
+
+// Snapshots the series in `keys` in slices while holding the GIL, then aggregates and replies
+// without it. Takes ownership of args.
+int AsyncRead_MRange(RedisModuleCtx *ctx, MRangeArgs *args, RedisModuleDict *keys);
+
+// Replies with the range of a snapshot from the read pool. Takes ownership of the snapshot and
+// of the aggregation classes of args.
+int AsyncRead_Range(RedisModuleCtx *ctx, Series *snapshot, const RangeArgs *args, bool reverse);
+
+#endif
@@ -0,0 +1,780 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "bulk_load.h"
+
+#include "common.h"
+#include "consts.h"
+#include "module.h"
+#include "reply.h"
+#include "series_template.h"
+#include "tsdb.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "rmutil/alloc.h"
+#include "rmutil/util.h"
+
+// Samples parsed between two GIL slices, bounds both the time the GIL is held and the memory
+// buffered by the worker
+#define LOAD_BATCH_SAMPLES 16384
+#define LOAD_READ_SIZE (64 * 1024)
+
+typedef enum LoadFormat
+{
+    LoadFormat_Influx = 0,
+    LoadFormat_Csv,
+} LoadFormat;
+
+typedef enum LoadState
+{
+    LoadState_Running = 0,
+    LoadState_Done,
+    LoadState_Cancelled,
+    LoadState_Failed,
+} LoadState;
+
+static const char *LoadStateNames[] = { "running", "done", "cancelled", "failed" };
+static const char *LoadFormatNames[] = { "influx", "csv" };
+
+typedef struct LoadSample
+{
+    timestamp_t timestamp;
+    double value;
+    uint64_t seq; // position in the file, keeps samples with the same timestamp in file order
+} LoadSample;
+
+// The samples of one series parsed since the last GIL slice
+typedef struct LoadSeries
+{
+    RedisModuleString *keyName;
+    RedisModuleString **labels; // key and value pairs, used only if the series is created
+    size_t labelsCount;
+    LoadSample *samples;
+    size_t count;
+    size_t capacity;
+} LoadSeries;
+
+// A label of the line being parsed, points into the line buffer
+typedef struct LoadLabel
+{
+    const char *key;
+    size_t keyLen;
+    const char *value;
+    size_t valueLen;
+} LoadLabel;
+
+typedef struct LoadJob
+{
+    RedisModuleCtx *ctx; // detached, with the db of the client which started the load
+    RedisModuleString *path;
+    RedisModuleString *templateName; // NULL without TEMPLATE
+    LoadFormat format;
+    FILE *file;
+    bool checkSlots; // skip the keys of slots served by other shards
+    long long bytesTotal;
+    long long startTime;
+
+    // written by the worker, read by TS.LOAD.STATUS
+    long long endTime;
+    long long bytesRead;
+    long long lines;
+    long long samples;
+    long long errors;
+    long long skipped;
+    long long seriesCreated;
+    int state;
+    bool cancel;
+
+    // owned by the worker
+    RedisModuleDict *pending; // key name -> LoadSeries
+    size_t pendingSamples;
+    uint64_t seq;
+    LoadLabel *labels;
+    size_t labelsCapacity;
+    char *keyBuf;
+    size_t keyBufCapacity;
+} LoadJob;
+
+// The running or the last finished load, replaced under the GIL only
+static LoadJob *currentJob = NULL;
+
+#define LOAD_INC(field, n) __atomic_add_fetch(&(field), (n), __ATOMIC_RELAXED)
+#define LOAD_GET(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+static void LoadJob_Free(LoadJob *job) {
+    RedisModule_FreeString(NULL, job->path);
+    if (job->templateName) {
+        RedisModule_FreeString(NULL, job->templateName);
+    }
+    RedisModule_FreeThreadSafeContext(job->ctx);
+    free(job);
+}
+
+static void LoadSeries_Free(LoadSeries *ls) {
+    RedisModule_FreeString(NULL, ls->keyName);
+    for (size_t i = 0; i < ls->labelsCount; i++) {
+        RedisModule_FreeString(NULL, ls->labels[i]);
+    }
+    free(ls->labels);
+    free(ls->samples);
+    free(ls);
+}
+
+static int LoadSample_Compare(const void *a, const void *b) {
+    const LoadSample *sa = a, *sb = b;
+    if (sa->timestamp != sb->timestamp) {
+        return sa->timestamp < sb->timestamp ? -1 : 1;
+    }
+    return sa->seq < sb->seq ? -1 : sa->seq > sb->seq;
+}
+
+/*********************
+ *  Applying samples *
+ *********************/
+
+static bool LoadJob_CreateSeries(LoadJob *job,
+                                 LoadSeries *ls,
+                                 const Sample *first,
+                                 Series **series,
+                                 RedisModuleKey **key) {
+    if (job->templateName && SeriesTemplate_Get(job->templateName) == NULL) {
+        // the template was deleted during the load
+        return false;
+    }
+
+    // TS.ADD key timestamp value [TEMPLATE name] [LABELS label value ...], also replicated as is
+    const int argc = 4 + (job->templateName ? 2 : 0) + (ls->labelsCount ? 1 + ls->labelsCount : 0);
+    RedisModuleString **argv = malloc(argc * sizeof(*argv));
+    int pos = 0;
+    argv[pos++] = RedisModule_CreateString(NULL, "TS.ADD", strlen("TS.ADD"));
+    argv[pos++] = ls->keyName;
+    argv[pos++] = RedisModule_CreateStringPrintf(NULL, "%" PRIu64, first->timestamp);
+    argv[pos++] = RedisModule_CreateStringPrintf(NULL, "%.17g", first->value);
+    if (job->templateName) {
+        argv[pos++] = RedisModule_CreateString(NULL, TEMPLATE_ARG, strlen(TEMPLATE_ARG));
+        argv[pos++] = job->templateName;
+    }
+    if (ls->labelsCount) {
+        argv[pos++] = RedisModule_CreateString(NULL, "LABELS", strlen("LABELS"));
+        for (size_t i = 0; i < ls->labelsCount; i++) {
+            argv[pos++] = ls->labels[i];
+        }
+    }
+
+    const bool created =
+        CreateSeriesFromArgs(job->ctx, ls->keyName, argv, argc, series, key) == REDISMODULE_OK;
+    if (created) {
+        RedisModule_Replicate(job->ctx, "TS.ADD", "v", argv + 1, argc - 1);
+    }
+
+    RedisModule_FreeString(NULL, argv[0]);
+    RedisModule_FreeString(NULL, argv[2]);
+    RedisModule_FreeString(NULL, argv[3]);
+    if (job->templateName) {
+        RedisModule_FreeString(NULL, argv[4]);
+    }
+    if (ls->labelsCount) {
+        RedisModule_FreeString(NULL, argv[argc - ls->labelsCount - 1]);
+    }
+    free(argv);
+    return created;
+}
+
+static void LoadJob_ReplicateBackfill(LoadJob *job,
+                                      RedisModuleString *keyName,
+                                      const Sample *samples,
+                                      size_t count) {
+    const size_t argc = 1 + count * 2;
+    RedisModuleString **argv = malloc(argc * sizeof(*argv));
+    argv[0] = keyName;
+    for (size_t i = 0; i < count; i++) {
+        argv[1 + i * 2] = RedisModule_CreateStringPrintf(NULL, "%" PRIu64, samples[i].timestamp);
+        argv[2 + i * 2] = RedisModule_CreateStringPrintf(NULL, "%.17g", samples[i].value);
+    }
+    RedisModule_Replicate(job->ctx, "TS.BACKFILL", "v", argv, argc);
+    for (size_t i = 1; i < argc; i++) {
+        RedisModule_FreeString(NULL, argv[i]);
+    }
+    free(argv);
+}
+
+// Must be called with the GIL held
+static void LoadJob_ApplySeries(LoadJob *job, LoadSeries *ls) {
+    RedisModuleCtx *ctx = job->ctx;
+
+    if (job->checkSlots &&
+        !RedisModule_ClusterCanAccessKeysInSlot(RedisModule_ClusterKeySlot(ls->keyName))) {
+        LOAD_INC(job->skipped, ls->count);
+        return;
+    }
+
+    qsort(ls->samples, ls->count, sizeof(*ls->samples), LoadSample_Compare);
+    Sample *samples = malloc(ls->count * sizeof(*samples));
+    for (size_t i = 0; i < ls->count; i++) {
+        samples[i].timestamp = ls->samples[i].timestamp;
+        samples[i].value = ls->samples[i].value;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, ls->keyName, REDISMODULE_READ | REDISMODULE_WRITE);
+    Series *series = NULL;
+    // a created series is replicated by TS.ADD with its first sample
+    size_t replicated = 0;
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
+        if (!LoadJob_CreateSeries(job, ls, &samples[0], &series, &key)) {
+            LOAD_INC(job->errors, ls->count);
+            goto cleanup;
+        }
+        LOAD_INC(job->seriesCreated, 1);
+        replicated = 1;
+    } else if (RedisModule_ModuleTypeGetType(key) != SeriesType) {
+        LOAD_INC(job->errors, ls->count);
+        goto cleanup;
+    } else {
+        series = RedisModule_ModuleTypeGetValue(key);
+    }
+
+    // the samples are sorted, so a created series gets the first one first, just like the replica
+    const size_t written = SeriesBackfill(ctx, series, samples, ls->count, DP_NONE, NULL);
+    if (written > replicated) {
+        LoadJob_ReplicateBackfill(job, ls->keyName, samples + replicated, ls->count - replicated);
+    }
+    WriteCtx_Event(ctx, WriteEvent_Add, ls->keyName);
+    LOAD_INC(job->samples, written);
+    LOAD_INC(job->errors, ls->count - written);
+
+cleanup:
+    RedisModule_CloseKey(key);
+    free(samples);
+}
+
+// Applies the pending samples in one GIL slice
+static void LoadJob_Flush(LoadJob *job) {
+    if (job->pendingSamples == 0) {
+        return;
+    }
+
+    RedisModule_ThreadSafeContextLock(job->ctx);
+    WriteCtx_Begin();
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(job->pending, "^", NULL, 0);
+    LoadSeries *ls;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&ls) != NULL) {
+        LoadJob_ApplySeries(job, ls);
+    }
+    RedisModule_DictIteratorStop(iter);
+    WriteCtx_End(job->ctx);
+    RedisModule_ThreadSafeContextUnlock(job->ctx);
+
+    iter = RedisModule_DictIteratorStartC(job->pending, "^", NULL, 0);
+    while (RedisModule_DictNextC(iter, NULL, (void **)&ls) != NULL) {
+        LoadSeries_Free(ls);
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeDict(NULL, job->pending);
+    job->pending = RedisModule_CreateDict(NULL);
+    job->pendingSamples = 0;
+}
+
+/********************
+ *  Parsing samples *
+ ********************/
+
+static bool isLegalLabel(const LoadLabel *label) {
+    // the same checks as LABELS of TS.CREATE, an illegal label fails the line instead of a series
+    if (label->keyLen == 0 || label->valueLen == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < label->valueLen; i++) {
+        if (strchr("(),", label->value[i]) != NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void LoadJob_PushLabel(LoadJob *job,
+                              size_t *count,
+                              const char *key,
+                              size_t keyLen,
+                              const char *value,
+                              size_t valueLen) {
+    if (*count == job->labelsCapacity) {
+        job->labelsCapacity = job->labelsCapacity ? job->labelsCapacity * 2 : 16;
+        job->labels = realloc(job->labels, job->labelsCapacity * sizeof(*job->labels));
+    }
+    job->labels[(*count)++] = (LoadLabel){ key, keyLen, value, valueLen };
+}
+
+static void LoadJob_AddSample(LoadJob *job,
+                              const char *key,
+                              size_t keyLen,
+                              size_t labelsCount,
+                              timestamp_t timestamp,
+                              double value) {
+    LoadSeries *ls = RedisModule_DictGetC(job->pending, (void *)key, keyLen, NULL);
+    if (ls == NULL) {
+        ls = calloc(1, sizeof(*ls));
+        ls->keyName = RedisModule_CreateString(NULL, key, keyLen);
+        ls->labelsCount = labelsCount * 2;
+        ls->labels = malloc(max(ls->labelsCount, 1) * sizeof(*ls->labels));
+        for (size_t i = 0; i < labelsCount; i++) {
+            const LoadLabel *label = &job->labels[i];
+            ls->labels[i * 2] = RedisModule_CreateString(NULL, label->key, label->keyLen);
+            ls->labels[i * 2 + 1] = RedisModule_CreateString(NULL, label->value, label->valueLen);
+        }
+        RedisModule_DictSetC(job->pending, (void *)key, keyLen, ls);
+    }
+
+    if (ls->count == ls->capacity) {
+        ls->capacity = ls->capacity ? ls->capacity * 2 : 16;
+        ls->samples = realloc(ls->samples, ls->capacity * sizeof(*ls->samples));
+    }
+    ls->samples[ls->count++] = (LoadSample){ timestamp, value, job->seq++ };
+    job->pendingSamples++;
+}
+
+static void LoadJob_SetKey(LoadJob *job, size_t offset, const char *str, size_t len) {
+    if (offset + len > job->keyBufCapacity) {
+        job->keyBufCapacity = max(offset + len, job->keyBufCapacity * 2);
+        job->keyBuf = realloc(job->keyBuf, job->keyBufCapacity);
+    }
+    memcpy(job->keyBuf + offset, str, len);
+}
+
+static bool parseUnsignedCStr(const char *str, size_t len, uint64_t *out) {
+    if (len == 0 || len > 20) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return false;
+        }
+        const uint64_t digit = str[i] - '0';
+        if (result > (UINT64_MAX - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    *out = result;
+    return true;
+}
+
+// Returns the first unescaped character of `stops` between `p` and `end`, or `end`.
+// With `quotes` the characters inside double quotes are skipped as well.
+static char *scanUntil(char *p, char *end, const char *stops, bool quotes) {
+    bool quoted = false;
+    for (; p < end; p++) {
+        if (*p == '\\' && p + 1 < end) {
+            p++;
+        } else if (quotes && *p == '"') {
+            quoted = !quoted;
+        } else if (!quoted && strchr(stops, *p) != NULL) {
+            return p;
+        }
+    }
+    return end;
+}
+
+// Removes the escaping backslashes in place, returns the new length
+static size_t unescape(char *str, size_t len) {
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '\\' && i + 1 < len) {
+            i++;
+        }
+        str[out++] = str[i];
+    }
+    return out;
+}
+
+static bool parseInfluxValue(const char *str, size_t len, double *value) {
+    if (len == 0) {
+        return false;
+    }
+    const char last = str[len - 1];
+    if (last == 'i' || last == 'u') {
+        const bool negative = last == 'i' && str[0] == '-';
+        uint64_t n;
+        if (!parseUnsignedCStr(str + negative, len - 1 - negative, &n)) {
+            return false;
+        }
+        *value = negative ? -(double)n : (double)n;
+        return true;
+    }
+    if ((len == 1 && (str[0] == 't' || str[0] == 'T')) ||
+        (len == 4 && strncasecmp(str, "true", len) == 0)) {
+        *value = 1;
+        return true;
+    }
+    if ((len == 1 && (str[0] == 'f' || str[0] == 'F')) ||
+        (len == 5 && strncasecmp(str, "false", len) == 0)) {
+        *value = 0;
+        return true;
+    }
+    return parse_double_cstr(str, len, value);
+}
+
+// measurement[,tag=value...] field=value[,field=value...] [timestamp_ns]
+// Every numeric field is a series named `<measurement and tags as written>:<field>`, labeled by
+// `measurement`, `field` and the tags. String fields are skipped.
+static bool parseInfluxLine(LoadJob *job, char *line, size_t len) {
+    char *end = line + len;
+    char *seriesEnd = scanUntil(line, end, " ", false);
+    if (seriesEnd == line || seriesEnd == end) {
+        return false;
+    }
+    char *fields = seriesEnd + 1;
+    char *fieldsEnd = scanUntil(fields, end, " ", true);
+
+    timestamp_t timestamp;
+    char *tsStart = fieldsEnd;
+    while (tsStart < end && *tsStart == ' ') {
+        tsStart++;
+    }
+    if (tsStart < end) {
+        uint64_t ns;
+        if (!parseUnsignedCStr(tsStart, end - tsStart, &ns)) {
+            return false;
+        }
+        timestamp = ns / 1000000;
+    } else {
+        timestamp = RedisModule_Milliseconds();
+    }
+
+    // the key prefix is the measurement and tags before unescaping
+    const size_t prefixLen = seriesEnd - line;
+    LoadJob_SetKey(job, 0, line, prefixLen);
+    LoadJob_SetKey(job, prefixLen, ":", 1);
+
+    size_t labelsCount = 0;
+    char *measurement = line;
+    char *measurementEnd = scanUntil(line, seriesEnd, ",", false);
+    LoadJob_PushLabel(job,
+                      &labelsCount,
+                      "measurement",
+                      strlen("measurement"),
+                      measurement,
+                      unescape(measurement, measurementEnd - measurement));
+    // the field label is filled per field
+    LoadJob_PushLabel(job, &labelsCount, "field", strlen("field"), NULL, 0);
+    for (char *tag = measurementEnd + 1; tag < seriesEnd;) {
+        char *tagEnd = scanUntil(tag, seriesEnd, ",", false);
+        char *eq = scanUntil(tag, tagEnd, "=", false);
+        if (eq == tagEnd) {
+            return false;
+        }
+        LoadJob_PushLabel(
+            job, &labelsCount, tag, unescape(tag, eq - tag), eq + 1, unescape(eq + 1, tagEnd - eq - 1));
+        if (!isLegalLabel(&job->labels[labelsCount - 1])) {
+            return false;
+        }
+        tag = tagEnd + 1;
+    }
+    if (!isLegalLabel(&job->labels[0])) {
+        return false;
+    }
+
+    bool parsed = true;
+    for (char *field = fields; field < fieldsEnd;) {
+        char *fieldEnd = scanUntil(field, fieldsEnd, ",", true);
+        char *eq = scanUntil(field, fieldEnd, "=", false);
+        char *valueStr = eq + 1;
+        double value;
+        if (eq == field || eq == fieldEnd) {
+            parsed = false;
+        } else if (*valueStr == '"') {
+            // string fields can't be stored in a series
+        } else if (!parseInfluxValue(valueStr, fieldEnd - valueStr, &value)) {
+            parsed = false;
+        } else {
+            const size_t nameLen = eq - field;
+            LoadJob_SetKey(job, prefixLen + 1, field, nameLen);
+            job->labels[1].value = field;
+            job->labels[1].valueLen = unescape(field, nameLen);
+            if (isLegalLabel(&job->labels[1])) {
+                LoadJob_AddSample(
+                    job, job->keyBuf, prefixLen + 1 + nameLen, labelsCount, timestamp, value);
+            } else {
+                parsed = false;
+            }
+        }
+        field = fieldEnd + 1;
+    }
+    return parsed;
+}
+
+// key,timestamp_ms,value[,label=value...]
+static bool parseCsvLine(LoadJob *job, char *line, size_t len) {
+    char *end = line + len;
+    char *keyEnd = memchr(line, ',', len);
+    if (keyEnd == NULL || keyEnd == line) {
+        return false;
+    }
+    char *tsStr = keyEnd + 1;
+    char *tsEnd = memchr(tsStr, ',', end - tsStr);
+    if (tsEnd == NULL) {
+        return false;
+    }
+    char *valueStr = tsEnd + 1;
+    char *valueEnd = memchr(valueStr, ',', end - valueStr);
+    if (valueEnd == NULL) {
+        valueEnd = end;
+    }
+
+    uint64_t timestamp;
+    double value;
+    if (!parseUnsignedCStr(tsStr, tsEnd - tsStr, &timestamp) ||
+        !parse_double_cstr(valueStr, valueEnd - valueStr, &value)) {
+        return false;
+    }
+
+    size_t labelsCount = 0;
+    for (char *label = valueEnd + 1; label < end;) {
+        char *labelEnd = memchr(label, ',', end - label);
+        if (labelEnd == NULL) {
+            labelEnd = end;
+        }
+        char *eq = memchr(label, '=', labelEnd - label);
+        if (eq == NULL) {
+            return false;
+        }
+        LoadJob_PushLabel(job, &labelsCount, label, eq - label, eq + 1, labelEnd - eq - 1);
+        if (!isLegalLabel(&job->labels[labelsCount - 1])) {
+            return false;
+        }
+        label = labelEnd + 1;
+    }
+
+    LoadJob_AddSample(job, line, keyEnd - line, labelsCount, timestamp, value);
+    return true;
+}
+
+static void LoadJob_ParseLine(LoadJob *job, char *line, size_t len) {
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    if (len == 0 || line[0] == '#') {
+        return;
+    }
+    line[len] = '\0';
+
+    LOAD_INC(job->lines, 1);
+    const bool parsed = job->format == LoadFormat_Influx ? parseInfluxLine(job, line, len)
+                                                         : parseCsvLine(job, line, len);
+    if (!parsed) {
+        LOAD_INC(job->errors, 1);
+    }
+}
+
+static void *LoadJob_Run(void *arg) {
+    LoadJob *job = arg;
+    job->pending = RedisModule_CreateDict(NULL);
+
+    // lines are parsed in place, a line longer than the buffer grows it
+    size_t capacity = LOAD_READ_SIZE, used = 0;
+    char *buf = malloc(capacity + 1);
+    bool eof = false;
+    while (!eof && !__atomic_load_n(&job->cancel, __ATOMIC_RELAXED)) {
+        if (used == capacity) {
+            capacity *= 2;
+            buf = realloc(buf, capacity + 1);
+        }
+        const size_t read = fread(buf + used, 1, capacity - used, job->file);
+        LOAD_INC(job->bytesRead, read);
+        used += read;
+        eof = read == 0;
+        if (eof && used > 0) {
+            // the last line has no newline
+            buf[used++] = '\n';
+        }
+
+        char *line = buf, *end = buf + used, *newline;
+        while (!__atomic_load_n(&job->cancel, __ATOMIC_RELAXED) &&
+               (newline = memchr(line, '\n', end - line)) != NULL) {
+            LoadJob_ParseLine(job, line, newline - line);
+            line = newline + 1;
+            if (job->pendingSamples >= LOAD_BATCH_SAMPLES) {
+                LoadJob_Flush(job);
+            }
+        }
+        used = end - line;
+        memmove(buf, line, used);
+    }
+
+    const bool failed = ferror(job->file);
+    fclose(job->file);
+    free(buf);
+    LoadJob_Flush(job);
+    RedisModule_FreeDict(NULL, job->pending);
+    free(job->labels);
+    free(job->keyBuf);
+
+    LoadState state = LoadState_Done;
+    if (__atomic_load_n(&job->cancel, __ATOMIC_RELAXED)) {
+        state = LoadState_Cancelled;
+    } else if (failed) {
+        state = LoadState_Failed;
+    }
+    __atomic_store_n(&job->endTime, RedisModule_Milliseconds(), __ATOMIC_RELAXED);
+    // the last access to the job, it may be freed by the next TS.LOAD from now on
+    __atomic_store_n(&job->state, state, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**************
+ *  Commands  *
+ **************/
+
+int TSDB_load(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    if (argc != 4 && argc != 6) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    LoadFormat format;
+    if (!RMUtil_StringEqualsCaseC(argv[2], "FORMAT")) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: missing FORMAT");
+    }
+    if (RMUtil_StringEqualsCaseC(argv[3], "influx")) {
+        format = LoadFormat_Influx;
+    } else if (RMUtil_StringEqualsCaseC(argv[3], "csv")) {
+        format = LoadFormat_Csv;
+    } else {
+        return RTS_ReplyGeneralError(ctx, "TSDB: unknown FORMAT");
+    }
+    if (argc == 6) {
+        if (!RMUtil_StringEqualsCaseC(argv[4], TEMPLATE_ARG)) {
+            return RTS_ReplyGeneralError(ctx, "TSDB: wrong arguments");
+        }
+        if (SeriesTemplate_Get(argv[5]) == NULL) {
+            return RTS_ReplyGeneralError(ctx, "TSDB: unknown template");
+        }
+    }
+
+    if (currentJob != NULL &&
+        __atomic_load_n(&currentJob->state, __ATOMIC_ACQUIRE) == LoadState_Running) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: a load is already running");
+    }
+
+    const bool checkSlots = RedisModule_GetContextFlags(ctx) & REDISMODULE_CTX_FLAGS_CLUSTER;
+    if (checkSlots && (RedisModule_ClusterKeySlot == NULL ||
+                       RedisModule_ClusterCanAccessKeysInSlot == NULL)) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: TS.LOAD is not supported by this cluster");
+    }
+
+    const char *path = RedisModule_StringPtrLen(argv[1], NULL);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: couldn't open the file");
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fclose(file);
+        return RTS_ReplyGeneralError(ctx, "TSDB: not a regular file");
+    }
+
+    LoadJob *job = calloc(1, sizeof(*job));
+    job->ctx = RedisModule_GetDetachedThreadSafeContext(ctx);
+    RedisModule_SelectDb(job->ctx, RedisModule_GetSelectedDb(ctx));
+    job->path = RedisModule_CreateStringFromString(NULL, argv[1]);
+    job->templateName = argc == 6 ? RedisModule_CreateStringFromString(NULL, argv[5]) : NULL;
+    job->format = format;
+    job->file = file;
+    job->checkSlots = checkSlots;
+    job->bytesTotal = st.st_size;
+    job->startTime = RedisModule_Milliseconds();
+    job->state = LoadState_Running;
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    const int rc = pthread_create(&thread, &attr, LoadJob_Run, job);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        fclose(file);
+        LoadJob_Free(job);
+        return RTS_ReplyGeneralError(ctx, "TSDB: couldn't start the load");
+    }
+
+    if (currentJob != NULL) {
+        LoadJob_Free(currentJob);
+    }
+    currentJob = job;
+    return RedisModule_ReplyWithSimpleString(ctx, "OK");
+}
+
+int TSDB_load_status(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    if (argc != 1) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (currentJob == NULL) {
+        ReplyWithMapOrArray(ctx, 1 * 2, true);
+        RedisModule_ReplyWithSimpleString(ctx, "state");
+        RedisModule_ReplyWithSimpleString(ctx, "idle");
+        return REDISMODULE_OK;
+    }
+
+    LoadJob *job = currentJob;
+    const int state = __atomic_load_n(&job->state, __ATOMIC_ACQUIRE);
+    const long long end =
+        state == LoadState_Running ? RedisModule_Milliseconds() : LOAD_GET(job->endTime);
+    const long long elapsed = end - job->startTime;
+    const long long samples = LOAD_GET(job->samples);
+
+    ReplyWithMapOrArray(ctx, 13 * 2, true); // 13 fields x 2 (key + value)
+    RedisModule_ReplyWithSimpleString(ctx, "state");
+    RedisModule_ReplyWithSimpleString(ctx, LoadStateNames[state]);
+    RedisModule_ReplyWithSimpleString(ctx, "path");
+    RedisModule_ReplyWithString(ctx, job->path);
+    RedisModule_ReplyWithSimpleString(ctx, "format");
+    RedisModule_ReplyWithSimpleString(ctx, LoadFormatNames[job->format]);
+    RedisModule_ReplyWithSimpleString(ctx, "bytesTotal");
+    RedisModule_ReplyWithLongLong(ctx, job->bytesTotal);
+    RedisModule_ReplyWithSimpleString(ctx, "bytesRead");
+    RedisModule_ReplyWithLongLong(ctx, LOAD_GET(job->bytesRead));
+    RedisModule_ReplyWithSimpleString(ctx, "lines");
+    RedisModule_ReplyWithLongLong(ctx, LOAD_GET(job->lines));
+    RedisModule_ReplyWithSimpleString(ctx, "samples");
+    RedisModule_ReplyWithLongLong(ctx, samples);
+    RedisModule_ReplyWithSimpleString(ctx, "errors");
+    RedisModule_ReplyWithLongLong(ctx, LOAD_GET(job->errors));
+    RedisModule_ReplyWithSimpleString(ctx, "skipped");
+    RedisModule_ReplyWithLongLong(ctx, LOAD_GET(job->skipped));
+    RedisModule_ReplyWithSimpleString(ctx, "seriesCreated");
+    RedisModule_ReplyWithLongLong(ctx, LOAD_GET(job->seriesCreated));
+    RedisModule_ReplyWithSimpleString(ctx, "template");
+    if (job->templateName) {
+        RedisModule_ReplyWithString(ctx, job->templateName);
+    } else {
+        RedisModule_ReplyWithNull(ctx);
+    }
+    RedisModule_ReplyWithSimpleString(ctx, "elapsedMs");
+    RedisModule_ReplyWithLongLong(ctx, elapsed);
+    RedisModule_ReplyWithSimpleString(ctx, "samplesPerSec");
+    RedisModule_ReplyWithLongLong(ctx, elapsed > 0 ? samples * 1000 / elapsed : samples);
+    return REDISMODULE_OK;
+}
+
+int TSDB_load_cancel(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    if (argc != 1) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (currentJob == NULL ||
+        __atomic_load_n(&currentJob->state, __ATOMIC_ACQUIRE) != LoadState_Running) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: no load is running");
+    }
+    // the worker stops before its next line, the samples parsed so far are still applied
+    __atomic_store_n(&currentJob->cancel, true, __ATOMIC_RELAXED);
+    return RedisModule_ReplyWithSimpleString(ctx, "OK");
+}
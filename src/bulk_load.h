@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+#include "RedisModulesSDK/redismodule.h"
+
+// TS.LOAD path FORMAT influx|csv [TEMPLATE name]
+// Loads a local file in a background thread, one load runs at a time
+int TSDB_load(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int TSDB_load_status(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int TSDB_load_cancel(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+
+#endif
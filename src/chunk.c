@@ -9,6 +9,7 @@
 #include "chunk.h"
 #include "common.h"
 #include "enriched_chunk.h"
+#include "fused_aggregation.h"
 
 #include "libmr_integration.h"
 
@@ -198,6 +199,50 @@ ChunkResult Uncompressed_UpsertSample(UpsertCtx *uCtx, int *size, DuplicatePolic
     return CR_OK;
 }
 
+ChunkResult Uncompressed_UpsertSamples(UpsertBatchCtx *uCtx,
+                                       int *size,
+                                       DuplicatePolicy duplicatePolicy) {
+    Chunk *regChunk = (Chunk *)uCtx->inChunk;
+    const Sample *samples = uCtx->samples;
+    const size_t count = uCtx->count;
+    const size_t numSamples = regChunk->num_samples;
+
+    Sample *merged = (Sample *)malloc((numSamples + count) * sizeof(Sample));
+    size_t n = 0, c = 0, i = 0;
+    while (c < numSamples || i < count) {
+        // on a tie the chunk sample goes first, so a batch sample is resolved against it
+        if (c < numSamples &&
+            (i == count || regChunk->samples[c].timestamp <= samples[i].timestamp)) {
+            merged[n++] = regChunk->samples[c++];
+            continue;
+        }
+
+        Sample sample = samples[i];
+        if (n > 0 && merged[n - 1].timestamp == sample.timestamp) {
+            uCtx->results[i] = handleDuplicateSample(duplicatePolicy, merged[n - 1], &sample);
+            if (uCtx->results[i] == CR_OK) {
+                merged[n - 1].value = sample.value;
+            }
+        } else {
+            uCtx->results[i] = CR_OK;
+            merged[n++] = sample;
+        }
+        ++i;
+    }
+
+    // keep the original capacity unless the merged samples outgrew it
+    const size_t newSize = max(regChunk->size, n * SAMPLE_SIZE);
+    free(regChunk->samples);
+    regChunk->samples = realloc(merged, newSize);
+    regChunk->size = newSize;
+    regChunk->num_samples = n;
+    if (n > 0) {
+        regChunk->base_timestamp = regChunk->samples[0].timestamp;
+    }
+    *size = (int)(n - numSamples);
+    return CR_OK;
+}
+
 size_t Uncompressed_DelRange(Chunk_t *chunk, timestamp_t startTs, timestamp_t endTs) {
     Chunk *regChunk = (Chunk *)chunk;
     Sample *newSamples = (Sample *)malloc(regChunk->size);
@@ -245,11 +290,12 @@ void reverseEnrichedChunk(EnrichedChunk *enrichedChunk) {
 void Uncompressed_ProcessChunk(const Chunk_t *chunk,
                                uint64_t start,
                                uint64_t end,
+                               size_t limit,
                                EnrichedChunk *enrichedChunk,
                                bool reverse) {
     const Chunk *_chunk = chunk;
     ResetEnrichedChunk(enrichedChunk);
-    if (unlikely(!_chunk || _chunk->num_samples == 0 || end < start ||
+    if (unlikely(!_chunk || _chunk->num_samples == 0 || end < start || limit == 0 ||
                  _chunk->base_timestamp > end ||
                  _chunk->samples[_chunk->num_samples - 1].timestamp < start)) {
         return;
@@ -269,14 +315,21 @@ void Uncompressed_ProcessChunk(const Chunk_t *chunk,
         return;
     }
 
-    // find end index
-    for (; i < _chunk->num_samples; i++) {
+    // find end index, a forward scan stops after limit samples
+    const size_t scan_end =
+        (!reverse && limit < _chunk->num_samples - si) ? si + limit : _chunk->num_samples;
+    ei = scan_end - 1;
+    for (; i < scan_end; i++) {
         if (_chunk->samples[i].timestamp > end) {
             ei = i - 1;
             break;
         }
     }
 
+    if (unlikely(reverse) && ei - si + 1 > limit) {
+        si = ei - limit + 1;
+    }
+
     enrichedChunk->samples.num_samples = ei - si + 1;
     if (enrichedChunk->samples.num_samples == 0) {
         return;
@@ -299,6 +352,26 @@ void Uncompressed_ProcessChunk(const Chunk_t *chunk,
     return;
 }
 
+void Uncompressed_AggregateRange(const Chunk_t *chunk,
+                                 uint64_t start,
+                                 uint64_t end,
+                                 struct FusedAggregationCtx *ctx) {
+    const Chunk *_chunk = chunk;
+    if (unlikely(!_chunk || _chunk->num_samples == 0 || end < start ||
+                 _chunk->base_timestamp > end ||
+                 _chunk->samples[_chunk->num_samples - 1].timestamp < start)) {
+        return;
+    }
+
+    size_t i = 0;
+    while (_chunk->samples[i].timestamp < start) {
+        i++;
+    }
+    for (; i < _chunk->num_samples && _chunk->samples[i].timestamp <= end; i++) {
+        FusedAggregation_AddSample(ctx, _chunk->samples[i].timestamp, _chunk->samples[i].value);
+    }
+}
+
 size_t Uncompressed_GetChunkSize(const Chunk_t *chunk, bool includeStruct) {
     const Chunk *uncompChunk = chunk;
     size_t size = includeStruct ? RedisModule_MallocSize((void *)uncompChunk) +
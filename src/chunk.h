@@ -55,6 +55,16 @@ ChunkResult Uncompressed_AddSample(Chunk_t *chunk, Sample *sample);
  * @return
  */
 ChunkResult Uncompressed_UpsertSample(UpsertCtx *uCtx, int *size, DuplicatePolicy duplicatePolicy);
+
+/**
+ * Merge a sorted run of samples into the chunk in a single pass.
+ * @param uCtx the chunk, the samples and the per sample results
+ * @param size the number of samples added to the chunk (updates of existing samples are excluded)
+ * @return CR_OK
+ */
+ChunkResult Uncompressed_UpsertSamples(UpsertBatchCtx *uCtx,
+                                       int *size,
+                                       DuplicatePolicy duplicatePolicy);
 size_t Uncompressed_DelRange(Chunk_t *chunk, timestamp_t startTs, timestamp_t endTs);
 
 uint64_t Uncompressed_NumOfSample(Chunk_t *chunk);
@@ -66,8 +76,13 @@ void reverseEnrichedChunk(EnrichedChunk *enrichedChunk);
 void Uncompressed_ProcessChunk(const Chunk_t *chunk,
                                uint64_t start,
                                uint64_t end,
+                               size_t limit,
                                EnrichedChunk *enrichedChunk,
                                bool reverse);
+void Uncompressed_AggregateRange(const Chunk_t *chunk,
+                                 uint64_t start,
+                                 uint64_t end,
+                                 struct FusedAggregationCtx *ctx);
 
 // RDB
 void Uncompressed_SaveToRDB(Chunk_t *chunk, struct RedisModuleIO *io);
@@ -123,6 +123,13 @@ static const RedisModuleCommandArg TS_ADD_ARGS[] = {
               { .name = "ignoreMaxTimediff", .type = REDISMODULE_ARG_TYPE_INTEGER },
               { .name = "ignoreMaxValDiff", .type = REDISMODULE_ARG_TYPE_DOUBLE },
               { 0 } } },
+    { .name = "TEMPLATE",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs = (RedisModuleCommandArg[]){ { .name = "template",
+                                              .type = REDISMODULE_ARG_TYPE_STRING,
+                                              .token = "TEMPLATE" },
+                                            { 0 } } },
     { .name = "LABELS",
       .type = REDISMODULE_ARG_TYPE_BLOCK,
       .flags = REDISMODULE_CMD_ARG_OPTIONAL,
@@ -1259,6 +1266,27 @@ static const RedisModuleCommandInfo TS_QUERYLABELS_INFO = {
     .args = (RedisModuleCommandArg *)TS_QUERYLABELS_ARGS,
 };
 
+// ===============================
+// TS.INDEXSTATS [label]
+// ===============================
+static const RedisModuleCommandArg TS_INDEXSTATS_ARGS[] = {
+    { .name = "label", .type = REDISMODULE_ARG_TYPE_STRING, .flags = REDISMODULE_CMD_ARG_OPTIONAL },
+    { 0 }
+};
+
+static const RedisModuleCommandInfo TS_INDEXSTATS_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Get the statistics of the label index: series and distinct values per label, and "
+               "the values of a label having the most series",
+    .complexity = "O(L) where L is the number of label names, or O(V) where V is the number of "
+                  "distinct values of the given label",
+    .since = "8.10.0",
+    .tips = "dont_cache",
+    .arity = -1,
+    .key_specs = NULL,
+    .args = (RedisModuleCommandArg *)TS_INDEXSTATS_ARGS,
+};
+
 // ===============================
 // TS.INFO key [DEBUG]
 // ===============================
@@ -1328,6 +1356,249 @@ static const RedisModuleCommandInfo TS_MADD_INFO = {
     .args = (RedisModuleCommandArg *)TS_MADD_ARGS,
 };
 
+// ===============================
+// TS.MADDROW timestamp {key value}...
+// ===============================
+static const RedisModuleCommandKeySpec TS_MADDROW_KEYSPECS[] = {
+    { .flags = REDISMODULE_CMD_KEY_RW | REDISMODULE_CMD_KEY_INSERT,
+      .begin_search_type = REDISMODULE_KSPEC_BS_INDEX,
+      .bs.index = { .pos = 2 },
+      .find_keys_type = REDISMODULE_KSPEC_FK_RANGE,
+      .fk.range = { .lastkey = -1, .keystep = 2, .limit = 0 } },
+    { 0 }
+};
+
+static const RedisModuleCommandArg TS_MADDROW_ARGS[] = {
+    { .name = "timestamp", .type = REDISMODULE_ARG_TYPE_STRING }, // unix timestamp (ms) or '*'
+    { .name = "kv",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_MULTIPLE,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "key", .type = REDISMODULE_ARG_TYPE_KEY, .key_spec_index = 0 },
+              { .name = "value", .type = REDISMODULE_ARG_TYPE_DOUBLE },
+              { 0 } } },
+    { 0 }
+};
+
+static const RedisModuleCommandInfo TS_MADDROW_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Append samples sharing one timestamp to one or more time series",
+    .complexity = "O(N*M) when N is the amount of series updated and M is the amount of compaction "
+                  "rules or O(N) with no compaction",
+    .since = "8.10.0",
+    .arity = -4,
+    .key_specs = (RedisModuleCommandKeySpec *)TS_MADDROW_KEYSPECS,
+    .args = (RedisModuleCommandArg *)TS_MADDROW_ARGS,
+};
+
+// ===============================
+// TS.BACKFILL key [ON_DUPLICATE policy] {timestamp value}...
+// ===============================
+static const RedisModuleCommandKeySpec TS_BACKFILL_KEYSPECS[] = {
+    { .flags = REDISMODULE_CMD_KEY_RW | REDISMODULE_CMD_KEY_UPDATE,
+      .begin_search_type = REDISMODULE_KSPEC_BS_INDEX,
+      .bs.index = { .pos = 1 },
+      .find_keys_type = REDISMODULE_KSPEC_FK_RANGE,
+      .fk.range = { .lastkey = 0, .keystep = 1, .limit = 0 } },
+    { 0 }
+};
+
+static const RedisModuleCommandArg TS_BACKFILL_ARGS[] = {
+    { .name = "key", .type = REDISMODULE_ARG_TYPE_KEY, .key_spec_index = 0 },
+    { .name = "ON_DUPLICATE",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs = (RedisModuleCommandArg[]){ { .name = "ON_DUPLICATE",
+                                              .type = REDISMODULE_ARG_TYPE_PURE_TOKEN,
+                                              .token = "ON_DUPLICATE" },
+                                            { .name = "policy_ovr",
+                                              .type = REDISMODULE_ARG_TYPE_ONEOF,
+                                              .subargs = (RedisModuleCommandArg *)POLICY_OPTIONS },
+                                            { 0 } } },
+    { .name = "tv",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_MULTIPLE,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "timestamp", .type = REDISMODULE_ARG_TYPE_INTEGER },
+              { .name = "value", .type = REDISMODULE_ARG_TYPE_DOUBLE },
+              { 0 } } },
+    { 0 }
+};
+
+static const RedisModuleCommandInfo TS_BACKFILL_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Write a batch of historical samples to a time series",
+    .complexity = "O(N+C) where N is the number of samples and C is the number of samples in the "
+                  "chunks they fall into",
+    .since = "8.10.0",
+    .arity = -4,
+    .key_specs = (RedisModuleCommandKeySpec *)TS_BACKFILL_KEYSPECS,
+    .args = (RedisModuleCommandArg *)TS_BACKFILL_ARGS,
+};
+
+// ===============================
+// TS.TEMPLATE.CREATE name [RETENTION retentionPeriod] [ENCODING <COMPRESSED|UNCOMPRESSED>]
+//  [CHUNK_SIZE size] [DUPLICATE_POLICY policy] [IGNORE ignoreMaxTimediff ignoreMaxValDiff]
+//  [RULES policy] [LABELS label value..]
+// ===============================
+static const RedisModuleCommandArg TS_TEMPLATE_CREATE_ARGS[] = {
+    { .name = "name", .type = REDISMODULE_ARG_TYPE_STRING },
+    { .name = "RETENTION",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs = (RedisModuleCommandArg[]){ { .name = "retentionPeriod",
+                                              .type = REDISMODULE_ARG_TYPE_INTEGER,
+                                              .token = "RETENTION" },
+                                            { 0 } } },
+    { .name = "ENCODING",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "ENCODING", .type = REDISMODULE_ARG_TYPE_PURE_TOKEN, .token = "ENCODING" },
+              { .name = "enc",
+                .type = REDISMODULE_ARG_TYPE_ONEOF,
+                .subargs = (RedisModuleCommandArg *)ENCODING_OPTIONS },
+              { 0 } } },
+    { .name = "CHUNK_SIZE",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "size", .type = REDISMODULE_ARG_TYPE_INTEGER, .token = "CHUNK_SIZE" },
+              { 0 } } },
+    { .name = "DUPLICATE_POLICY",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs = (RedisModuleCommandArg[]){ { .name = "DUPLICATE_POLICY",
+                                              .type = REDISMODULE_ARG_TYPE_PURE_TOKEN,
+                                              .token = "DUPLICATE_POLICY" },
+                                            { .name = "policy",
+                                              .type = REDISMODULE_ARG_TYPE_ONEOF,
+                                              .subargs = (RedisModuleCommandArg *)POLICY_OPTIONS },
+                                            { 0 } } },
+    { .name = "IGNORE",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "IGNORE", .type = REDISMODULE_ARG_TYPE_PURE_TOKEN, .token = "IGNORE" },
+              { .name = "ignoreMaxTimediff", .type = REDISMODULE_ARG_TYPE_INTEGER },
+              { .name = "ignoreMaxValDiff", .type = REDISMODULE_ARG_TYPE_DOUBLE },
+              { 0 } } },
+    { .name = "RULES",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "policy", .type = REDISMODULE_ARG_TYPE_STRING, .token = "RULES" },
+              { 0 } } },
+    { .name = "LABELS",
+      .type = REDISMODULE_ARG_TYPE_BLOCK,
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL,
+      .subargs =
+          (RedisModuleCommandArg[]){
+              { .name = "LABELS", .type = REDISMODULE_ARG_TYPE_PURE_TOKEN, .token = "LABELS" },
+              { .name = "label-value",
+                .type = REDISMODULE_ARG_TYPE_BLOCK,
+                .flags = REDISMODULE_CMD_ARG_MULTIPLE,
+                .subargs =
+                    (RedisModuleCommandArg[]){
+                        { .name = "label", .type = REDISMODULE_ARG_TYPE_STRING },
+                        { .name = "value", .type = REDISMODULE_ARG_TYPE_STRING },
+                        { 0 } } },
+              { 0 } } },
+    { 0 }
+};
+
+static const RedisModuleCommandInfo TS_TEMPLATE_CREATE_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Create a named template for series created on their first write",
+    .complexity = "O(L+R) where L is the number of labels and R the number of compaction rules",
+    .since = "8.10.0",
+    .tips = "request_policy:all_shards",
+    .arity = -2,
+    .key_specs = NULL, // No key specs - templates are not keys
+    .args = (RedisModuleCommandArg *)TS_TEMPLATE_CREATE_ARGS,
+};
+
+// ===============================
+// TS.TEMPLATE.DEL name
+// ===============================
+static const RedisModuleCommandArg TS_TEMPLATE_DEL_ARGS[] = {
+    { .name = "name", .type = REDISMODULE_ARG_TYPE_STRING },
+    { 0 }
+};
+
+static const RedisModuleCommandInfo TS_TEMPLATE_DEL_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Delete a series template",
+    .complexity = "O(L+R) where L is the number of labels and R the number of compaction rules",
+    .since = "8.10.0",
+    .tips = "request_policy:all_shards",
+    .arity = 2,
+    .key_specs = NULL, // No key specs - templates are not keys
+    .args = (RedisModuleCommandArg *)TS_TEMPLATE_DEL_ARGS,
+};
+
+// ===============================
+// TS.LOAD path FORMAT influx|csv [TEMPLATE name]
+// ===============================
+static const RedisModuleCommandArg LOAD_FORMAT_OPTIONS[] = {
+    { .name = "influx", .type = REDISMODULE_ARG_TYPE_PURE_TOKEN, .token = "INFLUX" },
+    { .name = "csv", .type = REDISMODULE_ARG_TYPE_PURE_TOKEN, .token = "CSV" },
+    { 0 }
+};
+
+static const RedisModuleCommandArg TS_LOAD_ARGS[] = {
+    { .name = "path", .type = REDISMODULE_ARG_TYPE_STRING },
+    { .name = "format",
+      .type = REDISMODULE_ARG_TYPE_ONEOF,
+      .token = "FORMAT",
+      .subargs = (RedisModuleCommandArg *)LOAD_FORMAT_OPTIONS },
+    { .name = "template",
+      .type = REDISMODULE_ARG_TYPE_STRING,
+      .token = "TEMPLATE",
+      .flags = REDISMODULE_CMD_ARG_OPTIONAL },
+    { 0 }
+};
+
+static const RedisModuleCommandInfo TS_LOAD_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Load samples from a local file in the background",
+    .complexity = "O(N) where N is the number of samples in the file",
+    .since = "8.10.0",
+    .arity = -4,
+    .key_specs = NULL, // No key specs - the keys are read from the file
+    .args = (RedisModuleCommandArg *)TS_LOAD_ARGS,
+};
+
+// ===============================
+// TS.LOAD.STATUS
+// ===============================
+static const RedisModuleCommandInfo TS_LOAD_STATUS_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Report the progress of the running or the last load",
+    .complexity = "O(1)",
+    .since = "8.10.0",
+    .arity = 1,
+    .key_specs = NULL,
+};
+
+// ===============================
+// TS.LOAD.CANCEL
+// ===============================
+static const RedisModuleCommandInfo TS_LOAD_CANCEL_INFO = {
+    .version = REDISMODULE_COMMAND_INFO_VERSION,
+    .summary = "Cancel the running load",
+    .complexity = "O(1)",
+    .since = "8.10.0",
+    .arity = 1,
+    .key_specs = NULL,
+};
+
 // ===============================
 // TS.MGET [LATEST] [WITHLABELS | SELECTED_LABELS label...] FILTER filterExpr...
 // ===============================
@@ -1771,6 +2042,12 @@ int RegisterTSCommandInfos(RedisModuleCtx *ctx) {
         RedisModule_SetCommandInfo(cmd_querylabels, &TS_QUERYLABELS_INFO) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
+    // Register TS.INDEXSTATS command info
+    RedisModuleCommand *cmd_indexstats = RedisModule_GetCommand(ctx, "TS.INDEXSTATS");
+    if (!cmd_indexstats ||
+        RedisModule_SetCommandInfo(cmd_indexstats, &TS_INDEXSTATS_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
     // Register TS.INFO command info
     RedisModuleCommand *cmd_info = RedisModule_GetCommand(ctx, "TS.INFO");
     if (!cmd_info || RedisModule_SetCommandInfo(cmd_info, &TS_INFO_INFO) == REDISMODULE_ERR)
@@ -1781,6 +2058,48 @@ int RegisterTSCommandInfos(RedisModuleCtx *ctx) {
     if (!cmd_madd || RedisModule_SetCommandInfo(cmd_madd, &TS_MADD_INFO) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
+    // Register TS.MADDROW command info
+    RedisModuleCommand *cmd_maddrow = RedisModule_GetCommand(ctx, "TS.MADDROW");
+    if (!cmd_maddrow ||
+        RedisModule_SetCommandInfo(cmd_maddrow, &TS_MADDROW_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    // Register TS.BACKFILL command info
+    RedisModuleCommand *cmd_backfill = RedisModule_GetCommand(ctx, "TS.BACKFILL");
+    if (!cmd_backfill ||
+        RedisModule_SetCommandInfo(cmd_backfill, &TS_BACKFILL_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    // Register TS.TEMPLATE.CREATE command info
+    RedisModuleCommand *cmd_template_create = RedisModule_GetCommand(ctx, "TS.TEMPLATE.CREATE");
+    if (!cmd_template_create ||
+        RedisModule_SetCommandInfo(cmd_template_create, &TS_TEMPLATE_CREATE_INFO) ==
+            REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    // Register TS.TEMPLATE.DEL command info
+    RedisModuleCommand *cmd_template_del = RedisModule_GetCommand(ctx, "TS.TEMPLATE.DEL");
+    if (!cmd_template_del ||
+        RedisModule_SetCommandInfo(cmd_template_del, &TS_TEMPLATE_DEL_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    // Register TS.LOAD command info
+    RedisModuleCommand *cmd_load = RedisModule_GetCommand(ctx, "TS.LOAD");
+    if (!cmd_load || RedisModule_SetCommandInfo(cmd_load, &TS_LOAD_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    // Register TS.LOAD.STATUS command info
+    RedisModuleCommand *cmd_load_status = RedisModule_GetCommand(ctx, "TS.LOAD.STATUS");
+    if (!cmd_load_status ||
+        RedisModule_SetCommandInfo(cmd_load_status, &TS_LOAD_STATUS_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    // Register TS.LOAD.CANCEL command info
+    RedisModuleCommand *cmd_load_cancel = RedisModule_GetCommand(ctx, "TS.LOAD.CANCEL");
+    if (!cmd_load_cancel ||
+        RedisModule_SetCommandInfo(cmd_load_cancel, &TS_LOAD_CANCEL_INFO) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
     // Register TS.MGET command info
     RedisModuleCommand *cmd_mget = RedisModule_GetCommand(ctx, "TS.MGET");
     if (!cmd_mget || RedisModule_SetCommandInfo(cmd_mget, &TS_MGET_INFO) == REDISMODULE_ERR)
@@ -15,6 +15,7 @@
 #include "compactions/compaction_common.h"
 #include "compactions/compaction_avx512f.h"
 #include "compactions/compaction_avx2.h"
+#include "compactions/compaction_neon.h"
 #include "utils/arch_features.h"
 
 #include <ctype.h>
@@ -34,21 +35,6 @@ typedef struct FirstValueContext
     timestamp_t ts; /* in-memory only; tracks oldest sample seen */
 } FirstValueContext;
 
-typedef struct SingleValueContext
-{
-    double value;
-    timestamp_t ts;    /* in-memory only; tracks newest sample seen */
-    bool fresh_bucket; /* in-memory only; lets reverse-mode reset across buckets without losing LOCF
-                        */
-} SingleValueContext;
-
-typedef struct AvgContext
-{
-    double val;
-    double cnt;
-    bool isOverflow;
-} AvgContext;
-
 typedef struct TwaContext
 {
     double res;
@@ -63,13 +49,6 @@ typedef struct TwaContext
     int64_t iteration;
 } TwaContext;
 
-typedef struct StdContext
-{
-    double sum;
-    double sum_2; // sum of (values^2)
-    uint64_t cnt;
-} StdContext;
-
 void finalize_empty_with_NAN(__unused void *contextPtr, double *value) {
     *value = NAN;
 }
@@ -261,6 +240,17 @@ void AvgAddValue(void *contextPtr, double value, __attribute__((unused)) timesta
     }
 }
 
+void AvgAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei) {
+    for (size_t i = si; i <= ei; ++i) {
+        if (!isnan(values[i])) {
+            AvgAddValue(context, values[i], 0);
+        }
+    }
+}
+
 int AvgFinalize(void *contextPtr, double *value) {
     AvgContext *context = (AvgContext *)contextPtr;
     if (unlikely(context->cnt == 0)) {
@@ -479,6 +469,17 @@ void StdAddValue(void *contextPtr, double value, __attribute__((unused)) timesta
     context->sum_2 += value * value;
 }
 
+void StdAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei) {
+    for (size_t i = si; i <= ei; ++i) {
+        if (!isnan(values[i])) {
+            StdAddValue(context, values[i], 0);
+        }
+    }
+}
+
 static inline double variance(double sum, double sum_2, double count) {
     if (count == 0) {
         return 0;
@@ -715,6 +716,15 @@ void MinAppendValue(void *contextPtr, double value, __attribute__((unused)) time
     }
 }
 
+void MinAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei) {
+    for (size_t i = si; i <= ei; ++i) {
+        _AssignIfSmaller(&((MaxMinContext *)context)->minValue, &values[i]);
+    }
+}
+
 void MaxMinAppendValue(void *contextPtr, double value, __attribute__((unused)) timestamp_t ts) {
     MaxMinContext *context = (MaxMinContext *)contextPtr;
     if (value > context->maxValue) {
@@ -725,6 +735,17 @@ void MaxMinAppendValue(void *contextPtr, double value, __attribute__((unused)) t
     }
 }
 
+void RangeAppendValuesVec(void *__restrict__ context,
+                          double *__restrict__ values,
+                          size_t si,
+                          size_t ei) {
+    MaxMinContext *maxMin = (MaxMinContext *)context;
+    for (size_t i = si; i <= ei; ++i) {
+        _AssignIfGreater(&maxMin->maxValue, &values[i]);
+        _AssignIfSmaller(&maxMin->minValue, &values[i]);
+    }
+}
+
 int MaxFinalize(void *contextPtr, double *value) {
     MaxMinContext *context = (MaxMinContext *)contextPtr;
     *value = context->maxValue;
@@ -778,6 +799,47 @@ void CountAppendValue(void *contextPtr, double value, __attribute__((unused)) ti
     context->value++;
 }
 
+void SumAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei) {
+    SingleValueContext *sum = (SingleValueContext *)context;
+    for (size_t i = si; i <= ei; ++i) {
+        if (!isnan(values[i])) {
+            sum->value += values[i];
+        }
+    }
+}
+
+void CountAppendValuesVec(void *__restrict__ context,
+                          double *__restrict__ values,
+                          size_t si,
+                          size_t ei) {
+    size_t count = 0;
+    for (size_t i = si; i <= ei; ++i) {
+        count += !isnan(values[i]);
+    }
+    ((SingleValueContext *)context)->value += count;
+}
+
+void CountNaNAppendValuesVec(void *__restrict__ context,
+                             double *__restrict__ values,
+                             size_t si,
+                             size_t ei) {
+    size_t count = 0;
+    for (size_t i = si; i <= ei; ++i) {
+        count += isnan(values[i]) != 0;
+    }
+    ((SingleValueContext *)context)->value += count;
+}
+
+void CountAllAppendValuesVec(void *__restrict__ context,
+                             __unused double *__restrict__ values,
+                             size_t si,
+                             size_t ei) {
+    ((SingleValueContext *)context)->value += ei - si + 1;
+}
+
 int CountFinalize(void *contextPtr, double *val) {
     FirstValueContext *context = (FirstValueContext *)contextPtr;
     *val = context->value;
@@ -978,10 +1040,21 @@ static AggregationClass aggCountAll = {
 };
 
 void initGlobalCompactionFunctions() {
-    const X86Features *features = getArchitectureOptimization();
     aggMax.appendValueVec = MaxAppendValuesVec;
+    aggMin.appendValueVec = MinAppendValuesVec;
+    aggRange.appendValueVec = RangeAppendValuesVec;
+    aggSum.appendValueVec = SumAppendValuesVec;
+    aggAvg.appendValueVec = AvgAppendValuesVec;
+    aggStdP.appendValueVec = StdAppendValuesVec;
+    aggStdS.appendValueVec = StdAppendValuesVec;
+    aggVarP.appendValueVec = StdAppendValuesVec;
+    aggVarS.appendValueVec = StdAppendValuesVec;
+    aggCount.appendValueVec = CountAppendValuesVec;
+    aggCountNaN.appendValueVec = CountNaNAppendValuesVec;
+    aggCountAll.appendValueVec = CountAllAppendValuesVec;
 
 #if defined(__x86_64__)
+    const X86Features *features = getArchitectureOptimization();
     if (!features) {
         return;
         /* remove this comment to enable avx512
@@ -991,6 +1064,33 @@ void initGlobalCompactionFunctions() {
         }*/
     } else if (features->avx2) {
         aggMax.appendValueVec = MaxAppendValuesAVX2;
+        aggMin.appendValueVec = MinAppendValuesAVX2;
+        aggRange.appendValueVec = RangeAppendValuesAVX2;
+        aggSum.appendValueVec = SumAppendValuesAVX2;
+        aggAvg.appendValueVec = AvgAppendValuesAVX2;
+        aggStdP.appendValueVec = StdAppendValuesAVX2;
+        aggStdS.appendValueVec = StdAppendValuesAVX2;
+        aggVarP.appendValueVec = StdAppendValuesAVX2;
+        aggVarS.appendValueVec = StdAppendValuesAVX2;
+        aggCount.appendValueVec = CountAppendValuesAVX2;
+        aggCountNaN.appendValueVec = CountNaNAppendValuesAVX2;
+        return;
+    }
+#elif defined(__aarch64__)
+    // SVE capable cores implement NEON as well, no SVE specific kernels yet
+    const Aarch64Features *features = getAarch64ArchitectureOptimization();
+    if (features && features->asimd) {
+        aggMax.appendValueVec = MaxAppendValuesNEON;
+        aggMin.appendValueVec = MinAppendValuesNEON;
+        aggRange.appendValueVec = RangeAppendValuesNEON;
+        aggSum.appendValueVec = SumAppendValuesNEON;
+        aggAvg.appendValueVec = AvgAppendValuesNEON;
+        aggStdP.appendValueVec = StdAppendValuesNEON;
+        aggStdS.appendValueVec = StdAppendValuesNEON;
+        aggVarP.appendValueVec = StdAppendValuesNEON;
+        aggVarS.appendValueVec = StdAppendValuesNEON;
+        aggCount.appendValueVec = CountAppendValuesNEON;
+        aggCountNaN.appendValueVec = CountNaNAppendValuesNEON;
         return;
     }
 #endif // __x86_64__
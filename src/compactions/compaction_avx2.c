@@ -49,3 +49,204 @@ void MaxAppendValuesAVX2(void *__restrict__ context,
 
     return;
 }
+
+// Below VECTOR_SIZE_AVX2 * 2 samples the portable implementations are used.
+// Lane-parallel sums add the samples in a different order than the scalar appendValue, so SUM,
+// AVG, VAR and STD may differ from it in the last bits. Comparisons and counts are exact.
+
+static really_inline __m256d _NotNaNMask(__m256d values) {
+    return _mm256_cmp_pd(values, values, _CMP_ORD_Q);
+}
+
+static really_inline double _HorizontalSum(__m256d vec) {
+    __m128d low = _mm256_castpd256_pd128(vec);
+    __m128d high = _mm256_extractf128_pd(vec, 1);
+    low = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(low) + _mm_cvtsd_f64(_mm_unpackhi_pd(low, low));
+}
+
+void MinAppendValuesAVX2(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < VECTOR_SIZE_AVX2 * 2) {
+        MinAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    double *res = &((MaxMinContext *)context)->minValue;
+    // _mm256_min_pd returns its second operand when either is NaN, so NaN samples are skipped
+    __m256d res_avx = _mm256_set1_pd(*res);
+    for (; si + VECTOR_SIZE_AVX2 <= ei + 1; si += VECTOR_SIZE_AVX2) {
+        res_avx = _mm256_min_pd(_mm256_loadu_pd(&values[si]), res_avx);
+    }
+
+    double vec[VECTOR_SIZE_AVX2];
+    _mm256_storeu_pd(vec, res_avx);
+    for (int i = 0; i < VECTOR_SIZE_AVX2; ++i) {
+        _AssignIfSmaller(res, &vec[i]);
+    }
+    for (; si <= ei; ++si) {
+        _AssignIfSmaller(res, &values[si]);
+    }
+}
+
+void RangeAppendValuesAVX2(void *__restrict__ context,
+                           double *__restrict__ values,
+                           size_t si,
+                           size_t ei) {
+    if ((ei - si + 1) < VECTOR_SIZE_AVX2 * 2) {
+        RangeAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    MaxMinContext *maxMin = (MaxMinContext *)context;
+    __m256d max_avx = _mm256_set1_pd(maxMin->maxValue);
+    __m256d min_avx = _mm256_set1_pd(maxMin->minValue);
+    for (; si + VECTOR_SIZE_AVX2 <= ei + 1; si += VECTOR_SIZE_AVX2) {
+        __m256d values_avx = _mm256_loadu_pd(&values[si]);
+        max_avx = _mm256_max_pd(values_avx, max_avx);
+        min_avx = _mm256_min_pd(values_avx, min_avx);
+    }
+
+    double max_vec[VECTOR_SIZE_AVX2], min_vec[VECTOR_SIZE_AVX2];
+    _mm256_storeu_pd(max_vec, max_avx);
+    _mm256_storeu_pd(min_vec, min_avx);
+    for (int i = 0; i < VECTOR_SIZE_AVX2; ++i) {
+        _AssignIfGreater(&maxMin->maxValue, &max_vec[i]);
+        _AssignIfSmaller(&maxMin->minValue, &min_vec[i]);
+    }
+    for (; si <= ei; ++si) {
+        _AssignIfGreater(&maxMin->maxValue, &values[si]);
+        _AssignIfSmaller(&maxMin->minValue, &values[si]);
+    }
+}
+
+// Sums the non NaN values of [si, ei] and returns their number, *si is left on the remainder.
+// sum_2 (sum of squares) and abs_sum (sum of absolute values) are optional.
+static really_inline size_t _SumNotNaN(const double *__restrict__ values,
+                                       size_t *si,
+                                       size_t ei,
+                                       double *sum,
+                                       double *sum_2,
+                                       double *abs_sum) {
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    __m256d sum_avx = _mm256_setzero_pd();
+    __m256d sum_2_avx = _mm256_setzero_pd();
+    __m256d abs_sum_avx = _mm256_setzero_pd();
+    size_t count = 0;
+    for (; *si + VECTOR_SIZE_AVX2 <= ei + 1; *si += VECTOR_SIZE_AVX2) {
+        __m256d values_avx = _mm256_loadu_pd(&values[*si]);
+        __m256d mask = _NotNaNMask(values_avx);
+        values_avx = _mm256_and_pd(values_avx, mask);
+        sum_avx = _mm256_add_pd(sum_avx, values_avx);
+        if (sum_2) {
+            sum_2_avx = _mm256_add_pd(sum_2_avx, _mm256_mul_pd(values_avx, values_avx));
+        }
+        if (abs_sum) {
+            abs_sum_avx = _mm256_add_pd(abs_sum_avx, _mm256_andnot_pd(sign_bit, values_avx));
+        }
+        count += __builtin_popcount(_mm256_movemask_pd(mask));
+    }
+    *sum = _HorizontalSum(sum_avx);
+    if (sum_2) {
+        *sum_2 = _HorizontalSum(sum_2_avx);
+    }
+    if (abs_sum) {
+        *abs_sum = _HorizontalSum(abs_sum_avx);
+    }
+    return count;
+}
+
+void SumAppendValuesAVX2(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < VECTOR_SIZE_AVX2 * 2) {
+        SumAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    double sum;
+    _SumNotNaN(values, &si, ei, &sum, NULL, NULL);
+    ((SingleValueContext *)context)->value += sum;
+    if (si <= ei) {
+        SumAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void AvgAppendValuesAVX2(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    AvgContext *avg = (AvgContext *)context;
+    if ((ei - si + 1) < VECTOR_SIZE_AVX2 * 2 || avg->isOverflow) {
+        AvgAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    const size_t start = si;
+    double sum, abs_sum;
+    const size_t count = _SumNotNaN(values, &si, ei, &sum, NULL, &abs_sum);
+    if (unlikely(!(fabs(avg->val) + abs_sum <= DBL_MAX))) {
+        // the running sum may overflow in some order, AvgAddValue then switches to the long double
+        // running average
+        AvgAppendValuesVec(context, values, start, ei);
+        return;
+    }
+    avg->val += sum;
+    avg->cnt += count;
+    if (si <= ei) {
+        AvgAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void StdAppendValuesAVX2(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < VECTOR_SIZE_AVX2 * 2) {
+        StdAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    StdContext *std = (StdContext *)context;
+    double sum, sum_2;
+    std->cnt += _SumNotNaN(values, &si, ei, &sum, &sum_2, NULL);
+    std->sum += sum;
+    std->sum_2 += sum_2;
+    if (si <= ei) {
+        StdAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void CountAppendValuesAVX2(void *__restrict__ context,
+                           double *__restrict__ values,
+                           size_t si,
+                           size_t ei) {
+    size_t count = 0;
+    for (; si + VECTOR_SIZE_AVX2 <= ei + 1; si += VECTOR_SIZE_AVX2) {
+        __m256d mask = _NotNaNMask(_mm256_loadu_pd(&values[si]));
+        count += __builtin_popcount(_mm256_movemask_pd(mask));
+    }
+    ((SingleValueContext *)context)->value += count;
+    if (si <= ei) {
+        CountAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void CountNaNAppendValuesAVX2(void *__restrict__ context,
+                              double *__restrict__ values,
+                              size_t si,
+                              size_t ei) {
+    size_t count = 0;
+    for (; si + VECTOR_SIZE_AVX2 <= ei + 1; si += VECTOR_SIZE_AVX2) {
+        __m256d values_avx = _mm256_loadu_pd(&values[si]);
+        __m256d mask = _mm256_cmp_pd(values_avx, values_avx, _CMP_UNORD_Q);
+        count += __builtin_popcount(_mm256_movemask_pd(mask));
+    }
+    ((SingleValueContext *)context)->value += count;
+    if (si <= ei) {
+        CountNaNAppendValuesVec(context, values, si, ei);
+    }
+}
@@ -29,6 +29,28 @@ typedef struct MaxMinContext
     double maxValue;
 } MaxMinContext;
 
+typedef struct SingleValueContext
+{
+    double value;
+    timestamp_t ts;    /* in-memory only; tracks newest sample seen */
+    bool fresh_bucket; /* in-memory only; lets reverse-mode reset across buckets without losing LOCF
+                        */
+} SingleValueContext;
+
+typedef struct AvgContext
+{
+    double val;
+    double cnt;
+    bool isOverflow;
+} AvgContext;
+
+typedef struct StdContext
+{
+    double sum;
+    double sum_2; // sum of (values^2)
+    uint64_t cnt;
+} StdContext;
+
 static really_inline void _AssignIfGreater(double *__restrict__ value, double *__restrict__ newValues)
 {
     if(*newValues > *value) {
@@ -36,10 +58,52 @@ static really_inline void _AssignIfGreater(double *__restrict__ value, double *_
     }
 }
 
+static really_inline void _AssignIfSmaller(double *__restrict__ value, double *__restrict__ newValues)
+{
+    if(*newValues < *value) {
+        *value = *newValues;
+    }
+}
+
+void AvgAddValue(void *contextPtr, double value, timestamp_t ts);
+
+// Portable appendValueVec implementations, NaN samples are skipped unless counted
 void MaxAppendValuesVec(void *__restrict__ context,
                         double *__restrict__ values,
                         size_t si,
                         size_t ei);
+void MinAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei);
+void RangeAppendValuesVec(void *__restrict__ context,
+                          double *__restrict__ values,
+                          size_t si,
+                          size_t ei);
+void SumAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei);
+void AvgAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei);
+void StdAppendValuesVec(void *__restrict__ context,
+                        double *__restrict__ values,
+                        size_t si,
+                        size_t ei);
+void CountAppendValuesVec(void *__restrict__ context,
+                          double *__restrict__ values,
+                          size_t si,
+                          size_t ei);
+void CountNaNAppendValuesVec(void *__restrict__ context,
+                             double *__restrict__ values,
+                             size_t si,
+                             size_t ei);
+void CountAllAppendValuesVec(void *__restrict__ context,
+                             double *__restrict__ values,
+                             size_t si,
+                             size_t ei);
 
 static really_inline bool is_aligned(void *p, int N)
 {
@@ -0,0 +1,234 @@
+#include "compaction_common.h"
+#include <arm_neon.h>
+
+// Advanced SIMD is part of the ARMv8-A baseline, so unlike the x86 kernels this file is built
+// without extra compiler flags. The loops handle two vectors per iteration to keep two
+// independent dependency chains in flight.
+#define VECTOR_SIZE_NEON (sizeof(float64x2_t) / sizeof(double))
+#define BLOCK_SIZE_NEON (VECTOR_SIZE_NEON * 2)
+
+// Below BLOCK_SIZE_NEON * 2 samples the portable implementations are used.
+// Lane-parallel sums add the samples in a different order than the scalar appendValue, so SUM,
+// AVG, VAR and STD may differ from it in the last bits. Comparisons and counts are exact.
+
+// All ones in the lanes that are not NaN
+static really_inline uint64x2_t _NotNaNMask(float64x2_t values) {
+    return vceqq_f64(values, values);
+}
+
+static really_inline float64x2_t _ZeroMasked(float64x2_t values, uint64x2_t mask) {
+    return vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(values), mask));
+}
+
+// Counts the not NaN values of [*si, ei] in whole blocks, *si is left on the remainder
+static really_inline size_t _CountNotNaN(const double *__restrict__ values, size_t *si, size_t ei) {
+    uint64x2_t count = vdupq_n_u64(0);
+    for (; *si + BLOCK_SIZE_NEON <= ei + 1; *si += BLOCK_SIZE_NEON) {
+        uint64x2_t mask0 = _NotNaNMask(vld1q_f64(&values[*si]));
+        uint64x2_t mask1 = _NotNaNMask(vld1q_f64(&values[*si + VECTOR_SIZE_NEON]));
+        // a set lane is -1, so subtracting the masks counts them
+        count = vsubq_u64(count, vaddq_u64(mask0, mask1));
+    }
+    return vaddvq_u64(count);
+}
+
+void MaxAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < BLOCK_SIZE_NEON * 2) {
+        MaxAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    double *res = &((MaxMinContext *)context)->maxValue;
+    // vmaxnmq_f64 returns the number when the other operand is a quiet NaN, so NaN samples are
+    // skipped
+    float64x2_t res0 = vdupq_n_f64(*res);
+    float64x2_t res1 = res0;
+    for (; si + BLOCK_SIZE_NEON <= ei + 1; si += BLOCK_SIZE_NEON) {
+        res0 = vmaxnmq_f64(res0, vld1q_f64(&values[si]));
+        res1 = vmaxnmq_f64(res1, vld1q_f64(&values[si + VECTOR_SIZE_NEON]));
+    }
+    *res = vmaxnmvq_f64(vmaxnmq_f64(res0, res1));
+    for (; si <= ei; ++si) {
+        _AssignIfGreater(res, &values[si]);
+    }
+}
+
+void MinAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < BLOCK_SIZE_NEON * 2) {
+        MinAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    double *res = &((MaxMinContext *)context)->minValue;
+    float64x2_t res0 = vdupq_n_f64(*res);
+    float64x2_t res1 = res0;
+    for (; si + BLOCK_SIZE_NEON <= ei + 1; si += BLOCK_SIZE_NEON) {
+        res0 = vminnmq_f64(res0, vld1q_f64(&values[si]));
+        res1 = vminnmq_f64(res1, vld1q_f64(&values[si + VECTOR_SIZE_NEON]));
+    }
+    *res = vminnmvq_f64(vminnmq_f64(res0, res1));
+    for (; si <= ei; ++si) {
+        _AssignIfSmaller(res, &values[si]);
+    }
+}
+
+void RangeAppendValuesNEON(void *__restrict__ context,
+                           double *__restrict__ values,
+                           size_t si,
+                           size_t ei) {
+    if ((ei - si + 1) < BLOCK_SIZE_NEON * 2) {
+        RangeAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    MaxMinContext *maxMin = (MaxMinContext *)context;
+    float64x2_t max0 = vdupq_n_f64(maxMin->maxValue);
+    float64x2_t max1 = max0;
+    float64x2_t min0 = vdupq_n_f64(maxMin->minValue);
+    float64x2_t min1 = min0;
+    for (; si + BLOCK_SIZE_NEON <= ei + 1; si += BLOCK_SIZE_NEON) {
+        float64x2_t values0 = vld1q_f64(&values[si]);
+        float64x2_t values1 = vld1q_f64(&values[si + VECTOR_SIZE_NEON]);
+        max0 = vmaxnmq_f64(max0, values0);
+        max1 = vmaxnmq_f64(max1, values1);
+        min0 = vminnmq_f64(min0, values0);
+        min1 = vminnmq_f64(min1, values1);
+    }
+    maxMin->maxValue = vmaxnmvq_f64(vmaxnmq_f64(max0, max1));
+    maxMin->minValue = vminnmvq_f64(vminnmq_f64(min0, min1));
+    for (; si <= ei; ++si) {
+        _AssignIfGreater(&maxMin->maxValue, &values[si]);
+        _AssignIfSmaller(&maxMin->minValue, &values[si]);
+    }
+}
+
+// Sums the non NaN values of [si, ei] and returns their number, *si is left on the remainder.
+// sum_2 (sum of squares) and abs_sum (sum of absolute values) are optional.
+static really_inline size_t _SumNotNaN(const double *__restrict__ values,
+                                       size_t *si,
+                                       size_t ei,
+                                       double *sum,
+                                       double *sum_2,
+                                       double *abs_sum) {
+    const float64x2_t zero = vdupq_n_f64(0);
+    float64x2_t sum0 = zero, sum1 = zero;
+    float64x2_t sum_2_0 = zero, sum_2_1 = zero;
+    float64x2_t abs_sum0 = zero, abs_sum1 = zero;
+    uint64x2_t count = vdupq_n_u64(0);
+    for (; *si + BLOCK_SIZE_NEON <= ei + 1; *si += BLOCK_SIZE_NEON) {
+        float64x2_t values0 = vld1q_f64(&values[*si]);
+        float64x2_t values1 = vld1q_f64(&values[*si + VECTOR_SIZE_NEON]);
+        uint64x2_t mask0 = _NotNaNMask(values0);
+        uint64x2_t mask1 = _NotNaNMask(values1);
+        values0 = _ZeroMasked(values0, mask0);
+        values1 = _ZeroMasked(values1, mask1);
+        sum0 = vaddq_f64(sum0, values0);
+        sum1 = vaddq_f64(sum1, values1);
+        if (sum_2) {
+            sum_2_0 = vfmaq_f64(sum_2_0, values0, values0);
+            sum_2_1 = vfmaq_f64(sum_2_1, values1, values1);
+        }
+        if (abs_sum) {
+            abs_sum0 = vaddq_f64(abs_sum0, vabsq_f64(values0));
+            abs_sum1 = vaddq_f64(abs_sum1, vabsq_f64(values1));
+        }
+        count = vsubq_u64(count, vaddq_u64(mask0, mask1));
+    }
+    *sum = vaddvq_f64(vaddq_f64(sum0, sum1));
+    if (sum_2) {
+        *sum_2 = vaddvq_f64(vaddq_f64(sum_2_0, sum_2_1));
+    }
+    if (abs_sum) {
+        *abs_sum = vaddvq_f64(vaddq_f64(abs_sum0, abs_sum1));
+    }
+    return vaddvq_u64(count);
+}
+
+void SumAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < BLOCK_SIZE_NEON * 2) {
+        SumAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    double sum;
+    _SumNotNaN(values, &si, ei, &sum, NULL, NULL);
+    ((SingleValueContext *)context)->value += sum;
+    if (si <= ei) {
+        SumAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void AvgAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    AvgContext *avg = (AvgContext *)context;
+    if ((ei - si + 1) < BLOCK_SIZE_NEON * 2 || avg->isOverflow) {
+        AvgAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    const size_t start = si;
+    double sum, abs_sum;
+    const size_t count = _SumNotNaN(values, &si, ei, &sum, NULL, &abs_sum);
+    if (unlikely(!(fabs(avg->val) + abs_sum <= DBL_MAX))) {
+        // same overflow handling as AvgAppendValuesAVX2
+        AvgAppendValuesVec(context, values, start, ei);
+        return;
+    }
+    avg->val += sum;
+    avg->cnt += count;
+    if (si <= ei) {
+        AvgAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void StdAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei) {
+    if ((ei - si + 1) < BLOCK_SIZE_NEON * 2) {
+        StdAppendValuesVec(context, values, si, ei);
+        return;
+    }
+
+    StdContext *std = (StdContext *)context;
+    double sum, sum_2;
+    std->cnt += _SumNotNaN(values, &si, ei, &sum, &sum_2, NULL);
+    std->sum += sum;
+    std->sum_2 += sum_2;
+    if (si <= ei) {
+        StdAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void CountAppendValuesNEON(void *__restrict__ context,
+                           double *__restrict__ values,
+                           size_t si,
+                           size_t ei) {
+    ((SingleValueContext *)context)->value += _CountNotNaN(values, &si, ei);
+    if (si <= ei) {
+        CountAppendValuesVec(context, values, si, ei);
+    }
+}
+
+void CountNaNAppendValuesNEON(void *__restrict__ context,
+                              double *__restrict__ values,
+                              size_t si,
+                              size_t ei) {
+    const size_t start = si;
+    const size_t notNaN = _CountNotNaN(values, &si, ei);
+    ((SingleValueContext *)context)->value += (si - start) - notNaN;
+    if (si <= ei) {
+        CountNaNAppendValuesVec(context, values, si, ei);
+    }
+}
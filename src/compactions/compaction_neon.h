@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef COMPACTION_NEON_H
+#define COMPACTION_NEON_H
+
+void MaxAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei);
+
+void MinAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei);
+
+void RangeAppendValuesNEON(void *__restrict__ context,
+                           double *__restrict__ values,
+                           size_t si,
+                           size_t ei);
+
+void SumAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei);
+
+void AvgAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei);
+
+void StdAppendValuesNEON(void *__restrict__ context,
+                         double *__restrict__ values,
+                         size_t si,
+                         size_t ei);
+
+void CountAppendValuesNEON(void *__restrict__ context,
+                           double *__restrict__ values,
+                           size_t si,
+                           size_t ei);
+
+void CountNaNAppendValuesNEON(void *__restrict__ context,
+                              double *__restrict__ values,
+                              size_t si,
+                              size_t ei);
+
+#endif // COMPACTION_NEON_H
@@ -193,6 +193,82 @@ ChunkResult Compressed_UpsertSample(UpsertCtx *uCtx, int *size, DuplicatePolicy
     return rv;
 }
 
+ChunkResult Compressed_UpsertSamples(UpsertBatchCtx *uCtx,
+                                     int *size,
+                                     DuplicatePolicy duplicatePolicy) {
+    CompressedChunk *oldChunk = (CompressedChunk *)uCtx->inChunk;
+    const Sample *samples = uCtx->samples;
+    const size_t count = uCtx->count;
+
+    // Reserve room for the new samples up front using the current bits-per-sample ratio, so the
+    // merge doesn't grow the buffer CHUNK_RESIZE_STEP bytes at a time.
+    size_t bytesPerSample = sizeof(Sample);
+    if (oldChunk->count > 0) {
+        bytesPerSample = oldChunk->idx / BIT / oldChunk->count + 1;
+    }
+    size_t newSize = oldChunk->size + count * bytesPerSample;
+    newSize = (newSize + sizeof(binary_t) - 1) / sizeof(binary_t) * sizeof(binary_t);
+
+    CompressedChunk *newChunk = Compressed_NewChunk(newSize);
+    Compressed_Iterator *iter = Compressed_NewChunkIterator(oldChunk);
+
+    Sample chunkSample;
+    ChunkResult chunkRes = Compressed_ChunkIteratorGetNext(iter, &chunkSample);
+    // The last merged sample is held back until the next one is known, so a following sample
+    // with the same timestamp can still be resolved against it by the duplicate policy.
+    Sample pending;
+    bool hasPending = false;
+    size_t i = 0;
+    while (chunkRes == CR_OK || i < count) {
+        Sample next;
+        ChunkResult *res = NULL;
+        if (chunkRes == CR_OK && (i == count || chunkSample.timestamp <= samples[i].timestamp)) {
+            next = chunkSample;
+            chunkRes = Compressed_ChunkIteratorGetNext(iter, &chunkSample);
+        } else {
+            next = samples[i];
+            res = &uCtx->results[i];
+            ++i;
+        }
+
+        if (hasPending && pending.timestamp == next.timestamp) {
+            // only a batch sample can collide, chunk samples precede batch samples on a tie
+            *res = handleDuplicateSample(duplicatePolicy, pending, &next);
+            if (*res == CR_OK) {
+                pending = next;
+            }
+            continue;
+        }
+
+        if (hasPending) {
+            ensureAddSample(newChunk, &pending);
+        }
+        pending = next;
+        hasPending = true;
+        if (res) {
+            *res = CR_OK;
+        }
+    }
+    if (hasPending) {
+        ensureAddSample(newChunk, &pending);
+    }
+
+    *size = (int)(newChunk->count - oldChunk->count);
+    // Keep the original capacity while the merged samples still fit in it, so the latest chunk
+    // doesn't look full to the next append, otherwise drop the over-reservation.
+    if (newChunk->idx / BIT < oldChunk->size) {
+        newChunk->data = realloc(newChunk->data, oldChunk->size);
+        newChunk->size = oldChunk->size;
+    } else {
+        trimChunk(newChunk);
+    }
+    swapChunks(newChunk, oldChunk);
+
+    Compressed_FreeChunkIterator(iter);
+    Compressed_FreeChunk(newChunk);
+    return CR_OK;
+}
+
 ChunkResult Compressed_AddSample(Chunk_t *chunk, Sample *sample) {
     return Compressed_Append((CompressedChunk *)chunk, sample->timestamp, sample->value);
 }
@@ -256,17 +332,19 @@ size_t Compressed_DelRange(Chunk_t *chunk, timestamp_t startTs, timestamp_t endT
 }
 
 // TODO: convert to template and unify with decompressChunk when moving to RUST
-// decompress chunk reverse
+// decompress chunk reverse, the samples up to end are decoded anyway, only the last limit of them
+// are kept
 static inline void decompressChunkReverse(const CompressedChunk *compressedChunk,
                                           uint64_t start,
                                           uint64_t end,
+                                          size_t limit,
                                           EnrichedChunk *enrichedChunk) {
     uint64_t numSamples = compressedChunk->count;
     uint64_t lastTS = compressedChunk->prevTimestamp;
     Sample sample;
     ResetEnrichedChunk(enrichedChunk);
-    if (unlikely(numSamples == 0 || end < start || compressedChunk->baseTimestamp > end ||
-                 lastTS < start)) {
+    if (unlikely(numSamples == 0 || end < start || limit == 0 ||
+                 compressedChunk->baseTimestamp > end || lastTS < start)) {
         return;
     }
 
@@ -334,7 +412,8 @@ _done:
     enrichedChunk->samples.timestamps = timestamps_ptr + 1;
     enrichedChunk->samples._values = values_ptr + 1;
     enrichedChunk->samples.num_samples =
-        enrichedChunk->samples.og_timestamps + numSamples - enrichedChunk->samples.timestamps;
+        min(limit,
+            enrichedChunk->samples.og_timestamps + numSamples - enrichedChunk->samples.timestamps);
     enrichedChunk->rev = true;
 
     Compressed_FreeChunkIterator(iter);
@@ -342,18 +421,19 @@ _done:
     return;
 }
 
-// decompress chunk
+// decompress chunk, stops after limit samples
 static inline void decompressChunk(const CompressedChunk *compressedChunk,
                                    uint64_t start,
                                    uint64_t end,
+                                   size_t limit,
                                    EnrichedChunk *enrichedChunk) {
     uint64_t numSamples = compressedChunk->count;
     uint64_t lastTS = compressedChunk->prevTimestamp;
     Sample sample;
     ChunkResult res;
     ResetEnrichedChunk(enrichedChunk);
-    if (unlikely(numSamples == 0 || end < start || compressedChunk->baseTimestamp > end ||
-                 lastTS < start)) {
+    if (unlikely(numSamples == 0 || end < start || limit == 0 ||
+                 compressedChunk->baseTimestamp > end || lastTS < start)) {
         return;
     }
 
@@ -375,9 +455,13 @@ static inline void decompressChunk(const CompressedChunk *compressedChunk,
     *timestamps_ptr++ = sample.timestamp;
     *values_ptr++ = sample.value;
 
+    // the samples are decoded up to this count, the first one in range included
+    const uint64_t decodeTo =
+        (limit - 1 < numSamples - iter->count) ? iter->count + limit - 1 : numSamples;
+
     if (lastTS > end) { // the range not include the whole chunk
         // 4 samples per iteration
-        const size_t n = numSamples >= 4 ? numSamples - 4 : 0;
+        const size_t n = decodeTo >= 4 ? decodeTo - 4 : 0;
         while (iter->count < n) {
             Compressed_ChunkIteratorGetNext(iter, &sample);
             *timestamps_ptr++ = sample.timestamp;
@@ -401,7 +485,7 @@ static inline void decompressChunk(const CompressedChunk *compressedChunk,
         }
 
         // left-overs
-        while (iter->count < numSamples) {
+        while (iter->count < decodeTo) {
             Compressed_ChunkIteratorGetNext(iter, &sample);
             if (sample.timestamp > end) {
                 goto _done;
@@ -410,7 +494,7 @@ static inline void decompressChunk(const CompressedChunk *compressedChunk,
             *values_ptr++ = sample.value;
         }
     } else {
-        while (iter->count < numSamples) {
+        while (iter->count < decodeTo) {
             Compressed_ChunkIteratorGetNext(iter, &sample);
             *timestamps_ptr++ = sample.timestamp;
             *values_ptr++ = sample.value;
@@ -464,6 +548,7 @@ void Compressed_FreeChunkIterator(ChunkIter_t *iter) {
 void Compressed_ProcessChunk(const Chunk_t *chunk,
                              uint64_t start,
                              uint64_t end,
+                             size_t limit,
                              EnrichedChunk *enrichedChunk,
                              bool reverse) {
     if (unlikely(!chunk)) {
@@ -472,14 +557,26 @@ void Compressed_ProcessChunk(const Chunk_t *chunk,
     const CompressedChunk *compressedChunk = chunk;
 
     if (unlikely(reverse)) {
-        decompressChunkReverse(compressedChunk, start, end, enrichedChunk);
+        decompressChunkReverse(compressedChunk, start, end, limit, enrichedChunk);
     } else {
-        decompressChunk(compressedChunk, start, end, enrichedChunk);
+        decompressChunk(compressedChunk, start, end, limit, enrichedChunk);
     }
 
     return;
 }
 
+void Compressed_AggregateRange(const Chunk_t *chunk,
+                               uint64_t start,
+                               uint64_t end,
+                               struct FusedAggregationCtx *ctx) {
+    const CompressedChunk *compressedChunk = chunk;
+    if (unlikely(!chunk || compressedChunk->count == 0 || end < start ||
+                 compressedChunk->baseTimestamp > end || compressedChunk->prevTimestamp < start)) {
+        return;
+    }
+    Compressed_AggregateSamples(compressedChunk, start, end, ctx);
+}
+
 typedef void (*SaveUnsignedFunc)(void *, uint64_t);
 typedef void (*SaveStringBufferFunc)(void *, const char *str, size_t len);
 typedef uint64_t (*ReadUnsignedFunc)(void *);
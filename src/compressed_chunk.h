@@ -30,13 +30,22 @@ int Compressed_DefragChunk(RedisModuleDefragCtx *ctx,
 // Append a sample to a compressed chunk
 ChunkResult Compressed_AddSample(Chunk_t *chunk, Sample *sample);
 ChunkResult Compressed_UpsertSample(UpsertCtx *uCtx, int *size, DuplicatePolicy duplicatePolicy);
+// Merge a sorted run of samples into the chunk with a single decode/encode pass
+ChunkResult Compressed_UpsertSamples(UpsertBatchCtx *uCtx,
+                                     int *size,
+                                     DuplicatePolicy duplicatePolicy);
 size_t Compressed_DelRange(Chunk_t *chunk, timestamp_t startTs, timestamp_t endTs);
 
 void Compressed_ProcessChunk(const Chunk_t *chunk,
                              uint64_t start,
                              uint64_t end,
+                             size_t limit,
                              EnrichedChunk *enrichedChunk,
                              bool reverse);
+void Compressed_AggregateRange(const Chunk_t *chunk,
+                               uint64_t start,
+                               uint64_t end,
+                               struct FusedAggregationCtx *ctx);
 
 // Read from compressed chunk using an iterator
 ChunkIter_t *Compressed_NewChunkIterator(const Chunk_t *chunk);
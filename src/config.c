@@ -8,7 +8,9 @@
  */
 #include "config.h"
 
+#include "async_read.h"
 #include "consts.h"
+#include "indexer.h"
 #include "libmr_integration.h"
 #include "module.h"
 #include "parse_policies.h"
@@ -49,6 +51,10 @@ void InitConfig(void) {
     TSGlobalConfig.libmrProtocol = LIBMR_PROTOCOL_DEFAULT;
     TSGlobalConfig.password = NULL;
     TSGlobalConfig.topologyEvents = true;
+    TSGlobalConfig.readThreads = 0;
+    TSGlobalConfig.readOffload = READ_OFFLOAD_DEFAULT;
+    TSGlobalConfig.rollupRouting = false;
+    TSGlobalConfig.numericLabels = NULL;
 
     if (getConfigStringCache) {
         RedisModule_FreeString(rts_staticCtx, getConfigStringCache);
@@ -70,6 +76,11 @@ void FreeConfig(void) {
         TSGlobalConfig.password = NULL;
     }
 
+    if (TSGlobalConfig.numericLabels) {
+        free(TSGlobalConfig.numericLabels);
+        TSGlobalConfig.numericLabels = NULL;
+    }
+
     if (getConfigStringCache) {
         RedisModule_FreeString(rts_staticCtx, getConfigStringCache);
         getConfigStringCache = NULL;
@@ -119,6 +130,35 @@ const char *ChunkTypeToString(int options) {
     return "invalid";
 }
 
+static const struct
+{
+    const char *name;
+    ReadOffloadCommand command;
+} readOffloadCommands[] = {
+    { "range", READ_OFFLOAD_RANGE },
+    { "revrange", READ_OFFLOAD_REVRANGE },
+    { "mrange", READ_OFFLOAD_MRANGE },
+    { "mrevrange", READ_OFFLOAD_MREVRANGE },
+};
+
+#define READ_OFFLOAD_COMMANDS_COUNT (sizeof(readOffloadCommands) / sizeof(readOffloadCommands[0]))
+
+// Formats the flags as a comma separated list of command names, e.g. "mrange,mrevrange"
+static void ReadOffloadToString(int flags, char *buf, size_t len) {
+    size_t pos = 0;
+    buf[0] = '\0';
+    for (size_t i = 0; i < READ_OFFLOAD_COMMANDS_COUNT; i++) {
+        if (!(flags & readOffloadCommands[i].command)) {
+            continue;
+        }
+        pos += snprintf(buf + pos,
+                        len - pos,
+                        "%s%s",
+                        pos ? "," : "",
+                        readOffloadCommands[i].name);
+    }
+}
+
 static RedisModuleString *getModernStringConfigValue(const char *name, void *privdata) {
     if (!strcasecmp("ts-compaction-policy", name)) {
         char *rulesAsString = CompactionRulesToString(TSGlobalConfig.compactionRules,
@@ -184,6 +224,27 @@ static RedisModuleString *getModernStringConfigValue(const char *name, void *pri
         getConfigStringCache =
             RedisModule_CreateStringPrintf(rts_staticCtx, "%lf", TSGlobalConfig.ignoreMaxValDiff);
 
+        return getConfigStringCache;
+    } else if (!strcasecmp("ts-read-offload", name)) {
+        char value[64];
+        ReadOffloadToString(TSGlobalConfig.readOffload, value, sizeof(value));
+
+        if (getConfigStringCache) {
+            RedisModule_FreeString(rts_staticCtx, getConfigStringCache);
+        }
+
+        getConfigStringCache = RedisModule_CreateString(rts_staticCtx, value, strlen(value));
+
+        return getConfigStringCache;
+    } else if (!strcasecmp("ts-numeric-labels", name)) {
+        const char *value = TSGlobalConfig.numericLabels ? TSGlobalConfig.numericLabels : "";
+
+        if (getConfigStringCache) {
+            RedisModule_FreeString(rts_staticCtx, getConfigStringCache);
+        }
+
+        getConfigStringCache = RedisModule_CreateString(rts_staticCtx, value, strlen(value));
+
         return getConfigStringCache;
     }
 
@@ -314,6 +375,77 @@ static bool Config_SetLibmrProtocolFromRedisString(RedisModuleString *value,
     return true;
 }
 
+static bool Config_SetReadOffloadFromRedisString(RedisModuleString *value,
+                                                 RedisModuleString **err) {
+    size_t len = 0;
+    const char *list = RedisModule_StringPtrLen(value, &len);
+    char *copy = strndup(list, len);
+    char *saveptr = NULL;
+    int flags = 0;
+
+    for (char *token = strtok_r(copy, ", ", &saveptr); token != NULL;
+         token = strtok_r(NULL, ", ", &saveptr)) {
+        size_t i = 0;
+        while (i < READ_OFFLOAD_COMMANDS_COUNT && strcasecmp(readOffloadCommands[i].name, token)) {
+            i++;
+        }
+        if (i == READ_OFFLOAD_COMMANDS_COUNT) {
+            *err = RedisModule_CreateStringPrintf(
+                NULL, "Invalid command for `ts-read-offload`: %s", token);
+            free(copy);
+            return false;
+        }
+        flags |= readOffloadCommands[i].command;
+    }
+
+    free(copy);
+    TSGlobalConfig.readOffload = flags;
+    return true;
+}
+
+static bool Config_SetNumericLabelsFromRedisString(RedisModuleString *value,
+                                                   RedisModuleString **err) {
+    size_t len = 0;
+    const char *list = RedisModule_StringPtrLen(value, &len);
+    char *copy = strndup(list, len);
+    char *saveptr = NULL;
+    // at most a label per two characters, and the labels joined by commas fit in len + 1
+    const char **labels = malloc((len / 2 + 1) * sizeof(char *));
+    size_t *labelLens = malloc((len / 2 + 1) * sizeof(size_t));
+    char *joined = malloc(len + 1);
+    size_t count = 0, joinedLen = 0;
+
+    for (char *token = strtok_r(copy, ", ", &saveptr); token != NULL;
+         token = strtok_r(NULL, ", ", &saveptr)) {
+        if (strpbrk(token, "=!^<>~()") != NULL) {
+            *err = RedisModule_CreateStringPrintf(
+                NULL, "Invalid label for `ts-numeric-labels`: %s", token);
+            free(labels);
+            free(labelLens);
+            free(joined);
+            free(copy);
+            return false;
+        }
+        labels[count] = token;
+        labelLens[count] = strlen(token);
+        if (count > 0) {
+            joined[joinedLen++] = ',';
+        }
+        memcpy(joined + joinedLen, token, labelLens[count]);
+        joinedLen += labelLens[count];
+        count++;
+    }
+    joined[joinedLen] = '\0';
+
+    IndexSetNumericLabels(labels, labelLens, count);
+    free(TSGlobalConfig.numericLabels);
+    TSGlobalConfig.numericLabels = joined;
+    free(labels);
+    free(labelLens);
+    free(copy);
+    return true;
+}
+
 static int setModernStringConfigValue(const char *name,
                                       RedisModuleString *value,
                                       void *data,
@@ -335,6 +467,12 @@ static int setModernStringConfigValue(const char *name,
     } else if (!strcasecmp("ts-libmr-protocol", name)) {
         return Config_SetLibmrProtocolFromRedisString(value, err) ? REDISMODULE_OK
                                                                   : REDISMODULE_ERR;
+    } else if (!strcasecmp("ts-read-offload", name)) {
+        return Config_SetReadOffloadFromRedisString(value, err) ? REDISMODULE_OK
+                                                                : REDISMODULE_ERR;
+    } else if (!strcasecmp("ts-numeric-labels", name)) {
+        return Config_SetNumericLabelsFromRedisString(value, err) ? REDISMODULE_OK
+                                                                  : REDISMODULE_ERR;
     }
 
     return REDISMODULE_ERR;
@@ -343,6 +481,8 @@ static int setModernStringConfigValue(const char *name,
 static int getModernBoolConfigValue(const char *name, void *privdata) {
     if (!strcasecmp("ts-topology-events", name)) {
         return TSGlobalConfig.topologyEvents;
+    } else if (!strcasecmp("ts-rollup-routing", name)) {
+        return TSGlobalConfig.rollupRouting;
     }
 
     return 0;
@@ -355,6 +495,10 @@ static int setModernBoolConfigValue(const char *name,
     if (!strcasecmp("ts-topology-events", name)) {
         TSGlobalConfig.topologyEvents = value;
 
+        return REDISMODULE_OK;
+    } else if (!strcasecmp("ts-rollup-routing", name)) {
+        TSGlobalConfig.rollupRouting = value;
+
         return REDISMODULE_OK;
     }
 
@@ -370,6 +514,8 @@ static long long getModernIntegerConfigValue(const char *name, void *privdata) {
         return TSGlobalConfig.chunkSizeBytes;
     } else if (!strcasecmp("ts-ignore-max-time-diff", name)) {
         return TSGlobalConfig.ignoreMaxTimeDiff;
+    } else if (!strcasecmp("ts-read-threads", name)) {
+        return TSGlobalConfig.readThreads;
     }
 
     return 0;
@@ -412,6 +558,21 @@ static int setModernIntegerConfigValue(const char *name,
 
         TSGlobalConfig.ignoreMaxTimeDiff = value;
 
+        return REDISMODULE_OK;
+    } else if (!strcasecmp("ts-read-threads", name)) {
+        // The pool can't be resized once started, but the reads can be moved back to the main
+        // thread and later to the same pool again
+        const size_t poolSize = AsyncRead_PoolSize();
+        if (poolSize > 0 && value != 0 && value != (long long)poolSize) {
+            *err = RedisModule_CreateStringPrintf(
+                NULL,
+                "Cannot resize ts-read-threads after the read pool has started with %zu threads",
+                poolSize);
+            return REDISMODULE_ERR;
+        }
+
+        TSGlobalConfig.readThreads = value;
+
         return REDISMODULE_OK;
     }
 
@@ -620,6 +781,72 @@ bool RegisterModernConfigurationOptions(RedisModuleCtx *ctx) {
                     12,
                     TSGlobalConfig.topologyEvents);
 
+    if (RedisModule_RegisterNumericConfig(ctx,
+                                          "ts-read-threads",
+                                          TSGlobalConfig.readThreads,
+                                          REDISMODULE_CONFIG_UNPREFIXED,
+                                          READ_THREADS_MIN,
+                                          READ_THREADS_MAX,
+                                          getModernIntegerConfigValue,
+                                          setModernIntegerConfigValue,
+                                          NULL,
+                                          NULL)) {
+        return false;
+    }
+
+    RedisModule_Log(
+        ctx, "notice", "\t{ %-*s: %*lld }", 23, "ts-read-threads", 12, TSGlobalConfig.readThreads);
+
+    {
+        char oldValue[64];
+        ReadOffloadToString(TSGlobalConfig.readOffload, oldValue, sizeof(oldValue));
+
+        if (RedisModule_RegisterStringConfig(ctx,
+                                             "ts-read-offload",
+                                             oldValue,
+                                             REDISMODULE_CONFIG_UNPREFIXED,
+                                             getModernStringConfigValue,
+                                             setModernStringConfigValue,
+                                             NULL,
+                                             NULL)) {
+            return false;
+        }
+
+        RedisModule_Log(ctx, "notice", "\t{ %-*s: %*s }", 23, "ts-read-offload", 12, oldValue);
+    }
+
+    if (RedisModule_RegisterStringConfig(ctx,
+                                         "ts-numeric-labels",
+                                         "",
+                                         REDISMODULE_CONFIG_UNPREFIXED,
+                                         getModernStringConfigValue,
+                                         setModernStringConfigValue,
+                                         NULL,
+                                         NULL)) {
+        return false;
+    }
+
+    RedisModule_Log(ctx, "notice", "\t{ %-*s: %*s }", 23, "ts-numeric-labels", 12, "");
+
+    if (RedisModule_RegisterBoolConfig(ctx,
+                                       "ts-rollup-routing",
+                                       TSGlobalConfig.rollupRouting,
+                                       REDISMODULE_CONFIG_UNPREFIXED,
+                                       getModernBoolConfigValue,
+                                       setModernBoolConfigValue,
+                                       NULL,
+                                       NULL)) {
+        return false;
+    }
+
+    RedisModule_Log(ctx,
+                    "notice",
+                    "\t{ %-*s: %*d }",
+                    23,
+                    "ts-rollup-routing",
+                    12,
+                    TSGlobalConfig.rollupRouting);
+
     RedisModule_Log(ctx, "notice", "]");
 
     return true;
@@ -866,6 +1093,45 @@ int ReadDeprecatedLoadTimeConfig(RedisModuleCtx *ctx,
         }
     }
 
+    if (argc > 1 && RMUtil_ArgIndex("ts-rollup-routing", argv, argc) >= 0) {
+        RedisModuleString *rollupRouting;
+        if (RMUtil_ParseArgsAfter("ts-rollup-routing", argv, argc, "s", &rollupRouting) !=
+            REDISMODULE_OK) {
+            RedisModule_Log(ctx, "warning", "Unable to parse argument after ts-rollup-routing");
+            return TSDB_ERROR;
+        }
+        const char *rollupRouting_cstr = RedisModule_StringPtrLen(rollupRouting, NULL);
+        if (!strcasecmp(rollupRouting_cstr, "yes")) {
+            TSGlobalConfig.rollupRouting = true;
+        } else if (!strcasecmp(rollupRouting_cstr, "no")) {
+            TSGlobalConfig.rollupRouting = false;
+        } else {
+            RedisModule_Log(ctx,
+                            "warning",
+                            "Invalid value for ts-rollup-routing, must be 'yes' or 'no': %s",
+                            rollupRouting_cstr);
+            return TSDB_ERROR;
+        }
+    }
+
+    if (argc > 1 && RMUtil_ArgIndex("ts-read-threads", argv, argc) >= 0) {
+        long long readThreads;
+        if (RMUtil_ParseArgsAfter("ts-read-threads", argv, argc, "l", &readThreads) !=
+            REDISMODULE_OK) {
+            RedisModule_Log(ctx, "warning", "Unable to parse argument after ts-read-threads");
+            return TSDB_ERROR;
+        }
+        if (readThreads < READ_THREADS_MIN || readThreads > READ_THREADS_MAX) {
+            RedisModule_Log(ctx,
+                            "warning",
+                            "Invalid value for ts-read-threads. Must be between %d and %d",
+                            READ_THREADS_MIN,
+                            READ_THREADS_MAX);
+            return TSDB_ERROR;
+        }
+        TSGlobalConfig.readThreads = readThreads;
+    }
+
     if (argc > 1 && RMUtil_ArgIndex("LIBMR_PROTOCOL", argv, argc) >= 0) {
         LOG_DEPRECATED_OPTION("LIBMR_PROTOCOL", "ts-libmr-protocol", showDeprecationWarning);
         RedisModuleString *protocol;
@@ -26,6 +26,19 @@
 #define IGNORE_MAX_TIME_DIFF_MAX LLONG_MAX
 #define IGNORE_MAX_VAL_DIFF_MIN 0.0
 #define IGNORE_MAX_VAL_DIFF_MAX DBL_MAX
+#define READ_THREADS_MIN 0
+#define READ_THREADS_MAX 16
+
+// Read commands that may run on the read thread pool
+typedef enum ReadOffloadCommand
+{
+    READ_OFFLOAD_RANGE = 1 << 0,
+    READ_OFFLOAD_REVRANGE = 1 << 1,
+    READ_OFFLOAD_MRANGE = 1 << 2,
+    READ_OFFLOAD_MREVRANGE = 1 << 3,
+} ReadOffloadCommand;
+
+#define READ_OFFLOAD_DEFAULT (READ_OFFLOAD_MRANGE | READ_OFFLOAD_MREVRANGE)
 
 typedef struct
 {
@@ -43,6 +56,10 @@ typedef struct
     long long ignoreMaxTimeDiff; // Insert filter max time diff with the last sample
     double ignoreMaxValDiff;     // Insert filter max value diff with the last sample
     bool topologyEvents;         // Subscribe to cluster topology change events
+    long long readThreads;       // size of the read thread pool, 0 runs reads on the main thread
+    int readOffload;             // ReadOffloadCommand flags of the commands using the read pool
+    bool rollupRouting;          // Answer aggregated ranges from compaction rule destinations
+    char *numericLabels;         // comma separated labels indexed by number for range filters
 } TSConfig;
 
 extern TSConfig TSGlobalConfig;
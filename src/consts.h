@@ -49,6 +49,9 @@
 #define SPLIT_FACTOR 1.2
 #define DEFAULT_DUPLICATE_POLICY DP_BLOCK
 
+/* TS.QUERYINDEX Defaults */
+#define QUERYINDEX_CURSOR_LIMIT_DEFAULT 1000LL
+
 /* TS.Range Aggregation types */
 typedef enum
 {
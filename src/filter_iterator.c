@@ -9,10 +9,14 @@
 #include "filter_iterator.h"
 
 #include "abstract_iterator.h"
+#include "filters/filter_by_value_avx2.h"
+#include "filters/filter_by_value_avx512f.h"
+#include "filters/filter_by_value_common.h"
+#include "filters/filter_by_value_neon.h"
 #include "series_iterator.h"
-#include "utils/arr.h"
+#include "utils/arch_features.h"
 #include <assert.h>
-#include <math.h> /* ceil */
+#include <math.h>
 #include <string.h>
 
 static inline bool check_sample_value(double value, FilterByValueArgs *byValueArgs) {
@@ -23,21 +27,27 @@ static inline bool check_sample_value(double value, FilterByValueArgs *byValueAr
     }
 }
 
-typedef struct dfs_stack_val
-{
-    size_t si;
-    size_t ei;
-    size_t filter_si;
-    size_t filter_ei;
-} dfs_stack_val;
-
-#define dfs_stack_val_init(_val, _si, _ei, _filter_si, _filter_ei)                                 \
-    do {                                                                                           \
-        (_val).si = (_si);                                                                         \
-        (_val).ei = (_ei);                                                                         \
-        (_val).filter_si = (_filter_si);                                                           \
-        (_val).filter_ei = (_filter_ei);                                                           \
-    } while (0)
+// The FILTER_BY_VALUE kernel picked by initFilterByValueFunctions
+static FilterByValueFunc filterByValueFunc = FilterByValueScalar;
+
+void initFilterByValueFunctions() {
+    filterByValueFunc = FilterByValueScalar;
+#if defined(__x86_64__)
+    const X86Features *features = getArchitectureOptimization();
+    if (!features) {
+        return;
+    } else if (features->avx512f) {
+        filterByValueFunc = FilterByValueAVX512F;
+    } else if (features->avx2) {
+        filterByValueFunc = FilterByValueAVX2;
+    }
+#elif defined(__aarch64__)
+    const Aarch64Features *features = getAarch64ArchitectureOptimization();
+    if (features && features->asimd) {
+        filterByValueFunc = FilterByValueNEON;
+    }
+#endif // __x86_64__
+}
 
 static inline timestamp_t calc_bucket_ts(BucketTimestamp bucketTS,
                                          timestamp_t ts,
@@ -54,92 +64,57 @@ static inline timestamp_t calc_bucket_ts(BucketTimestamp bucketTS,
     }
 }
 
-// returns the number of matches
+size_t GallopLowerBound(const timestamp_t *values, size_t si, size_t n, timestamp_t ts) {
+    if (si >= n || values[si] >= ts) {
+        return si;
+    }
+
+    size_t l = si, h = si + 1, step = 1; // values[l] < ts, values[h] >= ts or h is n
+    while (h < n && values[h] < ts) {
+        l = h;
+        step <<= 1;
+        h = l + step;
+    }
+    h = min(h, n);
+    while (l < h - 1) {
+        const size_t m = l + (h - l) / 2;
+        if (values[m] < ts) {
+            l = m;
+        } else {
+            h = m;
+        }
+    }
+    return h;
+}
+
+/* Intersects the ascending sample timestamps with filter[filter_si, filter_n) and keeps the
+ * matching samples in place, returns their number. Whichever side is behind gallops to the other,
+ * so a few filter timestamps against a large chunk (or the opposite) cost O(m log(n / m)).
+ * *filter_end is set to the first filter index after the last sample. */
 static size_t filterSamples(Samples *samples,
                             const timestamp_t *filter,
                             size_t filter_si,
-                            size_t filter_ei) {
-    size_t count = 0;
-    size_t num_samples = samples->num_samples;
-    dfs_stack_val *dfs_stack =
-        array_new(dfs_stack_val, ceil(log(num_samples)) + 1); // + 1 is for one left child
-    dfs_stack_val first_frame = {
-        .si = 0, .ei = num_samples - 1, .filter_si = filter_si, .filter_ei = filter_ei
-    };
-    dfs_stack_val left_frame, right_frame;
-    array_append(dfs_stack, first_frame);
-    dfs_stack_val cur_frame;
-    bool found_left, found_right;
-    while (array_len(dfs_stack) > 0) {
-        cur_frame = array_pop(dfs_stack);
-        if (cur_frame.si == cur_frame.ei) {
-            assert((num_samples <= 1) || cur_frame.filter_ei == cur_frame.filter_si);
-            for (size_t i = cur_frame.filter_si; i <= cur_frame.filter_ei; ++i) {
-                const timestamp_t sample_ts = samples->timestamps[cur_frame.si];
-                if (sample_ts == filter[i]) {
-                    samples->timestamps[count] = sample_ts;
-                    for (size_t a = 0; a < samples->values_per_sample; ++a) {
-                        Samples_value_at(samples, count, a) =
-                            Samples_value_at(samples, cur_frame.si, a);
-                    }
-                    ++(count);
-                    break;
-                }
+                            size_t filter_n,
+                            size_t *filter_end) {
+    timestamp_t *timestamps = samples->timestamps;
+    const size_t n = samples->num_samples;
+    size_t count = 0, i = 0, j = filter_si;
+    while (i < n && j < filter_n) {
+        if (timestamps[i] < filter[j]) {
+            i = GallopLowerBound(timestamps, i + 1, n, filter[j]);
+        } else if (timestamps[i] > filter[j]) {
+            j = GallopLowerBound(filter, j + 1, filter_n, timestamps[i]);
+        } else {
+            timestamps[count] = timestamps[i];
+            for (size_t a = 0; a < samples->values_per_sample; ++a) {
+                Samples_value_at(samples, count, a) = Samples_value_at(samples, i, a);
             }
-            continue;
-        }
-
-        const size_t mid = (cur_frame.si + cur_frame.ei) / 2;
-
-        // find filter values that fit into left bucket
-        found_left = false;
-        size_t _filter_si = cur_frame.filter_si, _filter_ei;
-
-        while (_filter_si <= cur_frame.filter_ei &&
-               filter[_filter_si] < samples->timestamps[cur_frame.si]) {
-            ++_filter_si;
-        }
-
-        _filter_ei = _filter_si;
-        while (_filter_ei <= cur_frame.filter_ei &&
-               filter[_filter_ei] <= samples->timestamps[mid]) {
-            found_left = true;
-            ++_filter_ei;
-        }
-
-        if (found_left) {
-            dfs_stack_val_init(left_frame, cur_frame.si, mid, _filter_si, _filter_ei - 1);
-        }
-
-        // find filter that fit into right bucket
-        found_right = false;
-        _filter_si = _filter_ei;
-        while (_filter_si <= cur_frame.filter_ei &&
-               filter[_filter_si] < samples->timestamps[mid + 1]) {
-            ++_filter_si;
-        }
-
-        _filter_ei = _filter_si;
-        while (_filter_ei <= cur_frame.filter_ei &&
-               filter[_filter_ei] <= samples->timestamps[cur_frame.ei]) {
-            found_right = true;
-            ++_filter_ei;
-        }
-
-        if (found_right) {
-            dfs_stack_val_init(right_frame, mid + 1, cur_frame.ei, _filter_si, _filter_ei - 1);
-        }
-
-        if (found_right) {
-            array_append(dfs_stack, right_frame);
-        }
-
-        if (found_left) {
-            array_append(dfs_stack, left_frame);
+            ++count;
+            ++i;
+            ++j;
         }
     }
-
-    array_free(dfs_stack);
+    *filter_end = j;
     return count;
 }
 
@@ -149,26 +124,41 @@ EnrichedChunk *SeriesFilterTSIterator_GetNextChunk(struct AbstractIterator *base
     size_t count = 0;
     assert(self->ByTsArgs.hasValue);
 
-    if (self->tsFilterIndex == self->ByTsArgs.count) {
+    if (self->tsFilterIndex == self->ByTsArgs.count || self->limit == 0) {
         return NULL;
     }
     while ((enrichedChunk = self->base.input->GetNext(self->base.input)) &&
            enrichedChunk->samples.num_samples > 0) {
         assert(!enrichedChunk->rev); // the impl assumes that the chunk isn't reversed
+        const timestamp_t firstTimestamp = enrichedChunk->samples.timestamps[0];
+        size_t filter_end;
         count = filterSamples(&enrichedChunk->samples,
                               self->ByTsArgs.values,
                               self->tsFilterIndex,
-                              self->ByTsArgs.count - 1);
+                              self->ByTsArgs.count,
+                              &filter_end);
+        // the next chunks can only match the filter timestamps on their side of this chunk
+        if (unlikely(self->reverse)) {
+            self->ByTsArgs.count = GallopLowerBound(
+                self->ByTsArgs.values, self->tsFilterIndex, self->ByTsArgs.count, firstTimestamp);
+        } else {
+            self->tsFilterIndex = filter_end;
+        }
         if (count > 0) {
             enrichedChunk->samples.num_samples = count;
             if (unlikely(self->reverse)) {
                 reverseEnrichedChunk(enrichedChunk);
-                self->ByTsArgs.count -= count;
-            } else {
-                self->tsFilterIndex += count; // at least count samples consumed
+            }
+            // the input isn't pulled again once limit samples passed the filter
+            enrichedChunk->samples.num_samples = min(count, self->limit);
+            if (self->limit != SIZE_MAX) {
+                self->limit -= enrichedChunk->samples.num_samples;
             }
             return enrichedChunk;
         }
+        if (self->tsFilterIndex == self->ByTsArgs.count) {
+            break;
+        }
     }
 
     return NULL;
@@ -176,20 +166,24 @@ EnrichedChunk *SeriesFilterTSIterator_GetNextChunk(struct AbstractIterator *base
 
 SeriesFilterTSIterator *SeriesFilterTSIterator_New(AbstractIterator *input,
                                                    FilterByTSArgs ByTsArgs,
-                                                   bool rev) {
-    SeriesFilterTSIterator *newIter = malloc(sizeof(SeriesFilterTSIterator));
+                                                   size_t limit,
+                                                   bool rev,
+                                                   QueryArena *arena) {
+    SeriesFilterTSIterator *newIter = QueryArena_Alloc(arena, sizeof(SeriesFilterTSIterator));
     newIter->base.input = input;
+    newIter->base.arena = arena;
     newIter->base.GetNext = SeriesFilterTSIterator_GetNextChunk;
     newIter->base.Close = SeriesFilterIterator_Close;
     newIter->ByTsArgs = ByTsArgs;
     newIter->tsFilterIndex = 0;
+    newIter->limit = limit;
     newIter->reverse = rev;
     return newIter;
 }
 
 void SeriesFilterIterator_Close(struct AbstractIterator *iterator) {
     iterator->input->Close(iterator->input);
-    free(iterator);
+    QueryArena_Release(iterator->arena, iterator);
 }
 
 EnrichedChunk *SeriesFilterValIterator_GetNextChunk(struct AbstractIterator *base) {
@@ -198,22 +192,39 @@ EnrichedChunk *SeriesFilterValIterator_GetNextChunk(struct AbstractIterator *bas
     size_t i, count = 0;
     assert(self->byValueArgs.hasValue);
 
+    if (self->limit == 0) {
+        return NULL;
+    }
     while ((enrichedChunk = self->base.input->GetNext(self->base.input))) {
         // currently if the query reversed the chunk will be already reversed here
         // assert(self->reverse == enrichedChunk->rev);
-        for (i = 0; i < enrichedChunk->samples.num_samples; ++i) {
-            if (check_sample_value(Samples_value_at(&enrichedChunk->samples, i, 0),
-                                   &self->byValueArgs)) {
-                enrichedChunk->samples.timestamps[count] = enrichedChunk->samples.timestamps[i];
-                for (size_t a = 0; a < enrichedChunk->samples.values_per_sample; ++a) {
-                    Samples_value_at(&enrichedChunk->samples, count, a) =
-                        Samples_value_at(&enrichedChunk->samples, i, a);
+        if (enrichedChunk->samples.values_per_sample == 1) {
+            // the whole chunk is filtered, the samples past the limit are dropped
+            count = filterByValueFunc(enrichedChunk->samples.timestamps,
+                                      enrichedChunk->samples._values,
+                                      enrichedChunk->samples.num_samples,
+                                      self->byValueArgs.min,
+                                      self->byValueArgs.max);
+            count = min(count, self->limit);
+        } else {
+            for (i = 0; i < enrichedChunk->samples.num_samples && count < self->limit; ++i) {
+                if (check_sample_value(Samples_value_at(&enrichedChunk->samples, i, 0),
+                                       &self->byValueArgs)) {
+                    enrichedChunk->samples.timestamps[count] =
+                        enrichedChunk->samples.timestamps[i];
+                    for (size_t a = 0; a < enrichedChunk->samples.values_per_sample; ++a) {
+                        Samples_value_at(&enrichedChunk->samples, count, a) =
+                            Samples_value_at(&enrichedChunk->samples, i, a);
+                    }
+                    ++count;
                 }
-                ++count;
             }
         }
         if (count > 0) {
             enrichedChunk->samples.num_samples = count;
+            if (self->limit != SIZE_MAX) {
+                self->limit -= count;
+            }
             return enrichedChunk;
         }
     }
@@ -222,12 +233,16 @@ EnrichedChunk *SeriesFilterValIterator_GetNextChunk(struct AbstractIterator *bas
 }
 
 SeriesFilterValIterator *SeriesFilterValIterator_New(AbstractIterator *input,
-                                                     FilterByValueArgs byValue) {
-    SeriesFilterValIterator *newIter = malloc(sizeof(SeriesFilterValIterator));
+                                                     FilterByValueArgs byValue,
+                                                     size_t limit,
+                                                     QueryArena *arena) {
+    SeriesFilterValIterator *newIter = QueryArena_Alloc(arena, sizeof(SeriesFilterValIterator));
     newIter->base.input = input;
+    newIter->base.arena = arena;
     newIter->base.GetNext = SeriesFilterValIterator_GetNextChunk;
     newIter->base.Close = SeriesFilterIterator_Close;
     newIter->byValueArgs = byValue;
+    newIter->limit = limit;
     return newIter;
 }
 
@@ -243,11 +258,13 @@ AggregationIterator *AggregationIterator_New(struct AbstractIterator *input,
                                              api_timestamp_t startTimestamp,
                                              api_timestamp_t endTimestamp,
                                              FilterByValueArgs byValueArgs,
-                                             FilterByTSArgs byTsArgs) {
-    AggregationIterator *iter = malloc(sizeof(AggregationIterator));
+                                             FilterByTSArgs byTsArgs,
+                                             QueryArena *arena) {
+    AggregationIterator *iter = QueryArena_Alloc(arena, sizeof(AggregationIterator));
     iter->base.GetNext = AggregationIterator_GetNextChunk;
     iter->base.Close = AggregationIterator_Close;
     iter->base.input = input;
+    iter->base.arena = arena;
     iter->numAggregations = numAggregations;
     for (size_t i = 0; i < numAggregations; i++) {
         iter->aggregations[i] = *aggregations[i];
@@ -262,8 +279,7 @@ AggregationIterator *AggregationIterator_New(struct AbstractIterator *input,
     iter->initialized = false;
     iter->empty = empty;
     iter->bucketTS = bucketTS;
-    iter->aux_chunk = NewEnrichedChunk();
-    iter->aux_chunk->samples.values_per_sample = numAggregations;
+    iter->aux_chunk = QueryArena_NewEnrichedChunk(arena, numAggregations);
     iter->startTimestamp = startTimestamp;
     iter->endTimestamp = endTimestamp;
     iter->hasTwa = false;
@@ -280,7 +296,9 @@ AggregationIterator *AggregationIterator_New(struct AbstractIterator *input,
     iter->byValueArgs = byValueArgs;
     iter->byTsArgs = byTsArgs;
     memset(iter->validPerAgg, 0, sizeof(iter->validPerAgg));
-    ReallocSamplesArray(&iter->aux_chunk->samples, 1);
+    if (iter->aux_chunk->samples.size == 0) {
+        ReallocSamplesArray(&iter->aux_chunk->samples, 1);
+    }
     ResetEnrichedChunk(iter->aux_chunk);
     return iter;
 }
@@ -442,31 +460,40 @@ static inline bool finalizeBucket(Samples *samples, size_t index, AggregationIte
     return true;
 }
 
-// assumes num of samples > si + 1, returns -1 when no such an index
-static int64_t findLastIndexbeforeTS(const EnrichedChunk *chunk,
-                                     timestamp_t timestamp,
-                                     int64_t si) {
-    timestamp_t *timestamps = chunk->samples.timestamps;
-    int64_t h = chunk->samples.num_samples - 1;
-    if (unlikely(timestamps[si] >= timestamp)) {
-        // the first sample of the current range finalize prev chunk bucket
-        return -1;
-    }
-    if (timestamps[h] < timestamp) { // range of size 1 will be handled here
-        return h;
-    }
+// Whether ts lies past the boundary of the current bucket in iteration order: bound is the
+// exclusive bucket end (contextScope) forward and the bucket start in reverse.
+static really_inline bool pastBucketBound(timestamp_t ts, timestamp_t bound, bool reversed) {
+    return reversed ? ts < bound : ts >= bound;
+}
 
-    int64_t m, l = si;
-    assert(h > l);      // from here h > l
-    while (l < h - 1) { // if l == h-1 it means l has the result
-        m = (l + h) / 2;
-        if (timestamps[m] < timestamp) {
-            l = m;
-        } else {
+/* Returns the last index of the run of samples starting at si that don't cross bound, si - 1 when
+ * samples[si] already crosses it. Gallops from si and then bisects the last step, so a bucket of k
+ * samples costs O(log k) comparisons regardless of the chunk size. */
+static int64_t findBucketEndIndex(const Samples *samples,
+                                  int64_t si,
+                                  timestamp_t bound,
+                                  bool reversed) {
+    const timestamp_t *timestamps = samples->timestamps;
+    const int64_t n = samples->num_samples;
+    if (unlikely(pastBucketBound(timestamps[si], bound, reversed))) {
+        return si - 1;
+    }
+
+    int64_t l = si, h = si + 1, step = 1; // l doesn't cross, h crosses or is n
+    while (h < n && !pastBucketBound(timestamps[h], bound, reversed)) {
+        l = h;
+        step <<= 1;
+        h = l + step;
+    }
+    h = min(h, n);
+    while (l < h - 1) {
+        const int64_t m = l + (h - l) / 2;
+        if (pastBucketBound(timestamps[m], bound, reversed)) {
             h = m;
+        } else {
+            l = m;
         }
     }
-
     return l;
 }
 
@@ -1071,118 +1098,6 @@ static void agg_iter_advance_context_scope(AggregationIterator *self,
     self->aggregationLastTimestamp = BucketStartNormalize(self->aggregationLastTimestamp);
 }
 
-// MAX fast path: vector-append samples with timestamp < *contextScope; advance si past the run.
-static void agg_iter_max_drain_vec_segment(AggregationIterator *self,
-                                           EnrichedChunk *enrichedChunk,
-                                           AggregationClass *aggregation,
-                                           void *aggregationContext,
-                                           uint64_t *contextScope,
-                                           int64_t *si,
-                                           int64_t *ei) {
-    *ei = findLastIndexbeforeTS(enrichedChunk, *contextScope, *si);
-    if (likely(*ei >= 0)) {
-        aggregation->appendValueVec(aggregationContext, enrichedChunk->samples._values, *si, *ei);
-        for (int64_t idx = *si; idx <= *ei; idx++) {
-            if (aggregation->isValueValid(Samples_value_at(&enrichedChunk->samples, idx, 0))) {
-                self->validSamplesInBucket = true;
-                self->validPerAgg[0] = true;
-            }
-        }
-        *si = *ei + 1;
-    }
-}
-
-/* Opening sample after vec drain: finalize prior bucket, optional empty gap, advance scope, append.
- * Returns 0 or -1 on fillEmptyBuckets error. Caller ensures *si < num_samples. */
-static int agg_iter_max_emit_opening_sample(AggregationIterator *self,
-                                            EnrichedChunk *enrichedChunk,
-                                            AggregationClass *aggregation,
-                                            void *aggregationContext,
-                                            uint64_t aggregationTimeDelta,
-                                            bool is_reversed,
-                                            void (*appendValue)(void *, double, timestamp_t),
-                                            uint64_t *contextScope,
-                                            size_t *agg_n_samples,
-                                            int64_t *si,
-                                            Sample *sample) {
-    sample->timestamp = enrichedChunk->samples.timestamps[*si];
-    sample->value = Samples_value_at(&enrichedChunk->samples, *si, 0);
-    assert(enrichedChunk->samples.timestamps[*si] >= *contextScope);
-    if (finalizeBucket(&enrichedChunk->samples, *agg_n_samples, self)) {
-        (*agg_n_samples)++;
-    }
-    self->aggregationLastTimestamp =
-        CalcBucketStart(sample->timestamp, aggregationTimeDelta, self->timestampAlignment);
-    if (self->empty) {
-        timestamp_t first_bucket, last_bucket;
-        if (agg_iter_empty_gap_after_finalize(*contextScope,
-                                              self->aggregationLastTimestamp,
-                                              aggregationTimeDelta,
-                                              is_reversed,
-                                              true,
-                                              &first_bucket,
-                                              &last_bucket)) {
-            int err = fillEmptyBuckets(&enrichedChunk->samples,
-                                       agg_n_samples,
-                                       first_bucket,
-                                       last_bucket,
-                                       self,
-                                       is_reversed,
-                                       false, // interior gap: neighbors exist on both sides
-                                       si);
-            if (err != 0) {
-                return -1;
-            }
-        }
-    }
-    agg_iter_advance_context_scope(self, aggregationTimeDelta, contextScope);
-
-    if (aggregation->isValueValid(sample->value)) {
-        appendValue(aggregationContext, sample->value, sample->timestamp);
-        self->validSamplesInBucket = true;
-        self->validPerAgg[0] = true;
-    }
-    (*si)++;
-    return 0;
-}
-
-// Single agg MAX forward: vectorized append per bucket. Returns 0 or -1 on fillEmptyBuckets error.
-static int agg_iter_process_chunk_max_fast_path(AggregationIterator *self,
-                                                EnrichedChunk *enrichedChunk,
-                                                AggregationClass *aggregation,
-                                                void *aggregationContext,
-                                                uint64_t aggregationTimeDelta,
-                                                bool is_reversed,
-                                                void (*appendValue)(void *, double, timestamp_t),
-                                                uint64_t *contextScope,
-                                                size_t *agg_n_samples,
-                                                int64_t *si,
-                                                int64_t *ei,
-                                                Sample *sample) {
-    Samples *samples = &enrichedChunk->samples;
-    while (*si < (int64_t)samples->num_samples) {
-        agg_iter_max_drain_vec_segment(
-            self, enrichedChunk, aggregation, aggregationContext, contextScope, si, ei);
-        if (*si >= (int64_t)samples->num_samples) {
-            break;
-        }
-        if (agg_iter_max_emit_opening_sample(self,
-                                             enrichedChunk,
-                                             aggregation,
-                                             aggregationContext,
-                                             aggregationTimeDelta,
-                                             is_reversed,
-                                             appendValue,
-                                             contextScope,
-                                             agg_n_samples,
-                                             si,
-                                             sample) != 0) {
-            return -1;
-        }
-    }
-    return 0;
-}
-
 static int agg_iter_general_on_bucket_boundary(AggregationIterator *self,
                                                EnrichedChunk *enrichedChunk,
                                                Sample *sample,
@@ -1294,6 +1209,41 @@ static void agg_iter_append_sample_to_all_aggs(AggregationIterator *self,
     }
 }
 
+/* Appends samples [si, ei], which all belong to the current bucket, to every aggregation.
+ * Aggregations with appendValueVec take the whole segment in one call, the others keep getting
+ * the samples one by one in iteration order. */
+static void agg_iter_append_segment_to_all_aggs(AggregationIterator *self,
+                                                const Samples *samples,
+                                                int64_t si,
+                                                int64_t ei) {
+    for (size_t a = 0; a < self->numAggregations; a++) {
+        AggregationClass *aggregation = &self->aggregations[a];
+        void *aggregationContext = self->aggregationContexts[a];
+        if (aggregation->appendValueVec) {
+            aggregation->appendValueVec(aggregationContext, samples->_values, si, ei);
+            for (int64_t idx = si; idx <= ei && !self->validPerAgg[a]; idx++) {
+                if (aggregation->isValueValid(Samples_value_at(samples, idx, 0))) {
+                    self->validSamplesInBucket = true;
+                    self->validPerAgg[a] = true;
+                }
+            }
+            continue;
+        }
+        for (int64_t idx = si; idx <= ei; idx++) {
+            const double value = Samples_value_at(samples, idx, 0);
+            if (aggregation->isValueValid(value)) {
+                aggregation->appendValue(aggregationContext, value, samples->timestamps[idx]);
+                self->validSamplesInBucket = true;
+                self->validPerAgg[a] = true;
+            }
+        }
+    }
+}
+
+/* Splits the chunk into per-bucket segments: the sample opening a bucket goes through
+ * agg_iter_general_on_bucket_boundary and is appended on its own (in-place output may overwrite
+ * its slot), the rest of the bucket is located with findBucketEndIndex and appended as a whole.
+ * Returns 0 or -1 on fillEmptyBuckets error. */
 static int agg_iter_process_chunk_general(AggregationIterator *self,
                                           EnrichedChunk *enrichedChunk,
                                           AggregationClass *aggregation,
@@ -1311,25 +1261,29 @@ static int agg_iter_process_chunk_general(AggregationIterator *self,
     bool twaHadValid[self->numAggregations];
 
     while (*si < (int64_t)samples->num_samples) {
-        sample->timestamp = enrichedChunk->samples.timestamps[*si];
-        sample->value = Samples_value_at(&enrichedChunk->samples, *si, 0);
-        if ((!is_reversed && sample->timestamp >= *contextScope) ||
-            (is_reversed && sample->timestamp < self->aggregationLastTimestamp)) {
-            if (agg_iter_general_on_bucket_boundary(self,
-                                                    enrichedChunk,
-                                                    sample,
-                                                    aggregationTimeDelta,
-                                                    is_reversed,
-                                                    multiAgg,
-                                                    contextScope,
-                                                    agg_n_samples,
-                                                    si,
-                                                    twa_last_samples,
-                                                    twaHadValid) != 0) {
-                return -1;
-            }
+        const timestamp_t bound = is_reversed ? self->aggregationLastTimestamp : *contextScope;
+        const int64_t ei = findBucketEndIndex(samples, *si, bound, is_reversed);
+        if (ei >= *si) {
+            agg_iter_append_segment_to_all_aggs(self, samples, *si, ei);
+            *si = ei + 1;
+            continue;
         }
 
+        sample->timestamp = samples->timestamps[*si];
+        sample->value = Samples_value_at(samples, *si, 0);
+        if (agg_iter_general_on_bucket_boundary(self,
+                                                enrichedChunk,
+                                                sample,
+                                                aggregationTimeDelta,
+                                                is_reversed,
+                                                multiAgg,
+                                                contextScope,
+                                                agg_n_samples,
+                                                si,
+                                                twa_last_samples,
+                                                twaHadValid) != 0) {
+            return -1;
+        }
         agg_iter_append_sample_to_all_aggs(
             self, aggregation, aggregationContext, appendValue, sample);
         (*si)++;
@@ -1498,7 +1452,7 @@ EnrichedChunk *AggregationIterator_GetNextChunk(struct AbstractIterator *iter) {
     AbstractIterator *input = iter->input;
     EnrichedChunk *enrichedChunk = input->GetNext(input);
     size_t agg_n_samples = 0;
-    int64_t si = 0, ei;
+    int64_t si = 0;
 
     if (!enrichedChunk || enrichedChunk->samples.num_samples == 0) {
         bool enter_finalize;
@@ -1528,36 +1482,19 @@ EnrichedChunk *AggregationIterator_GetNextChunk(struct AbstractIterator *iter) {
     self->aggregationLastTimestamp = BucketStartNormalize(self->aggregationLastTimestamp);
     while (enrichedChunk) {
         assert(self->reverse == enrichedChunk->rev || enrichedChunk->samples.num_samples == 0);
-        if (self->numAggregations == 1 && aggregation->type == TS_AGG_MAX && !is_reversed) {
-            if (agg_iter_process_chunk_max_fast_path(self,
-                                                     enrichedChunk,
-                                                     aggregation,
-                                                     aggregationContext,
-                                                     aggregationTimeDelta,
-                                                     is_reversed,
-                                                     appendValue,
-                                                     &contextScope,
-                                                     &agg_n_samples,
-                                                     &si,
-                                                     &ei,
-                                                     &sample) != 0) {
-                return NULL;
-            }
-        } else {
-            if (agg_iter_process_chunk_general(self,
-                                               enrichedChunk,
-                                               aggregation,
-                                               aggregationContext,
-                                               aggregationTimeDelta,
-                                               is_reversed,
-                                               multiAgg,
-                                               appendValue,
-                                               &contextScope,
-                                               &agg_n_samples,
-                                               &si,
-                                               &sample) != 0) {
-                return NULL;
-            }
+        if (agg_iter_process_chunk_general(self,
+                                           enrichedChunk,
+                                           aggregation,
+                                           aggregationContext,
+                                           aggregationTimeDelta,
+                                           is_reversed,
+                                           multiAgg,
+                                           appendValue,
+                                           &contextScope,
+                                           &agg_n_samples,
+                                           &si,
+                                           &sample) != 0) {
+            return NULL;
         }
 
         EnrichedChunk *out =
@@ -1578,6 +1515,6 @@ void AggregationIterator_Close(struct AbstractIterator *iterator) {
     for (size_t a = 0; a < self->numAggregations; a++) {
         self->aggregations[a].freeContext(self->aggregationContexts[a]);
     }
-    FreeEnrichedChunk(self->aux_chunk);
-    free(iterator);
+    QueryArena_FreeEnrichedChunk(iterator->arena, self->aux_chunk);
+    QueryArena_Release(iterator->arena, iterator);
 }
@@ -13,30 +13,43 @@
 #ifndef FILTER_ITERATOR_H
 #define FILTER_ITERATOR_H
 
+// The first index in [si, n) of the ascending values that is >= ts, n when there is none. Gallops
+// from si, so an answer k slots away costs O(log k) comparisons.
+size_t GallopLowerBound(const timestamp_t *values, size_t si, size_t n, timestamp_t ts);
+
 typedef struct SeriesFilterTSIterator
 {
     AbstractIterator base;
     FilterByTSArgs ByTsArgs;
     size_t tsFilterIndex; // the index in the TS filter array in ByTsArgs
+    size_t limit;         // remaining samples to produce, SIZE_MAX when unbounded
     bool reverse;
 } SeriesFilterTSIterator;
 
 SeriesFilterTSIterator *SeriesFilterTSIterator_New(AbstractIterator *input,
                                                    FilterByTSArgs ByTsArgs,
-                                                   bool rev);
+                                                   size_t limit,
+                                                   bool rev,
+                                                   QueryArena *arena);
 
 EnrichedChunk *SeriesFilterTSIterator_GetNextChunk(struct AbstractIterator *base);
 
 void SeriesFilterIterator_Close(struct AbstractIterator *iterator);
 
+// Picks the FILTER_BY_VALUE kernel for the instruction sets of the CPU, see arch_features.h
+void initFilterByValueFunctions();
+
 typedef struct SeriesFilterValIterator
 {
     AbstractIterator base;
     FilterByValueArgs byValueArgs;
+    size_t limit; // remaining samples to produce, SIZE_MAX when unbounded
 } SeriesFilterValIterator;
 
 SeriesFilterValIterator *SeriesFilterValIterator_New(AbstractIterator *input,
-                                                     FilterByValueArgs byValue);
+                                                     FilterByValueArgs byValue,
+                                                     size_t limit,
+                                                     QueryArena *arena);
 
 EnrichedChunk *SeriesFilterValIterator_GetNextChunk(struct AbstractIterator *base);
 
@@ -84,7 +97,8 @@ AggregationIterator *AggregationIterator_New(struct AbstractIterator *input,
                                              api_timestamp_t startTimestamp,
                                              api_timestamp_t endTimestamp,
                                              FilterByValueArgs byValueArgs,
-                                             FilterByTSArgs byTsArgs);
+                                             FilterByTSArgs byTsArgs,
+                                             QueryArena *arena);
 EnrichedChunk *AggregationIterator_GetNextChunk(struct AbstractIterator *iter);
 void AggregationIterator_Close(struct AbstractIterator *iterator);
 
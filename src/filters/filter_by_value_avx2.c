@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "filter_by_value_avx2.h"
+
+#include <immintrin.h>
+
+#define VECTOR_SIZE_FILTER_AVX2 (sizeof(__m256d) / sizeof(double))
+
+// For every 4 bit mask of passing lanes, the 32 bit lane permutation moving the passing 64 bit
+// lanes to the front in order
+static const int32_t compactPermutation[16][8] __attribute__((aligned(32))) = {
+    { 0, 1, 2, 3, 4, 5, 6, 7 }, // 0000
+    { 0, 1, 2, 3, 4, 5, 6, 7 }, // 0001
+    { 2, 3, 2, 3, 4, 5, 6, 7 }, // 0010
+    { 0, 1, 2, 3, 4, 5, 6, 7 }, // 0011
+    { 4, 5, 2, 3, 4, 5, 6, 7 }, // 0100
+    { 0, 1, 4, 5, 4, 5, 6, 7 }, // 0101
+    { 2, 3, 4, 5, 4, 5, 6, 7 }, // 0110
+    { 0, 1, 2, 3, 4, 5, 6, 7 }, // 0111
+    { 6, 7, 2, 3, 4, 5, 6, 7 }, // 1000
+    { 0, 1, 6, 7, 4, 5, 6, 7 }, // 1001
+    { 2, 3, 6, 7, 4, 5, 6, 7 }, // 1010
+    { 0, 1, 2, 3, 6, 7, 6, 7 }, // 1011
+    { 4, 5, 6, 7, 4, 5, 6, 7 }, // 1100
+    { 0, 1, 4, 5, 6, 7, 6, 7 }, // 1101
+    { 2, 3, 4, 5, 6, 7, 6, 7 }, // 1110
+    { 0, 1, 2, 3, 4, 5, 6, 7 }, // 1111
+};
+
+size_t FilterByValueAVX2(timestamp_t *__restrict__ timestamps,
+                         double *__restrict__ values,
+                         size_t n,
+                         double min,
+                         double max) {
+    const __m256d min_avx = _mm256_set1_pd(min);
+    const __m256d max_avx = _mm256_set1_pd(max);
+    size_t count = 0, i = 0;
+    // The whole block is stored at count <= i after it was loaded, so compacting in place only
+    // overwrites samples which were already read
+    for (; i + VECTOR_SIZE_FILTER_AVX2 <= n; i += VECTOR_SIZE_FILTER_AVX2) {
+        const __m256d values_avx = _mm256_loadu_pd(&values[i]);
+        const __m256i timestamps_avx = _mm256_loadu_si256((const __m256i *)&timestamps[i]);
+        // ordered comparisons are false for NaN
+        const __m256d pass = _mm256_and_pd(_mm256_cmp_pd(values_avx, min_avx, _CMP_GE_OQ),
+                                           _mm256_cmp_pd(values_avx, max_avx, _CMP_LE_OQ));
+        const int mask = _mm256_movemask_pd(pass);
+        const __m256i permutation = _mm256_load_si256((const __m256i *)compactPermutation[mask]);
+        _mm256_storeu_pd(&values[count],
+                         _mm256_castsi256_pd(_mm256_permutevar8x32_epi32(
+                             _mm256_castpd_si256(values_avx), permutation)));
+        _mm256_storeu_si256((__m256i *)&timestamps[count],
+                            _mm256_permutevar8x32_epi32(timestamps_avx, permutation));
+        count += __builtin_popcount(mask);
+    }
+    return FilterByValueCompact(timestamps, values, count, i, n, min, max);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "filter_by_value_avx512f.h"
+
+#include <immintrin.h>
+
+#define VECTOR_SIZE_FILTER_AVX512F (sizeof(__m512d) / sizeof(double))
+
+size_t FilterByValueAVX512F(timestamp_t *__restrict__ timestamps,
+                            double *__restrict__ values,
+                            size_t n,
+                            double min,
+                            double max) {
+    const __m512d min_avx = _mm512_set1_pd(min);
+    const __m512d max_avx = _mm512_set1_pd(max);
+    size_t count = 0, i = 0;
+    for (; i + VECTOR_SIZE_FILTER_AVX512F <= n; i += VECTOR_SIZE_FILTER_AVX512F) {
+        const __m512d values_avx = _mm512_loadu_pd(&values[i]);
+        const __m512i timestamps_avx = _mm512_loadu_si512(&timestamps[i]);
+        // ordered comparisons are false for NaN
+        const __mmask8 pass = _mm512_cmp_pd_mask(values_avx, min_avx, _CMP_GE_OQ) &
+                              _mm512_cmp_pd_mask(values_avx, max_avx, _CMP_LE_OQ);
+        // only the passing lanes are written, at count <= i
+        _mm512_mask_compressstoreu_pd(&values[count], pass, values_avx);
+        _mm512_mask_compressstoreu_epi64(&timestamps[count], pass, timestamps_avx);
+        count += __builtin_popcount(pass);
+    }
+    return FilterByValueCompact(timestamps, values, count, i, n, min, max);
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef FILTER_BY_VALUE_AVX512F_H
+#define FILTER_BY_VALUE_AVX512F_H
+
+#include "filter_by_value_common.h"
+
+size_t FilterByValueAVX512F(timestamp_t *__restrict__ timestamps,
+                            double *__restrict__ values,
+                            size_t n,
+                            double min,
+                            double max);
+
+#endif // FILTER_BY_VALUE_AVX512F_H
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef FILTER_BY_VALUE_COMMON_H
+#define FILTER_BY_VALUE_COMMON_H
+
+#include "../consts.h"
+
+#include <stddef.h>
+
+// Keeps the samples of [0, n) whose value is within [min, max] (NaN never is), compacting the
+// timestamps and values in place in their original order. Returns the number of samples kept.
+typedef size_t (*FilterByValueFunc)(timestamp_t *__restrict__ timestamps,
+                                    double *__restrict__ values,
+                                    size_t n,
+                                    double min,
+                                    double max);
+
+// Branch-free stream compaction of [i, n) after count samples were kept from [0, i): every sample
+// is written to the output slot and the slot only advances when it passed, so the data-dependent
+// outcome never reaches a branch predictor. Returns the total number of samples kept.
+static inline size_t FilterByValueCompact(timestamp_t *__restrict__ timestamps,
+                                          double *__restrict__ values,
+                                          size_t count,
+                                          size_t i,
+                                          size_t n,
+                                          double min,
+                                          double max) {
+    for (; i < n; i++) {
+        const double value = values[i];
+        timestamps[count] = timestamps[i];
+        values[count] = value;
+        count += (value >= min) & (value <= max);
+    }
+    return count;
+}
+
+static inline size_t FilterByValueScalar(timestamp_t *__restrict__ timestamps,
+                                         double *__restrict__ values,
+                                         size_t n,
+                                         double min,
+                                         double max) {
+    return FilterByValueCompact(timestamps, values, 0, 0, n, min, max);
+}
+
+#endif // FILTER_BY_VALUE_COMMON_H
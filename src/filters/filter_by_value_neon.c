@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "filter_by_value_neon.h"
+
+#include <arm_neon.h>
+
+#define VECTOR_SIZE_FILTER_NEON (sizeof(float64x2_t) / sizeof(double))
+
+// NEON has neither a movemask nor a compress store: the predicate is evaluated two lanes at a
+// time and each lane is stored at the output slot, which advances by the lane's mask bit.
+size_t FilterByValueNEON(timestamp_t *__restrict__ timestamps,
+                         double *__restrict__ values,
+                         size_t n,
+                         double min,
+                         double max) {
+    const float64x2_t min_neon = vdupq_n_f64(min);
+    const float64x2_t max_neon = vdupq_n_f64(max);
+    size_t count = 0, i = 0;
+    for (; i + VECTOR_SIZE_FILTER_NEON * 2 <= n; i += VECTOR_SIZE_FILTER_NEON * 2) {
+        const float64x2_t values0 = vld1q_f64(&values[i]);
+        const float64x2_t values1 = vld1q_f64(&values[i + VECTOR_SIZE_FILTER_NEON]);
+        const uint64x2_t timestamps0 = vld1q_u64(&timestamps[i]);
+        const uint64x2_t timestamps1 = vld1q_u64(&timestamps[i + VECTOR_SIZE_FILTER_NEON]);
+        // ordered comparisons are false for NaN, a passing lane is all ones
+        const uint64x2_t pass0 =
+            vandq_u64(vcgeq_f64(values0, min_neon), vcleq_f64(values0, max_neon));
+        const uint64x2_t pass1 =
+            vandq_u64(vcgeq_f64(values1, min_neon), vcleq_f64(values1, max_neon));
+
+        vst1q_lane_f64(&values[count], values0, 0);
+        vst1q_lane_u64(&timestamps[count], timestamps0, 0);
+        count += vgetq_lane_u64(pass0, 0) & 1;
+        vst1q_lane_f64(&values[count], values0, 1);
+        vst1q_lane_u64(&timestamps[count], timestamps0, 1);
+        count += vgetq_lane_u64(pass0, 1) & 1;
+        vst1q_lane_f64(&values[count], values1, 0);
+        vst1q_lane_u64(&timestamps[count], timestamps1, 0);
+        count += vgetq_lane_u64(pass1, 0) & 1;
+        vst1q_lane_f64(&values[count], values1, 1);
+        vst1q_lane_u64(&timestamps[count], timestamps1, 1);
+        count += vgetq_lane_u64(pass1, 1) & 1;
+    }
+    return FilterByValueCompact(timestamps, values, count, i, n, min, max);
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "fused_aggregation.h"
+
+#include "tsdb.h"
+
+#include "rmutil/alloc.h"
+
+typedef struct FusedAggregationIterator
+{
+    AbstractIterator base;
+    Series *series;
+    RedisModuleDictIter *dictIter;
+    Chunk_t *currentChunk;
+    timestamp_t startTimestamp;
+    timestamp_t endTimestamp;
+    FusedAggregationCtx ctx;
+    EnrichedChunk *enrichedChunk;
+    bool done;
+} FusedAggregationIterator;
+
+bool FusedAggregation_Supported(const Series *series, const RangeArgs *args, bool reverse) {
+    if (reverse || args->aggregationArgs.numClasses != 1 || args->aggregationArgs.empty ||
+        args->filterByTSArgs.hasValue || args->filterByValueArgs.hasValue ||
+        (args->latest && series->srcKey)) {
+        return false;
+    }
+
+    switch (args->aggregationArgs.classes[0]->type) {
+        case TS_AGG_MIN:
+        case TS_AGG_MAX:
+        case TS_AGG_SUM:
+        case TS_AGG_AVG:
+        case TS_AGG_COUNT:
+        case TS_AGG_FIRST:
+        case TS_AGG_LAST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static EnrichedChunk *FusedAggregationIterator_GetNextChunk(AbstractIterator *iter) {
+    FusedAggregationIterator *self = (FusedAggregationIterator *)iter;
+    const ChunkFuncs *funcs = self->series->funcs;
+    Samples *out = &self->enrichedChunk->samples;
+
+    if (self->done) {
+        return NULL;
+    }
+
+    ResetEnrichedChunk(self->enrichedChunk);
+    while (self->currentChunk) {
+        Chunk_t *chunk = self->currentChunk;
+        if (funcs->GetFirstTimestamp(chunk) > self->endTimestamp) {
+            break;
+        }
+        if (!RedisModule_DictNextC(self->dictIter, NULL, (void *)&self->currentChunk)) {
+            self->currentChunk = NULL;
+        }
+
+        // a chunk can close at most one bucket per sample
+        const size_t needed = funcs->GetNumOfSample(chunk) + 1;
+        if (out->size < needed) {
+            ReallocSamplesArray(out, needed);
+        }
+        funcs->AggregateRange(chunk, self->startTimestamp, self->endTimestamp, &self->ctx);
+        if (out->num_samples > 0) {
+            return self->enrichedChunk;
+        }
+    }
+
+    self->done = true;
+    if (self->ctx.initialized) {
+        if (out->size == 0) {
+            ReallocSamplesArray(out, 1);
+        }
+        FusedAggregation_CloseBucket(&self->ctx);
+    }
+    return out->num_samples > 0 ? self->enrichedChunk : NULL;
+}
+
+static void FusedAggregationIterator_Close(AbstractIterator *iter) {
+    FusedAggregationIterator *self = (FusedAggregationIterator *)iter;
+    RedisModule_DictIteratorStop(self->dictIter);
+    self->ctx.aggregation->freeContext(self->ctx.context);
+    QueryArena_FreeEnrichedChunk(iter->arena, self->enrichedChunk);
+    QueryArena_Release(iter->arena, self);
+}
+
+AbstractIterator *FusedAggregationIterator_New(Series *series,
+                                               timestamp_t startTimestamp,
+                                               timestamp_t endTimestamp,
+                                               AggregationClass *aggregation,
+                                               int64_t timeDelta,
+                                               timestamp_t timestampAlignment,
+                                               BucketTimestamp bucketTS,
+                                               QueryArena *arena) {
+    FusedAggregationIterator *iter = QueryArena_Alloc(arena, sizeof(FusedAggregationIterator));
+    iter->base.GetNext = FusedAggregationIterator_GetNextChunk;
+    iter->base.Close = FusedAggregationIterator_Close;
+    iter->base.input = NULL;
+    iter->base.arena = arena;
+    iter->series = series;
+    iter->startTimestamp = startTimestamp;
+    iter->endTimestamp = endTimestamp;
+    iter->done = false;
+    iter->enrichedChunk = QueryArena_NewEnrichedChunk(arena, 1);
+    iter->ctx = (FusedAggregationCtx){
+        .aggregation = aggregation,
+        .context = aggregation->createContext(false),
+        .timeDelta = timeDelta,
+        .timestampAlignment = timestampAlignment,
+        .bucketTS = bucketTS,
+        .bucketStart = 0,
+        .bucketEnd = 0,
+        .initialized = false,
+        .validSamplesInBucket = false,
+        .out = &iter->enrichedChunk->samples,
+    };
+
+    // same chunk lookup as SeriesIterator: the chunk that may contain startTimestamp, or the first
+    timestamp_t rax_key;
+    seriesEncodeTimestamp(&rax_key, startTimestamp);
+    iter->dictIter =
+        RedisModule_DictIteratorStartC(series->chunks, "<=", &rax_key, sizeof(rax_key));
+    if (!RedisModule_DictNextC(iter->dictIter, NULL, (void *)&iter->currentChunk)) {
+        RedisModule_DictIteratorReseekC(iter->dictIter, "^", NULL, 0);
+        if (!RedisModule_DictNextC(iter->dictIter, NULL, (void *)&iter->currentChunk)) {
+            iter->currentChunk = NULL;
+        }
+    }
+
+    return (AbstractIterator *)iter;
+}
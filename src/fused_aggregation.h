@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef FUSED_AGGREGATION_H
+#define FUSED_AGGREGATION_H
+
+#include "abstract_iterator.h"
+#include "enriched_chunk.h"
+#include "query_arena.h"
+#include "query_language.h"
+#include "tsdb.h"
+
+#include <math.h>
+
+/*
+ * Bucket state of a single forward aggregation which is fed straight from the chunk decoders
+ * (see ChunkFuncs.AggregateRange), without materializing the samples of the chunk.
+ * Produces the same buckets as AggregationIterator for a query without EMPTY and FILTER_BY_*.
+ */
+typedef struct FusedAggregationCtx
+{
+    AggregationClass *aggregation;
+    void *context;
+    int64_t timeDelta;
+    timestamp_t timestampAlignment;
+    BucketTimestamp bucketTS;
+    timestamp_t bucketStart; // normalized start of the current bucket
+    uint64_t bucketEnd;      // first timestamp of the next bucket
+    bool initialized;
+    bool validSamplesInBucket;
+    Samples *out; // finalized buckets, callers must leave room for one bucket per sample + 1
+} FusedAggregationCtx;
+
+static inline void FusedAggregation_OpenBucket(FusedAggregationCtx *ctx, timestamp_t ts) {
+    const timestamp_t start = CalcBucketStart(ts, ctx->timeDelta, ctx->timestampAlignment);
+    ctx->bucketEnd = start + ctx->timeDelta;
+    ctx->bucketStart = BucketStartNormalize(start);
+}
+
+// Writes the current bucket to ctx->out unless it holds only NaN samples
+static inline void FusedAggregation_CloseBucket(FusedAggregationCtx *ctx) {
+    if (ctx->validSamplesInBucket) {
+        Samples *out = ctx->out;
+        ctx->aggregation->finalize(ctx->context, &Samples_value_at(out, out->num_samples, 0));
+        switch (ctx->bucketTS) {
+            case BucketMidTimestamp:
+                out->timestamps[out->num_samples] = ctx->bucketStart + ctx->timeDelta / 2;
+                break;
+            case BucketEndTimestamp:
+                out->timestamps[out->num_samples] = ctx->bucketStart + ctx->timeDelta;
+                break;
+            default:
+                out->timestamps[out->num_samples] = ctx->bucketStart;
+                break;
+        }
+        out->num_samples++;
+    }
+    ctx->aggregation->resetContext(ctx->context);
+    ctx->validSamplesInBucket = false;
+}
+
+// Samples must be fed in ascending timestamp order
+static inline void FusedAggregation_AddSample(FusedAggregationCtx *ctx,
+                                              timestamp_t ts,
+                                              double value) {
+    if (unlikely(ts >= ctx->bucketEnd || !ctx->initialized)) {
+        if (ctx->initialized) {
+            FusedAggregation_CloseBucket(ctx);
+        }
+        ctx->initialized = true;
+        FusedAggregation_OpenBucket(ctx, ts);
+    }
+    // all the supported aggregations ignore NaN samples
+    if (!isnan(value)) {
+        ctx->aggregation->appendValue(ctx->context, value, ts);
+        ctx->validSamplesInBucket = true;
+    }
+}
+
+// Whether SeriesQuery can replace the SeriesIterator -> AggregationIterator chain with
+// FusedAggregationIterator for these arguments
+bool FusedAggregation_Supported(const Series *series, const RangeArgs *args, bool reverse);
+
+AbstractIterator *FusedAggregationIterator_New(Series *series,
+                                               timestamp_t startTimestamp,
+                                               timestamp_t endTimestamp,
+                                               AggregationClass *aggregation,
+                                               int64_t timeDelta,
+                                               timestamp_t timestampAlignment,
+                                               BucketTimestamp bucketTS,
+                                               QueryArena *arena);
+
+#endif // FUSED_AGGREGATION_H
@@ -16,9 +16,11 @@ static const ChunkFuncs regChunk = {
 
     .AddSample = Uncompressed_AddSample,
     .UpsertSample = Uncompressed_UpsertSample,
+    .UpsertSamples = Uncompressed_UpsertSamples,
     .DelRange = Uncompressed_DelRange,
 
     .ProcessChunk = Uncompressed_ProcessChunk,
+    .AggregateRange = Uncompressed_AggregateRange,
 
     .GetChunkSize = Uncompressed_GetChunkSize,
     .GetNumOfSample = Uncompressed_NumOfSample,
@@ -41,9 +43,11 @@ static const ChunkFuncs comprChunk = {
 
     .AddSample = Compressed_AddSample,
     .UpsertSample = Compressed_UpsertSample,
+    .UpsertSamples = Compressed_UpsertSamples,
     .DelRange = Compressed_DelRange,
 
     .ProcessChunk = Compressed_ProcessChunk,
+    .AggregateRange = Compressed_AggregateRange,
 
     .GetChunkSize = Compressed_GetChunkSize,
     .GetNumOfSample = Compressed_ChunkNumOfSample,
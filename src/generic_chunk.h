@@ -23,6 +23,7 @@
 #include <stdint.h>
 
 struct RedisModuleIO;
+struct FusedAggregationCtx;
 
 typedef struct Sample
 {
@@ -45,6 +46,14 @@ typedef struct UpsertCtx
     Chunk_t *inChunk; // original chunk
 } UpsertCtx;
 
+typedef struct UpsertBatchCtx
+{
+    const Sample *samples; // sorted by timestamp, equal timestamps keep their arrival order
+    ChunkResult *results;  // per sample, CR_OK if it was merged or CR_ERR if the policy rejected it
+    size_t count;
+    Chunk_t *inChunk; // original chunk
+} UpsertBatchCtx;
+
 typedef struct ChunkFuncs
 {
     Chunk_t *(*NewChunk)(size_t sampleCount);
@@ -56,12 +65,21 @@ typedef struct ChunkFuncs
     size_t (*DelRange)(Chunk_t *chunk, timestamp_t startTs, timestamp_t endTs);
     ChunkResult (*AddSample)(Chunk_t *chunk, Sample *sample);
     ChunkResult (*UpsertSample)(UpsertCtx *uCtx, int *size, DuplicatePolicy duplicatePolicy);
+    ChunkResult (*UpsertSamples)(UpsertBatchCtx *uCtx, int *size, DuplicatePolicy duplicatePolicy);
 
+    // Decodes the samples in [start, end], at most limit of them counted from start (from end when
+    // reverse)
     void (*ProcessChunk)(const Chunk_t *chunk,
                          uint64_t start,
                          uint64_t end,
+                         size_t limit,
                          EnrichedChunk *enrichedChunk,
                          bool reverse);
+    // Feeds the samples in [start, end] in ascending order into a fused aggregation
+    void (*AggregateRange)(const Chunk_t *chunk,
+                           uint64_t start,
+                           uint64_t end,
+                           struct FusedAggregationCtx *ctx);
 
     size_t (*GetChunkSize)(const Chunk_t *chunk, bool includeStruct);
     uint64_t (*GetNumOfSample)(Chunk_t *chunk);
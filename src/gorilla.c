@@ -94,6 +94,8 @@
 
 #include "gorilla.h"
 
+#include "fused_aggregation.h"
+
 #include <assert.h>
 #include <math.h>
 
@@ -519,8 +521,7 @@ static inline double readFloat(Compressed_Iterator *iter, const uint64_t *data)
     return iter->prevValue.d = rv.d;
 }
 
-ChunkResult Compressed_ChunkIteratorGetNext(ChunkIter_t *abstractIter, Sample *sample) {
-    Compressed_Iterator *iter = (Compressed_Iterator *)abstractIter;
+static inline ChunkResult readNextSample(Compressed_Iterator *iter, Sample *sample) {
 #ifdef DEBUG
     assert(iter);
     assert(iter->chunk);
@@ -548,3 +549,36 @@ ChunkResult Compressed_ChunkIteratorGetNext(ChunkIter_t *abstractIter, Sample *s
     iter->count++;
     return CR_OK;
 }
+
+ChunkResult Compressed_ChunkIteratorGetNext(ChunkIter_t *abstractIter, Sample *sample) {
+    return readNextSample((Compressed_Iterator *)abstractIter, sample);
+}
+
+void Compressed_AggregateSamples(const CompressedChunk *chunk,
+                                 uint64_t start,
+                                 uint64_t end,
+                                 struct FusedAggregationCtx *ctx) {
+    Compressed_Iterator iter = {
+        .chunk = (CompressedChunk *)chunk,
+        .idx = 0,
+        .count = 0,
+        .prevTS = chunk->baseTimestamp,
+        .prevDelta = 0,
+        .prevValue = chunk->baseValue,
+        .leading = 32,
+        .trailing = 32,
+        .blocksize = 0,
+    };
+    Sample sample;
+
+    // decoding is inlined here so every sample goes straight from the bitstream to the bucket
+    while (readNextSample(&iter, &sample) == CR_OK) {
+        if (sample.timestamp < start) {
+            continue;
+        }
+        if (sample.timestamp > end) {
+            break;
+        }
+        FusedAggregation_AddSample(ctx, sample.timestamp, sample.value);
+    }
+}
@@ -72,4 +72,11 @@ typedef struct Compressed_Iterator
 ChunkResult Compressed_Append(CompressedChunk *chunk, uint64_t timestamp, double value);
 ChunkResult Compressed_ChunkIteratorGetNext(ChunkIter_t *iter, Sample *sample);
 
+struct FusedAggregationCtx;
+// Decodes the samples in [start, end] and feeds them into ctx, see fused_aggregation.h
+void Compressed_AggregateSamples(const CompressedChunk *chunk,
+                                 uint64_t start,
+                                 uint64_t end,
+                                 struct FusedAggregationCtx *ctx);
+
 #endif
@@ -12,14 +12,22 @@
 
 #include "consts.h"
 #include "utils/overflow.h"
+#include "utils/roaring.h"
 
+#include <ctype.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <math.h>
+#include <regex.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <rmutil/alloc.h>
 
-RedisModuleDict *labelsIndex;  // maps label to it's ts keys.
-RedisModuleDict *tsLabelIndex; // maps ts_key to it's dict in labelsIndex
+RedisModuleDict *labelsIndex;     // maps label to the posting list (Roaring) of its series ids
+RedisModuleDict *tsLabelIndex;    // maps ts_key to its IndexedSeries
+SeriesIdTable seriesIds;          // maps series id to its IndexedSeries
+RedisModuleDict *labelStatsIndex; // maps label name to its LabelStats
 extern bool isReshardTrimming, isAsmTrimming, isAsmImporting;
 
 #define KV_PREFIX_LITERAL "__index_"
@@ -27,24 +35,300 @@ extern bool isReshardTrimming, isAsmTrimming, isAsmImporting;
 #define KV_PREFIX KV_PREFIX_LITERAL "%s=%s"
 #define K_PREFIX K_PREFIX_LITERAL "%s"
 
+// An entry of a series deferred to the bulk build, the entry bytes are in IndexBuild.bytes
+typedef struct IndexBuildPair
+{
+    size_t offset;
+    uint32_t len;
+    uint32_t labelLen;
+    uint32_t id;
+} IndexBuildPair;
+
+// The entries of the series indexed while an rdb loads, built into posting lists at the end
+static struct IndexBuild
+{
+    bool active;
+    IndexBuildPair *pairs;
+    size_t count;
+    size_t capacity;
+    char *bytes;
+    size_t bytesLen;
+    size_t bytesCapacity;
+} indexBuild;
+
 typedef enum
 {
     Indexer_Add = 0x1,
     Indexer_Remove = 0x2,
 } INDEXER_OPERATION_T;
 
+// A value of a numeric label and the posting list of its index entry
+typedef struct NumericValue
+{
+    double number;
+    Roaring *postings;
+} NumericValue;
+
+// The values of a numeric label sorted by number, so a range is a binary search away
+typedef struct NumericLabelIndex
+{
+    NumericValue *values;
+    size_t count;
+    size_t capacity;
+} NumericLabelIndex;
+
+static RedisModuleDict *numericLabelsIndex; // maps a numeric label to its NumericLabelIndex
+
+// Parses a label value as a number, it must be a whole finite or infinite number
+static bool parseLabelNumber(const char *value, size_t valueLen, double *number) {
+    char buf[64];
+    if (valueLen == 0 || valueLen >= sizeof(buf) || isspace((unsigned char)value[0])) {
+        return false;
+    }
+    memcpy(buf, value, valueLen);
+    buf[valueLen] = '\0';
+    char *end;
+    *number = strtod(buf, &end);
+    return end == buf + valueLen && !isnan(*number);
+}
+
+// The first value not less than number, or greater than it when after is set
+static size_t NumericLabelIndex_Bound(const NumericLabelIndex *index, double number, bool after) {
+    size_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (index->values[mid].number < number || (after && index->values[mid].number == number)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void NumericLabelIndex_Insert(NumericLabelIndex *index, double number, Roaring *postings) {
+    if (index->count == index->capacity) {
+        index->capacity = max(index->capacity * 2, 16);
+        index->values = realloc(index->values, index->capacity * sizeof(NumericValue));
+    }
+    const size_t pos = NumericLabelIndex_Bound(index, number, true);
+    memmove(&index->values[pos + 1],
+            &index->values[pos],
+            (index->count - pos) * sizeof(NumericValue));
+    index->values[pos] = (NumericValue){ .number = number, .postings = postings };
+    index->count++;
+}
+
+// Adds the value of the label to the numeric index when the label is numeric and the value a
+// number. postings is the posting list of the label=value entry of labelsIndex.
+static void numericIndexAdd(const char *label,
+                            size_t labelLen,
+                            const char *value,
+                            size_t valueLen,
+                            Roaring *postings) {
+    if (numericLabelsIndex == NULL) {
+        return;
+    }
+    NumericLabelIndex *index =
+        RedisModule_DictGetC(numericLabelsIndex, (void *)label, labelLen, NULL);
+    double number;
+    if (index != NULL && parseLabelNumber(value, valueLen, &number)) {
+        NumericLabelIndex_Insert(index, number, postings);
+    }
+}
+
+// The numeric value of the entry of labelsIndex, NULL when the entry isn't the one of a number
+// of a numeric label. A label may contain '=', so each split of the entry is tried.
+static NumericValue *numericIndexFind(const char *entry,
+                                      size_t entryLen,
+                                      const Roaring *postings,
+                                      NumericLabelIndex **owner) {
+    const size_t kvLitLen = strlen(KV_PREFIX_LITERAL);
+    if (numericLabelsIndex == NULL || RedisModule_DictSize(numericLabelsIndex) == 0 ||
+        entryLen <= kvLitLen || memcmp(entry, KV_PREFIX_LITERAL, kvLitLen) != 0) {
+        return NULL;
+    }
+    const char *label = entry + kvLitLen;
+    const size_t labelValueLen = entryLen - kvLitLen;
+    for (const char *eq = memchr(label, '=', labelValueLen); eq != NULL;
+         eq = memchr(eq + 1, '=', labelValueLen - (eq + 1 - label))) {
+        NumericLabelIndex *index =
+            RedisModule_DictGetC(numericLabelsIndex, (void *)label, eq - label, NULL);
+        double number;
+        if (index == NULL || !parseLabelNumber(eq + 1, labelValueLen - (eq + 1 - label), &number)) {
+            continue;
+        }
+        for (size_t i = NumericLabelIndex_Bound(index, number, false);
+             i < index->count && index->values[i].number == number;
+             i++) {
+            if (index->values[i].postings == postings) {
+                *owner = index;
+                return &index->values[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+// Removes the posting list of the entry from the numeric index, before the list is freed
+static void numericIndexRemove(const char *entry, size_t entryLen, const Roaring *postings) {
+    NumericLabelIndex *index;
+    NumericValue *value = numericIndexFind(entry, entryLen, postings, &index);
+    if (value != NULL) {
+        const size_t pos = value - index->values;
+        memmove(value, value + 1, (index->count - pos - 1) * sizeof(NumericValue));
+        index->count--;
+    }
+}
+
+// Rebuilds the values of the numeric labels from labelsIndex, after the index was replaced
+void IndexRebuildNumericLabels() {
+    if (numericLabelsIndex == NULL) {
+        return;
+    }
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(numericLabelsIndex, "^", NULL, 0);
+    char *label;
+    size_t labelLen;
+    NumericLabelIndex *index;
+    while ((label = RedisModule_DictNextC(iter, &labelLen, (void **)&index)) != NULL) {
+        index->count = 0;
+        if (labelsIndex == NULL) { // the index isn't initialized yet
+            continue;
+        }
+        // the entries of the values of the label are contiguous, from a range seek
+        const size_t seekLen = strlen(KV_PREFIX_LITERAL) + labelLen + 1;
+        char *seek = malloc(seekLen);
+        memcpy(seek, KV_PREFIX_LITERAL, strlen(KV_PREFIX_LITERAL));
+        memcpy(seek + strlen(KV_PREFIX_LITERAL), label, labelLen);
+        seek[seekLen - 1] = '=';
+        RedisModuleDictIter *entries =
+            RedisModule_DictIteratorStartC(labelsIndex, ">=", seek, seekLen);
+        char *entry;
+        size_t entryLen;
+        Roaring *postings;
+        while ((entry = RedisModule_DictNextC(entries, &entryLen, (void **)&postings)) != NULL &&
+               entryLen >= seekLen && memcmp(entry, seek, seekLen) == 0) {
+            double number;
+            if (parseLabelNumber(entry + seekLen, entryLen - seekLen, &number)) {
+                NumericLabelIndex_Insert(index, number, postings);
+            }
+        }
+        RedisModule_DictIteratorStop(entries);
+        free(seek);
+    }
+    RedisModule_DictIteratorStop(iter);
+}
+
+void IndexSetNumericLabels(const char **labels, const size_t *labelLens, size_t count) {
+    if (numericLabelsIndex != NULL) {
+        RedisModuleDictIter *iter =
+            RedisModule_DictIteratorStartC(numericLabelsIndex, "^", NULL, 0);
+        NumericLabelIndex *index;
+        while (RedisModule_DictNextC(iter, NULL, (void **)&index) != NULL) {
+            free(index->values);
+            free(index);
+        }
+        RedisModule_DictIteratorStop(iter);
+        RedisModule_FreeDict(NULL, numericLabelsIndex);
+    }
+    numericLabelsIndex = RedisModule_CreateDict(NULL);
+    for (size_t i = 0; i < count; i++) {
+        NumericLabelIndex *index = calloc(1, sizeof(NumericLabelIndex));
+        if (RedisModule_DictSetC(numericLabelsIndex, (void *)labels[i], labelLens[i], index) !=
+            REDISMODULE_OK) { // a duplicate
+            free(index);
+        }
+    }
+    IndexRebuildNumericLabels();
+}
+
+bool IsNumericLabel(const char *label, size_t labelLen) {
+    return numericLabelsIndex != NULL &&
+           RedisModule_DictGetC(numericLabelsIndex, (void *)label, labelLen, NULL) != NULL;
+}
+
 void IndexInit() {
     labelsIndex = RedisModule_CreateDict(NULL);
     tsLabelIndex = RedisModule_CreateDict(NULL);
+    seriesIds = (SeriesIdTable){ 0 };
+    labelStatsIndex = RedisModule_CreateDict(NULL);
+    IndexRebuildNumericLabels();
+}
+
+static uint32_t SeriesIdTable_Acquire(SeriesIdTable *table, IndexedSeries *series) {
+    uint32_t id;
+    if (table->numFreeIds > 0) {
+        id = table->freeIds[--table->numFreeIds];
+    } else {
+        if (table->size == table->capacity) {
+            table->capacity = table->capacity ? table->capacity * 2 : 1024;
+            table->byId = realloc(table->byId, table->capacity * sizeof(IndexedSeries *));
+            table->freeIds = realloc(table->freeIds, table->capacity * sizeof(uint32_t));
+        }
+        id = table->size++;
+    }
+    table->byId[id] = series;
+    return id;
+}
+
+static void SeriesIdTable_Release(SeriesIdTable *table, uint32_t id) {
+    table->byId[id] = NULL;
+    table->freeIds[table->numFreeIds++] = id;
+    if (table->pending) {
+        Roaring_Remove(table->pending, id);
+    }
+}
+
+static void SeriesIdTable_Free(SeriesIdTable *table) {
+    free(table->byId);
+    free(table->freeIds);
+    Roaring_Free(table->pending);
+    free(table->pendingLabelsHash);
+    *table = (SeriesIdTable){ 0 };
+}
+
+static Roaring *defragPostings(RedisModuleDefragCtx *ctx, Roaring *postings) {
+    postings = defragPtr(ctx, postings);
+    postings->containers = defragPtr(ctx, postings->containers);
+    for (uint32_t i = 0; i < postings->count; i++) {
+        RoaringContainer *c = &postings->containers[i];
+        if (c->type == RoaringContainer_Bitset) {
+            c->words = defragPtr(ctx, c->words);
+        } else {
+            c->values = defragPtr(ctx, c->values);
+        }
+    }
+    return postings;
+}
+
+static int DefragPostingsLeaf(RedisModuleDefragCtx *ctx,
+                              void *data,
+                              unsigned char *key,
+                              size_t keylen,
+                              void **newptr) {
+    Roaring *postings = defragPostings(ctx, (Roaring *)data);
+    if (postings != data) { // the numeric index points to the posting lists too
+        NumericLabelIndex *index;
+        NumericValue *value = numericIndexFind((const char *)key, keylen, data, &index);
+        if (value != NULL) {
+            value->postings = postings;
+        }
+    }
+    *newptr = postings;
+    return DefragStatus_Finished;
 }
 
-static int DefragIndexLeaf(RedisModuleDefragCtx *ctx,
-                           void *data,
-                           __unused unsigned char *key,
-                           __unused size_t keylen,
-                           void **newptr) {
+static int DefragIndexedSeriesLeaf(RedisModuleDefragCtx *ctx,
+                                   void *data,
+                                   __unused unsigned char *key,
+                                   __unused size_t keylen,
+                                   void **newptr) {
     static RedisModuleString *seekTo = NULL;
-    *newptr = (void *)defragDict(ctx, (RedisModuleDict *)data, NULL, &seekTo);
+    IndexedSeries *series = defragPtr(ctx, data);
+    seriesIds.byId[series->id] = series;
+    series->key = defragString(ctx, series->key);
+    series->labels = defragDict(ctx, series->labels, NULL, &seekTo);
+    *newptr = series;
     return (seekTo == NULL) ? DefragStatus_Finished : DefragStatus_Paused;
 }
 
@@ -53,13 +337,18 @@ int DefragIndex(RedisModuleDefragCtx *ctx) {
     static RedisModuleDict **index = &labelsIndex;
 
     // can only defrag one index at a time
-    *index = defragDict(ctx, *index, DefragIndexLeaf, &seekTo);
+    *index = defragDict(ctx,
+                        *index,
+                        index == &labelsIndex ? DefragPostingsLeaf : DefragIndexedSeriesLeaf,
+                        &seekTo);
     if (seekTo != NULL) { // defrag paused
         return DefragStatus_Paused;
     }
 
     index = (index == &labelsIndex) ? &tsLabelIndex : &labelsIndex;
     if (index == &labelsIndex) { // defragged both indexes, done
+        seriesIds.byId = defragPtr(ctx, seriesIds.byId);
+        seriesIds.freeIds = defragPtr(ctx, seriesIds.freeIds);
         return DefragStatus_Finished;
     }
 
@@ -169,6 +458,67 @@ int parsePredicate(RedisModuleCtx *ctx,
     return TSDB_OK;
 }
 
+// Compiles the regex of a l=~re or l!~re predicate, it must match the whole value
+static bool CompileLabelRegex(const char *pattern, size_t patternLen, regex_t *regex) {
+    char *anchored = malloc(patternLen + sizeof("^()$"));
+    sprintf(anchored, "^(%.*s)$", (int)patternLen, pattern);
+    const int rc = regcomp(regex, anchored, REG_EXTENDED | REG_NOSUB);
+    free(anchored);
+    return rc == 0;
+}
+
+int parsePatternPredicate(RedisModuleCtx *ctx,
+                          const char *label_value_pair,
+                          size_t label_value_pair_size,
+                          size_t operator_pos,
+                          QueryPredicate *retQuery) {
+    const char *value = label_value_pair + operator_pos + 2;
+    const size_t value_size = label_value_pair_size - operator_pos - 2;
+    if (operator_pos == 0 || value_size == 0) {
+        return TSDB_ERROR;
+    }
+    if (retQuery->type != PREFIX_MATCH) {
+        regex_t regex;
+        if (!CompileLabelRegex(value, value_size, &regex)) {
+            return TSDB_ERROR;
+        }
+        regfree(&regex);
+    }
+
+    retQuery->key = RedisModule_CreateString(NULL, label_value_pair, operator_pos);
+    retQuery->valueListCount = 1;
+    retQuery->valuesList = malloc(sizeof(RedisModuleString *));
+    retQuery->valuesList[0] = RedisModule_CreateString(NULL, value, value_size);
+    return TSDB_OK;
+}
+
+int parseRangePredicate(RedisModuleCtx *ctx,
+                        const char *label_value_pair,
+                        size_t label_value_pair_size,
+                        size_t operator_pos,
+                        QueryPredicate *retQuery) {
+    const char *op = label_value_pair + operator_pos;
+    const bool orEqual = op[1] == '=';
+    const char *value = op + 1 + orEqual;
+    const size_t value_size = label_value_pair_size - operator_pos - 1 - orEqual;
+    double bound;
+    if (operator_pos == 0 || !IsNumericLabel(label_value_pair, operator_pos) ||
+        !parseLabelNumber(value, value_size, &bound)) {
+        return TSDB_ERROR;
+    }
+
+    if (op[0] == '>') {
+        retQuery->type = orEqual ? NUMERIC_GE : NUMERIC_GT;
+    } else {
+        retQuery->type = orEqual ? NUMERIC_LE : NUMERIC_LT;
+    }
+    retQuery->key = RedisModule_CreateString(NULL, label_value_pair, operator_pos);
+    retQuery->valueListCount = 1;
+    retQuery->valuesList = malloc(sizeof(RedisModuleString *));
+    retQuery->valuesList[0] = RedisModule_CreateString(NULL, value, value_size);
+    return TSDB_OK;
+}
+
 int CountPredicateType(QueryPredicateList *queries, PredicateType type) {
     int count = 0;
     for (int i = 0; i < queries->count; i++) {
@@ -179,55 +529,243 @@ int CountPredicateType(QueryPredicateList *queries, PredicateType type) {
     return count;
 }
 
-static inline void labelsIndexRemoveTsKey(RedisModuleDict *leaf,
-                                          RedisModuleString *key,
-                                          RedisModuleString *ts_key,
-                                          RedisModuleDict *_labelsIndex) {
-    RedisModule_DictDel(leaf, ts_key, NULL);
-    if (RedisModule_DictSize(leaf) == 0) {
-        RedisModule_FreeDict(NULL, leaf);
+int CountMatcherPredicates(QueryPredicateList *queries) {
+    int fewest = INT_MAX, count = 0;
+    for (int i = 0; i < queries->count; i++) {
+        if (queries->list[i].type == GROUP_OR) {
+            fewest = min(fewest, count);
+            count = 0;
+        } else if (IS_MATCHER(queries->list[i].type)) {
+            count++;
+        }
+    }
+    return min(fewest, count);
+}
+
+// Returns whether the posting list of key was deleted as it became empty
+static bool labelsIndexRemoveSeries(RedisModuleDict *_labelsIndex,
+                                    RedisModuleString *key,
+                                    uint32_t id) {
+    int nokey = 0;
+    Roaring *postings = RedisModule_DictGet(_labelsIndex, key, &nokey);
+    if (nokey) {
+        return false;
+    }
+    Roaring_Remove(postings, id);
+    if (Roaring_Cardinality(postings) == 0) {
+        if (_labelsIndex == labelsIndex) {
+            size_t keyLen;
+            const char *keyBuf = RedisModule_StringPtrLen(key, &keyLen);
+            numericIndexRemove(keyBuf, keyLen, postings);
+        }
+        Roaring_Free(postings);
         RedisModule_DictDel(_labelsIndex, key, NULL);
+        return true;
     }
+    return false;
 }
 
-void labelIndexUnderKey(INDEXER_OPERATION_T op,
-                        RedisModuleString *key,
-                        RedisModuleString *ts_key,
-                        RedisModuleDict *_labelsIndex,
-                        RedisModuleDict *_tsLabelIndex) {
+// Adds the series to the posting list of key, *created is the list when it's new, NULL
+// otherwise. Returns whether the series wasn't in the list yet.
+static bool labelIndexUnderKey(RedisModuleString *key,
+                               IndexedSeries *series,
+                               LabelStats *stats,
+                               Roaring **created) {
     int nokey = 0;
-    RedisModuleDict *leaf = RedisModule_DictGet(_labelsIndex, key, &nokey);
+    Roaring *postings = RedisModule_DictGet(labelsIndex, key, &nokey);
+    *created = NULL;
     if (nokey) {
-        leaf = RedisModule_CreateDict(NULL);
-        RedisModule_DictSet(_labelsIndex, key, leaf);
+        postings = Roaring_New();
+        RedisModule_DictSet(labelsIndex, key, postings);
+        *created = postings;
     }
+    RedisModule_DictSet(series->labels, key, stats);
+    return Roaring_Add(postings, series->id);
+}
 
-    RedisModuleDict *ts_leaf = RedisModule_DictGet(_tsLabelIndex, ts_key, &nokey);
+static LabelStats *labelStatsUnderLabel(const char *label, size_t labelLen) {
+    int nokey = 0;
+    LabelStats *stats = RedisModule_DictGetC(labelStatsIndex, (void *)label, labelLen, &nokey);
     if (nokey) {
-        ts_leaf = RedisModule_CreateDict(NULL);
-        RedisModule_DictSet(_tsLabelIndex, ts_key, ts_leaf);
+        stats = calloc(1, sizeof(LabelStats));
+        RedisModule_DictSetC(labelStatsIndex, (void *)label, labelLen, stats);
+    }
+    return stats;
+}
+
+// Updates the stats of a label after the series was removed from the posting list of key, an
+// entry of a value of the label or the entry of the label itself
+static void labelStatsRemoveSeries(RedisModuleDict *_labelStatsIndex,
+                                   RedisModuleString *key,
+                                   LabelStats *stats,
+                                   bool postingsDeleted) {
+    size_t keyLen;
+    const char *keyBuf = RedisModule_StringPtrLen(key, &keyLen);
+    const size_t kLitLen = strlen(K_PREFIX_LITERAL);
+    if (keyLen < kLitLen || memcmp(keyBuf, K_PREFIX_LITERAL, kLitLen) != 0) {
+        stats->numValues -= postingsDeleted;
+        return;
+    }
+    // the entries of the values sort before the entry of the label, so they are already removed
+    if (--stats->numSeries == 0) {
+        RedisModule_DictDelC(_labelStatsIndex, (void *)(keyBuf + kLitLen), keyLen - kLitLen, NULL);
+        free(stats);
     }
+}
+
+static void IndexBuild_Add(const char *label,
+                           size_t labelLen,
+                           const char *value,
+                           size_t valueLen,
+                           uint32_t id) {
+    const size_t kvLitLen = strlen(KV_PREFIX_LITERAL), kLitLen = strlen(K_PREFIX_LITERAL);
+    const size_t needed = kvLitLen + labelLen + 1 + valueLen + kLitLen + labelLen;
+    if (indexBuild.bytesLen + needed > indexBuild.bytesCapacity) {
+        indexBuild.bytesCapacity = max(indexBuild.bytesCapacity * 2, indexBuild.bytesLen + needed);
+        indexBuild.bytes = realloc(indexBuild.bytes, indexBuild.bytesCapacity);
+    }
+    if (indexBuild.count + 2 > indexBuild.capacity) {
+        indexBuild.capacity = max(indexBuild.capacity * 2, 64);
+        indexBuild.pairs = realloc(indexBuild.pairs, indexBuild.capacity * sizeof(IndexBuildPair));
+    }
+
+    char *entry = indexBuild.bytes + indexBuild.bytesLen;
+    memcpy(entry, KV_PREFIX_LITERAL, kvLitLen);
+    memcpy(entry + kvLitLen, label, labelLen);
+    entry[kvLitLen + labelLen] = '=';
+    memcpy(entry + kvLitLen + labelLen + 1, value, valueLen);
+    const size_t kvLen = kvLitLen + labelLen + 1 + valueLen;
+    memcpy(entry + kvLen, K_PREFIX_LITERAL, kLitLen);
+    memcpy(entry + kvLen + kLitLen, label, labelLen);
+
+    indexBuild.pairs[indexBuild.count++] = (IndexBuildPair){
+        .offset = indexBuild.bytesLen, .len = kvLen, .labelLen = labelLen, .id = id
+    };
+    indexBuild.pairs[indexBuild.count++] = (IndexBuildPair){ .offset = indexBuild.bytesLen + kvLen,
+                                                             .len = kLitLen + labelLen,
+                                                             .labelLen = labelLen,
+                                                             .id = id };
+    indexBuild.bytesLen += needed;
+}
 
-    if (op & Indexer_Add) {
-        RedisModule_DictSet(leaf, ts_key, NULL);
-        RedisModule_DictSet(ts_leaf, key, NULL);
-    } else if (op & Indexer_Remove) {
-        labelsIndexRemoveTsKey(leaf, key, ts_key, _labelsIndex);
+static int IndexBuildPair_Compare(const void *a, const void *b) {
+    const IndexBuildPair *pa = a, *pb = b;
+    const int cmp = memcmp(indexBuild.bytes + pa->offset,
+                           indexBuild.bytes + pb->offset,
+                           min(pa->len, pb->len));
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (pa->len != pb->len) {
+        return pa->len < pb->len ? -1 : 1;
+    }
+    return pa->id < pb->id ? -1 : pa->id > pb->id;
+}
+
+// Builds the deferred entries, each posting list is looked up once and filled in id order
+static void IndexBuild_Flush() {
+    if (indexBuild.count == 0) {
+        return;
+    }
+    qsort(indexBuild.pairs, indexBuild.count, sizeof(IndexBuildPair), IndexBuildPair_Compare);
+    const size_t kLitLen = strlen(K_PREFIX_LITERAL), kvLitLen = strlen(KV_PREFIX_LITERAL);
+    size_t i = 0;
+    while (i < indexBuild.count) {
+        const IndexBuildPair *first = &indexBuild.pairs[i];
+        const char *entry = indexBuild.bytes + first->offset;
+        const bool isLabelEntry =
+            first->len >= kLitLen && memcmp(entry, K_PREFIX_LITERAL, kLitLen) == 0;
+
+        int nokey = 0;
+        Roaring *postings = RedisModule_DictGetC(labelsIndex, (void *)entry, first->len, &nokey);
+        if (nokey) {
+            postings = Roaring_New();
+            RedisModule_DictSetC(labelsIndex, (void *)entry, first->len, postings);
+        }
+        LabelStats *stats = labelStatsUnderLabel(entry + (isLabelEntry ? kLitLen : kvLitLen),
+                                                 first->labelLen);
+        uint64_t added = 0;
+        for (; i < indexBuild.count && indexBuild.pairs[i].len == first->len &&
+               memcmp(entry, indexBuild.bytes + indexBuild.pairs[i].offset, first->len) == 0;
+             i++) {
+            const uint32_t id = indexBuild.pairs[i].id;
+            RedisModule_DictSetC(seriesIds.byId[id]->labels, (void *)entry, first->len, stats);
+            added += Roaring_Add(postings, id);
+        }
+        if (isLabelEntry) {
+            stats->numSeries += added;
+        } else if (nokey) {
+            stats->numValues++;
+            const size_t valueOffset = kvLitLen + first->labelLen + 1;
+            numericIndexAdd(entry + kvLitLen,
+                            first->labelLen,
+                            entry + valueOffset,
+                            first->len - valueOffset,
+                            postings);
+        }
     }
+    indexBuild.count = 0;
+    indexBuild.bytesLen = 0;
+}
+
+void IndexBulkBuildStart() {
+    indexBuild.active = true;
+}
+
+uint64_t IndexBulkBuildEnd() {
+    const uint64_t built = indexBuild.count / 2;
+    IndexBuild_Flush();
+    free(indexBuild.pairs);
+    free(indexBuild.bytes);
+    indexBuild = (struct IndexBuild){ 0 };
+    return built;
 }
 
 void IndexMetric(RedisModuleString *ts_key, Label *labels, size_t labels_count) {
+    if (labels_count == 0) { // series without labels aren't indexed
+        return;
+    }
+
+    int nokey = 0;
+    IndexedSeries *series = RedisModule_DictGet(tsLabelIndex, ts_key, &nokey);
+    if (nokey) {
+        series = malloc(sizeof(IndexedSeries));
+        series->key = RedisModule_CreateStringFromString(NULL, ts_key);
+        series->labels = RedisModule_CreateDict(NULL);
+        series->id = SeriesIdTable_Acquire(&seriesIds, series);
+        // unknown until the series publishes it, so the series is never skipped by a query
+        series->firstTimestamp = 0;
+        series->lastTimestamp = UINT64_MAX;
+        RedisModule_DictSet(tsLabelIndex, ts_key, series);
+    }
+
+    if (indexBuild.active) {
+        for (size_t i = 0; i < labels_count; i++) {
+            size_t labelLen, valueLen;
+            const char *label = RedisModule_StringPtrLen(labels[i].key, &labelLen);
+            const char *value = RedisModule_StringPtrLen(labels[i].value, &valueLen);
+            IndexBuild_Add(label, labelLen, value, valueLen, series->id);
+        }
+        return;
+    }
+
     const char *key_string, *value_string;
     for (int i = 0; i < labels_count; i++) {
-        size_t _s;
-        key_string = RedisModule_StringPtrLen(labels[i].key, &_s);
-        value_string = RedisModule_StringPtrLen(labels[i].value, &_s);
+        size_t key_len, value_len;
+        key_string = RedisModule_StringPtrLen(labels[i].key, &key_len);
+        value_string = RedisModule_StringPtrLen(labels[i].value, &value_len);
         RedisModuleString *indexed_key_value =
             RedisModule_CreateStringPrintf(NULL, KV_PREFIX, key_string, value_string);
         RedisModuleString *indexed_key = RedisModule_CreateStringPrintf(NULL, K_PREFIX, key_string);
 
-        labelIndexUnderKey(Indexer_Add, indexed_key_value, ts_key, labelsIndex, tsLabelIndex);
-        labelIndexUnderKey(Indexer_Add, indexed_key, ts_key, labelsIndex, tsLabelIndex);
+        LabelStats *stats = labelStatsUnderLabel(key_string, key_len);
+        Roaring *created;
+        labelIndexUnderKey(indexed_key_value, series, stats, &created);
+        if (created) {
+            stats->numValues++;
+            numericIndexAdd(key_string, key_len, value_string, value_len, created);
+        }
+        stats->numSeries += labelIndexUnderKey(indexed_key, series, stats, &created);
 
         RedisModule_FreeString(NULL, indexed_key_value);
         RedisModule_FreeString(NULL, indexed_key);
@@ -239,21 +777,28 @@ void IndexMetric(RedisModuleString *ts_key, Label *labels, size_t labels_count)
 void RemoveIndexedMetric_generic(RedisModuleString *ts_key,
                                  RedisModuleDict *_labelsIndex,
                                  RedisModuleDict *_tsLabelIndex,
+                                 SeriesIdTable *_seriesIds,
+                                 RedisModuleDict *_labelStatsIndex,
                                  bool del_key) {
     int nokey = 0;
-    RedisModuleDict *ts_leaf = RedisModule_DictGet(_tsLabelIndex, ts_key, &nokey);
+    IndexedSeries *series = RedisModule_DictGet(_tsLabelIndex, ts_key, &nokey);
     if (nokey) { // series has no labels or already been removed from index
         return;
     }
 
-    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(ts_leaf, "^", NULL, 0);
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(series->labels, "^", NULL, 0);
     RedisModuleString *currentLabelKey;
-    while ((currentLabelKey = RedisModule_DictNext(NULL, iter, NULL)) != NULL) {
-        labelIndexUnderKey(Indexer_Remove, currentLabelKey, ts_key, _labelsIndex, _tsLabelIndex);
+    LabelStats *stats;
+    while ((currentLabelKey = RedisModule_DictNext(NULL, iter, (void **)&stats)) != NULL) {
+        const bool deleted = labelsIndexRemoveSeries(_labelsIndex, currentLabelKey, series->id);
+        labelStatsRemoveSeries(_labelStatsIndex, currentLabelKey, stats, deleted);
         RedisModule_FreeString(NULL, currentLabelKey);
     }
     RedisModule_DictIteratorStop(iter);
-    RedisModule_FreeDict(NULL, ts_leaf);
+    RedisModule_FreeDict(NULL, series->labels);
+    SeriesIdTable_Release(_seriesIds, series->id);
+    RedisModule_FreeString(NULL, series->key);
+    free(series);
     if (del_key) {
         RedisModule_DictDel(_tsLabelIndex, ts_key, NULL);
     }
@@ -261,25 +806,34 @@ void RemoveIndexedMetric_generic(RedisModuleString *ts_key,
 
 // Removes the ts from the label index and from the inverse index, if exist.
 void RemoveIndexedMetric(RedisModuleString *ts_key) {
-    RemoveIndexedMetric_generic(ts_key, labelsIndex, tsLabelIndex, true);
+    // the series may have deferred entries
+    IndexBuild_Flush();
+    RemoveIndexedMetric_generic(
+        ts_key, labelsIndex, tsLabelIndex, &seriesIds, labelStatsIndex, true);
 }
 
 // Removes all indexed metrics
 void RemoveAllIndexedMetrics_generic(RedisModuleDict *_labelsIndex,
-                                     RedisModuleDict **_tsLabelIndex) {
+                                     RedisModuleDict **_tsLabelIndex,
+                                     SeriesIdTable *_seriesIds,
+                                     RedisModuleDict *_labelStatsIndex) {
     RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(*_tsLabelIndex, "^", NULL, 0);
     RedisModuleString *currentTSKey;
     while ((currentTSKey = RedisModule_DictNext(NULL, iter, NULL)) != NULL) {
-        RemoveIndexedMetric_generic(currentTSKey, _labelsIndex, *_tsLabelIndex, false);
+        RemoveIndexedMetric_generic(
+            currentTSKey, _labelsIndex, *_tsLabelIndex, _seriesIds, _labelStatsIndex, false);
         RedisModule_FreeString(NULL, currentTSKey);
     }
     RedisModule_DictIteratorStop(iter);
     RedisModule_FreeDict(NULL, *_tsLabelIndex);
     *_tsLabelIndex = RedisModule_CreateDict(NULL);
+    SeriesIdTable_Free(_seriesIds);
 }
 
 void RemoveAllIndexedMetrics() {
-    RemoveAllIndexedMetrics_generic(labelsIndex, &tsLabelIndex);
+    indexBuild.count = 0;
+    indexBuild.bytesLen = 0;
+    RemoveAllIndexedMetrics_generic(labelsIndex, &tsLabelIndex, &seriesIds, labelStatsIndex);
 }
 
 int IsKeyIndexed(RedisModuleString *ts_key) {
@@ -288,6 +842,489 @@ int IsKeyIndexed(RedisModuleString *ts_key) {
     return !nokey;
 }
 
+#define LABELS_HASH_SEED 14695981039346656037ULL
+
+// FNV-1a
+static inline uint64_t hashBytes(uint64_t hash, const char *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)buf[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// The label entries of a series are hashed one by one and summed, so their order doesn't matter
+static inline uint64_t mixEntryHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// The hash of the label index entries of the labels, IndexedSeriesLabelsHash once indexed
+static uint64_t LabelsHash(const Label *labels, size_t count) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t keyLen, valueLen;
+        const char *key = RedisModule_StringPtrLen(labels[i].key, &keyLen);
+        const char *value = RedisModule_StringPtrLen(labels[i].value, &valueLen);
+        uint64_t entry = hashBytes(LABELS_HASH_SEED, KV_PREFIX_LITERAL, strlen(KV_PREFIX_LITERAL));
+        entry = hashBytes(hashBytes(hashBytes(entry, key, keyLen), "=", 1), value, valueLen);
+        hash += mixEntryHash(entry);
+        entry = hashBytes(LABELS_HASH_SEED, K_PREFIX_LITERAL, strlen(K_PREFIX_LITERAL));
+        hash += mixEntryHash(hashBytes(entry, key, keyLen));
+    }
+    return hash;
+}
+
+static uint64_t IndexedSeriesLabelsHash(const IndexedSeries *series) {
+    uint64_t hash = 0;
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(series->labels, "^", NULL, 0);
+    const char *entry;
+    size_t entryLen;
+    while ((entry = RedisModule_DictNextC(iter, &entryLen, NULL)) != NULL) {
+        hash += mixEntryHash(hashBytes(LABELS_HASH_SEED, entry, entryLen));
+    }
+    RedisModule_DictIteratorStop(iter);
+    return hash;
+}
+
+// The length of the label name in the label index entry
+static size_t IndexEntryLabelLen(const char *entry, size_t entryLen) {
+    const size_t kLitLen = strlen(K_PREFIX_LITERAL), kvLitLen = strlen(KV_PREFIX_LITERAL);
+    if (entryLen >= kLitLen && memcmp(entry, K_PREFIX_LITERAL, kLitLen) == 0) {
+        return entryLen - kLitLen;
+    }
+    const char *separator = memchr(entry + kvLitLen, '=', entryLen - kvLitLen);
+    return separator - (entry + kvLitLen);
+}
+
+// A value entry tells its label only when no label name has a '=', as "l=v=w" could belong to
+// the label "l" or "l=v"
+static bool IndexIsPersistable() {
+    bool persistable = true;
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(labelStatsIndex, "^", NULL, 0);
+    const char *label;
+    size_t labelLen;
+    while (persistable && (label = RedisModule_DictNextC(iter, &labelLen, NULL)) != NULL) {
+        persistable = memchr(label, '=', labelLen) == NULL;
+    }
+    RedisModule_DictIteratorStop(iter);
+    return persistable;
+}
+
+// The layout of the aux data is the id table size, then the series (id, key, hash of the label
+// entries) and the posting lists (entry, length of its label name, serialized ids)
+void IndexAuxSave(RedisModuleIO *io) {
+    if (!IndexIsPersistable()) {
+        RedisModule_SaveUnsigned(io, false);
+        return;
+    }
+    RedisModule_SaveUnsigned(io, true);
+    RedisModule_SaveUnsigned(io, seriesIds.size);
+
+    RedisModule_SaveUnsigned(io, RedisModule_DictSize(tsLabelIndex));
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(tsLabelIndex, "^", NULL, 0);
+    IndexedSeries *series;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&series) != NULL) {
+        RedisModule_SaveUnsigned(io, series->id);
+        RedisModule_SaveString(io, series->key);
+        RedisModule_SaveUnsigned(io, IndexedSeriesLabelsHash(series));
+    }
+    RedisModule_DictIteratorStop(iter);
+
+    RedisModule_SaveUnsigned(io, RedisModule_DictSize(labelsIndex));
+    iter = RedisModule_DictIteratorStartC(labelsIndex, "^", NULL, 0);
+    const char *entry;
+    size_t entryLen;
+    Roaring *postings;
+    while ((entry = RedisModule_DictNextC(iter, &entryLen, (void **)&postings)) != NULL) {
+        RedisModule_SaveStringBuffer(io, entry, entryLen);
+        RedisModule_SaveUnsigned(io, IndexEntryLabelLen(entry, entryLen));
+        const size_t size = Roaring_SerializedSize(postings);
+        char *buf = malloc(size);
+        Roaring_Serialize(postings, buf);
+        RedisModule_SaveStringBuffer(io, buf, size);
+        free(buf);
+    }
+    RedisModule_DictIteratorStop(iter);
+}
+
+// An index being read from the aux data, it replaces the empty index once fully read
+typedef struct IndexRestore
+{
+    RedisModuleDict *labelsIndex;
+    RedisModuleDict *tsLabelIndex;
+    SeriesIdTable seriesIds;
+    RedisModuleDict *labelStatsIndex;
+} IndexRestore;
+
+// Frees the restored index without going through the series, which may not match the postings
+static void IndexRestore_Free(IndexRestore *restore) {
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(restore->tsLabelIndex, "^", NULL, 0);
+    IndexedSeries *series;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&series) != NULL) {
+        RedisModule_FreeDict(NULL, series->labels);
+        RedisModule_FreeString(NULL, series->key);
+        free(series);
+    }
+    RedisModule_DictIteratorStop(iter);
+    iter = RedisModule_DictIteratorStartC(restore->labelsIndex, "^", NULL, 0);
+    Roaring *postings;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&postings) != NULL) {
+        Roaring_Free(postings);
+    }
+    RedisModule_DictIteratorStop(iter);
+    iter = RedisModule_DictIteratorStartC(restore->labelStatsIndex, "^", NULL, 0);
+    LabelStats *stats;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&stats) != NULL) {
+        free(stats);
+    }
+    RedisModule_DictIteratorStop(iter);
+    SeriesIdTable_Free(&restore->seriesIds);
+    RedisModule_FreeDict(NULL, restore->labelsIndex);
+    RedisModule_FreeDict(NULL, restore->tsLabelIndex);
+    RedisModule_FreeDict(NULL, restore->labelStatsIndex);
+}
+
+static bool IndexRestore_ReadSeries(RedisModuleIO *io, IndexRestore *restore) {
+    SeriesIdTable *ids = &restore->seriesIds;
+    const uint64_t id = RedisModule_LoadUnsigned(io);
+    RedisModuleString *key = RedisModule_LoadString(io);
+    const uint64_t hash = RedisModule_LoadUnsigned(io);
+    if (RedisModule_IsIOError(io) || id >= ids->size || ids->byId[id] != NULL) {
+        if (key) {
+            RedisModule_FreeString(NULL, key);
+        }
+        return false;
+    }
+
+    IndexedSeries *series = malloc(sizeof(IndexedSeries));
+    series->key = key;
+    series->labels = RedisModule_CreateDict(NULL);
+    series->id = id;
+    series->firstTimestamp = 0;
+    series->lastTimestamp = UINT64_MAX;
+    if (RedisModule_DictSet(restore->tsLabelIndex, key, series) != REDISMODULE_OK) {
+        RedisModule_FreeDict(NULL, series->labels);
+        RedisModule_FreeString(NULL, key);
+        free(series);
+        return false;
+    }
+    ids->byId[id] = series;
+    ids->pendingLabelsHash[id] = hash;
+    Roaring_Add(ids->pending, id);
+    return true;
+}
+
+static bool IndexRestore_ReadPostings(RedisModuleIO *io, IndexRestore *restore) {
+    size_t entryLen = 0, bufLen = 0;
+    char *entry = RedisModule_LoadStringBuffer(io, &entryLen);
+    const uint64_t labelLen = RedisModule_LoadUnsigned(io);
+    char *buf = RedisModule_LoadStringBuffer(io, &bufLen);
+    Roaring *postings = NULL;
+    bool valid = !RedisModule_IsIOError(io);
+    if (valid) {
+        postings = Roaring_Deserialize(buf, bufLen);
+        valid = postings != NULL && Roaring_Cardinality(postings) > 0;
+    }
+
+    const size_t kLitLen = strlen(K_PREFIX_LITERAL), kvLitLen = strlen(KV_PREFIX_LITERAL);
+    const bool isLabelEntry =
+        valid && entryLen >= kLitLen && memcmp(entry, K_PREFIX_LITERAL, kLitLen) == 0;
+    const bool isValueEntry =
+        valid && entryLen > kvLitLen && memcmp(entry, KV_PREFIX_LITERAL, kvLitLen) == 0;
+    const char *label = isLabelEntry ? entry + kLitLen : isValueEntry ? entry + kvLitLen : NULL;
+    valid = (isLabelEntry && labelLen == entryLen - kLitLen) ||
+            (isValueEntry && labelLen < entryLen - kvLitLen && label[labelLen] == '=');
+
+    RoaringIterator iter;
+    uint32_t id;
+    RoaringIterator_Init(&iter, postings);
+    while (valid && RoaringIterator_Next(&iter, &id)) {
+        valid = id < restore->seriesIds.size && restore->seriesIds.byId[id] != NULL;
+    }
+    valid = valid && RedisModule_DictSetC(restore->labelsIndex, entry, entryLen, postings) ==
+                         REDISMODULE_OK;
+    if (valid) {
+        int nokey = 0;
+        LabelStats *stats =
+            RedisModule_DictGetC(restore->labelStatsIndex, (void *)label, labelLen, &nokey);
+        if (nokey) {
+            stats = calloc(1, sizeof(LabelStats));
+            RedisModule_DictSetC(restore->labelStatsIndex, (void *)label, labelLen, stats);
+        }
+        if (isLabelEntry) {
+            stats->numSeries = Roaring_Cardinality(postings);
+        } else {
+            stats->numValues++;
+        }
+        RoaringIterator_Init(&iter, postings);
+        while (RoaringIterator_Next(&iter, &id)) {
+            RedisModule_DictSetC(restore->seriesIds.byId[id]->labels, entry, entryLen, stats);
+        }
+    } else {
+        Roaring_Free(postings);
+    }
+    if (entry) {
+        RedisModule_Free(entry);
+    }
+    if (buf) {
+        RedisModule_Free(buf);
+    }
+    return valid;
+}
+
+static bool IndexRestore_Read(RedisModuleIO *io, IndexRestore *restore) {
+    SeriesIdTable *ids = &restore->seriesIds;
+    const uint64_t size = RedisModule_LoadUnsigned(io);
+    const uint64_t numSeries = RedisModule_LoadUnsigned(io);
+    if (RedisModule_IsIOError(io) || size > UINT32_MAX || numSeries > size) {
+        return false;
+    }
+    ids->size = size;
+    ids->capacity = max(size, 1);
+    ids->byId = calloc(ids->capacity, sizeof(IndexedSeries *));
+    ids->freeIds = malloc(ids->capacity * sizeof(uint32_t));
+    ids->pending = Roaring_New();
+    ids->pendingLabelsHash = malloc(ids->capacity * sizeof(uint64_t));
+
+    for (uint64_t i = 0; i < numSeries; i++) {
+        if (!IndexRestore_ReadSeries(io, restore)) {
+            return false;
+        }
+    }
+    // the lowest free ids are handed out first
+    for (uint32_t id = size; id > 0; id--) {
+        if (ids->byId[id - 1] == NULL) {
+            ids->freeIds[ids->numFreeIds++] = id - 1;
+        }
+    }
+
+    const uint64_t numPostings = RedisModule_LoadUnsigned(io);
+    if (RedisModule_IsIOError(io)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < numPostings; i++) {
+        if (!IndexRestore_ReadPostings(io, restore)) {
+            return false;
+        }
+    }
+
+    // each value entry comes with the entry of its label
+    bool valid = true;
+    RedisModuleDictIter *iter =
+        RedisModule_DictIteratorStartC(restore->labelStatsIndex, "^", NULL, 0);
+    LabelStats *stats;
+    while (valid && RedisModule_DictNextC(iter, NULL, (void **)&stats) != NULL) {
+        valid = stats->numSeries > 0 && stats->numValues > 0;
+    }
+    RedisModule_DictIteratorStop(iter);
+    // the postings give each series the entries it was saved with
+    IndexedSeries *series;
+    iter = RedisModule_DictIteratorStartC(restore->tsLabelIndex, "^", NULL, 0);
+    while (valid && RedisModule_DictNextC(iter, NULL, (void **)&series) != NULL) {
+        valid = IndexedSeriesLabelsHash(series) == ids->pendingLabelsHash[series->id];
+    }
+    RedisModule_DictIteratorStop(iter);
+    return valid;
+}
+
+int IndexAuxLoad(RedisModuleIO *io) {
+    const uint64_t persisted = RedisModule_LoadUnsigned(io);
+    if (RedisModule_IsIOError(io)) {
+        return REDISMODULE_ERR;
+    }
+    if (!persisted) {
+        return REDISMODULE_OK;
+    }
+
+    IndexRestore restore = {
+        .labelsIndex = RedisModule_CreateDict(NULL),
+        .tsLabelIndex = RedisModule_CreateDict(NULL),
+        .labelStatsIndex = RedisModule_CreateDict(NULL),
+    };
+    const bool valid = IndexRestore_Read(io, &restore);
+    if (RedisModule_IsIOError(io)) {
+        IndexRestore_Free(&restore);
+        return REDISMODULE_ERR;
+    }
+    // the series whose key isn't loaded are dropped at the end of the loading, which is only
+    // notified with server events
+    if (!valid || RedisModule_DictSize(tsLabelIndex) > 0 || seriesIds.pending ||
+        RedisModule_SubscribeToServerEvent == NULL) {
+        if (!valid) {
+            RedisModule_LogIOError(io, "warning", "invalid label index, it is rebuilt instead");
+        }
+        IndexRestore_Free(&restore);
+        return REDISMODULE_OK;
+    }
+
+    RedisModule_FreeDict(NULL, labelsIndex);
+    labelsIndex = restore.labelsIndex;
+    RedisModule_FreeDict(NULL, tsLabelIndex);
+    tsLabelIndex = restore.tsLabelIndex;
+    SeriesIdTable_Free(&seriesIds);
+    seriesIds = restore.seriesIds;
+    RedisModule_FreeDict(NULL, labelStatsIndex);
+    labelStatsIndex = restore.labelStatsIndex;
+    IndexRebuildNumericLabels();
+    RedisModule_LogIOError(io,
+                           "notice",
+                           "restored the label index of %" PRIu64 " series",
+                           (uint64_t)RedisModule_DictSize(tsLabelIndex));
+    return REDISMODULE_OK;
+}
+
+bool IndexConfirmRestoredSeries(RedisModuleString *ts_key, const Label *labels, size_t count) {
+    if (seriesIds.pending == NULL) {
+        return false;
+    }
+    int nokey = 0;
+    IndexedSeries *series = RedisModule_DictGet(tsLabelIndex, ts_key, &nokey);
+    if (nokey || !Roaring_Remove(seriesIds.pending, series->id)) {
+        return false;
+    }
+    if (seriesIds.pendingLabelsHash[series->id] == LabelsHash(labels, count)) {
+        return true;
+    }
+    // the key was saved with other labels
+    RemoveIndexedMetric(ts_key);
+    return false;
+}
+
+uint64_t IndexRestoreEnd() {
+    Roaring *pending = seriesIds.pending;
+    if (pending == NULL) {
+        return 0;
+    }
+    // detached first, as removing the series releases their ids
+    seriesIds.pending = NULL;
+    RoaringIterator iter;
+    RoaringIterator_Init(&iter, pending);
+    uint32_t id;
+    while (RoaringIterator_Next(&iter, &id)) {
+        RedisModuleString *key = RedisModule_CreateStringFromString(NULL, seriesIds.byId[id]->key);
+        RemoveIndexedMetric(key);
+        RedisModule_FreeString(NULL, key);
+    }
+    const uint64_t dropped = Roaring_Cardinality(pending);
+    Roaring_Free(pending);
+    free(seriesIds.pendingLabelsHash);
+    seriesIds.pendingLabelsHash = NULL;
+    return dropped;
+}
+
+uint32_t IndexedSeriesId(RedisModuleString *ts_key) {
+    int nokey;
+    IndexedSeries *series = RedisModule_DictGet(tsLabelIndex, ts_key, &nokey);
+    return nokey ? INDEX_NO_SERIES_ID : series->id;
+}
+
+// The id is a hint kept by the caller, the key tells whether it still belongs to ts_key
+static IndexedSeries *IndexedSeriesById(uint32_t id, RedisModuleString *ts_key) {
+    if (id >= seriesIds.size || seriesIds.byId[id] == NULL) {
+        return NULL;
+    }
+    IndexedSeries *series = seriesIds.byId[id];
+    size_t keyLen, indexedKeyLen;
+    const char *key = RedisModule_StringPtrLen(ts_key, &keyLen);
+    const char *indexedKey = RedisModule_StringPtrLen(series->key, &indexedKeyLen);
+    if (keyLen != indexedKeyLen || memcmp(key, indexedKey, keyLen) != 0) {
+        return NULL;
+    }
+    return series;
+}
+
+void IndexSetTimeRange(uint32_t id, RedisModuleString *ts_key, uint64_t first, uint64_t last) {
+    IndexedSeries *series = IndexedSeriesById(id, ts_key);
+    if (series) {
+        series->firstTimestamp = first;
+        series->lastTimestamp = last;
+    }
+}
+
+void IndexExtendTimeRange(uint32_t id, RedisModuleString *ts_key, uint64_t first, uint64_t last) {
+    IndexedSeries *series = IndexedSeriesById(id, ts_key);
+    if (series) {
+        series->firstTimestamp = min(series->firstTimestamp, first);
+        series->lastTimestamp = max(series->lastTimestamp, last);
+    }
+}
+
+const LabelStats *GetLabelStats(const char *label, size_t labelLen) {
+    return RedisModule_DictGetC(labelStatsIndex, (void *)label, labelLen, NULL);
+}
+
+void ForEachLabelStats(void (*emit)(void *userData,
+                                    const char *label,
+                                    size_t labelLen,
+                                    const LabelStats *stats),
+                       void *userData) {
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(labelStatsIndex, "^", NULL, 0);
+    char *label;
+    size_t labelLen;
+    LabelStats *stats;
+    while ((label = RedisModule_DictNextC(iter, &labelLen, (void **)&stats)) != NULL) {
+        emit(userData, label, labelLen, stats);
+    }
+    RedisModule_DictIteratorStop(iter);
+}
+
+size_t GetLabelTopValues(const char *label,
+                         size_t labelLen,
+                         LabelValueCount *top,
+                         size_t maxTop) {
+    // the entries of the values of the label, each posting list holds the series of a value
+    RedisModuleString *prefix =
+        RedisModule_CreateStringPrintf(NULL, KV_PREFIX_LITERAL "%.*s=", (int)labelLen, label);
+    size_t prefixLen;
+    const char *prefixBuf = RedisModule_StringPtrLen(prefix, &prefixLen);
+
+    size_t count = 0;
+    RedisModuleDictIter *iter =
+        RedisModule_DictIteratorStartC(labelsIndex, ">=", (void *)prefixBuf, prefixLen);
+    char *entry;
+    size_t entryLen;
+    Roaring *postings;
+    while (maxTop > 0 &&
+           (entry = RedisModule_DictNextC(iter, &entryLen, (void **)&postings)) != NULL) {
+        if (entryLen < prefixLen || memcmp(entry, prefixBuf, prefixLen) != 0) {
+            break;
+        }
+        const uint64_t numSeries = Roaring_Cardinality(postings);
+        if (count == maxTop && numSeries <= top[count - 1].numSeries) {
+            continue;
+        }
+        size_t pos = count;
+        if (count < maxTop) {
+            count++;
+        } else {
+            RedisModule_FreeString(NULL, top[--pos].value);
+        }
+        // on ties the smaller value, which came first, stays ahead
+        for (; pos > 0 && top[pos - 1].numSeries < numSeries; pos--) {
+            top[pos] = top[pos - 1];
+        }
+        top[pos].value = RedisModule_CreateString(NULL, entry + prefixLen, entryLen - prefixLen);
+        top[pos].numSeries = numSeries;
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeString(NULL, prefix);
+    return count;
+}
+
+uint64_t IndexedSeriesCount() {
+    return RedisModule_DictSize(tsLabelIndex);
+}
+
+uint64_t IndexedLabelsCount() {
+    return RedisModule_DictSize(labelStatsIndex);
+}
+
+uint64_t IndexPostingListsCount() {
+    return RedisModule_DictSize(labelsIndex);
+}
+
 // Estimates the label-index memory attributable to a single time series (MOD-6409 #6).
 //
 // The index is global module state rather than part of the value object, but the
@@ -296,11 +1333,11 @@ int IsKeyIndexed(RedisModuleString *ts_key) {
 // keeps the property that summing over all keys counts the index exactly once.
 //
 // Two contributions are summed:
-//   1. The inverse-index dict (tsLabelIndex[ts_key]), which is owned exclusively by
-//      this key, is counted in full.
-//   2. Each shared leaf dict in labelsIndex (one per "label=value" / "label" the key
+//   1. The IndexedSeries (tsLabelIndex[ts_key]) with its key name, id slot and dict of
+//      label entries, which is owned exclusively by this key, is counted in full.
+//   2. Each shared posting list in labelsIndex (one per "label=value" / "label" the key
 //      indexes) is shared by every key carrying that same label, so only this key's
-//      per-entry slice (size / entry-count) is attributed to it.
+//      per-entry slice (size / cardinality) is attributed to it.
 //
 // Dict sizes come from RedisModule_MallocSizeDict(), which is itself an approximation,
 // so the result is an estimate.
@@ -315,22 +1352,23 @@ size_t IndexMemUsage(RedisModuleString *ts_key) {
         return 0;
     }
     int nokey = 0;
-    RedisModuleDict *ts_leaf = RedisModule_DictGet(tsLabelIndex, ts_key, &nokey);
+    IndexedSeries *series = RedisModule_DictGet(tsLabelIndex, ts_key, &nokey);
     if (nokey) { // series has no labels or is not indexed
         return 0;
     }
 
-    size_t total = RedisModule_MallocSizeDict(ts_leaf);
+    size_t total = sizeof(IndexedSeries) + RedisModule_MallocSizeString(series->key) +
+                   sizeof(IndexedSeries *) + RedisModule_MallocSizeDict(series->labels);
 
-    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(ts_leaf, "^", NULL, 0);
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(series->labels, "^", NULL, 0);
     RedisModuleString *labelKey;
     while ((labelKey = RedisModule_DictNext(NULL, iter, NULL)) != NULL) {
         int leaf_nokey = 0;
-        RedisModuleDict *leaf = RedisModule_DictGet(labelsIndex, labelKey, &leaf_nokey);
-        if (!leaf_nokey && leaf != NULL) {
-            const uint64_t entries = RedisModule_DictSize(leaf);
+        Roaring *postings = RedisModule_DictGet(labelsIndex, labelKey, &leaf_nokey);
+        if (!leaf_nokey && postings != NULL) {
+            const uint64_t entries = Roaring_Cardinality(postings);
             if (entries > 0) {
-                total += RedisModule_MallocSizeDict(leaf) / entries;
+                total += Roaring_MemUsage(postings) / entries;
             }
         }
         RedisModule_FreeString(NULL, labelKey);
@@ -340,23 +1378,12 @@ size_t IndexMemUsage(RedisModuleString *ts_key) {
     return total;
 }
 
-static uint64_t _calc_dicts_total_size(RedisModuleDict **dicts, size_t dict_size) {
-    uint64_t total_size = 0;
-    for (size_t i = 0; i < dict_size; i++) {
-        if (dicts[i] != NULL) {
-            total_size += RedisModule_DictSize(dicts[i]);
-        }
-    }
-
-    return total_size;
-}
-
-void GetPredicateKeysDicts(RedisModuleCtx *ctx,
-                           const QueryPredicate *predicate,
-                           RedisModuleDict ***dicts,
-                           size_t *dicts_size) {
+void GetPredicatePostings(RedisModuleCtx *ctx,
+                          const QueryPredicate *predicate,
+                          Roaring ***postings,
+                          size_t *postings_size) {
     /*
-     * Return the dictionary of all the keys that match the predicate.
+     * Return the posting lists of the ids of the series that match the predicate.
      */
     RedisModuleString *index_key;
     size_t _s;
@@ -364,11 +1391,11 @@ void GetPredicateKeysDicts(RedisModuleCtx *ctx,
     const char *value;
 
     if (predicate->type == NCONTAINS || predicate->type == CONTAINS) {
-        *dicts = (RedisModuleDict **)malloc(sizeof(RedisModuleDict *));
-        *dicts_size = 1;
+        *postings = (Roaring **)malloc(sizeof(Roaring *));
+        *postings_size = 1;
         index_key = RedisModule_CreateStringPrintf(
             ctx, K_PREFIX, RedisModule_StringPtrLen(predicate->key, &_s));
-        (*dicts)[0] = RedisModule_DictGet(labelsIndex, index_key, NULL);
+        (*postings)[0] = RedisModule_DictGet(labelsIndex, index_key, NULL);
         RedisModule_FreeString(ctx, index_key);
 
         return;
@@ -376,94 +1403,314 @@ void GetPredicateKeysDicts(RedisModuleCtx *ctx,
 
     size_t to_allocate = 0;
 
-    if (__builtin_mul_overflow(
-            predicate->valueListCount, sizeof(RedisModuleDict *), &to_allocate)) {
+    if (__builtin_mul_overflow(predicate->valueListCount, sizeof(Roaring *), &to_allocate)) {
         return;
     }
 
     // one or more entries
-    *dicts = (RedisModuleDict **)malloc(to_allocate);
-    *dicts_size = predicate->valueListCount;
+    *postings = (Roaring **)malloc(to_allocate);
+    *postings_size = predicate->valueListCount;
 
     for (size_t i = 0; i < predicate->valueListCount; ++i) {
         value = RedisModule_StringPtrLen(predicate->valuesList[i], &_s);
         index_key = RedisModule_CreateStringPrintf(ctx, KV_PREFIX, key, value);
-        (*dicts)[i] = RedisModule_DictGet(labelsIndex, index_key, NULL);
+        (*postings)[i] = RedisModule_DictGet(labelsIndex, index_key, NULL);
         RedisModule_FreeString(ctx, index_key);
     }
 }
 
-void PromoteSmallestPredicateToFront(RedisModuleCtx *ctx,
-                                     QueryPredicate *index_predicate,
-                                     size_t predicate_count) {
-    /*
-     * Find the predicate that has the minimal amount of keys that match to it, and move it to the
-     * beginning of the predicate list so we will start our calculation from the smallest predicate.
-     * This is an optimization, so we will copy the smallest dict possible.
-     */
-    if (predicate_count <= 1) {
+// Adds a posting list to the union in *ids, the first one is borrowed until a second one comes
+static void UnionPostings(Roaring **ids, bool *owned, Roaring *postings) {
+    if (*ids == NULL) {
+        *ids = postings;
         return;
     }
+    if (!*owned) {
+        *ids = Roaring_Copy(*ids);
+        *owned = true;
+    }
+    Roaring_Or(*ids, postings);
+}
 
-    int minIndex = 0;
-    uint64_t minSize = UINT64_MAX;
-    bool isCloned;
-    uint64_t currentDictSize;
-    RedisModuleDict **dicts = NULL;
-    size_t dicts_size;
-    for (size_t i = 0; i < predicate_count; ++i) {
-        if (!IS_INCLUSION(index_predicate[i].type)) {
-            // There is at least 1 inclusion predicate
-            continue;
+// The ids of the series whose value of the predicate label starts with the prefix or matches the
+// regex. Only the index entries of that label are walked, from a range seek to the first entry
+// with the prefix, or with the label for a regex.
+static Roaring *PatternPredicateIds(RedisModuleCtx *ctx,
+                                    const QueryPredicate *predicate,
+                                    bool *owned) {
+    size_t labelLen, patternLen;
+    const char *label = RedisModule_StringPtrLen(predicate->key, &labelLen);
+    const char *pattern = RedisModule_StringPtrLen(predicate->valuesList[0], &patternLen);
+    const bool isRegex = predicate->type != PREFIX_MATCH;
+    regex_t regex;
+    *owned = false;
+    if (isRegex && !CompileLabelRegex(pattern, patternLen, &regex)) { // checked by the parser
+        return NULL;
+    }
+
+    RedisModuleString *seek =
+        RedisModule_CreateStringPrintf(ctx, KV_PREFIX, label, isRegex ? "" : pattern);
+    size_t seekLen;
+    const char *seekBuf = RedisModule_StringPtrLen(seek, &seekLen);
+    const size_t valueOffset = strlen(KV_PREFIX_LITERAL) + labelLen + 1;
+
+    Roaring *ids = NULL;
+    char *value = NULL;
+    size_t valueCapacity = 0;
+    RedisModuleDictIter *iter =
+        RedisModule_DictIteratorStartC(labelsIndex, ">=", (void *)seekBuf, seekLen);
+    char *entry;
+    size_t entryLen;
+    Roaring *postings;
+    while ((entry = RedisModule_DictNextC(iter, &entryLen, (void **)&postings)) != NULL) {
+        if (entryLen < seekLen || memcmp(entry, seekBuf, seekLen) != 0) {
+            break; // past the entries of the label
+        }
+        if (isRegex) {
+            const size_t valueLen = entryLen - valueOffset;
+            if (valueLen + 1 > valueCapacity) {
+                valueCapacity = valueLen + 1;
+                value = realloc(value, valueCapacity);
+            }
+            memcpy(value, entry + valueOffset, valueLen);
+            value[valueLen] = '\0';
+            if (regexec(&regex, value, 0, NULL, 0) != 0) {
+                continue;
+            }
         }
+        UnionPostings(&ids, owned, postings);
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeString(ctx, seek);
+    free(value);
+    if (isRegex) {
+        regfree(&regex);
+    }
+    return ids;
+}
+
+// The ids of the series whose value of the numeric label is in the range of the predicate, a
+// union of the posting lists of the values between two binary searches
+static Roaring *NumericPredicateIds(const QueryPredicate *predicate, bool *owned) {
+    size_t labelLen, boundLen;
+    const char *label = RedisModule_StringPtrLen(predicate->key, &labelLen);
+    const char *boundStr = RedisModule_StringPtrLen(predicate->valuesList[0], &boundLen);
+    *owned = false;
+    double bound;
+    // the label may not be numeric anymore, or not on this shard
+    const NumericLabelIndex *index =
+        numericLabelsIndex
+            ? RedisModule_DictGetC(numericLabelsIndex, (void *)label, labelLen, NULL)
+            : NULL;
+    if (index == NULL || !parseLabelNumber(boundStr, boundLen, &bound)) {
+        return NULL;
+    }
+
+    size_t from = 0, to = index->count;
+    switch (predicate->type) {
+        case NUMERIC_GT:
+            from = NumericLabelIndex_Bound(index, bound, true);
+            break;
+        case NUMERIC_GE:
+            from = NumericLabelIndex_Bound(index, bound, false);
+            break;
+        case NUMERIC_LT:
+            to = NumericLabelIndex_Bound(index, bound, false);
+            break;
+        default:
+            to = NumericLabelIndex_Bound(index, bound, true);
+            break;
+    }
+    Roaring *ids = NULL;
+    for (size_t i = from; i < to; i++) {
+        UnionPostings(&ids, owned, index->values[i].postings);
+    }
+    return ids;
+}
+
+// The ids of the series matching the values of the predicate (or having its label), NULL when
+// there are none. *owned tells whether the caller must free the result or it's a posting list
+// of the index.
+static Roaring *PredicateIds(RedisModuleCtx *ctx, const QueryPredicate *predicate, bool *owned) {
+    if (predicate->type == REGEX_MATCH || predicate->type == REGEX_NOTMATCH ||
+        predicate->type == PREFIX_MATCH) {
+        return PatternPredicateIds(ctx, predicate, owned);
+    }
+    if (IS_NUMERIC_RANGE(predicate->type)) {
+        return NumericPredicateIds(predicate, owned);
+    }
+
+    Roaring **postings = NULL;
+    size_t postings_size = 0;
+    GetPredicatePostings(ctx, predicate, &postings, &postings_size);
 
-        dicts_size = 0;
-        GetPredicateKeysDicts(ctx, &index_predicate[i], &dicts, &dicts_size);
-        uint64_t curSize = _calc_dicts_total_size(dicts, dicts_size);
-        free(dicts);
-        if (curSize < minSize) {
-            minIndex = i;
-            minSize = curSize;
+    Roaring *ids = NULL;
+    *owned = false;
+    for (size_t i = 0; i < postings_size; i++) {
+        if (postings[i] != NULL) { // else no series has this value
+            UnionPostings(&ids, owned, postings[i]);
         }
     }
+    free(postings);
+    return ids;
+}
+
+// A predicate of the plan, resolved to the ids of the series it selects
+typedef struct QueryPlanStep
+{
+    const QueryPredicate *predicate;
+    Roaring *ids; // NULL when no series matches
+    bool resolved;
+    bool owned; // ids is a union of postings, not a posting list of the index
+    bool inclusion;
+    uint64_t estimate; // the cardinality of ids once resolved, an upper bound before
+} QueryPlanStep;
+
+/*
+ * The predicates of a query compiled once into their posting lists: the inclusions ordered by
+ * ascending cardinality, so the smallest one drives the intersection, then the exclusions as set
+ * differences, largest first. The caller's predicate list is left untouched.
+ *
+ * The regex, prefix and numeric range predicates union the postings of many values of their
+ * label, so they are resolved only when the steps before them left candidates. Until then their
+ * estimate is the number of series having the label, from the label stats.
+ */
+typedef struct QueryPlan
+{
+    QueryPlanStep *steps;
+    size_t count;
+    bool empty; // an inclusion matches no series, or there is no inclusion
+} QueryPlan;
+
+static inline bool IsDeferredPredicate(PredicateType type) {
+    return type == REGEX_MATCH || type == REGEX_NOTMATCH || type == PREFIX_MATCH ||
+           IS_NUMERIC_RANGE(type);
+}
+
+static void QueryPlanStep_Resolve(RedisModuleCtx *ctx, QueryPlanStep *step) {
+    if (step->resolved) {
+        return;
+    }
+    step->ids = PredicateIds(ctx, step->predicate, &step->owned);
+    step->estimate = step->ids ? Roaring_Cardinality(step->ids) : 0;
+    step->resolved = true;
+}
 
-    // switch between the minimal predicate and the predicate in the first place
-    if (minIndex != 0) {
-        __SWAP(index_predicate[minIndex], index_predicate[0]);
+static int QueryPlanStep_Compare(const void *a, const void *b) {
+    const QueryPlanStep *x = a, *y = b;
+    if (x->inclusion != y->inclusion) {
+        return x->inclusion ? -1 : 1;
     }
+    if (x->estimate == y->estimate) {
+        return 0;
+    }
+    // ascending for the inclusions, descending for the exclusions
+    return (x->estimate < y->estimate) == x->inclusion ? -1 : 1;
 }
 
-static bool _isKeySatisfyAllPredicates(RedisModuleCtx *ctx,
-                                       const char *currentKey,
-                                       size_t currentKeyLen,
-                                       const QueryPredicate *index_predicate,
-                                       size_t predicate_count) {
-    RedisModuleDict **dicts = NULL;
-    size_t dicts_size;
-    for (size_t i = 1; i < min(predicate_count, SIZE_MAX - 1); ++i) {
-        bool inclusion = IS_INCLUSION(index_predicate[i].type);
-        GetPredicateKeysDicts(ctx, &index_predicate[i], &dicts, &dicts_size);
-        bool found = false;
-        for (size_t j = 0; j < dicts_size; j++) {
-            RedisModuleDict *curDict = dicts[j];
-            if (!curDict) { // empty dict
-                continue;
+static void QueryPlan_Compile(RedisModuleCtx *ctx,
+                              QueryPlan *plan,
+                              const QueryPredicate *index_predicate,
+                              size_t predicate_count) {
+    plan->steps = malloc(predicate_count * sizeof(QueryPlanStep));
+    plan->count = 0;
+    plan->empty = true;
+
+    bool hasInclusion = false;
+    for (size_t i = 0; i < predicate_count; i++) {
+        QueryPlanStep step = { .predicate = &index_predicate[i],
+                               .inclusion = IS_INCLUSION(index_predicate[i].type) };
+        if (IsDeferredPredicate(step.predicate->type)) {
+            size_t labelLen;
+            const char *label = RedisModule_StringPtrLen(step.predicate->key, &labelLen);
+            const LabelStats *stats = GetLabelStats(label, labelLen);
+            step.estimate = stats ? stats->numSeries : 0;
+            step.resolved = step.estimate == 0; // no series has the label
+        } else {
+            QueryPlanStep_Resolve(ctx, &step);
+        }
+        if (step.estimate == 0) {
+            if (step.inclusion) { // no need to resolve the rest
+                if (step.owned) {
+                    Roaring_Free(step.ids);
+                }
+                return;
             }
+            continue; // an exclusion of nothing
+        }
+        hasInclusion |= step.inclusion;
+        plan->steps[plan->count++] = step;
+    }
+    if (!hasInclusion) {
+        return;
+    }
+
+    plan->empty = false;
+    qsort(plan->steps, plan->count, sizeof(QueryPlanStep), QueryPlanStep_Compare);
+}
+
+// The ids matching all the steps, NULL when the plan is empty. The result is owned by the caller.
+static Roaring *QueryPlan_Execute(RedisModuleCtx *ctx, QueryPlan *plan) {
+    if (plan->empty) {
+        return NULL;
+    }
 
-            int doesNotExist = 0;
-            RedisModule_DictGetC(curDict, (char *)currentKey, currentKeyLen, &doesNotExist);
-            if (!doesNotExist) {
-                found = true;
+    QueryPlanStep *driving = &plan->steps[0];
+    QueryPlanStep_Resolve(ctx, driving);
+    if (driving->ids == NULL) {
+        return NULL;
+    }
+    Roaring *ids = driving->owned ? driving->ids : Roaring_Copy(driving->ids);
+    driving->owned = false; // moved to the result
+    for (size_t i = 1; i < plan->count && Roaring_Cardinality(ids) > 0; i++) {
+        QueryPlanStep *step = &plan->steps[i];
+        QueryPlanStep_Resolve(ctx, step);
+        if (step->inclusion) {
+            if (step->ids) {
+                Roaring_And(ids, step->ids);
+            } else {
+                Roaring_Clear(ids);
             }
+        } else if (step->ids) {
+            Roaring_AndNot(ids, step->ids);
         }
-        free(dicts);
+    }
+    return ids;
+}
 
-        if ((inclusion && !found) || (!inclusion && found)) {
-            return false;
+static void QueryPlan_Free(QueryPlan *plan) {
+    for (size_t i = 0; i < plan->count; i++) {
+        if (plan->steps[i].owned) {
+            Roaring_Free(plan->steps[i].ids);
         }
     }
+    free(plan->steps);
+}
 
-    return true;
+// The ids matching any OR group of the predicates, each group is planned on its own. NULL when
+// none matches.
+static Roaring *QueryGroupsIds(RedisModuleCtx *ctx,
+                               const QueryPredicate *index_predicate,
+                               size_t predicate_count) {
+    Roaring *ids = NULL;
+    size_t groupStart = 0;
+    for (size_t i = 0; i <= predicate_count; i++) {
+        if (i < predicate_count && index_predicate[i].type != GROUP_OR) {
+            continue;
+        }
+        QueryPlan plan;
+        QueryPlan_Compile(ctx, &plan, index_predicate + groupStart, i - groupStart);
+        Roaring *groupIds = QueryPlan_Execute(ctx, &plan);
+        QueryPlan_Free(&plan);
+        if (ids == NULL) {
+            ids = groupIds;
+        } else if (groupIds != NULL) {
+            Roaring_Or(ids, groupIds);
+            Roaring_Free(groupIds);
+        }
+        groupStart = i + 1;
+    }
+    return ids;
 }
 
 static inline bool OwnKeyDuringSharding(
@@ -481,6 +1728,14 @@ static inline bool OwnKeyDuringASM(RedisModuleString *key) { // ASM version
     return RedisModule_ClusterCanAccessKeysInSlot(slot);
 }
 
+// Whether the key is the responsibility of this shard, see TrimUnownedKeysDuringReshard
+static inline bool OwnKeyDuringReshard(RedisModuleString *key) {
+    if (likely(!(isReshardTrimming || isAsmTrimming || isAsmImporting))) {
+        return true;
+    }
+    return (isReshardTrimming ? OwnKeyDuringSharding : OwnKeyDuringASM)(key);
+}
+
 // Results here come from our in-memory label index, not the Redis keyspace, so core's
 // per-slot ownership filtering never applies to them. The index is cleaned lazily (via
 // unlink/keyspace notifications), so during a slot migration it still contains keys for
@@ -508,62 +1763,127 @@ RedisModuleDict *QueryIndex(RedisModuleCtx *ctx,
                             QueryPredicate *index_predicate,
                             size_t predicate_count,
                             bool *hasPermissionError) {
+    return QueryIndexInRange(
+        ctx, index_predicate, predicate_count, 0, UINT64_MAX, hasPermissionError);
+}
+
+RedisModuleDict *QueryIndexInRange(RedisModuleCtx *ctx,
+                                   QueryPredicate *index_predicate,
+                                   size_t predicate_count,
+                                   uint64_t start,
+                                   uint64_t end,
+                                   bool *hasPermissionError) {
     RedisModuleDict *res = RedisModule_CreateDict(ctx);
     if (predicate_count == 0) {
         return res;
     }
 
-    PromoteSmallestPredicateToFront(ctx, index_predicate, predicate_count);
-
-    QueryPredicate *predicate = &index_predicate[0];
-
-    if (!IS_INCLUSION(predicate->type)) {
+    // The predicates are evaluated on the series ids, the keys are only looked up for the result
+    Roaring *ids = QueryGroupsIds(ctx, index_predicate, predicate_count);
+    if (ids == NULL || Roaring_Cardinality(ids) == 0) {
+        Roaring_Free(ids);
         return res;
     }
 
-    RedisModuleDict **dicts = NULL;
-    size_t dicts_size = 0;
-    GetPredicateKeysDicts(ctx, &index_predicate[0], &dicts, &dicts_size);
-
-    // Resolve the user once for the whole multi-dict scan so ACL checks
-    // below don't alloc/free a RedisModuleUser per candidate key.
+    // Resolve the user once for the whole result so ACL checks
+    // below don't alloc/free a RedisModuleUser per key.
     User_Ctx_t userCtx = { .user = NULL, .is_owned = false };
     if (hasPermissionError) {
         userCtx = GetUserFromContext(ctx);
     }
 
-    for (size_t i = 0; i < dicts_size; i++) {
-        RedisModuleDict *dict = dicts[i];
-        if (dict == NULL) {
-            continue;
-        }
-
-        RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(dict, "^", NULL, 0);
-        char *currentKey = NULL;
-        size_t currentKeyLen = 0;
-        while ((currentKey = RedisModule_DictNextC(iter, &currentKeyLen, NULL)) != NULL) {
-            if (hasPermissionError) {
-                if (!CheckKeyIsAllowedToReadC(ctx, userCtx.user, currentKey, currentKeyLen)) {
-                    *hasPermissionError = true;
-                    continue;
-                }
-            }
-            if (_isKeySatisfyAllPredicates(
-                    ctx, currentKey, currentKeyLen, index_predicate, predicate_count)) {
-                RedisModule_DictSetC(res, currentKey, currentKeyLen, (void *)1);
+    RoaringIterator iter;
+    RoaringIterator_Init(&iter, ids);
+    uint32_t id;
+    while (RoaringIterator_Next(&iter, &id)) {
+        const IndexedSeries *series = seriesIds.byId[id];
+        size_t currentKeyLen;
+        const char *currentKey = RedisModule_StringPtrLen(series->key, &currentKeyLen);
+        if (hasPermissionError) {
+            if (!CheckKeyIsAllowedToReadC(ctx, userCtx.user, currentKey, currentKeyLen)) {
+                *hasPermissionError = true;
+                continue;
             }
         }
-        RedisModule_DictIteratorStop(iter);
+        // checked after the ACL, so the series out of the range still fail the query
+        if (series->firstTimestamp > end || series->lastTimestamp < start) {
+            continue;
+        }
+        RedisModule_DictSetC(res, (char *)currentKey, currentKeyLen, (void *)1);
     }
 
     FreeUser(&userCtx);
-    free(dicts);
+    Roaring_Free(ids);
 
     TrimUnownedKeysDuringReshard(res);
 
     return res;
 }
 
+uint64_t QueryIndexCount(RedisModuleCtx *ctx,
+                         QueryPredicate *index_predicate,
+                         size_t predicate_count) {
+    Roaring *ids =
+        predicate_count > 0 ? QueryGroupsIds(ctx, index_predicate, predicate_count) : NULL;
+    if (ids == NULL) {
+        return 0;
+    }
+
+    uint64_t count = Roaring_Cardinality(ids);
+    if (unlikely(isReshardTrimming || isAsmTrimming || isAsmImporting)) {
+        // the keys of the slots moving away aren't counted, so each key is checked
+        count = 0;
+        RoaringIterator iter;
+        RoaringIterator_Init(&iter, ids);
+        uint32_t id;
+        while (RoaringIterator_Next(&iter, &id)) {
+            count += OwnKeyDuringReshard(seriesIds.byId[id]->key);
+        }
+    }
+    Roaring_Free(ids);
+    return count;
+}
+
+uint64_t QueryIndexPage(RedisModuleCtx *ctx,
+                        QueryPredicate *index_predicate,
+                        size_t predicate_count,
+                        uint64_t cursor,
+                        size_t limit,
+                        void (*emit)(void *userData, uint32_t id, const char *key, size_t keyLen),
+                        void *userData) {
+    if (cursor > UINT32_MAX || limit == 0) {
+        return 0;
+    }
+    Roaring *ids =
+        predicate_count > 0 ? QueryGroupsIds(ctx, index_predicate, predicate_count) : NULL;
+    if (ids == NULL) {
+        return 0;
+    }
+
+    RoaringIterator iter;
+    RoaringIterator_Init(&iter, ids);
+    RoaringIterator_Seek(&iter, cursor);
+    uint64_t next = 0;
+    size_t emitted = 0;
+    uint32_t id;
+    while (RoaringIterator_Next(&iter, &id)) {
+        if (emitted == limit) { // the page is full, the next one starts from this series
+            next = id;
+            break;
+        }
+        const IndexedSeries *series = seriesIds.byId[id];
+        if (!OwnKeyDuringReshard(series->key)) {
+            continue;
+        }
+        size_t keyLen;
+        const char *key = RedisModule_StringPtrLen(series->key, &keyLen);
+        emit(userData, id, key, keyLen);
+        emitted++;
+    }
+    Roaring_Free(ids);
+    return next;
+}
+
 RedisModuleDict *GetAllIndexedSeriesKeys(RedisModuleCtx *ctx) {
     RedisModuleDict *res = RedisModule_CreateDict(ctx);
     RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(tsLabelIndex, "^", NULL, 0);
@@ -626,10 +1946,11 @@ void QueryLabelsFromIndex(const char *tsKey,
                           void (*emit)(void *userData, const char *buf, size_t len),
                           void *userData) {
     int nokey = 0;
-    RedisModuleDict *leaf = RedisModule_DictGetC(tsLabelIndex, (void *)tsKey, tsKeyLen, &nokey);
+    IndexedSeries *series = RedisModule_DictGetC(tsLabelIndex, (void *)tsKey, tsKeyLen, &nokey);
     if (nokey) {
         return;
     }
+    RedisModuleDict *leaf = series->labels;
 
     size_t kvLitLen = strlen(KV_PREFIX_LITERAL);
     size_t candidateLabelLen = subtype == QueryLabelsSubtype_Values ? prefixLen - kvLitLen - 1 : 0;
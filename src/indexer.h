@@ -36,11 +36,67 @@ typedef enum
     NCONTAINS,
     LIST_MATCH,    // List of matching predicates
     LIST_NOTMATCH, // List of non-matching predicates
-    // REQ,
-    // NREQ
+    REGEX_MATCH,    // l=~re, the value of label l matches the whole regex
+    REGEX_NOTMATCH, // l!~re, no label l or its value doesn't match the regex
+    PREFIX_MATCH,   // l^=p, the value of label l starts with p
+    GROUP_OR,       // OR, separates groups of predicates, a series matches any of the groups
+    NUMERIC_GT,     // l>n, the value of the numeric label l is a number greater than n
+    NUMERIC_GE,     // l>=n
+    NUMERIC_LT,     // l<n
+    NUMERIC_LE,     // l<=n
 } PredicateType;
 
-#define IS_INCLUSION(type) ((type) == EQ || (type) == CONTAINS || (type) == LIST_MATCH)
+// An indexed series, its dense integer id is what the posting lists of the label index store
+typedef struct IndexedSeries
+{
+    RedisModuleString *key;
+    RedisModuleDict *labels; // the label index entries of the series
+    uint32_t id;
+    // The time range of the samples of the series, a superset of it is always fine. Empty when
+    // firstTimestamp > lastTimestamp, unknown until the series publishes it.
+    uint64_t firstTimestamp;
+    uint64_t lastTimestamp;
+} IndexedSeries;
+
+#define INDEX_NO_SERIES_ID UINT32_MAX
+
+typedef struct SeriesIdTable
+{
+    IndexedSeries **byId; // NULL for a free id
+    uint32_t size;        // ids handed out, the free ones included
+    uint32_t capacity;
+    uint32_t *freeIds; // reused before new ids are handed out, so the ids stay dense
+    uint32_t numFreeIds;
+    // The series restored from the rdb whose key wasn't loaded yet, and the hash of their label
+    // entries by id. NULL unless the index was restored, see IndexAuxLoad.
+    struct Roaring *pending;
+    uint64_t *pendingLabelsHash;
+} SeriesIdTable;
+
+// Statistics of a label name, kept up to date as series are indexed and removed
+typedef struct LabelStats
+{
+    uint64_t numSeries; // series having the label
+    uint64_t numValues; // distinct values of the label
+} LabelStats;
+
+// A value of a label and the number of series having it
+typedef struct LabelValueCount
+{
+    RedisModuleString *value;
+    uint64_t numSeries;
+} LabelValueCount;
+
+#define IS_NUMERIC_RANGE(type) ((type) >= NUMERIC_GT && (type) <= NUMERIC_LE)
+
+#define IS_INCLUSION(type)                                                                         \
+    ((type) == EQ || (type) == CONTAINS || (type) == LIST_MATCH || (type) == REGEX_MATCH ||        \
+     (type) == PREFIX_MATCH || IS_NUMERIC_RANGE(type))
+
+// The predicates that select series by value, a query needs at least one of them
+#define IS_MATCHER(type)                                                                           \
+    ((type) == EQ || (type) == LIST_MATCH || (type) == REGEX_MATCH || (type) == PREFIX_MATCH ||    \
+     IS_NUMERIC_RANGE(type))
 
 typedef struct QueryPredicate
 {
@@ -62,6 +118,20 @@ int parsePredicate(RedisModuleCtx *ctx,
                    size_t label_value_pair_size,
                    QueryPredicate *retQuery,
                    const char *separator);
+// Parses l=~re, l!~re or l^=p whose two character operator starts at operator_pos, the type of
+// retQuery must already be set
+int parsePatternPredicate(RedisModuleCtx *ctx,
+                          const char *label_value_pair,
+                          size_t label_value_pair_size,
+                          size_t operator_pos,
+                          QueryPredicate *retQuery);
+// Parses l<n, l<=n, l>n or l>=n whose operator starts at operator_pos. Returns TSDB_ERROR when l
+// isn't a numeric label or n isn't a number, the pair is then not a range predicate.
+int parseRangePredicate(RedisModuleCtx *ctx,
+                        const char *label_value_pair,
+                        size_t label_value_pair_size,
+                        size_t operator_pos,
+                        QueryPredicate *retQuery);
 void QueryPredicate_Free(QueryPredicate *predicate, size_t count);
 void QueryPredicateList_Free(QueryPredicateList *list);
 
@@ -69,16 +139,100 @@ void IndexInit();
 int DefragIndex(RedisModuleDefragCtx *ctx);
 void FreeLabels(void *value, size_t labelsCount);
 void IndexMetric(RedisModuleString *ts_key, Label *labels, size_t labels_count);
+// While an rdb loads, IndexMetric only collects the entries of the series, which
+// IndexBulkBuildEnd sorts and builds into their posting lists. Returns the number of labels
+// built.
+void IndexBulkBuildStart();
+uint64_t IndexBulkBuildEnd();
 void RemoveIndexedMetric(RedisModuleString *ts_key);
 void RemoveAllIndexedMetrics();
 void RemoveAllIndexedMetrics_generic(RedisModuleDict *_labelsIndex,
-                                     RedisModuleDict **_tsLabelIndex);
+                                     RedisModuleDict **_tsLabelIndex,
+                                     SeriesIdTable *_seriesIds,
+                                     RedisModuleDict *_labelStatsIndex);
 int IsKeyIndexed(RedisModuleString *ts_key);
+
+// Declares the labels whose values are indexed by number as well, for the range predicates. The
+// values that aren't numbers are only in the label index.
+void IndexSetNumericLabels(const char **labels, const size_t *labelLens, size_t count);
+bool IsNumericLabel(const char *label, size_t labelLen);
+// Rebuilds the numeric index from the label index, once the label index was replaced
+void IndexRebuildNumericLabels();
+
+// Writes the label index to the aux data of the rdb
+void IndexAuxSave(RedisModuleIO *io);
+// Reads the label index written by IndexAuxSave, and restores it when the index is empty. Each
+// restored series is pending until IndexConfirmRestoredSeries matches it with its loaded key,
+// IndexRestoreEnd drops the ones left at the end of the loading.
+int IndexAuxLoad(RedisModuleIO *io);
+// Returns whether ts_key was restored with the same labels, so it needn't be indexed again
+bool IndexConfirmRestoredSeries(RedisModuleString *ts_key, const Label *labels, size_t count);
+// Returns the number of restored series dropped as their key wasn't loaded
+uint64_t IndexRestoreEnd();
+
+// The id of the indexed ts_key, INDEX_NO_SERIES_ID if it isn't indexed
+uint32_t IndexedSeriesId(RedisModuleString *ts_key);
+// Sets the time range of the samples of the series with the id, first > last when it has none.
+// Ignored when the id is not the one of ts_key anymore.
+void IndexSetTimeRange(uint32_t id, RedisModuleString *ts_key, uint64_t first, uint64_t last);
+// Extends the time range of the series with the id to include [first, last]
+void IndexExtendTimeRange(uint32_t id, RedisModuleString *ts_key, uint64_t first, uint64_t last);
+
+// The stats of a label, NULL when no series has it
+const LabelStats *GetLabelStats(const char *label, size_t labelLen);
+// Calls emit for each indexed label name in lexicographic order
+void ForEachLabelStats(void (*emit)(void *userData,
+                                    const char *label,
+                                    size_t labelLen,
+                                    const LabelStats *stats),
+                       void *userData);
+// Fills top with the (at most maxTop) values of the label having the most series, by descending
+// number of series, and returns their count. The caller frees the values.
+size_t GetLabelTopValues(const char *label,
+                         size_t labelLen,
+                         LabelValueCount *top,
+                         size_t maxTop);
+uint64_t IndexedSeriesCount();
+uint64_t IndexedLabelsCount();
+uint64_t IndexPostingListsCount();
 size_t IndexMemUsage(RedisModuleString *ts_key);
 RedisModuleDict *QueryIndex(RedisModuleCtx *ctx,
                             QueryPredicate *index_predicate,
                             size_t predicate_count,
                             bool *hasPermissionError);
+// Like QueryIndex, but skips the series whose time range doesn't intersect [start, end] without
+// opening their keys. Series without samples are only skipped when the range isn't the whole
+// timeline.
+RedisModuleDict *QueryIndexInRange(RedisModuleCtx *ctx,
+                                   QueryPredicate *index_predicate,
+                                   size_t predicate_count,
+                                   uint64_t start,
+                                   uint64_t end,
+                                   bool *hasPermissionError);
+
+// What TS.QUERYINDEX replies with
+typedef enum QueryIndexMode
+{
+    QueryIndexMode_Keys = 0, // the matching keys
+    QueryIndexMode_Count,    // their number
+    QueryIndexMode_Cursor,   // a page of them, resumed from a cursor
+} QueryIndexMode;
+
+// The number of series matching the predicates, the cardinality of their ids unless slots are
+// moving and the keys must be checked
+uint64_t QueryIndexCount(RedisModuleCtx *ctx,
+                         QueryPredicate *index_predicate,
+                         size_t predicate_count);
+// Calls emit for at most limit series matching the predicates, in ascending series id order from
+// the id cursor. Returns the cursor of the next page, 0 when there is none. A series indexed
+// during the whole iteration is emitted once, as long as its id doesn't change.
+uint64_t QueryIndexPage(RedisModuleCtx *ctx,
+                        QueryPredicate *index_predicate,
+                        size_t predicate_count,
+                        uint64_t cursor,
+                        size_t limit,
+                        void (*emit)(void *userData, uint32_t id, const char *key, size_t keyLen),
+                        void *userData);
 
 // Returns a fresh dict of every currently-indexed series key (ts_key -> dummy).
 // Used by TS.QUERYLABELS when no FILTER is given ("all series").
@@ -103,4 +257,6 @@ void QueryLabelsFromIndex(const char *tsKey,
                           void *userData);
 
 int CountPredicateType(QueryPredicateList *queries, PredicateType type);
+// The number of matchers of the OR group having the fewest, a query needs one in each group
+int CountMatcherPredicates(QueryPredicateList *queries);
 #endif
@@ -60,15 +60,6 @@ static inline bool check_and_reply_on_error(ExecutionCtx *eCtx, RedisModuleCtx *
     return true;
 }
 
-// This function used for calling freeing the blocked client context
-// in the main thread. It's needed cause there is a bug in RoF when calling
-// RedisModule_FreeThreadSafeContext from thread which is not the main one, see:
-// https://redislabs.atlassian.net/browse/RED-68772 . It should be fixed in redis 7
-static void rts_free_rctx(RedisModuleCtx *rctx, void *privateData) {
-    RedisModuleCtx *_rctx = privateData;
-    RedisModule_FreeThreadSafeContext(_rctx);
-}
-
 static int compare_slot_ranges(const void *a, const void *b) {
     const RedisModuleSlotRange *ra = *(const RedisModuleSlotRange **)a;
     const RedisModuleSlotRange *rb = *(const RedisModuleSlotRange **)b;
@@ -261,29 +252,13 @@ __done:
 }
 
 static void mrange_done_gears(ExecutionCtx *eCtx, RedisModuleCtx *ctx, MRangeData *data) {
-    RedisModuleBlockedClient *bc = data->bc;
-    RedisModuleCtx *rctx = RedisModule_GetThreadSafeContext(bc);
-
     if (unlikely(check_and_reply_on_error(eCtx, ctx))) {
         goto __done;
     }
 
     long long len = MR_ExecutionCtxGetResultsLen(eCtx);
 
-    TS_ResultSet *resultset = NULL;
-
-    if (data->args.groupByLabel) {
-        resultset = ResultSet_Create();
-        ResultSet_GroupbyLabel(resultset, data->args.groupByLabel);
-    } else {
-        // ponytail: postponed length — EXCLUDEEMPTY may skip series, so the real
-        // count is only known after emission (see ReplySetMapOrArrayLength below).
-        ReplyWithMapOrArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN, false);
-    }
-
-    long long replylen = 0;
-
-    Series **tempSeries = array_new(Record *, len); // calloc(len, sizeof(Series *));
+    Series **tempSeries = array_new(Series *, len);
     for (int i = 0; i < len; i++) {
         Record *raw_listRecord = MR_ExecutionCtxGetResult(eCtx, i);
         if (raw_listRecord->recordType != GetListRecordType()) {
@@ -302,65 +277,11 @@ static void mrange_done_gears(ExecutionCtx *eCtx, RedisModuleCtx *ctx, MRangeDat
             }
             Series *s = SeriesRecord_IntoSeries((SeriesRecord *)raw_record);
             tempSeries = array_append(tempSeries, s);
-
-            EnrichedChunk *first_chunk = NULL;
-            AbstractIterator *probe = NULL;
-            if (data->args.excludeEmpty) {
-                probe = SeriesQueryIfNonEmpty(
-                    s, &data->args.rangeArgs, data->args.reverse, &first_chunk);
-                if (!probe)
-                    continue;
-            }
-
-            if (data->args.groupByLabel) {
-                ResultSet_AddSeries(resultset, s, RedisModule_StringPtrLen(s->keyName, NULL));
-            } else {
-                ReplySeriesArrayPos(ctx,
-                                    s,
-                                    data->args.withLabels,
-                                    data->args.limitLabels,
-                                    data->args.numLimitLabels,
-                                    &data->args.rangeArgs,
-                                    data->args.reverse,
-                                    false,
-                                    probe,
-                                    first_chunk);
-                replylen++;
-            }
         }
     }
 
-    if (!data->args.groupByLabel) {
-        ReplySetMapOrArrayLength(ctx, replylen, false);
-    }
-
-    if (data->args.groupByLabel) {
-        // Apply the reducer
-        RangeArgs args = data->args.rangeArgs;
-        args.latest = false; // we already handled the latest flag in the client side
-        ResultSet_ApplyReducer(ctx, resultset, &args, &data->args.groupByReducerArgs);
-
-        // Do not apply the aggregation on the resultset, do apply max results on the final result
-        RangeArgs minimizedArgs = data->args.rangeArgs;
-        minimizedArgs.startTimestamp = 0;
-        minimizedArgs.endTimestamp = UINT64_MAX;
-        minimizedArgs.aggregationArgs.numClasses = 0;
-        minimizedArgs.aggregationArgs.classes = NULL;
-        minimizedArgs.aggregationArgs.timeDelta = 0;
-        minimizedArgs.filterByTSArgs.hasValue = false;
-        minimizedArgs.filterByValueArgs.hasValue = false;
-        minimizedArgs.latest = false;
-
-        replyResultSet(ctx,
-                       resultset,
-                       data->args.withLabels,
-                       data->args.limitLabels,
-                       data->args.numLimitLabels,
-                       &minimizedArgs,
-                       data->args.reverse);
+    replyMultiRangeFromSeries(ctx, tempSeries, array_len(tempSeries), &data->args);
 
-        ResultSet_Free(resultset);
-    }
     array_foreach(tempSeries, x, FreeSeries(x));
     array_free(tempSeries);
 
@@ -471,13 +392,122 @@ static void mget_done(ExecutionCtx *eCtx, void *privateData) {
     RTS_UnblockClient(bc, ctx);
 }
 
+typedef struct QueryIndexData
+{
+    RedisModuleBlockedClient *bc;
+    QueryIndexMode mode;
+    long long limit;
+} QueryIndexData;
+
+// A series of a page of a shard, see QueryIndexShardReply
+typedef struct QueryIndexPageEntry
+{
+    uint64_t id;
+    RedisModuleString *key;
+} QueryIndexPageEntry;
+
+static int QueryIndexPageEntry_Compare(const void *a, const void *b) {
+    const QueryIndexPageEntry *x = a, *y = b;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static void queryindex_reply_count(RedisModuleCtx *ctx,
+                                   ARR(ARR(RedisModuleString *)) nodesResults) {
+    long long total = 0;
+    array_foreach(nodesResults, stringList, {
+        long long count;
+        if (array_len(stringList) != 1 ||
+            RedisModule_StringToLongLong(stringList[0], &count) != REDISMODULE_OK) {
+            RedisModule_Log(ctx, "warning", "Unexpected results from nodes");
+            RedisModule_ReplyWithError(ctx, SLOT_RANGES_ERROR);
+            return;
+        }
+        total += count;
+    });
+    RedisModule_ReplyWithLongLong(ctx, total);
+}
+
+/*
+ * Merges the pages of the shards, which share the cursor but not the series ids. The page covers
+ * the ids below the smallest next cursor of the shards, every shard returned all its series
+ * there, and it's cut to the limit on an id boundary so the next cursor resumes exactly there.
+ */
+static void queryindex_reply_page(RedisModuleCtx *ctx,
+                                  ARR(ARR(RedisModuleString *)) nodesResults,
+                                  long long limit) {
+    uint64_t next = 0; // 0 when all the shards are done
+    size_t total = 0;
+    array_foreach(nodesResults, stringList, {
+        long long shardNext;
+        if (array_len(stringList) % 2 != 1 ||
+            RedisModule_StringToLongLong(stringList[0], &shardNext) != REDISMODULE_OK) {
+            RedisModule_Log(ctx, "warning", "Unexpected results from nodes");
+            RedisModule_ReplyWithError(ctx, SLOT_RANGES_ERROR);
+            return;
+        }
+        if (shardNext > 0 && (next == 0 || (uint64_t)shardNext < next)) {
+            next = shardNext;
+        }
+        total += array_len(stringList) / 2;
+    });
+
+    QueryIndexPageEntry *entries = malloc(max(total, 1) * sizeof(QueryIndexPageEntry));
+    size_t count = 0;
+    for (uint32_t i = 0; i < array_len(nodesResults); i++) {
+        ARR(RedisModuleString *) stringList = nodesResults[i];
+        for (uint32_t j = 1; j + 1 < array_len(stringList); j += 2) {
+            long long id = 0;
+            RedisModule_StringToLongLong(stringList[j], &id);
+            if (next == 0 || (uint64_t)id < next) {
+                entries[count].id = id;
+                entries[count].key = stringList[j + 1];
+                count++;
+            }
+        }
+    }
+    qsort(entries, count, sizeof(QueryIndexPageEntry), QueryIndexPageEntry_Compare);
+    if (count > (size_t)limit) {
+        const uint64_t cut = entries[limit].id;
+        size_t end = limit;
+        while (end > 0 && entries[end - 1].id == cut) {
+            end--;
+        }
+        if (end > 0) {
+            next = cut;
+        } else { // more shards than the limit have the id, they all go in
+            while (end < count && entries[end].id == cut) {
+                end++;
+            }
+            next = cut + 1;
+        }
+        count = end;
+    }
+
+    RedisModule_ReplyWithArray(ctx, 2);
+    RedisModule_ReplyWithLongLong(ctx, next);
+    RedisModule_ReplyWithArray(ctx, count);
+    for (size_t i = 0; i < count; i++) {
+        RedisModule_ReplyWithString(ctx, entries[i].key);
+    }
+    free(entries);
+}
+
 static void queryindex_done_internal(ExecutionCtx *eCtx,
                                      RedisModuleCtx *ctx,
-                                     RedisModuleBlockedClient *bc) {
+                                     QueryIndexData *data) {
     ARR(ARR(RedisModuleString *)) nodesResults = collect_node_results(eCtx, ctx);
     if (!nodesResults)
         goto __done;
 
+    if (data->mode == QueryIndexMode_Count) {
+        queryindex_reply_count(ctx, nodesResults);
+        goto __done;
+    }
+    if (data->mode == QueryIndexMode_Cursor) {
+        queryindex_reply_page(ctx, nodesResults, data->limit);
+        goto __done;
+    }
+
     ReplyWithSetOrArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
     size_t len = 0;
     array_foreach(nodesResults, stringList, {
@@ -493,12 +523,48 @@ __done:
         array_free(nodesResults);
 }
 
+// The string lists of the shards to COUNT or CURSOR, in the form of the internal protocol
+static ARR(ARR(RedisModuleString *)) queryindex_gears_string_lists(ExecutionCtx *eCtx) {
+    size_t len = MR_ExecutionCtxGetResultsLen(eCtx);
+    ARR(ARR(RedisModuleString *)) nodesResults = array_new(ARR(RedisModuleString *), len);
+    for (size_t i = 0; i < len; i++) {
+        Record *raw_listRecord = MR_ExecutionCtxGetResult(eCtx, i);
+        if (raw_listRecord->recordType != GetListRecordType()) {
+            continue;
+        }
+        size_t list_len = ListRecord_GetLen((ListRecord *)raw_listRecord);
+        ARR(RedisModuleString *) stringList = array_new(RedisModuleString *, list_len);
+        for (size_t j = 0; j < list_len; j++) {
+            StringRecord *r =
+                (StringRecord *)ListRecord_GetRecord((ListRecord *)raw_listRecord, j);
+            stringList = array_append(stringList, RedisModule_CreateString(NULL, r->str, r->len));
+        }
+        nodesResults = array_append(nodesResults, stringList);
+    }
+    return nodesResults;
+}
+
 static void queryindex_done_gears(ExecutionCtx *eCtx,
                                   RedisModuleCtx *ctx,
-                                  RedisModuleBlockedClient *bc) {
+                                  QueryIndexData *data) {
     if (unlikely(check_and_reply_on_error(eCtx, ctx)))
         return;
 
+    if (data->mode != QueryIndexMode_Keys) {
+        ARR(ARR(RedisModuleString *)) nodesResults = queryindex_gears_string_lists(eCtx);
+        if (data->mode == QueryIndexMode_Count) {
+            queryindex_reply_count(ctx, nodesResults);
+        } else {
+            queryindex_reply_page(ctx, nodesResults, data->limit);
+        }
+        array_foreach(nodesResults, stringList, {
+            array_foreach(stringList, str, { RedisModule_FreeString(NULL, str); });
+            array_free(stringList);
+        });
+        array_free(nodesResults);
+        return;
+    }
+
     size_t len = MR_ExecutionCtxGetResultsLen(eCtx);
     size_t total_len = 0;
     for (int i = 0; i < len; i++) {
@@ -533,21 +599,23 @@ static void queryindex_done_gears(ExecutionCtx *eCtx,
 }
 
 static void queryindex_done(ExecutionCtx *eCtx, void *privateData) {
-    RedisModuleBlockedClient *bc = privateData;
+    QueryIndexData *data = privateData;
+    RedisModuleBlockedClient *bc = data->bc;
     RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(bc);
 
     switch (TSGlobalConfig.libmrProtocol) {
         case LIBMR_PROTOCOL_GEARS:
-            queryindex_done_gears(eCtx, ctx, bc);
+            queryindex_done_gears(eCtx, ctx, data);
             break;
         case LIBMR_PROTOCOL_INTERNAL:
-            queryindex_done_internal(eCtx, ctx, bc);
+            queryindex_done_internal(eCtx, ctx, data);
             break;
         default:
             RedisModule_ReplyWithError(ctx, "Unknown LibMR protocol");
     }
 
     RTS_UnblockClient(bc, ctx);
+    free(data);
 }
 
 int TSDB_mget_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
@@ -605,7 +673,7 @@ int TSDB_mget_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
         return REDISMODULE_OK;
     }
 
-    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, rts_free_rctx);
+    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, RTS_FreeThreadSafeCtx);
     MR_ExecutionSetOnDoneHandler(exec, mget_done, bc);
 
     MR_Run(exec);
@@ -649,6 +717,12 @@ int TSDB_mrange_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, bool
     // Always send FILTERBY to shards; they apply it regardless of aggregation.
     queryArg->filterByValueArgs = args.rangeArgs.filterByValueArgs;
     queryArg->filterByTSArgs = args.rangeArgs.filterByTSArgs;
+    if (queryArg->filterByTSArgs.hasValue) {
+        // the query arg may outlive args, it owns a copy of the timestamps
+        const size_t valuesSize = queryArg->filterByTSArgs.count * sizeof(timestamp_t);
+        queryArg->filterByTSArgs.values = malloc(valuesSize);
+        memcpy(queryArg->filterByTSArgs.values, args.rangeArgs.filterByTSArgs.values, valuesSize);
+    }
     // Push aggregation to every shard for all cases (single-agg and multi-agg).
     // Multi-agg + GROUPBY is rejected at parse time, so no special case is needed.
     if (args.rangeArgs.aggregationArgs.numClasses > 0) {
@@ -691,7 +765,7 @@ int TSDB_mrange_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, bool
         return REDISMODULE_OK;
     }
 
-    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, rts_free_rctx);
+    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, RTS_FreeThreadSafeCtx);
     MRangeData *data = malloc(sizeof(struct MRangeData)); // freed by mrange_done
     data->bc = bc;
     data->args = args;
@@ -704,7 +778,11 @@ int TSDB_mrange_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, bool
     return REDISMODULE_OK;
 }
 
-int TSDB_queryindex_MR(RedisModuleCtx *ctx, QueryPredicateList *queries) {
+int TSDB_queryindex_MR(RedisModuleCtx *ctx,
+                       QueryPredicateList *queries,
+                       QueryIndexMode mode,
+                       long long cursor,
+                       long long limit) {
     QueryPredicates_Arg *queryArg = calloc(1, sizeof(QueryPredicates_Arg));
     queryArg->shouldReturnNull = false;
     queryArg->refCount = 1;
@@ -719,6 +797,9 @@ int TSDB_queryindex_MR(RedisModuleCtx *ctx, QueryPredicateList *queries) {
     queryArg->resp3 = _ReplySet(ctx);
     queryArg->userName = CopyCurrentUserName(ctx);
     queryArg->numAggClasses = 0;
+    queryArg->queryIndexMode = mode;
+    queryArg->cursor = cursor;
+    queryArg->limit = limit;
 
     MRError *err = NULL;
 
@@ -747,8 +828,11 @@ int TSDB_queryindex_MR(RedisModuleCtx *ctx, QueryPredicateList *queries) {
         return REDISMODULE_OK;
     }
 
-    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, rts_free_rctx);
-    MR_ExecutionSetOnDoneHandler(exec, queryindex_done, bc);
+    QueryIndexData *data = malloc(sizeof(QueryIndexData)); // freed by queryindex_done
+    data->bc = RTS_BlockClient(ctx, RTS_FreeThreadSafeCtx);
+    data->mode = mode;
+    data->limit = limit;
+    MR_ExecutionSetOnDoneHandler(exec, queryindex_done, data);
 
     MR_Run(exec);
     MR_FreeExecution(exec);
@@ -871,7 +955,7 @@ int TSDB_querylabels_MR(RedisModuleCtx *ctx,
         return REDISMODULE_OK;
     }
 
-    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, rts_free_rctx);
+    RedisModuleBlockedClient *bc = RTS_BlockClient(ctx, RTS_FreeThreadSafeCtx);
     MR_ExecutionSetOnDoneHandler(exec, querylabels_done, bc);
 
     MR_Run(exec);
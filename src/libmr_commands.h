@@ -20,7 +20,11 @@ typedef struct MData
 } MData;
 
 int TSDB_mget_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
-int TSDB_queryindex_MR(RedisModuleCtx *ctx, QueryPredicateList *queries);
+int TSDB_queryindex_MR(RedisModuleCtx *ctx,
+                       QueryPredicateList *queries,
+                       QueryIndexMode mode,
+                       long long cursor,
+                       long long limit);
 int TSDB_mrange_MR(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, bool reverse);
 int TSDB_querylabels_MR(RedisModuleCtx *ctx,
                         QueryLabelsSubtype subtype,
@@ -9,6 +9,7 @@
 #include "module.h"
 #include "query_language.h"
 #include "tsdb.h"
+#include <inttypes.h>
 #include <math.h>
 #include "reply.h"
 
@@ -90,6 +91,7 @@ static void QueryPredicates_ObjectFree(void *arg) {
     QueryPredicateList_Free(predicate_list->predicates);
     QueryPredicates_FreeLimitLabels(predicate_list);
     QueryPredicates_FreeUserName(predicate_list);
+    free(predicate_list->filterByTSArgs.values);
     free(predicate_list);
 }
 
@@ -217,11 +219,15 @@ static void QueryPredicates_ArgSerialize(WriteSerializationCtx *sctx, void *arg,
     MR_SerializationCtxWriteLongLong(sctx, predicate_list->filterByTSArgs.hasValue, error);
     if (predicate_list->filterByTSArgs.hasValue) {
         MR_SerializationCtxWriteLongLong(sctx, predicate_list->filterByTSArgs.count, error);
-        for (size_t i = 0; i < predicate_list->filterByTSArgs.count; i++) {
-            MR_SerializationCtxWriteLongLong(sctx, predicate_list->filterByTSArgs.values[i], error);
-        }
+        MR_SerializationCtxWriteBuffer(sctx,
+                                       (const char *)predicate_list->filterByTSArgs.values,
+                                       predicate_list->filterByTSArgs.count * sizeof(timestamp_t),
+                                       error);
     }
     MR_SerializationCtxWriteLongLong(sctx, predicate_list->excludeEmpty, error);
+    MR_SerializationCtxWriteLongLong(sctx, predicate_list->queryIndexMode, error);
+    MR_SerializationCtxWriteLongLong(sctx, predicate_list->cursor, error);
+    MR_SerializationCtxWriteLongLong(sctx, predicate_list->limit, error);
 }
 
 static void SerializationCtxWriteRedisString(WriteSerializationCtx *sctx,
@@ -259,6 +265,7 @@ static void QueryPredicates_CleanupFailedDeserialization(QueryPredicates_Arg *pr
     }
     free(predicates->predicates);
     QueryPredicates_FreeLimitLabels(predicates);
+    free(predicates->filterByTSArgs.values);
     free(predicates);
 }
 
@@ -350,14 +357,22 @@ static void *QueryPredicates_ArgDeserialize_impl(ReaderSerializationCtx *sctx,
     predicates->filterByTSArgs.hasValue = MR_SerializationCtxReadLongLong(sctx, error);
     if (predicates->filterByTSArgs.hasValue) {
         predicates->filterByTSArgs.count = MR_SerializationCtxReadLongLong(sctx, error);
-        if (predicates->filterByTSArgs.count > MAX_TS_VALUES_FILTER) {
+        size_t valuesSize;
+        const char *values = MR_SerializationCtxReadBuffer(sctx, &valuesSize, error);
+        if (*error || predicates->filterByTSArgs.count == 0 ||
+            valuesSize != predicates->filterByTSArgs.count * sizeof(timestamp_t)) {
             goto err;
         }
-        for (size_t i = 0; i < predicates->filterByTSArgs.count; i++) {
-            predicates->filterByTSArgs.values[i] = MR_SerializationCtxReadLongLong(sctx, error);
-        }
+        predicates->filterByTSArgs.values = malloc(valuesSize);
+        memcpy(predicates->filterByTSArgs.values, values, valuesSize);
     }
     predicates->excludeEmpty = MR_SerializationCtxReadLongLong(sctx, error);
+    predicates->queryIndexMode = MR_SerializationCtxReadLongLong(sctx, error);
+    if (predicates->queryIndexMode > QueryIndexMode_Cursor) {
+        goto err;
+    }
+    predicates->cursor = MR_SerializationCtxReadLongLong(sctx, error);
+    predicates->limit = MR_SerializationCtxReadLongLong(sctx, error);
 
     if (unlikely(expect_resp && *error)) {
         goto err;
@@ -854,6 +869,33 @@ Record *ShardMgetMapper(ExecutionCtx *rctx, void *arg) {
     return series_listOrMap;
 }
 
+static void AddQueryIndexPageEntry(void *userData, uint32_t id, const char *key, size_t keyLen) {
+    ARR(RedisModuleString *) *strings = userData;
+    *strings = array_append(*strings, RedisModule_CreateStringPrintf(NULL, "%u", id));
+    *strings = array_append(*strings, RedisModule_CreateString(NULL, key, keyLen));
+}
+
+// The reply of a shard to TS.QUERYINDEX COUNT or CURSOR, as strings so it travels like the keys:
+// the count, or the next cursor followed by the id and the key of each series of the page. The
+// coordinator needs the ids to merge the pages of the shards.
+static ARR(RedisModuleString *) QueryIndexShardReply(RedisModuleCtx *ctx,
+                                                     QueryPredicates_Arg *queryArg) {
+    QueryPredicate *list = queryArg->predicates->list;
+    const size_t count = queryArg->predicates->count;
+    ARR(RedisModuleString *) strings = array_new(RedisModuleString *, 1);
+    if (queryArg->queryIndexMode == QueryIndexMode_Count) {
+        strings = array_append(
+            strings,
+            RedisModule_CreateStringPrintf(NULL, "%" PRIu64, QueryIndexCount(ctx, list, count)));
+        return strings;
+    }
+    strings = array_append(strings, NULL); // the next cursor, known once the page is done
+    const uint64_t next = QueryIndexPage(
+        ctx, list, count, queryArg->cursor, queryArg->limit, AddQueryIndexPageEntry, &strings);
+    strings[0] = RedisModule_CreateStringPrintf(NULL, "%" PRIu64, next);
+    return strings;
+}
+
 Record *ShardQueryindexMapper(ExecutionCtx *rctx, void *arg) {
     QueryPredicates_Arg *predicates = arg;
 
@@ -864,6 +906,20 @@ Record *ShardQueryindexMapper(ExecutionCtx *rctx, void *arg) {
 
     RedisModule_ThreadSafeContextLock(rts_staticCtx);
 
+    if (predicates->queryIndexMode != QueryIndexMode_Keys) {
+        ARR(RedisModuleString *) strings = QueryIndexShardReply(rts_staticCtx, predicates);
+        Record *reply = ListRecord_Create(array_len(strings));
+        array_foreach(strings, str, {
+            size_t len;
+            const char *buf = RedisModule_StringPtrLen(str, &len);
+            ListRecord_Add(reply, StringRecord_Create(strndup(buf, len), len));
+            RedisModule_FreeString(NULL, str);
+        });
+        array_free(strings);
+        RedisModule_ThreadSafeContextUnlock(rts_staticCtx);
+        return reply;
+    }
+
     // The permission error is ignored.
     RedisModuleDict *result = QueryIndex(
         rts_staticCtx, predicates->predicates->list, predicates->predicates->count, NULL);
@@ -1054,8 +1110,7 @@ static void TS_INTERNAL_MRANGE_impl(RedisModuleCtx *ctx, void *args) {
         mrangeArgs.rangeArgs.timestampAlignment = queryArg->timestampAlignment;
     }
 
-    RedisModuleDict *qi =
-        QueryIndex(ctx, mrangeArgs.queryPredicates->list, mrangeArgs.queryPredicates->count, NULL);
+    RedisModuleDict *qi = QueryIndexForMRange(ctx, &mrangeArgs, NULL);
     replyUngroupedMultiRange(ctx, qi, &mrangeArgs);
     RedisModule_FreeDict(ctx, qi);
     ReleaseCtxUser(ctx);
@@ -1289,6 +1344,17 @@ static InternalCommandCallbacks MgetCallbacks = { .command = TS_INTERNAL_MGET,
 static void TS_INTERNAL_QUERYINDEX(RedisModuleCtx *ctx, void *args) {
     QueryPredicates_Arg *queryArg = args;
     ApplyCtxUser(ctx, queryArg->userName);
+    if (queryArg->queryIndexMode != QueryIndexMode_Keys) {
+        ARR(RedisModuleString *) strings = QueryIndexShardReply(ctx, queryArg);
+        RedisModule_ReplyWithArray(ctx, array_len(strings));
+        array_foreach(strings, str, {
+            RedisModule_ReplyWithString(ctx, str);
+            RedisModule_FreeString(NULL, str);
+        });
+        array_free(strings);
+        ReleaseCtxUser(ctx);
+        return;
+    }
     RedisModuleDict *qi =
         QueryIndex(ctx, queryArg->predicates->list, queryArg->predicates->count, NULL);
     RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(qi, "^", NULL, 0);
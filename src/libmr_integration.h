@@ -42,6 +42,10 @@ typedef struct QueryPredicates_Arg
     FilterByValueArgs filterByValueArgs;
     FilterByTSArgs filterByTSArgs;
     bool excludeEmpty;
+    // TS.QUERYINDEX: the keys, their count, or a page of them from the series id cursor
+    QueryIndexMode queryIndexMode;
+    uint64_t cursor;
+    long long limit;
 } QueryPredicates_Arg;
 
 typedef struct StringRecord
@@ -13,9 +13,12 @@
 
 #include "module.h"
 
+#include "async_read.h"
+#include "bulk_load.h"
 #include "compaction.h"
 #include "common.h"
 #include "config.h"
+#include "filter_iterator.h"
 #include "indexer.h"
 #include "libmr_commands.h"
 #include "libmr_integration.h"
@@ -23,6 +26,7 @@
 #include "rdb.h"
 #include "reply.h"
 #include "resultset.h"
+#include "series_template.h"
 #include "short_read.h"
 #include "tsdb.h"
 #include "version.h"
@@ -279,7 +283,46 @@ int TSDB_info(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     return REDISMODULE_OK;
 }
 
-void _TSDB_queryindex_impl(RedisModuleCtx *ctx, QueryPredicateList *queries) {
+// The keys of a TS.QUERYINDEX page, collected as the next cursor is replied before them
+typedef struct QueryIndexPageKeys
+{
+    RedisModuleString **keys;
+    size_t count;
+} QueryIndexPageKeys;
+
+static void AddQueryIndexPageKey(void *userData, uint32_t id, const char *key, size_t keyLen) {
+    QueryIndexPageKeys *page = userData;
+    page->keys[page->count++] = RedisModule_CreateString(NULL, key, keyLen);
+}
+
+void _TSDB_queryindex_impl(RedisModuleCtx *ctx,
+                           QueryPredicateList *queries,
+                           QueryIndexMode mode,
+                           long long cursor,
+                           long long limit) {
+    if (mode == QueryIndexMode_Count) {
+        RedisModule_ReplyWithLongLong(ctx, QueryIndexCount(ctx, queries->list, queries->count));
+        return;
+    }
+    if (mode == QueryIndexMode_Cursor) {
+        QueryIndexPageKeys page = { .keys = NULL, .count = 0 };
+        const size_t maxKeys = min((uint64_t)limit, IndexedSeriesCount());
+        page.keys = malloc(max(maxKeys, 1) * sizeof(RedisModuleString *));
+        const uint64_t next = QueryIndexPage(
+            ctx, queries->list, queries->count, cursor, limit, AddQueryIndexPageKey, &page);
+
+        // the next cursor, 0 after the last page, then the keys in series id order
+        RedisModule_ReplyWithArray(ctx, 2);
+        RedisModule_ReplyWithLongLong(ctx, next);
+        RedisModule_ReplyWithArray(ctx, page.count);
+        for (size_t i = 0; i < page.count; i++) {
+            RedisModule_ReplyWithString(ctx, page.keys[i]);
+            RedisModule_FreeString(NULL, page.keys[i]);
+        }
+        free(page.keys);
+        return;
+    }
+
     RedisModuleDict *result = QueryIndex(ctx, queries->list, queries->count, NULL);
 
     ReplyWithSetOrArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
@@ -296,6 +339,60 @@ void _TSDB_queryindex_impl(RedisModuleCtx *ctx, QueryPredicateList *queries) {
     ReplySetSetOrArrayLength(ctx, replylen);
 }
 
+// Parses [COUNT | CURSOR cursor [LIMIT limit]] before the filters of TS.QUERYINDEX, *first is
+// set to the first filter. Replies with the error on failure.
+static int ParseQueryIndexMode(RedisModuleCtx *ctx,
+                               RedisModuleString **argv,
+                               int argc,
+                               int *first,
+                               QueryIndexMode *mode,
+                               long long *cursor,
+                               long long *limit) {
+    bool hasLimit = false;
+    *first = 1;
+    *mode = QueryIndexMode_Keys;
+    *cursor = 0;
+    *limit = QUERYINDEX_CURSOR_LIMIT_DEFAULT;
+    while (*first < argc) {
+        const char *arg = RedisModule_StringPtrLen(argv[*first], NULL);
+        if (strcasecmp(arg, "COUNT") == 0 || strcasecmp(arg, "CURSOR") == 0) {
+            if (*mode != QueryIndexMode_Keys) {
+                RTS_ReplyGeneralError(ctx, "TSDB: COUNT and CURSOR can't be combined");
+                return REDISMODULE_ERR;
+            }
+            if (strcasecmp(arg, "COUNT") == 0) {
+                *mode = QueryIndexMode_Count;
+                (*first)++;
+                continue;
+            }
+            *mode = QueryIndexMode_Cursor;
+            if (*first + 1 >= argc ||
+                RedisModule_StringToLongLong(argv[*first + 1], cursor) != REDISMODULE_OK ||
+                *cursor < 0 || *cursor > UINT32_MAX) {
+                RTS_ReplyGeneralError(ctx, "TSDB: invalid cursor");
+                return REDISMODULE_ERR;
+            }
+            *first += 2;
+        } else if (strcasecmp(arg, "LIMIT") == 0) {
+            if (*first + 1 >= argc ||
+                RedisModule_StringToLongLong(argv[*first + 1], limit) != REDISMODULE_OK ||
+                *limit <= 0) {
+                RTS_ReplyGeneralError(ctx, "TSDB: invalid LIMIT");
+                return REDISMODULE_ERR;
+            }
+            hasLimit = true;
+            *first += 2;
+        } else {
+            break;
+        }
+    }
+    if (hasLimit && *mode != QueryIndexMode_Cursor) {
+        RTS_ReplyGeneralError(ctx, "TSDB: LIMIT is only valid with CURSOR");
+        return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
 int TSDB_queryindex(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
@@ -303,16 +400,26 @@ int TSDB_queryindex(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
         return RedisModule_WrongArity(ctx);
     }
 
-    int query_count = argc - 1;
+    int first;
+    QueryIndexMode mode;
+    long long cursor, limit;
+    if (ParseQueryIndexMode(ctx, argv, argc, &first, &mode, &cursor, &limit) != REDISMODULE_OK) {
+        return REDISMODULE_OK;
+    }
+    int query_count = argc - first;
+    if (query_count < 1) {
+        return RedisModule_WrongArity(ctx);
+    }
 
     int response = 0;
-    QueryPredicateList *queries = parseLabelListFromArgs(ctx, argv, 1, query_count, &response);
+    QueryPredicateList *queries =
+        parseLabelListFromArgs(ctx, argv, first, query_count, &response);
     if (response == TSDB_ERROR) {
         QueryPredicateList_Free(queries);
         return RTS_ReplyGeneralError(ctx, "TSDB: failed parsing labels");
     }
 
-    if (CountPredicateType(queries, EQ) + CountPredicateType(queries, LIST_MATCH) == 0) {
+    if (CountMatcherPredicates(queries) == 0) {
         QueryPredicateList_Free(queries);
         return RTS_ReplyGeneralError(ctx, "TSDB: please provide at least one matcher");
     }
@@ -327,9 +434,9 @@ int TSDB_queryindex(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
                                        "lua, or when blocking is not allowed");
             return REDISMODULE_OK;
         }
-        TSDB_queryindex_MR(ctx, queries);
+        TSDB_queryindex_MR(ctx, queries, mode, cursor, limit);
     } else {
-        _TSDB_queryindex_impl(ctx, queries);
+        _TSDB_queryindex_impl(ctx, queries, mode, cursor, limit);
     }
 
     QueryPredicateList_Free(queries);
@@ -464,6 +571,66 @@ int TSDB_querylabels(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     return REDISMODULE_OK;
 }
 
+#define INDEXSTATS_TOP_VALUES 10
+
+static void ReplyWithLabelStats(void *userData,
+                                const char *label,
+                                size_t labelLen,
+                                const LabelStats *stats) {
+    RedisModuleCtx *ctx = userData;
+    ReplyWithMapOrArray(ctx, 3 * 2, true);
+    RedisModule_ReplyWithSimpleString(ctx, "label");
+    RedisModule_ReplyWithStringBuffer(ctx, label, labelLen);
+    RedisModule_ReplyWithSimpleString(ctx, "series");
+    RedisModule_ReplyWithLongLong(ctx, stats->numSeries);
+    RedisModule_ReplyWithSimpleString(ctx, "distinctValues");
+    RedisModule_ReplyWithLongLong(ctx, stats->numValues);
+}
+
+// TS.INDEXSTATS [label]: the shape of the label index of this shard
+int TSDB_indexstats(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    if (argc > 2) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (argc == 1) {
+        ReplyWithMapOrArray(ctx, 4 * 2, true);
+        RedisModule_ReplyWithSimpleString(ctx, "series");
+        RedisModule_ReplyWithLongLong(ctx, IndexedSeriesCount());
+        RedisModule_ReplyWithSimpleString(ctx, "labels");
+        RedisModule_ReplyWithLongLong(ctx, IndexedLabelsCount());
+        RedisModule_ReplyWithSimpleString(ctx, "postingLists");
+        RedisModule_ReplyWithLongLong(ctx, IndexPostingListsCount());
+        RedisModule_ReplyWithSimpleString(ctx, "labelStats");
+        RedisModule_ReplyWithArray(ctx, IndexedLabelsCount());
+        ForEachLabelStats(ReplyWithLabelStats, ctx);
+        return REDISMODULE_OK;
+    }
+
+    size_t labelLen;
+    const char *label = RedisModule_StringPtrLen(argv[1], &labelLen);
+    const LabelStats *stats = GetLabelStats(label, labelLen);
+    LabelValueCount top[INDEXSTATS_TOP_VALUES];
+    const size_t numTop = GetLabelTopValues(label, labelLen, top, INDEXSTATS_TOP_VALUES);
+
+    ReplyWithMapOrArray(ctx, 4 * 2, true);
+    RedisModule_ReplyWithSimpleString(ctx, "label");
+    RedisModule_ReplyWithString(ctx, argv[1]);
+    RedisModule_ReplyWithSimpleString(ctx, "series");
+    RedisModule_ReplyWithLongLong(ctx, stats ? stats->numSeries : 0);
+    RedisModule_ReplyWithSimpleString(ctx, "distinctValues");
+    RedisModule_ReplyWithLongLong(ctx, stats ? stats->numValues : 0);
+    RedisModule_ReplyWithSimpleString(ctx, "topValues");
+    RedisModule_ReplyWithArray(ctx, numTop);
+    for (size_t i = 0; i < numTop; i++) {
+        RedisModule_ReplyWithArray(ctx, 2);
+        RedisModule_ReplyWithString(ctx, top[i].value);
+        RedisModule_ReplyWithLongLong(ctx, top[i].numSeries);
+        RedisModule_FreeString(NULL, top[i].value);
+    }
+    return REDISMODULE_OK;
+}
+
 // multi-series groupby logic
 static int replyGroupedMultiRange(RedisModuleCtx *ctx,
                                   TS_ResultSet *resultset,
@@ -576,6 +743,8 @@ int replyUngroupedMultiRange(RedisModuleCtx *ctx, RedisModuleDict *result, const
         RTS_ReplyKeyPermissionsError(ctx);
         return REDISMODULE_ERR;
     }
+    // the iterators of each series are allocated from the arena and rewound after its reply
+    QueryArena *arena = QueryArena_New();
     iter = RedisModule_DictIteratorStartC(result, "^", NULL, 0);
     ReplyWithMapOrArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN, false);
     while ((currentKey = RedisModule_DictNext(ctx, iter, NULL)) != NULL) {
@@ -592,14 +761,18 @@ int replyUngroupedMultiRange(RedisModuleCtx *ctx, RedisModuleDict *result, const
         }
 
         EnrichedChunk *first_chunk = NULL;
-        AbstractIterator *probe = NULL;
+        AbstractIterator *probe;
         if (args->excludeEmpty) {
-            probe = SeriesQueryIfNonEmpty(series, &args->rangeArgs, args->reverse, &first_chunk);
+            probe = SeriesQueryIfNonEmpty(
+                ctx, series, &args->rangeArgs, args->reverse, &first_chunk, arena);
             if (!probe) {
+                QueryArena_Reset(arena);
                 RedisModule_CloseKey(key);
                 RedisModule_FreeString(ctx, currentKey);
                 continue;
             }
+        } else {
+            probe = SeriesQuery(ctx, series, &args->rangeArgs, args->reverse, true, arena);
         }
         ReplySeriesArrayPos(ctx,
                             series,
@@ -611,16 +784,109 @@ int replyUngroupedMultiRange(RedisModuleCtx *ctx, RedisModuleDict *result, const
                             false,
                             probe,
                             first_chunk);
+        QueryArena_Reset(arena);
         replylen++;
         RedisModule_CloseKey(key);
         RedisModule_FreeString(ctx, currentKey);
     }
 
+    QueryArena_Free(arena);
     RedisModule_DictIteratorStop(iter);
     ReplySetMapOrArrayLength(ctx, replylen, false);
     return REDISMODULE_OK;
 }
 
+RedisModuleDict *QueryIndexForMRange(RedisModuleCtx *ctx,
+                                     const MRangeArgs *args,
+                                     bool *hasPermissionError) {
+    QueryPredicateList *predicates = args->queryPredicates;
+    // LATEST may reply the open bucket of a compaction and EMPTY may reply buckets without
+    // samples, so only a plain EXCLUDEEMPTY query can skip series by their time range
+    if (!args->excludeEmpty || args->rangeArgs.latest || args->rangeArgs.aggregationArgs.empty) {
+        return QueryIndex(ctx, predicates->list, predicates->count, hasPermissionError);
+    }
+    return QueryIndexInRange(ctx,
+                             predicates->list,
+                             predicates->count,
+                             args->rangeArgs.startTimestamp,
+                             args->rangeArgs.endTimestamp,
+                             hasPermissionError);
+}
+
+int replyMultiRangeFromSeries(RedisModuleCtx *ctx,
+                              Series **series,
+                              size_t count,
+                              const MRangeArgs *args) {
+    TS_ResultSet *resultset = NULL;
+    QueryArena *arena = NULL;
+    long long replylen = 0;
+    if (args->groupByLabel) {
+        resultset = ResultSet_Create();
+        ResultSet_GroupbyLabel(resultset, args->groupByLabel);
+    } else {
+        // EXCLUDEEMPTY may skip series, so the real count is only known after emission
+        ReplyWithMapOrArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN, false);
+        arena = QueryArena_New();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        Series *s = series[i];
+        if (args->groupByLabel) {
+            ResultSet_AddSeries(resultset, s, RedisModule_StringPtrLen(s->keyName, NULL));
+            continue;
+        }
+
+        EnrichedChunk *first_chunk = NULL;
+        AbstractIterator *probe;
+        if (args->excludeEmpty) {
+            probe = SeriesQueryIfNonEmpty(
+                ctx, s, &args->rangeArgs, args->reverse, &first_chunk, arena);
+            if (!probe) {
+                QueryArena_Reset(arena);
+                continue;
+            }
+        } else {
+            probe = SeriesQuery(ctx, s, &args->rangeArgs, args->reverse, true, arena);
+        }
+        ReplySeriesArrayPos(ctx,
+                            s,
+                            args->withLabels,
+                            (RedisModuleString **)args->limitLabels,
+                            args->numLimitLabels,
+                            &args->rangeArgs,
+                            args->reverse,
+                            false,
+                            probe,
+                            first_chunk);
+        QueryArena_Reset(arena);
+        replylen++;
+    }
+
+    if (!args->groupByLabel) {
+        QueryArena_Free(arena);
+        ReplySetMapOrArrayLength(ctx, replylen, false);
+        return REDISMODULE_OK;
+    }
+
+    // Apply the reducer, the latest flag was already handled when the series were collected
+    RangeArgs rangeArgs = args->rangeArgs;
+    rangeArgs.latest = false;
+    ResultSet_ApplyReducer(ctx, resultset, &rangeArgs, &args->groupByReducerArgs);
+
+    // Do not apply the aggregation on the resultset, do apply max results on the final result
+    RangeArgs minimizedArgs = RangeArgs_ZeroProcessing(&args->rangeArgs);
+
+    replyResultSet(ctx,
+                   resultset,
+                   args->withLabels,
+                   (RedisModuleString **)args->limitLabels,
+                   args->numLimitLabels,
+                   &minimizedArgs,
+                   args->reverse);
+    ResultSet_Free(resultset);
+    return REDISMODULE_OK;
+}
+
 static int TSDB_generic_mrange(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, bool rev) {
     MRangeArgs args;
     if (parseMRangeCommand(ctx, argv, argc, &args) != REDISMODULE_OK) {
@@ -629,8 +895,7 @@ static int TSDB_generic_mrange(RedisModuleCtx *ctx, RedisModuleString **argv, in
     args.reverse = rev;
 
     bool hasPermissionError = false;
-    RedisModuleDict *resultSeries = QueryIndex(
-        ctx, args.queryPredicates->list, args.queryPredicates->count, &hasPermissionError);
+    RedisModuleDict *resultSeries = QueryIndexForMRange(ctx, &args, &hasPermissionError);
 
     if (hasPermissionError) {
         MRangeArgs_Free(&args);
@@ -638,6 +903,10 @@ static int TSDB_generic_mrange(RedisModuleCtx *ctx, RedisModuleString **argv, in
         return REDISMODULE_ERR;
     }
 
+    if (AsyncRead_ShouldOffload(ctx, rev ? READ_OFFLOAD_MREVRANGE : READ_OFFLOAD_MRANGE)) {
+        return AsyncRead_MRange(ctx, &args, resultSeries);
+    }
+
     int result = REDISMODULE_OK;
     if (args.groupByLabel) {
         TS_ResultSet *resultset = ResultSet_Create();
@@ -705,10 +974,17 @@ int TSDB_generic_range(RedisModuleCtx *ctx, RedisModuleString **argv, int argc,
         goto _out;
     }
 
+    if (AsyncRead_ShouldOffload(ctx, rev ? READ_OFFLOAD_REVRANGE : READ_OFFLOAD_RANGE)) {
+        Series *snapshot = SeriesSnapshot(
+            series, rangeArgs.startTimestamp, rangeArgs.endTimestamp, rangeArgs.latest);
+        RedisModule_CloseKey(key);
+        return AsyncRead_Range(ctx, snapshot, &rangeArgs, rev);
+    }
+
     ReplySeriesRange(ctx, series, &rangeArgs, rev);
 
 _out:
-    free(rangeArgs.aggregationArgs.classes);
+    RangeArgs_Free(&rangeArgs);
     RedisModule_CloseKey(key);
     return REDISMODULE_OK;
 }
@@ -878,7 +1154,7 @@ int TSDB_generic_nrange(RedisModuleCtx *ctx, RedisModuleString **argv, int argc,
             perKey.aggregationArgs.classes = &rangeArgs.aggregationArgs.classes[classOffset];
             classOffset += aggs_per_key[i];
         }
-        iters[i] = SeriesQuery(series[i], &perKey, rev, true);
+        iters[i] = SeriesQuery(ctx, series[i], &perKey, rev, true, NULL);
     }
 
     ReplySeriesNRange(ctx, iters, (size_t)numKeys, aggs_per_key, rangeArgs.count, rev);
@@ -888,7 +1164,7 @@ cleanup:
     free(allClasses);
     free(iters);
     free(aggs_per_key);
-    free(rangeArgs.aggregationArgs.classes);
+    RangeArgs_Free(&rangeArgs);
     for (size_t i = 0; i < opened; i++) {
         RedisModule_CloseKey(keys[i]);
     }
@@ -905,6 +1181,86 @@ int TSDB_nrevrange(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     return TSDB_generic_nrange(ctx, argv, argc, true);
 }
 
+typedef struct PendingWriteEvent
+{
+    WriteEvent event;
+    RedisModuleString *keyName;
+} PendingWriteEvent;
+
+// Commands run one at a time on the main thread, so a single context is enough. `depth` allows a
+// command to be called from another one (e.g. through RM_Call) without flushing early.
+static struct
+{
+    int depth;
+    RedisModuleDict *seen[WriteEvent_Count];
+    PendingWriteEvent *pending; // in the order they were first recorded
+    size_t count;
+    size_t capacity;
+} writeCtx;
+
+static void emitWriteEvent(RedisModuleCtx *ctx, WriteEvent event, RedisModuleString *keyName) {
+    switch (event) {
+        case WriteEvent_Add:
+            RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_MODULE, "ts.add", keyName);
+            break;
+        case WriteEvent_AddDest:
+            RedisModule_NotifyKeyspaceEvent(
+                ctx, REDISMODULE_NOTIFY_MODULE, "ts.add:dest", keyName);
+            break;
+        case WriteEvent_KeyReady:
+            RedisModule_SignalKeyAsReady(ctx, keyName);
+            break;
+        case WriteEvent_Count:
+            break;
+    }
+}
+
+void WriteCtx_Begin() {
+    if (writeCtx.depth++ > 0) {
+        return;
+    }
+    for (int i = 0; i < WriteEvent_Count; i++) {
+        writeCtx.seen[i] = RedisModule_CreateDict(NULL);
+    }
+}
+
+void WriteCtx_Event(RedisModuleCtx *ctx, WriteEvent event, RedisModuleString *keyName) {
+    if (writeCtx.depth == 0) {
+        emitWriteEvent(ctx, event, keyName);
+        return;
+    }
+
+    size_t len;
+    const char *keyStr = RedisModule_StringPtrLen(keyName, &len);
+    if (RedisModule_DictSetC(writeCtx.seen[event], (void *)keyStr, len, NULL) != REDISMODULE_OK) {
+        return; // already recorded
+    }
+    if (writeCtx.count == writeCtx.capacity) {
+        writeCtx.capacity = writeCtx.capacity ? writeCtx.capacity * 2 : 16;
+        writeCtx.pending = realloc(writeCtx.pending, writeCtx.capacity * sizeof(*writeCtx.pending));
+    }
+    // the key name may be released before the end of the command, e.g. when a rule is deleted
+    writeCtx.pending[writeCtx.count++] = (PendingWriteEvent){
+        .event = event,
+        .keyName = RedisModule_HoldString(NULL, keyName),
+    };
+}
+
+void WriteCtx_End(RedisModuleCtx *ctx) {
+    if (--writeCtx.depth > 0) {
+        return;
+    }
+    for (size_t i = 0; i < writeCtx.count; i++) {
+        emitWriteEvent(ctx, writeCtx.pending[i].event, writeCtx.pending[i].keyName);
+        RedisModule_FreeString(NULL, writeCtx.pending[i].keyName);
+    }
+    writeCtx.count = 0;
+    for (int i = 0; i < WriteEvent_Count; i++) {
+        RedisModule_FreeDict(NULL, writeCtx.seen[i]);
+        writeCtx.seen[i] = NULL;
+    }
+}
+
 static int internalAdd(RedisModuleCtx *ctx,
                        Series *series,
                        api_timestamp_t timestamp,
@@ -953,8 +1309,7 @@ static void handleCompaction(RedisModuleCtx *ctx,
             double aggVal;
             if (rule->aggClass->finalize(rule->aggContext, &aggVal) == TSDB_OK) {
                 internalAdd(ctx, destSeries, rule->startCurrentTimeBucket, aggVal, DP_LAST, false);
-                RedisModule_NotifyKeyspaceEvent(
-                    ctx, REDISMODULE_NOTIFY_MODULE, "ts.add:dest", rule->destKey);
+                WriteCtx_Event(ctx, WriteEvent_AddDest, rule->destKey);
             }
         }
         Sample last_sample;
@@ -997,18 +1352,63 @@ static inline bool filter_close_samples(DuplicatePolicy dp_policy,
            fabs(value - series->lastValue) <= series->ignoreMaxValDiff;
 }
 
-static int internalAdd(RedisModuleCtx *ctx,
-                       Series *series,
-                       api_timestamp_t timestamp,
-                       double value,
-                       DuplicatePolicy dp_override,
-                       bool should_reply) {
+typedef enum AddResult
+{
+    AddResult_Ok,
+    AddResult_Filtered, // ignored as a close sample, replied with the last timestamp
+    AddResult_TooOld,
+    AddResult_UpsertError,
+    AddResult_InvalidValue,
+    AddResult_InvalidTimestamp,
+    AddResult_NegativeTimestamp,
+    AddResult_WrongType,
+} AddResult;
+
+static void replyAddResult(RedisModuleCtx *ctx, AddResult result, api_timestamp_t timestamp) {
+    switch (result) {
+        case AddResult_Ok:
+        case AddResult_Filtered:
+            RedisModule_ReplyWithLongLong(ctx, timestamp);
+            break;
+        case AddResult_TooOld:
+            RTS_ReplyGeneralError(ctx, "TSDB: Timestamp is older than retention");
+            break;
+        case AddResult_UpsertError:
+            RTS_ReplyGeneralError(ctx,
+                                  "TSDB: Error at upsert, update is not supported when "
+                                  "DUPLICATE_POLICY is set to BLOCK mode, or either current or new "
+                                  "value is NaN and DUPLICATE_POLICY is MAX/MIN/SUM");
+            break;
+        case AddResult_InvalidValue:
+            RTS_ReplyGeneralError(ctx, "TSDB: invalid value");
+            break;
+        case AddResult_InvalidTimestamp:
+            RTS_ReplyGeneralError(ctx, "TSDB: invalid timestamp");
+            break;
+        case AddResult_NegativeTimestamp:
+            RTS_ReplyGeneralError(ctx, "TSDB: invalid timestamp, must be a nonnegative integer");
+            break;
+        case AddResult_WrongType:
+            RTS_ReplyGeneralError(ctx, "TSDB: the key is not a TSDB key");
+            break;
+    }
+}
+
+static inline bool isOlderThanRetention(const Series *series, api_timestamp_t timestamp) {
     const timestamp_t lastTS = series->lastTimestamp;
     const uint64_t retention = series->retentionTime;
+    return retention && timestamp < lastTS && retention < lastTS - timestamp;
+}
+
+// Same as internalAdd without replying, the caller replies according to the result
+static AddResult internalAddNoReply(RedisModuleCtx *ctx,
+                                    Series *series,
+                                    api_timestamp_t timestamp,
+                                    double value,
+                                    DuplicatePolicy dp_override) {
     // ensure inside retention period.
-    if (retention && timestamp < lastTS && retention < lastTS - timestamp) {
-        RTS_ReplyGeneralError(ctx, "TSDB: Timestamp is older than retention");
-        return REDISMODULE_ERR;
+    if (isOlderThanRetention(series, timestamp)) {
+        return AddResult_TooOld;
     }
 
     // Use module level configuration if key level configuration doesn't exist
@@ -1018,17 +1418,12 @@ static int internalAdd(RedisModuleCtx *ctx,
     // Insert filter for close samples. If configured, it's used to ignore last measurement if its
     // value is negligible compared to the last sample.
     if (filter_close_samples(dp_policy, series, timestamp, value)) {
-        RedisModule_ReplyWithLongLong(ctx, series->lastTimestamp);
-        return REDISMODULE_ERR;
+        return AddResult_Filtered;
     }
 
     if (timestamp <= series->lastTimestamp && series->totalSamples != 0) {
         if (SeriesUpsertSample(series, timestamp, value, dp_policy) != REDISMODULE_OK) {
-            RTS_ReplyGeneralError(ctx,
-                                  "TSDB: Error at upsert, update is not supported when "
-                                  "DUPLICATE_POLICY is set to BLOCK mode, or either current or new "
-                                  "value is NaN and DUPLICATE_POLICY is MAX/MIN/SUM");
-            return REDISMODULE_ERR;
+            return AddResult_UpsertError;
         }
     } else {
         SeriesAddSample(series, timestamp, value);
@@ -1046,7 +1441,25 @@ static int internalAdd(RedisModuleCtx *ctx,
     // Wake any TS.READ waiters parked on this key. Cheap no-op when no client
     // is blocked; harmless extra try_reply when the upsert was an in-place
     // update (the reply_cb will re-check and stay parked if nothing changed).
-    RedisModule_SignalKeyAsReady(ctx, series->keyName);
+    WriteCtx_Event(ctx, WriteEvent_KeyReady, series->keyName);
+    return AddResult_Ok;
+}
+
+static int internalAdd(RedisModuleCtx *ctx,
+                       Series *series,
+                       api_timestamp_t timestamp,
+                       double value,
+                       DuplicatePolicy dp_override,
+                       bool should_reply) {
+    const AddResult result = internalAddNoReply(ctx, series, timestamp, value, dp_override);
+    if (result == AddResult_Filtered) {
+        RedisModule_ReplyWithLongLong(ctx, series->lastTimestamp);
+        return REDISMODULE_ERR;
+    }
+    if (result != AddResult_Ok) {
+        replyAddResult(ctx, result, timestamp);
+        return REDISMODULE_ERR;
+    }
 
     if (should_reply) {
         RedisModule_ReplyWithLongLong(ctx, timestamp);
@@ -1054,6 +1467,84 @@ static int internalAdd(RedisModuleCtx *ctx,
     return REDISMODULE_OK;
 }
 
+static AddResult parseTimestamp(const RedisModuleString *timestampStr,
+                                api_timestamp_t *timestamp) {
+    long long timestampValue;
+    if (RedisModule_StringToLongLong(timestampStr, &timestampValue) != REDISMODULE_OK) {
+        return AddResult_InvalidTimestamp;
+    }
+    if (timestampValue < 0) {
+        return AddResult_NegativeTimestamp;
+    }
+    *timestamp = (api_timestamp_t)timestampValue;
+    return AddResult_Ok;
+}
+
+// Parse a sample's timestamp and value, shared by the multi-sample write commands
+static AddResult parseSample(const RedisModuleString *timestampStr,
+                             const RedisModuleString *valueStr,
+                             Sample *sample) {
+    if (!parse_double(valueStr, &sample->value)) {
+        return AddResult_InvalidValue;
+    }
+    return parseTimestamp(timestampStr, &sample->timestamp);
+}
+
+// Creates the series from the template named after the TEMPLATE argument, other creation
+// arguments except LABELS are taken from the template
+static int createFromTemplate(RedisModuleCtx *ctx,
+                              RedisModuleString *keyName,
+                              RedisModuleString **argv,
+                              int argc,
+                              int templatePos,
+                              Series **series,
+                              RedisModuleKey **key) {
+    if (templatePos + 1 >= argc) {
+        RedisModule_WrongArity(ctx);
+        return REDISMODULE_ERR;
+    }
+    const SeriesTemplate *tmpl = SeriesTemplate_Get(argv[templatePos + 1]);
+    if (tmpl == NULL) {
+        RTS_ReplyGeneralError(ctx, "TSDB: unknown template");
+        return REDISMODULE_ERR;
+    }
+
+    size_t labelsCount = 0;
+    Label *labels = NULL;
+    if (parseLabelsFromArgs(argv, argc, &labelsCount, &labels, false) == REDISMODULE_ERR) {
+        RTS_ReplyGeneralError(ctx, "TSDB: Couldn't parse LABELS");
+        return REDISMODULE_ERR;
+    }
+    if (SeriesTemplate_CreateSeries(ctx, tmpl, keyName, labels, labelsCount, series, key) !=
+        TSDB_OK) {
+        RTS_ReplyGeneralError(ctx, "TSDB: failed to create the series from the template");
+        return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
+int CreateSeriesFromArgs(RedisModuleCtx *ctx,
+                         RedisModuleString *keyName,
+                         RedisModuleString **argv,
+                         int argc,
+                         Series **series,
+                         RedisModuleKey **key) {
+    int labelsPos = RMUtil_ArgIndex("LABELS", argv, argc);
+    int templatePos = RMUtil_ArgIndex(TEMPLATE_ARG, argv, labelsPos < 0 ? argc : labelsPos);
+    if (templatePos > 0) {
+        return createFromTemplate(ctx, keyName, argv, argc, templatePos, series, key);
+    }
+
+    CreateCtx cCtx = { 0 };
+    if (parseCreateArgs(ctx, argv, argc, &cCtx) != REDISMODULE_OK) {
+        return REDISMODULE_ERR;
+    }
+
+    CreateTsKey(ctx, keyName, &cCtx, series, key);
+    SeriesCreateRulesFromGlobalConfig(ctx, keyName, *series, cCtx.labels, cCtx.labelsCount);
+    return REDISMODULE_OK;
+}
+
 static inline int add(RedisModuleCtx *ctx,
                       RedisModuleString *keyName,
                       const RedisModuleString *timestampStr,
@@ -1062,35 +1553,21 @@ static inline int add(RedisModuleCtx *ctx,
                       int argc) {
     RedisModuleKey *key = RedisModule_OpenKey(ctx, keyName, REDISMODULE_READ | REDISMODULE_WRITE);
 
-    double value;
-    if (!parse_double(valueStr, &value)) {
-        RTS_ReplyGeneralError(ctx, "TSDB: invalid value");
-        return REDISMODULE_ERR;
-    }
-
-    long long timestampValue;
-    if (RedisModule_StringToLongLong(timestampStr, &timestampValue) != REDISMODULE_OK) {
-        RTS_ReplyGeneralError(ctx, "TSDB: invalid timestamp");
-        return REDISMODULE_ERR;
-    }
-    if (timestampValue < 0) {
-        RTS_ReplyGeneralError(ctx, "TSDB: invalid timestamp, must be a nonnegative integer");
+    Sample sample;
+    const AddResult parsed = parseSample(timestampStr, valueStr, &sample);
+    if (parsed != AddResult_Ok) {
+        replyAddResult(ctx, parsed, 0);
         return REDISMODULE_ERR;
     }
-    const api_timestamp_t timestamp = (api_timestamp_t)timestampValue;
 
     Series *series = NULL;
     DuplicatePolicy dp = DP_NONE;
 
     if (argv != NULL && RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
         // the key doesn't exist, lets check we have enough information to create one
-        CreateCtx cCtx = { 0 };
-        if (parseCreateArgs(ctx, argv, argc, &cCtx) != REDISMODULE_OK) {
+        if (CreateSeriesFromArgs(ctx, keyName, argv, argc, &series, &key) != REDISMODULE_OK) {
             return REDISMODULE_ERR;
         }
-
-        CreateTsKey(ctx, keyName, &cCtx, &series, &key);
-        SeriesCreateRulesFromGlobalConfig(ctx, keyName, series, cCtx.labels, cCtx.labelsCount);
     } else if (RedisModule_ModuleTypeGetType(key) != SeriesType) {
         RTS_ReplyGeneralError(ctx, "TSDB: the key is not a TSDB key");
         return REDISMODULE_ERR;
@@ -1103,7 +1580,7 @@ static inline int add(RedisModuleCtx *ctx,
             return REDISMODULE_ERR;
         }
     }
-    const int rv = internalAdd(ctx, series, timestamp, value, dp, true);
+    const int rv = internalAdd(ctx, series, sample.timestamp, sample.value, dp, true);
     RedisModule_CloseKey(key);
     return rv;
 }
@@ -1112,6 +1589,67 @@ static inline RedisModuleString *getCurrentTime(RedisModuleCtx *ctx) {
     return RedisModule_CreateStringPrintf(ctx, "%llu", RedisModule_Milliseconds());
 }
 
+typedef struct MAddEntry
+{
+    AddResult result;
+    api_timestamp_t replyTimestamp;
+    const RedisModuleString *timestampStr;
+} MAddEntry;
+
+// Out-of-order samples of one series, merged into their chunks together instead of one by one
+typedef struct UpsertBatch
+{
+    Series *series;
+    Sample *samples;
+    ChunkResult *results;
+    size_t *entryIdx; // the MAddEntry each sample came from
+    size_t count;
+    size_t capacity;
+} UpsertBatch;
+
+static void UpsertBatch_Push(UpsertBatch *batch, Sample sample, size_t entryIdx) {
+    if (batch->count == batch->capacity) {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : 16;
+        batch->samples = realloc(batch->samples, batch->capacity * sizeof(*batch->samples));
+        batch->results = realloc(batch->results, batch->capacity * sizeof(*batch->results));
+        batch->entryIdx = realloc(batch->entryIdx, batch->capacity * sizeof(*batch->entryIdx));
+    }
+    batch->samples[batch->count] = sample;
+    batch->entryIdx[batch->count] = entryIdx;
+    batch->count++;
+}
+
+static void UpsertBatch_Flush(RedisModuleCtx *ctx, UpsertBatch *batch, MAddEntry *entries) {
+    if (batch->count == 0) {
+        return;
+    }
+    Series *series = batch->series;
+    const DuplicatePolicy dp_policy = series->duplicatePolicy ?: TSGlobalConfig.duplicatePolicy;
+    SeriesUpsertSamples(series, batch->samples, batch->count, batch->results, dp_policy);
+    for (size_t i = 0; i < batch->count; i++) {
+        entries[batch->entryIdx[i]].result =
+            batch->results[i] == CR_OK ? AddResult_Ok : AddResult_UpsertError;
+    }
+    batch->count = 0;
+    WriteCtx_Event(ctx, WriteEvent_KeyReady, series->keyName);
+}
+
+static void UpsertBatch_Free(UpsertBatch *batch) {
+    free(batch->samples);
+    free(batch->results);
+    free(batch->entryIdx);
+    free(batch);
+}
+
+static void flushUpsertBatches(RedisModuleCtx *ctx, RedisModuleDict *batches, MAddEntry *entries) {
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(batches, "^", NULL, 0);
+    UpsertBatch *batch;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&batch)) {
+        UpsertBatch_Flush(ctx, batch, entries);
+    }
+    RedisModule_DictIteratorStop(iter);
+}
+
 int TSDB_madd(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
@@ -1120,14 +1658,19 @@ int TSDB_madd(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     }
 
     RedisModuleString *curTimeStr = NULL;
-
-    RedisModule_ReplyWithArray(ctx, (argc - 1) / 3);
-    const RedisModuleString **replArgv = malloc((argc - 1) * sizeof *replArgv);
-    const RedisModuleString **offset = replArgv;
-    for (int i = 1; i < argc; i += 3) {
-        RedisModuleString *keyName = argv[i];
-        const RedisModuleString *timestampStr = argv[i + 1];
-        const RedisModuleString *valueStr = argv[i + 2];
+    WriteCtx_Begin();
+
+    const size_t numEntries = (argc - 1) / 3;
+    MAddEntry *entries = calloc(numEntries, sizeof(*entries));
+    // Out-of-order samples are deferred into a batch per series. A batch is flushed before any
+    // in-order sample of the same series, and before appends to series with compaction rules, so
+    // the final state is the same as applying the samples in argument order.
+    RedisModuleDict *batches = RedisModule_CreateDict(NULL);
+    for (size_t n = 0; n < numEntries; n++) {
+        RedisModuleString *keyName = argv[1 + n * 3];
+        const RedisModuleString *timestampStr = argv[2 + n * 3];
+        const RedisModuleString *valueStr = argv[3 + n * 3];
+        MAddEntry *entry = &entries[n];
 
         if (stringEqualsC(timestampStr, "*")) {
             // if timestamp is "*", take current time (automatic timestamp)
@@ -1136,11 +1679,69 @@ int TSDB_madd(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
             }
             timestampStr = curTimeStr;
         }
+        entry->timestampStr = timestampStr;
+
+        Sample sample;
+        entry->result = parseSample(timestampStr, valueStr, &sample);
+        if (entry->result != AddResult_Ok) {
+            continue;
+        }
+        entry->replyTimestamp = sample.timestamp;
+
+        RedisModuleKey *key =
+            RedisModule_OpenKey(ctx, keyName, REDISMODULE_READ | REDISMODULE_WRITE);
+        if (RedisModule_ModuleTypeGetType(key) != SeriesType) {
+            RedisModule_CloseKey(key);
+            entry->result = AddResult_WrongType;
+            continue;
+        }
+        Series *series = RedisModule_ModuleTypeGetValue(key);
+        RedisModule_CloseKey(key);
+
+        UpsertBatch *batch = RedisModule_DictGetC(batches, &series, sizeof(series), NULL);
+        if (series->totalSamples != 0 && sample.timestamp < series->lastTimestamp) {
+            if (isOlderThanRetention(series, sample.timestamp)) {
+                entry->result = AddResult_TooOld;
+                continue;
+            }
+            if (!batch) {
+                batch = calloc(1, sizeof(*batch));
+                batch->series = series;
+                RedisModule_DictSetC(batches, &series, sizeof(series), batch);
+            }
+            UpsertBatch_Push(batch, sample, n);
+            continue;
+        }
 
-        if (add(ctx, keyName, timestampStr, valueStr, NULL, -1) == REDISMODULE_OK) {
-            *offset++ = keyName;
-            *offset++ = timestampStr;
-            *offset++ = valueStr;
+        if (series->rules) {
+            flushUpsertBatches(ctx, batches, entries);
+        } else if (batch) {
+            UpsertBatch_Flush(ctx, batch, entries);
+        }
+        entry->result = internalAddNoReply(ctx, series, sample.timestamp, sample.value, DP_NONE);
+        if (entry->result == AddResult_Filtered) {
+            entry->replyTimestamp = series->lastTimestamp;
+        }
+    }
+    flushUpsertBatches(ctx, batches, entries);
+
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(batches, "^", NULL, 0);
+    UpsertBatch *batch;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&batch)) {
+        UpsertBatch_Free(batch);
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeDict(NULL, batches);
+
+    RedisModule_ReplyWithArray(ctx, numEntries);
+    const RedisModuleString **replArgv = malloc((argc - 1) * sizeof *replArgv);
+    const RedisModuleString **offset = replArgv;
+    for (size_t n = 0; n < numEntries; n++) {
+        replyAddResult(ctx, entries[n].result, entries[n].replyTimestamp);
+        if (entries[n].result == AddResult_Ok) {
+            *offset++ = argv[1 + n * 3];
+            *offset++ = entries[n].timestampStr;
+            *offset++ = argv[3 + n * 3];
         }
     }
     const size_t replArgc = offset - replArgv;
@@ -1152,11 +1753,232 @@ int TSDB_madd(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
         RedisModule_Replicate(ctx, "TS.MADD", "v", replArgv, replArgc);
     }
     free(replArgv);
+    free(entries);
 
     for (int i = 1; i < argc; i += 3) {
-        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_MODULE, "ts.add", argv[i]);
+        WriteCtx_Event(ctx, WriteEvent_Add, argv[i]);
+    }
+    WriteCtx_End(ctx);
+
+    return REDISMODULE_OK;
+}
+
+// TS.MADDROW timestamp key value [key value ...]
+// Appends a row of samples sharing one timestamp, which is parsed (or taken from the clock for
+// `*`) once. Replies like TS.MADD, with an array holding the timestamp or the error of every key.
+int TSDB_maddrow(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 4 || (argc - 2) % 2 != 0) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    RedisModuleString *timestampStr = argv[1];
+    if (stringEqualsC(timestampStr, "*")) {
+        timestampStr = getCurrentTime(ctx);
+    }
+    api_timestamp_t timestamp;
+    const AddResult parsed = parseTimestamp(timestampStr, &timestamp);
+    if (parsed != AddResult_Ok) {
+        replyAddResult(ctx, parsed, 0);
+        return REDISMODULE_ERR;
+    }
+
+    WriteCtx_Begin();
+    const size_t numEntries = (argc - 2) / 2;
+    MAddEntry *entries = calloc(numEntries, sizeof(*entries));
+    size_t added = 0;
+    for (size_t n = 0; n < numEntries; n++) {
+        RedisModuleString *keyName = argv[2 + n * 2];
+        MAddEntry *entry = &entries[n];
+        entry->replyTimestamp = timestamp;
+
+        double value;
+        if (!parse_double(argv[3 + n * 2], &value)) {
+            entry->result = AddResult_InvalidValue;
+            continue;
+        }
+
+        RedisModuleKey *key =
+            RedisModule_OpenKey(ctx, keyName, REDISMODULE_READ | REDISMODULE_WRITE);
+        if (RedisModule_ModuleTypeGetType(key) != SeriesType) {
+            RedisModule_CloseKey(key);
+            entry->result = AddResult_WrongType;
+            continue;
+        }
+        Series *series = RedisModule_ModuleTypeGetValue(key);
+        RedisModule_CloseKey(key);
+
+        entry->result = internalAddNoReply(ctx, series, timestamp, value, DP_NONE);
+        if (entry->result == AddResult_Filtered) {
+            entry->replyTimestamp = series->lastTimestamp;
+        } else if (entry->result == AddResult_Ok) {
+            added++;
+        }
+    }
+
+    const RedisModuleString **replArgv = malloc((argc - 1) * sizeof *replArgv);
+    const RedisModuleString **offset = replArgv;
+    *offset++ = timestampStr;
+    for (size_t n = 0; n < numEntries; n++) {
+        if (entries[n].result == AddResult_Ok) {
+            *offset++ = argv[2 + n * 2];
+            *offset++ = argv[3 + n * 2];
+        }
+    }
+
+    RedisModule_ReplyWithArray(ctx, numEntries);
+    for (size_t n = 0; n < numEntries; n++) {
+        replyAddResult(ctx, entries[n].result, entries[n].replyTimestamp);
+    }
+
+    if (added > 0) {
+        // only the added samples are replicated, with the resolved timestamp
+        RedisModule_Replicate(ctx, "TS.MADDROW", "v", replArgv, offset - replArgv);
+    }
+    free(replArgv);
+    free(entries);
+
+    for (int i = 2; i < argc; i += 2) {
+        WriteCtx_Event(ctx, WriteEvent_Add, argv[i]);
+    }
+    WriteCtx_End(ctx);
+
+    return REDISMODULE_OK;
+}
+
+size_t SeriesBackfill(RedisModuleCtx *ctx,
+                      Series *series,
+                      const Sample *samples,
+                      size_t count,
+                      DuplicatePolicy dp,
+                      bool *accepted) {
+    // split into the out-of-order part and the part which extends the series, keeping the
+    // position of every sample in the arguments
+    Sample *older = malloc(count * sizeof(*older));
+    Sample *newer = malloc(count * sizeof(*newer));
+    size_t *olderPos = malloc(count * sizeof(*olderPos));
+    size_t *newerPos = malloc(count * sizeof(*newerPos));
+    size_t olderCount = 0, newerCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (accepted) {
+            accepted[i] = false;
+        }
+        if (series->totalSamples != 0 && samples[i].timestamp <= series->lastTimestamp) {
+            if (!isOlderThanRetention(series, samples[i].timestamp)) {
+                olderPos[olderCount] = i;
+                older[olderCount++] = samples[i];
+            }
+        } else {
+            newerPos[newerCount] = i;
+            newer[newerCount++] = samples[i];
+        }
+    }
+
+    const DuplicatePolicy dp_policy =
+        dp ?: series->duplicatePolicy ?: TSGlobalConfig.duplicatePolicy;
+    ChunkResult *results = malloc(max(olderCount, 1) * sizeof(*results));
+    size_t written = SeriesUpsertSamples(series, older, olderCount, results, dp_policy);
+    if (written > 0) {
+        WriteCtx_Event(ctx, WriteEvent_KeyReady, series->keyName);
+    }
+    for (size_t i = 0; accepted && i < olderCount; i++) {
+        accepted[olderPos[i]] = results[i] == CR_OK;
+    }
+    for (size_t i = 0; i < newerCount; i++) {
+        if (internalAddNoReply(ctx, series, newer[i].timestamp, newer[i].value, dp) ==
+            AddResult_Ok) {
+            written++;
+            if (accepted) {
+                accepted[newerPos[i]] = true;
+            }
+        }
+    }
+
+    free(results);
+    free(newerPos);
+    free(olderPos);
+    free(newer);
+    free(older);
+    return written;
+}
+
+// TS.BACKFILL key [ON_DUPLICATE policy] timestamp value [timestamp value ...]
+// Samples older than the series' last sample are merged into their chunks as a single batch, the
+// rest are appended in argument order afterwards. Replies with the number of samples written.
+int TSDB_backfill(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 4) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    int samplesStart = 2;
+    DuplicatePolicy dp = DP_NONE;
+    if (RMUtil_StringEqualsCaseC(argv[2], TS_ADD_DUPLICATE_POLICY_ARG)) {
+        if (ParseDuplicatePolicy(ctx, argv, argc, TS_ADD_DUPLICATE_POLICY_ARG, &dp, NULL) !=
+            TSDB_OK) {
+            return REDISMODULE_ERR;
+        }
+        samplesStart = 4;
+    }
+    if (argc <= samplesStart || (argc - samplesStart) % 2 != 0) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    const size_t count = (argc - samplesStart) / 2;
+    Sample *samples = malloc(count * sizeof(*samples));
+    for (size_t i = 0; i < count; i++) {
+        const AddResult parsed =
+            parseSample(argv[samplesStart + i * 2], argv[samplesStart + i * 2 + 1], &samples[i]);
+        if (parsed != AddResult_Ok) {
+            free(samples);
+            replyAddResult(ctx, parsed, 0);
+            return REDISMODULE_ERR;
+        }
     }
 
+    Series *series;
+    RedisModuleKey *key;
+    const GetSeriesResult status = GetSeries(ctx,
+                                             argv[1],
+                                             &key,
+                                             &series,
+                                             REDISMODULE_READ | REDISMODULE_WRITE,
+                                             GetSeriesFlags_DeleteReferences);
+    if (status != GetSeriesResult_Success) {
+        free(samples);
+        return REDISMODULE_ERR;
+    }
+    WriteCtx_Begin();
+
+    bool *accepted = malloc(count * sizeof(*accepted));
+    const size_t written = SeriesBackfill(ctx, series, samples, count, dp, accepted);
+    RedisModule_CloseKey(key);
+    free(samples);
+
+    RedisModule_ReplyWithLongLong(ctx, written);
+    if (written > 0) {
+        // only the written samples are replicated, like TS.MADD, so the replica never stores a
+        // sample the primary rejected
+        const RedisModuleString **replArgv = malloc((argc - 1) * sizeof *replArgv);
+        const RedisModuleString **offset = replArgv;
+        for (int i = 1; i < samplesStart; i++) {
+            *offset++ = argv[i];
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (accepted[i]) {
+                *offset++ = argv[samplesStart + i * 2];
+                *offset++ = argv[samplesStart + i * 2 + 1];
+            }
+        }
+        RedisModule_Replicate(ctx, "TS.BACKFILL", "v", replArgv, offset - replArgv);
+        free(replArgv);
+        WriteCtx_Event(ctx, WriteEvent_Add, argv[1]);
+    }
+    free(accepted);
+    WriteCtx_End(ctx);
+
     return REDISMODULE_OK;
 }
 
@@ -1209,6 +2031,7 @@ int CreateTsKey(RedisModuleCtx *ctx,
     }
 
     IndexMetric(keyName, (*series)->labels, (*series)->labelsCount);
+    SeriesIndexTimeRange(*series);
 
     return TSDB_OK;
 }
@@ -1249,6 +2072,49 @@ int TSDB_create(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     return REDISMODULE_OK;
 }
 
+// TS.TEMPLATE.CREATE name [RETENTION retentionPeriod] [ENCODING enc] [CHUNK_SIZE size]
+//                        [DUPLICATE_POLICY policy] [IGNORE maxTimediff maxValDiff]
+//                        [RULES policy] [LABELS label value..]
+int TSDB_template_create(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc < 2) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (SeriesTemplate_Get(argv[1]) != NULL) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: template already exists");
+    }
+
+    SeriesTemplate *tmpl = SeriesTemplate_Parse(ctx, argv, argc);
+    if (tmpl == NULL) {
+        return REDISMODULE_ERR;
+    }
+    SeriesTemplate_Add(tmpl);
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+    RedisModule_ReplicateVerbatim(ctx);
+    return REDISMODULE_OK;
+}
+
+// TS.TEMPLATE.DEL name
+int TSDB_template_del(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    RedisModule_AutoMemory(ctx);
+
+    if (argc != 2) {
+        return RedisModule_WrongArity(ctx);
+    }
+
+    // series created from the template hold their own references to its strings
+    if (SeriesTemplate_Del(argv[1]) != REDISMODULE_OK) {
+        return RTS_ReplyGeneralError(ctx, "TSDB: unknown template");
+    }
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+    RedisModule_ReplicateVerbatim(ctx);
+    return REDISMODULE_OK;
+}
+
 int TSDB_alter(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     RedisModule_AutoMemory(ctx);
 
@@ -1290,6 +2156,7 @@ int TSDB_alter(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
         series->labels = cCtx.labels;
         series->labelsCount = cCtx.labelsCount;
         IndexMetric(keyName, series->labels, series->labelsCount);
+        SeriesIndexTimeRange(series);
     }
 
     if (RMUtil_ArgIndex("IGNORE", argv, argc) > 0) {
@@ -1842,7 +2709,7 @@ static int parse_read_args(RedisModuleCtx *ctx, RedisModuleString **argv, int ar
  */
 static size_t TSDB_count_samples_up_to(Series *series, const RangeArgs *range, size_t threshold) {
     AbstractIterator *iter =
-        SeriesQuery(series, range, /*reverse=*/false, /*check_retention=*/true);
+        SeriesQuery(NULL, series, range, /*reverse=*/false, /*check_retention=*/true, NULL);
     EnrichedChunk *chunk;
     size_t total = 0;
     while (total < threshold && (chunk = iter->GetNext(iter))) {
@@ -2393,6 +3260,31 @@ void persistCallback(RedisModuleCtx *ctx, RedisModuleEvent eid, uint64_t subeven
     return;
 }
 
+void loadingCallback(RedisModuleCtx *ctx, RedisModuleEvent eid, uint64_t subevent, void *data) {
+    if (memcmp(&eid, &RedisModuleEvent_Loading, sizeof(eid)) != 0) {
+        return;
+    }
+
+    if (subevent == REDISMODULE_SUBEVENT_LOADING_RDB_START ||
+        subevent == REDISMODULE_SUBEVENT_LOADING_REPL_START) {
+        // the aof runs commands which read the index, so only the rdbs are indexed in bulk
+        IndexBulkBuildStart();
+    } else if (subevent == REDISMODULE_SUBEVENT_LOADING_ENDED ||
+               subevent == REDISMODULE_SUBEVENT_LOADING_FAILED) {
+        const uint64_t built = IndexBulkBuildEnd();
+        if (built > 0) {
+            RedisModule_Log(
+                ctx, "notice", "indexed %" PRIu64 " labels of the loaded series", built);
+        }
+        // the restored series whose key wasn't loaded are stale
+        const uint64_t dropped = IndexRestoreEnd();
+        if (dropped > 0) {
+            RedisModule_Log(
+                ctx, "notice", "dropped %" PRIu64 " stale series of the restored index", dropped);
+        }
+    }
+}
+
 void ShardingEvent(RedisModuleCtx *ctx, RedisModuleEvent eid, uint64_t subevent, void *data) {
     /**
      * On sharding event we need to do couple of things depends on the subevent given:
@@ -2634,6 +3526,24 @@ static int Stub_RegisterDefragCallbacks(RedisModuleCtx *ctx,
                                         RedisModuleDefragFunc end) {
     return REDISMODULE_OK;
 }
+
+// INFO timeseries_query_arena: allocations of the multi series queries
+// INFO timeseries_index: size of the label index
+static void TSInfoFunc(RedisModuleInfoCtx *ctx, int for_crash_report) {
+    const QueryArenaStats stats = QueryArena_GetStats();
+    RedisModule_InfoAddSection(ctx, "query_arena");
+    RedisModule_InfoAddFieldULongLong(ctx, "query_arenas", stats.arenas);
+    RedisModule_InfoAddFieldULongLong(ctx, "query_arena_blocks", stats.blocks);
+    RedisModule_InfoAddFieldULongLong(ctx, "query_arena_allocations", stats.allocations);
+    RedisModule_InfoAddFieldULongLong(ctx, "query_arena_chunks_created", stats.chunksCreated);
+    RedisModule_InfoAddFieldULongLong(ctx, "query_arena_chunks_recycled", stats.chunksRecycled);
+
+    RedisModule_InfoAddSection(ctx, "index");
+    RedisModule_InfoAddFieldULongLong(ctx, "index_series", IndexedSeriesCount());
+    RedisModule_InfoAddFieldULongLong(ctx, "index_labels", IndexedLabelsCount());
+    RedisModule_InfoAddFieldULongLong(ctx, "index_posting_lists", IndexPostingListsCount());
+}
+
 /*
 module loading function, possible arguments:
 COMPACTION_POLICY - compaction policy from parse_policies.h
@@ -2704,6 +3614,7 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
     }
 
     initGlobalCompactionFunctions();
+    initFilterByValueFunctions();
 
     if (register_mr(ctx, TSGlobalConfig.numThreads) != REDISMODULE_OK) {
         FreeConfigAndStaticCtx();
@@ -2720,6 +3631,9 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
         .copy = CopySeries,
         .free = FreeSeries,
         .defrag = DefragSeries,
+        .aux_load = series_aux_load,
+        .aux_save2 = series_aux_save,
+        .aux_save_triggers = REDISMODULE_AUX_BEFORE_RDB,
     };
 
     SeriesType = RedisModule_CreateDataType(ctx, "TSDB-TYPE", TS_LATEST_ENCVER, &tm);
@@ -2753,6 +3667,7 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
     }
 
     IndexInit();
+    SeriesTemplate_Init();
     if (RedisModule_RegisterDefragFunc2(ctx, DefragIndex) != REDISMODULE_OK) {
         RedisModule_Log(ctx, "warning", "Failed to register defrag function");
         FreeConfigAndStaticCtx();
@@ -2760,16 +3675,71 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
         return REDISMODULE_ERR;
     }
 
+    if (RedisModule_RegisterInfoFunc(ctx, TSInfoFunc) != REDISMODULE_OK) {
+        RedisModule_Log(ctx, "warning", "Failed to register info function");
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
     RegisterCommandWithModesAndAcls(ctx, "ts.create", TSDB_create, "write deny-oom", "write fast");
     RegisterCommandWithModesAndAcls(ctx, "ts.alter", TSDB_alter, "write deny-oom", "write");
     RegisterCommandWithModesAndAcls(ctx, "ts.createrule", TSDB_createRule, "write fast", "write");
     RegisterCommandWithModesAndAcls(ctx, "ts.deleterule", TSDB_deleteRule, "write", "write fast");
     RegisterCommandWithModesAndAcls(ctx, "ts.add", TSDB_add, "write deny-oom", "write");
+    RegisterCommandWithModesAndAcls(ctx, "ts.backfill", TSDB_backfill, "write deny-oom", "write");
     RegisterCommandWithModesAndAcls(ctx, "ts.incrby", TSDB_incrby, "write deny-oom", "write");
     RegisterCommandWithModesAndAcls(ctx, "ts.decrby", TSDB_incrby, "write deny-oom", "write");
     RegisterCommandWithModesAndAcls(ctx, "ts.range", TSDB_range, "readonly", "read");
     RegisterCommandWithModesAndAcls(ctx, "ts.revrange", TSDB_revrange, "readonly", "read");
 
+    if (RedisModule_CreateCommand(
+            ctx, "ts.template.create", TSDB_template_create, "write deny-oom", 0, 0, 0) ==
+        REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.template.create", "write");
+
+    if (RedisModule_CreateCommand(ctx, "ts.template.del", TSDB_template_del, "write", 0, 0, 0) ==
+        REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.template.del", "write");
+
+    if (RedisModule_CreateCommand(ctx, "ts.load", TSDB_load, "write deny-oom admin", 0, 0, 0) ==
+        REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.load", "write");
+
+    if (RedisModule_CreateCommand(
+            ctx, "ts.load.status", TSDB_load_status, "readonly admin", 0, 0, 0) ==
+        REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.load.status", "read");
+
+    if (RedisModule_CreateCommand(ctx, "ts.load.cancel", TSDB_load_cancel, "admin", 0, 0, 0) ==
+        REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.load.cancel", "write");
+
     if (RedisModule_CreateCommand(ctx, "ts.queryindex", TSDB_queryindex, "readonly", 0, 0, -1) ==
         REDISMODULE_ERR) {
         FreeConfigAndStaticCtx();
@@ -2788,6 +3758,15 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 
     SetCommandAcls(ctx, "ts.querylabels", "read");
 
+    if (RedisModule_CreateCommand(
+            ctx, "ts.indexstats", TSDB_indexstats, "readonly admin", 0, 0, 0) == REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.indexstats", "read");
+
     RegisterCommandWithModesAndAcls(ctx, "ts.info", TSDB_info, "readonly", "read fast");
     RegisterCommandWithModesAndAcls(ctx, "ts.get", TSDB_get, "readonly", "read fast");
     // TS.READ may block on the key; intentionally NOT flagged "fast".
@@ -2803,6 +3782,15 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 
     SetCommandAcls(ctx, "ts.madd", "write");
 
+    if (RedisModule_CreateCommand(ctx, "ts.maddrow", TSDB_maddrow, "write deny-oom", 2, -1, 2) ==
+        REDISMODULE_ERR) {
+        FreeConfigAndStaticCtx();
+
+        return REDISMODULE_ERR;
+    }
+
+    SetCommandAcls(ctx, "ts.maddrow", "write");
+
     if (RedisModule_CreateCommand(ctx, "ts.mrange", TSDB_mrange, "readonly", 0, 0, -1) ==
         REDISMODULE_ERR) {
         FreeConfigAndStaticCtx();
@@ -2880,6 +3868,7 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
         RedisModule_SubscribeToServerEvent(ctx, RedisModuleEvent_FlushDB, FlushEventCallback);
         RedisModule_SubscribeToServerEvent(ctx, RedisModuleEvent_SwapDB, swapDbEventCallback);
         RedisModule_SubscribeToServerEvent(ctx, RedisModuleEvent_Persistence, persistCallback);
+        RedisModule_SubscribeToServerEvent(ctx, RedisModuleEvent_Loading, loadingCallback);
     }
 
     Initialize_RdbNotifications(ctx);
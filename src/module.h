@@ -169,6 +169,39 @@ int CreateTsKey(RedisModuleCtx *ctx,
                 Series **series,
                 RedisModuleKey **key);
 
+// Creates the series `keyName` from TS.ADD style arguments: the TEMPLATE, or the creation
+// arguments and the global compaction policy. Replies with an error on failure.
+int CreateSeriesFromArgs(RedisModuleCtx *ctx,
+                         RedisModuleString *keyName,
+                         RedisModuleString **argv,
+                         int argc,
+                         Series **series,
+                         RedisModuleKey **key);
+
+// Write events of the running command. While a write context is open (WriteCtx_Begin), an event
+// is recorded once per key and emitted by WriteCtx_End, otherwise it is emitted right away.
+typedef enum WriteEvent
+{
+    WriteEvent_Add = 0,     // `ts.add` keyspace notification
+    WriteEvent_AddDest,     // `ts.add:dest` keyspace notification of a compaction destination
+    WriteEvent_KeyReady,    // RedisModule_SignalKeyAsReady, wakes TS.READ waiters
+    WriteEvent_Count,
+} WriteEvent;
+
+void WriteCtx_Begin();
+void WriteCtx_Event(RedisModuleCtx *ctx, WriteEvent event, RedisModuleString *keyName);
+void WriteCtx_End(RedisModuleCtx *ctx);
+
+// Writes the samples like TS.BACKFILL: samples older than the last one are merged into their chunks
+// as one batch, the rest are appended in order. Returns the number of samples written, `accepted`
+// (when not NULL) tells which of the samples were written.
+size_t SeriesBackfill(RedisModuleCtx *ctx,
+                      Series *series,
+                      const Sample *samples,
+                      size_t count,
+                      DuplicatePolicy dp,
+                      bool *accepted);
+
 bool CheckVersionForBlockedClientMeasureTime();
 
 GetSeriesResult CheckDictSeriesPermissions(RedisModuleCtx *ctx,
@@ -177,6 +210,18 @@ GetSeriesResult CheckDictSeriesPermissions(RedisModuleCtx *ctx,
 
 int replyUngroupedMultiRange(RedisModuleCtx *ctx, RedisModuleDict *result, const MRangeArgs *args);
 
+// The series matching the filter of the MRANGE, with EXCLUDEEMPTY the series whose samples are all
+// out of the range are skipped by the index
+RedisModuleDict *QueryIndexForMRange(RedisModuleCtx *ctx,
+                                     const MRangeArgs *args,
+                                     bool *hasPermissionError);
+
+// Replies with series that are not linked to a key, e.g. snapshots or series received from shards
+int replyMultiRangeFromSeries(RedisModuleCtx *ctx,
+                              Series **series,
+                              size_t count,
+                              const MRangeArgs *args);
+
 // ACL: skips candidates the caller can't read. Shared by the local and cluster-fanout
 // TS.QUERYLABELS paths (see libmr_integration.c).
 void QueryLabelsAggregateFromCandidates(RedisModuleCtx *ctx,
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "query_arena.h"
+
+#include "rmutil/alloc.h"
+
+#include <stdalign.h>
+
+#define QUERY_ARENA_ALIGN alignof(max_align_t)
+#define QUERY_ARENA_STAT_INC(field) __atomic_add_fetch(&stats.field, 1, __ATOMIC_RELAXED)
+
+static QueryArenaStats stats;
+
+static inline size_t alignUp(size_t size) {
+    return (size + QUERY_ARENA_ALIGN - 1) & ~(QUERY_ARENA_ALIGN - 1);
+}
+
+static inline char *blockData(QueryArenaBlock *block) {
+    return (char *)block + alignUp(sizeof(QueryArenaBlock));
+}
+
+static QueryArenaBlock *newBlock(size_t size) {
+    QueryArenaBlock *block = malloc(alignUp(sizeof(QueryArenaBlock)) + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    QUERY_ARENA_STAT_INC(blocks);
+    return block;
+}
+
+QueryArena *QueryArena_New() {
+    QueryArena *arena = malloc(sizeof(QueryArena));
+    arena->blocks = newBlock(QUERY_ARENA_BLOCK_SIZE);
+    arena->current = arena->blocks;
+    arena->numFreeChunks = 0;
+    QUERY_ARENA_STAT_INC(arenas);
+    return arena;
+}
+
+void QueryArena_Reset(QueryArena *arena) {
+    for (QueryArenaBlock *block = arena->blocks; block; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->blocks;
+}
+
+void QueryArena_Free(QueryArena *arena) {
+    QueryArenaBlock *block = arena->blocks;
+    while (block) {
+        QueryArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    for (size_t i = 0; i < arena->numFreeChunks; i++) {
+        FreeEnrichedChunk(arena->freeChunks[i]);
+    }
+    free(arena);
+}
+
+void *QueryArena_Alloc(QueryArena *arena, size_t size) {
+    if (!arena) {
+        return malloc(size);
+    }
+
+    size = alignUp(size);
+    // the remainder of a block too small for size is left unused until the next reset
+    QueryArenaBlock *block = arena->current;
+    while (block->size - block->used < size) {
+        if (!block->next) {
+            block->next = newBlock(size > QUERY_ARENA_BLOCK_SIZE ? size : QUERY_ARENA_BLOCK_SIZE);
+        }
+        block = block->next;
+    }
+    arena->current = block;
+
+    void *ptr = blockData(block) + block->used;
+    block->used += size;
+    QUERY_ARENA_STAT_INC(allocations);
+    return ptr;
+}
+
+void QueryArena_Release(QueryArena *arena, void *ptr) {
+    if (!arena) {
+        free(ptr);
+    }
+}
+
+EnrichedChunk *QueryArena_NewEnrichedChunk(QueryArena *arena, size_t valuesPerSample) {
+    if (!arena || arena->numFreeChunks == 0) {
+        EnrichedChunk *chunk = NewEnrichedChunk();
+        chunk->samples.values_per_sample = valuesPerSample;
+        if (arena) {
+            QUERY_ARENA_STAT_INC(chunksCreated);
+        }
+        return chunk;
+    }
+
+    EnrichedChunk *chunk = arena->freeChunks[--arena->numFreeChunks];
+    Samples *samples = &chunk->samples;
+    // the buffers hold size timestamps and size * values_per_sample values
+    const size_t valuesCapacity = samples->size * samples->values_per_sample;
+    samples->values_per_sample = valuesPerSample;
+    if (samples->size > valuesCapacity / valuesPerSample) {
+        samples->size = valuesCapacity / valuesPerSample;
+    }
+    ResetEnrichedChunk(chunk);
+    QUERY_ARENA_STAT_INC(chunksRecycled);
+    return chunk;
+}
+
+void QueryArena_FreeEnrichedChunk(QueryArena *arena, EnrichedChunk *chunk) {
+    if (!arena || arena->numFreeChunks == QUERY_ARENA_MAX_FREE_CHUNKS) {
+        FreeEnrichedChunk(chunk);
+        return;
+    }
+    arena->freeChunks[arena->numFreeChunks++] = chunk;
+}
+
+QueryArenaStats QueryArena_GetStats() {
+    QueryArenaStats result;
+    result.arenas = __atomic_load_n(&stats.arenas, __ATOMIC_RELAXED);
+    result.blocks = __atomic_load_n(&stats.blocks, __ATOMIC_RELAXED);
+    result.allocations = __atomic_load_n(&stats.allocations, __ATOMIC_RELAXED);
+    result.chunksCreated = __atomic_load_n(&stats.chunksCreated, __ATOMIC_RELAXED);
+    result.chunksRecycled = __atomic_load_n(&stats.chunksRecycled, __ATOMIC_RELAXED);
+    return result;
+}
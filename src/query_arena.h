@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef QUERY_ARENA_H
+#define QUERY_ARENA_H
+
+#include "enriched_chunk.h"
+
+#include <stddef.h>
+
+#define QUERY_ARENA_BLOCK_SIZE (16 * 1024)
+#define QUERY_ARENA_MAX_FREE_CHUNKS 8
+
+typedef struct QueryArenaBlock
+{
+    struct QueryArenaBlock *next;
+    size_t size; // usable bytes after the header
+    size_t used;
+} QueryArenaBlock;
+
+/*
+ * Memory of a multi series query. The iterators of a series are bump allocated from blocks that
+ * are rewound by QueryArena_Reset once the series was replied, and the EnrichedChunks they close
+ * are kept with their sample buffers for the iterators of the next series. Not thread safe, a
+ * query owns its arena.
+ */
+typedef struct QueryArena
+{
+    QueryArenaBlock *blocks;
+    QueryArenaBlock *current;
+    EnrichedChunk *freeChunks[QUERY_ARENA_MAX_FREE_CHUNKS];
+    size_t numFreeChunks;
+} QueryArena;
+
+// Process wide counters, reported by INFO in the timeseries_query_arena section
+typedef struct QueryArenaStats
+{
+    unsigned long long arenas;         // arenas created, one per multi series query
+    unsigned long long blocks;         // blocks malloc-ed by the arenas
+    unsigned long long allocations;    // allocations served by the arenas
+    unsigned long long chunksCreated;  // EnrichedChunks created for an arena
+    unsigned long long chunksRecycled; // EnrichedChunks reused by a later iterator of the query
+} QueryArenaStats;
+
+QueryArena *QueryArena_New();
+
+// Rewinds the blocks and keeps the closed chunks, all the allocations must be dead
+void QueryArena_Reset(QueryArena *arena);
+
+void QueryArena_Free(QueryArena *arena);
+
+// The allocation functions fall back to the heap when arena is NULL, so the iterators are written
+// once for both cases
+void *QueryArena_Alloc(QueryArena *arena, size_t size);
+
+// Frees ptr when it came from the heap, arena allocations live until the reset
+void QueryArena_Release(QueryArena *arena, void *ptr);
+
+// An empty chunk of valuesPerSample values per sample, its buffers may be reused
+EnrichedChunk *QueryArena_NewEnrichedChunk(QueryArena *arena, size_t valuesPerSample);
+
+void QueryArena_FreeEnrichedChunk(QueryArena *arena, EnrichedChunk *chunk);
+
+QueryArenaStats QueryArena_GetStats();
+
+#endif // QUERY_ARENA_H
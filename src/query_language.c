@@ -605,22 +605,54 @@ static size_t values_remove_duplicates(timestamp_t *values, size_t size) {
     return cur + 1;
 }
 
+// FILTER_BY_TS_PACKED carries the timestamps as one argument of 8 byte little-endian integers
+static timestamp_t decodePackedTimestamp(const unsigned char *bytes) {
+    timestamp_t ts = 0;
+    for (int i = 7; i >= 0; i--) {
+        ts = (ts << 8) | bytes[i];
+    }
+    return ts;
+}
+
 static int parseFilterByTimestamp(RedisModuleCtx *ctx,
                                   RedisModuleString **argv,
                                   int argc,
                                   FilterByTSArgs *args) {
     int offset = RMUtil_ArgIndex("FILTER_BY_TS", argv, argc);
-    size_t index = 0;
-    if (offset > 0) {
-        if (offset + 1 == argc) {
-            RTS_ReplyGeneralError(ctx, "TSDB: FILTER_BY_TS one or more arguments are missing");
+    const int packedOffset = RMUtil_ArgIndex("FILTER_BY_TS_PACKED", argv, argc);
+    if (offset <= 0 && packedOffset <= 0) {
+        return TSDB_OK;
+    }
+
+    const unsigned char *packed = NULL;
+    size_t packedLen = 0;
+    if (packedOffset > 0) {
+        if (packedOffset + 1 == argc) {
+            RTS_ReplyGeneralError(ctx, "TSDB: FILTER_BY_TS_PACKED argument is missing");
+            return TSDB_ERROR;
+        }
+        packed =
+            (const unsigned char *)RedisModule_StringPtrLen(argv[packedOffset + 1], &packedLen);
+        if (packedLen == 0 || packedLen % sizeof(timestamp_t) != 0) {
+            RTS_ReplyGeneralError(
+                ctx, "TSDB: FILTER_BY_TS_PACKED must be a multiple of 8 bytes timestamps");
             return TSDB_ERROR;
         }
+    }
+    if (offset > 0 && offset + 1 == argc) {
+        RTS_ReplyGeneralError(ctx, "TSDB: FILTER_BY_TS one or more arguments are missing");
+        return TSDB_ERROR;
+    }
 
-        while (offset + 1 < argc && index < MAX_TS_VALUES_FILTER) {
+    const size_t maxValues =
+        (offset > 0 ? argc - offset - 1 : 0) + packedLen / sizeof(timestamp_t);
+    timestamp_t *values = malloc(maxValues * sizeof(timestamp_t));
+    size_t index = 0;
+    if (offset > 0) {
+        while (offset + 1 < argc) {
             timestamp_t val;
             if (parseTimestamp(argv[offset + 1], &val) == REDISMODULE_OK) {
-                args->values[index] = val;
+                values[index] = val;
                 index++;
                 offset++;
             } else {
@@ -630,16 +662,28 @@ static int parseFilterByTimestamp(RedisModuleCtx *ctx,
         }
         if (index == 0) {
             RTS_ReplyGeneralError(ctx, "TSDB: FILTER_BY_TS one or more arguments are missing");
+            free(values);
             return TSDB_ERROR;
         }
+    }
+    for (size_t i = 0; i < packedLen; i += sizeof(timestamp_t)) {
+        values[index++] = decodePackedTimestamp(packed + i);
+    }
 
-        // We sort the provided timestamps in order to improve query time filtering
-        qsort(args->values, index, sizeof(uint64_t), comp_uint64);
-        index = values_remove_duplicates(args->values, index);
-
-        args->hasValue = (index > 0);
-        args->count = index;
+    // We sort the provided timestamps in order to improve query time filtering, large lists are
+    // usually sent already sorted
+    size_t i = 1;
+    while (i < index && values[i - 1] <= values[i]) {
+        i++;
     }
+    if (i < index) {
+        qsort(values, index, sizeof(uint64_t), comp_uint64);
+    }
+    index = values_remove_duplicates(values, index);
+
+    args->hasValue = true;
+    args->count = index;
+    args->values = values;
     return TSDB_OK;
 }
 
@@ -752,6 +796,15 @@ error_free_classes:
     return REDISMODULE_ERR;
 }
 
+void RangeArgs_Free(RangeArgs *args) {
+    free(args->aggregationArgs.classes);
+    args->aggregationArgs.classes = NULL;
+    args->aggregationArgs.numClasses = 0;
+    free(args->filterByTSArgs.values);
+    args->filterByTSArgs.values = NULL;
+    args->filterByTSArgs.hasValue = false;
+}
+
 QueryPredicateList *parseLabelListFromArgs(RedisModuleCtx *ctx,
                                            RedisModuleString **argv,
                                            int start,
@@ -769,9 +822,40 @@ QueryPredicateList *parseLabelListFromArgs(RedisModuleCtx *ctx,
         size_t label_value_pair_size;
         QueryPredicate *query = &queries->list[current_index];
         const char *label_value_pair = RedisModule_StringPtrLen(argv[i], &label_value_pair_size);
-        // l!=(v1,v2,...) key with label l that doesn't equal any of the values in the list
-        // Note: order is important! Must be before "!=".
-        if (strstr(label_value_pair, "!=(") != NULL) {
+        if (strcasecmp(label_value_pair, "OR") == 0) {
+            // OR between two non empty groups of predicates
+            if (current_index == 0 || queries->list[current_index - 1].type == GROUP_OR ||
+                i == start + query_count - 1) {
+                *response = TSDB_ERROR;
+                break;
+            }
+            query->type = GROUP_OR;
+            query->key = RedisModule_CreateString(NULL, label_value_pair, label_value_pair_size);
+            current_index++;
+            continue;
+        }
+        // l=~re, l!~re and l^=p: the operator follows the label, a regex or a prefix may contain
+        // any of the other operators
+        const size_t operator_pos = strcspn(label_value_pair, "=!^");
+        const char *op = label_value_pair + operator_pos;
+        const size_t range_pos = strcspn(label_value_pair, "=!^<>");
+        const char *range_op = label_value_pair + range_pos;
+        if (((op[0] == '=' || op[0] == '!') && op[1] == '~') || (op[0] == '^' && op[1] == '=')) {
+            query->type = op[0] == '=' ? REGEX_MATCH : op[0] == '!' ? REGEX_NOTMATCH : PREFIX_MATCH;
+            if (parsePatternPredicate(
+                    ctx, label_value_pair, label_value_pair_size, operator_pos, query) ==
+                TSDB_ERROR) {
+                *response = TSDB_ERROR;
+                break;
+            }
+            // l<n, l<=n, l>n and l>=n on a numeric label, otherwise the '<' or '>' is part of the
+            // label as before
+        } else if ((range_op[0] == '<' || range_op[0] == '>') &&
+                   parseRangePredicate(
+                       ctx, label_value_pair, label_value_pair_size, range_pos, query) == TSDB_OK) {
+            // l!=(v1,v2,...) key with label l that doesn't equal any of the values in the list
+            // Note: order is important! Must be before "!=".
+        } else if (strstr(label_value_pair, "!=(") != NULL) {
             query->type = LIST_NOTMATCH;
             if (parsePredicate(ctx, label_value_pair, label_value_pair_size, query, "!=(") ==
                 TSDB_ERROR) {
@@ -900,7 +984,7 @@ int parseFilter(RedisModuleCtx *ctx,
         return REDISMODULE_ERR;
     }
 
-    if (CountPredicateType(queries, EQ) + CountPredicateType(queries, LIST_MATCH) == 0) {
+    if (CountMatcherPredicates(queries) == 0) {
         QueryPredicateList_Free(queries);
         RTS_ReplyGeneralError(ctx, "TSDB: please provide at least one matcher");
         return REDISMODULE_ERR;
@@ -1039,15 +1123,13 @@ int parseMRangeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc,
 error_free_all:
     QueryPredicateList_Free(queries);
 error_free_classes:
-    free(args.rangeArgs.aggregationArgs.classes);
+    RangeArgs_Free(&args.rangeArgs);
     return REDISMODULE_ERR;
 }
 
 void MRangeArgs_Free(MRangeArgs *args) {
     QueryPredicateList_Free(args->queryPredicates);
-    free(args->rangeArgs.aggregationArgs.classes);
-    args->rangeArgs.aggregationArgs.classes = NULL;
-    args->rangeArgs.aggregationArgs.numClasses = 0;
+    RangeArgs_Free(&args->rangeArgs);
 }
 
 void MGetArgs_Free(MGetArgs *args) {
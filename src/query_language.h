@@ -50,13 +50,11 @@ typedef struct FilterByValueArgs
     double max;
 } FilterByValueArgs;
 
-#define MAX_TS_VALUES_FILTER 128
-
 typedef struct FilterByTSArgs
 {
     bool hasValue;
     size_t count;
-    timestamp_t values[MAX_TS_VALUES_FILTER];
+    timestamp_t *values; // heap-allocated sorted unique timestamps, NULL when !hasValue
 } FilterByTSArgs;
 
 typedef enum RangeAlignment
@@ -177,6 +175,8 @@ int parseRangeArguments(RedisModuleCtx *ctx,
                         RedisModuleString **argv,
                         int argc,
                         RangeArgs *out);
+// Frees the aggregation classes and the FILTER_BY_TS timestamps owned by args
+void RangeArgs_Free(RangeArgs *args);
 
 QueryPredicateList *parseLabelListFromArgs(RedisModuleCtx *ctx,
                                            RedisModuleString **argv,
@@ -11,8 +11,10 @@
 #include "common.h"
 #include "consts.h"
 #include "endianconv.h"
+#include "indexer.h"
 #include "load_io_error_macros.h"
 #include "module.h"
+#include "series_template.h"
 
 #include <inttypes.h>
 #include <string.h>
@@ -223,3 +225,29 @@ void series_rdb_save(RedisModuleIO *io, void *value) {
     }
     RedisModule_DictIteratorStop(iter);
 }
+
+// The aux data holds the templates, then the label index
+void series_aux_save(RedisModuleIO *io, int when) {
+    if (when != REDISMODULE_AUX_BEFORE_RDB ||
+        (SeriesTemplate_Count() == 0 && IndexedSeriesCount() == 0)) {
+        // nothing is written, so the rdb stays loadable without the module
+        return;
+    }
+    SeriesTemplate_AuxSave(io);
+    IndexAuxSave(io);
+}
+
+int series_aux_load(RedisModuleIO *io, int encver, int when) {
+    if (encver > TS_LATEST_ENCVER) {
+        RedisModule_LogIOError(io, "error", "aux data is not in the correct encoding");
+        return REDISMODULE_ERR;
+    }
+    if (when != REDISMODULE_AUX_BEFORE_RDB) {
+        return REDISMODULE_OK;
+    }
+    if (SeriesTemplate_AuxLoad(io) != REDISMODULE_OK) {
+        return REDISMODULE_ERR;
+    }
+    // older rdbs only hold the templates, the index is then rebuilt from the keys
+    return encver >= TS_INDEX_AUX_VER ? IndexAuxLoad(io) : REDISMODULE_OK;
+}
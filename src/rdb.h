@@ -24,13 +24,16 @@
 #define TS_LAST_AGGREGATION_EMPTY 7
 #define TS_CREATE_IGNORE_VER 8
 #define TS_NAN_SUPPORT_VER 9
+#define TS_INDEX_AUX_VER 10
 
 // This flag should be updated whenever a new rdb version is introduced
-#define TS_LATEST_ENCVER TS_NAN_SUPPORT_VER
+#define TS_LATEST_ENCVER TS_INDEX_AUX_VER
 
 extern int last_rdb_load_version;
 
 void *series_rdb_load(RedisModuleIO *io, int encver);
 void series_rdb_save(RedisModuleIO *io, void *value);
+void series_aux_save(RedisModuleIO *io, int when);
+int series_aux_load(RedisModuleIO *io, int encver, int when);
 
 #endif
@@ -156,11 +156,13 @@ int ReplySeriesArrayPos(RedisModuleCtx *ctx,
     return REDISMODULE_OK;
 }
 
-AbstractIterator *SeriesQueryIfNonEmpty(Series *series,
+AbstractIterator *SeriesQueryIfNonEmpty(RedisModuleCtx *ctx,
+                                        Series *series,
                                         const RangeArgs *args,
                                         bool reverse,
-                                        EnrichedChunk **first_chunk_out) {
-    AbstractIterator *iter = SeriesQuery(series, args, reverse, true);
+                                        EnrichedChunk **first_chunk_out,
+                                        QueryArena *arena) {
+    AbstractIterator *iter = SeriesQuery(ctx, series, args, reverse, true, arena);
     EnrichedChunk *chunk;
     while ((chunk = iter->GetNext(iter)) != NULL) {
         if (chunk->samples.num_samples > 0) {
@@ -213,7 +215,8 @@ int ReplySeriesRangeFromIter(RedisModuleCtx *ctx,
 }
 
 int ReplySeriesRange(RedisModuleCtx *ctx, Series *series, const RangeArgs *args, bool reverse) {
-    return ReplySeriesRangeFromIter(ctx, SeriesQuery(series, args, reverse, true), NULL, args);
+    return ReplySeriesRangeFromIter(
+        ctx, SeriesQuery(ctx, series, args, reverse, true, NULL), NULL, args);
 }
 
 void ReplyWithSeriesLabelsWithLimit(RedisModuleCtx *ctx,
@@ -332,7 +335,7 @@ int ReplyMultiAggSeriesGroup(RedisModuleCtx *ctx,
     AbstractSampleIterator *iters[TS_AGG_TYPES_MAX];
     for (size_t aggIdx = 0; aggIdx < numAggTypes; aggIdx++)
         iters[aggIdx] = (AbstractSampleIterator *)SeriesSampleIterator_New(
-            SeriesQuery(group[aggIdx], &rawArgs, rev, true));
+            SeriesQuery(ctx, group[aggIdx], &rawArgs, rev, true, NULL));
 
     long long limit = (args->count != -1) ? args->count : LLONG_MAX;
     RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
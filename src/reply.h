@@ -46,10 +46,12 @@ int ReplySeriesArrayPos(RedisModuleCtx *ctx,
                         AbstractIterator *iter,
                         EnrichedChunk *first_chunk);
 
-AbstractIterator *SeriesQueryIfNonEmpty(Series *series,
+AbstractIterator *SeriesQueryIfNonEmpty(RedisModuleCtx *ctx,
+                                        Series *series,
                                         const RangeArgs *args,
                                         bool reverse,
-                                        EnrichedChunk **first_chunk_out);
+                                        EnrichedChunk **first_chunk_out,
+                                        QueryArena *arena);
 
 int ReplySeriesRange(RedisModuleCtx *ctx, Series *series, const RangeArgs *args, bool rev);
 int ReplySeriesRangeFromIter(RedisModuleCtx *ctx,
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "rollup_routing.h"
+
+#include "module.h"
+#include "series_iterator.h"
+
+#include "rmutil/alloc.h"
+
+#define ROLLUP_MAX_PARTS 3 // raw head, rule destination, raw tail
+
+// Concatenation of the per part chains, each part yields whole requested buckets
+typedef struct RollupIterator
+{
+    AbstractIterator base;
+    AbstractIterator *parts[ROLLUP_MAX_PARTS];
+    size_t numParts;
+    size_t currentPart;
+    RedisModuleKey *destKey;
+} RollupIterator;
+
+static EnrichedChunk *RollupIterator_GetNext(AbstractIterator *iter) {
+    RollupIterator *self = (RollupIterator *)iter;
+    while (self->currentPart < self->numParts) {
+        AbstractIterator *part = self->parts[self->currentPart];
+        EnrichedChunk *chunk = part->GetNext(part);
+        if (chunk) {
+            return chunk;
+        }
+        self->currentPart++;
+    }
+    return NULL;
+}
+
+static void RollupIterator_Close(AbstractIterator *iter) {
+    RollupIterator *self = (RollupIterator *)iter;
+    for (size_t i = 0; i < self->numParts; i++) {
+        self->parts[i]->Close(self->parts[i]);
+    }
+    RedisModule_CloseKey(self->destKey);
+    free(self);
+}
+
+// The aggregation over the rule destination which equals queryType over the raw samples,
+// TS_AGG_INVALID when a rule of ruleType can't answer queryType. sameBuckets tells whether the
+// rule buckets are the requested ones, each destination sample is then a requested bucket.
+static TS_AGG_TYPES_T RollupComposedType(TS_AGG_TYPES_T queryType,
+                                         TS_AGG_TYPES_T ruleType,
+                                         bool sameBuckets) {
+    if (queryType != ruleType) {
+        return TS_AGG_INVALID;
+    }
+    switch (queryType) {
+        case TS_AGG_MIN:
+        case TS_AGG_MAX:
+        case TS_AGG_SUM:
+        case TS_AGG_FIRST:
+        case TS_AGG_LAST:
+            return queryType;
+        case TS_AGG_COUNT:
+        case TS_AGG_COUNT_NAN:
+        case TS_AGG_COUNT_ALL:
+            return TS_AGG_SUM;
+        case TS_AGG_TWA:
+            // a TWA bucket also depends on the samples around it, which the rule doesn't
+            // recompute when they change
+            return TS_AGG_INVALID;
+        default:
+            return sameBuckets ? TS_AGG_LAST : TS_AGG_INVALID;
+    }
+}
+
+static inline bool IsBucketStart(timestamp_t ts, timestamp_t timeDelta, timestamp_t alignment) {
+    return CalcBucketStart(ts, timeDelta, alignment) == ts;
+}
+
+/*
+ * Whether dest holds every finalized bucket of rule for the raw samples in [start, end]: its
+ * retention must reach start, and a rule created on a series that already had samples lacks the
+ * older buckets, so dest must start no later than the bucket of the first raw sample.
+ */
+static bool RollupDestCovers(Series *series,
+                             const CompactionRule *rule,
+                             const Series *dest,
+                             timestamp_t start,
+                             timestamp_t end) {
+    // the key may have been replaced, make sure this is the destination of our rule
+    if (!dest->srcKey || RedisModule_StringCompare(dest->srcKey, series->keyName) != 0) {
+        return false;
+    }
+    if (dest->retentionTime > 0 && dest->lastTimestamp > dest->retentionTime &&
+        dest->lastTimestamp - dest->retentionTime > start) {
+        return false;
+    }
+
+    AbstractIterator *rawIter =
+        SeriesIterator_New(series, start, end, 1, NULL, false, false, false, NULL);
+    EnrichedChunk *chunk = rawIter->GetNext(rawIter);
+    bool covers = true;
+    if (chunk && chunk->samples.num_samples > 0) {
+        const timestamp_t firstBucket = BucketStartNormalize(CalcBucketStart(
+            chunk->samples.timestamps[0], rule->bucketDuration, rule->timestampAlignment));
+        covers = false;
+        if (dest->totalSamples > 0) {
+            RedisModuleDictIter *iter =
+                RedisModule_DictIteratorStartC(dest->chunks, "^", NULL, 0);
+            Chunk_t *first = NULL;
+            RedisModule_DictNextC(iter, NULL, (void *)&first);
+            covers = first && dest->funcs->GetFirstTimestamp(first) <= firstBucket;
+            RedisModule_DictIteratorStop(iter);
+        }
+    }
+    rawIter->Close(rawIter);
+    return covers;
+}
+
+AbstractIterator *RollupRouting_Query(RedisModuleCtx *ctx,
+                                      Series *series,
+                                      const RangeArgs *args,
+                                      bool reverse,
+                                      timestamp_t startTimestamp,
+                                      timestamp_t timestampAlignment) {
+    const AggregationArgs *aggArgs = &args->aggregationArgs;
+    if (aggArgs->numClasses != 1 || aggArgs->empty || args->filterByTSArgs.hasValue ||
+        args->filterByValueArgs.hasValue || (args->latest && series->srcKey) ||
+        series->totalSamples == 0 || startTimestamp > args->endTimestamp) {
+        return NULL;
+    }
+
+    const timestamp_t timeDelta = aggArgs->timeDelta;
+    const timestamp_t endTimestamp = args->endTimestamp;
+    // a partial first bucket is read from the raw series
+    const timestamp_t bodyStart =
+        IsBucketStart(startTimestamp, timeDelta, timestampAlignment)
+            ? startTimestamp
+            : CalcBucketStart(startTimestamp, timeDelta, timestampAlignment) + timeDelta;
+    // so is a partial last bucket, unless there are no samples after endTimestamp
+    timestamp_t lastBucketStart = UINT64_MAX;
+    if (endTimestamp < series->lastTimestamp &&
+        !IsBucketStart(endTimestamp + 1, timeDelta, timestampAlignment)) {
+        lastBucketStart =
+            BucketStartNormalize(CalcBucketStart(endTimestamp, timeDelta, timestampAlignment));
+    }
+
+    CompactionRule *best = NULL;
+    Series *bestDest = NULL;
+    RedisModuleKey *bestKey = NULL;
+    TS_AGG_TYPES_T bodyType = TS_AGG_INVALID;
+    timestamp_t tailStart = 0;
+    for (CompactionRule *rule = series->rules; rule; rule = rule->nextRule) {
+        const TS_AGG_TYPES_T composed = RollupComposedType(
+            aggArgs->classes[0]->type, rule->aggType, timeDelta == rule->bucketDuration);
+        if (composed == TS_AGG_INVALID || rule->startCurrentTimeBucket == -1LL ||
+            timeDelta % rule->bucketDuration != 0 ||
+            modulo((int64_t)(timestampAlignment - rule->timestampAlignment),
+                   rule->bucketDuration) != 0 ||
+            (best && best->bucketDuration >= rule->bucketDuration)) {
+            continue;
+        }
+
+        // the requested bucket holding the unfinalized rule bucket is read from the raw series
+        const timestamp_t ruleTailStart = min(
+            lastBucketStart,
+            BucketStartNormalize(
+                CalcBucketStart(rule->startCurrentTimeBucket, timeDelta, timestampAlignment)));
+        if (bodyStart >= ruleTailStart || bodyStart > endTimestamp) {
+            continue;
+        }
+
+        RedisModuleKey *key;
+        Series *dest;
+        const GetSeriesFlags flags = GetSeriesFlags_SilentOperation | GetSeriesFlags_CheckForAcls;
+        if (GetSeries(ctx, rule->destKey, &key, &dest, REDISMODULE_READ, flags) !=
+            GetSeriesResult_Success) {
+            continue;
+        }
+        if (!RollupDestCovers(
+                series, rule, dest, bodyStart, min(ruleTailStart - 1, endTimestamp))) {
+            RedisModule_CloseKey(key);
+            continue;
+        }
+        if (bestKey) {
+            RedisModule_CloseKey(bestKey);
+        }
+        best = rule;
+        bestDest = dest;
+        bestKey = key;
+        bodyType = composed;
+        tailStart = ruleTailStart;
+    }
+    if (!best) {
+        return NULL;
+    }
+
+    RangeArgs partArgs = *args;
+    partArgs.alignment = TimestampAlignment;
+    partArgs.timestampAlignment = timestampAlignment;
+    partArgs.latest = false;
+
+    AbstractIterator *head = NULL, *tail = NULL;
+    if (startTimestamp < bodyStart) {
+        partArgs.startTimestamp = startTimestamp;
+        partArgs.endTimestamp = bodyStart - 1;
+        head = SeriesQueryDirect(series, &partArgs, reverse, true, NULL);
+    }
+    if (tailStart <= endTimestamp) {
+        partArgs.startTimestamp = tailStart;
+        partArgs.endTimestamp = endTimestamp;
+        tail = SeriesQueryDirect(series, &partArgs, reverse, true, NULL);
+    }
+
+    AggregationClass *bodyClasses[] = { GetAggClass(bodyType) };
+    partArgs.aggregationArgs.classes = bodyClasses;
+    partArgs.startTimestamp = bodyStart;
+    partArgs.endTimestamp = min(tailStart - 1, endTimestamp);
+    AbstractIterator *body = SeriesQueryDirect(bestDest, &partArgs, reverse, true, NULL);
+
+    RollupIterator *iter = malloc(sizeof(RollupIterator));
+    iter->base.GetNext = RollupIterator_GetNext;
+    iter->base.Close = RollupIterator_Close;
+    iter->base.input = NULL;
+    iter->base.arena = NULL;
+    iter->numParts = 0;
+    iter->currentPart = 0;
+    iter->destKey = bestKey;
+    AbstractIterator *ordered[] = { reverse ? tail : head, body, reverse ? head : tail };
+    for (size_t i = 0; i < ROLLUP_MAX_PARTS; i++) {
+        if (ordered[i]) {
+            iter->parts[iter->numParts++] = ordered[i];
+        }
+    }
+    return (AbstractIterator *)iter;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef ROLLUP_ROUTING_H
+#define ROLLUP_ROUTING_H
+
+#include "abstract_iterator.h"
+#include "query_language.h"
+#include "tsdb.h"
+
+/*
+ * Answers an aggregated range query of `series` from the destination of one of its compaction
+ * rules (ts-rollup-routing). A rule qualifies when its buckets tile the requested ones and its
+ * aggregator composes into the requested one, e.g. a SUM of a COUNT rule answers COUNT, or when
+ * its buckets are the requested ones with the requested aggregator, e.g. an hourly AVG rule.
+ * The query is split on requested bucket boundaries: the rule destination answers the middle,
+ * the raw series answers a partial first bucket (retention or an unaligned start), a partial
+ * last bucket and the bucket holding the rule's unfinalized bucket.
+ *
+ * The destinations are opened with ctx, so they are looked up in the client's db and checked
+ * against its ACLs. startTimestamp is already clamped by the retention and timestampAlignment
+ * resolved from args->alignment. Returns NULL when no rule can answer the query with the same
+ * result.
+ */
+AbstractIterator *RollupRouting_Query(RedisModuleCtx *ctx,
+                                      Series *series,
+                                      const RangeArgs *args,
+                                      bool reverse,
+                                      timestamp_t startTimestamp,
+                                      timestamp_t timestampAlignment);
+
+#endif // ROLLUP_ROUTING_H
@@ -21,18 +21,24 @@ void SeriesIteratorClose(AbstractIterator *iterator);
 AbstractIterator *SeriesIterator_New(Series *series,
                                      timestamp_t start_ts,
                                      timestamp_t end_ts,
+                                     size_t limit,
+                                     const FilterByTSArgs *tsFilter,
                                      bool rev,
                                      bool rev_chunk,
-                                     bool latest) {
-    SeriesIterator *iter = malloc(sizeof(SeriesIterator));
+                                     bool latest,
+                                     QueryArena *arena) {
+    SeriesIterator *iter = QueryArena_Alloc(arena, sizeof(SeriesIterator));
     iter->base.Close = SeriesIteratorClose;
     iter->base.GetNext = SeriesIteratorGetNextChunk;
     iter->base.input = NULL;
+    iter->base.arena = arena;
     iter->currentChunk = NULL;
-    iter->enrichedChunk = NewEnrichedChunk();
+    iter->enrichedChunk = QueryArena_NewEnrichedChunk(arena, 1);
     iter->series = series;
     iter->minTimestamp = start_ts;
     iter->maxTimestamp = end_ts;
+    iter->limit = limit;
+    iter->tsFilter = tsFilter ? *tsFilter : (FilterByTSArgs){ .hasValue = false };
     iter->reverse = rev;
     iter->reverse_chunk = rev_chunk;
     iter->latest = latest;
@@ -61,12 +67,24 @@ AbstractIterator *SeriesIterator_New(Series *series,
 void SeriesIteratorClose(AbstractIterator *iterator) {
     SeriesIterator *self = (SeriesIterator *)iterator;
     RedisModule_DictIteratorStop(self->dictIter);
-    FreeEnrichedChunk(self->enrichedChunk);
-    free(iterator);
+    QueryArena_FreeEnrichedChunk(iterator->arena, self->enrichedChunk);
+    QueryArena_Release(iterator->arena, iterator);
 }
 
 extern RedisModuleCtx *rts_staticCtx; // global redis ctx
 
+// Whether a FILTER_BY_TS timestamp falls in the part of chunk within the query range
+static bool ChunkHasFilterTimestamp(const SeriesIterator *iter, Chunk_t *chunk) {
+    const ChunkFuncs *funcs = iter->series->funcs;
+    const timestamp_t first = max(funcs->GetFirstTimestamp(chunk), iter->minTimestamp);
+    const timestamp_t last = min(funcs->GetLastTimestamp(chunk), iter->maxTimestamp);
+    if (first > last) {
+        return false;
+    }
+    const size_t i = GallopLowerBound(iter->tsFilter.values, 0, iter->tsFilter.count, first);
+    return i < iter->tsFilter.count && iter->tsFilter.values[i] <= last;
+}
+
 // LATEST is ignored for a series that is not a compaction.
 #define should_finalize_last_bucket(iter)                                                          \
     ((iter)->latest && (iter)->series->srcKey &&                                                   \
@@ -80,10 +98,28 @@ EnrichedChunk *SeriesIteratorGetNextChunk(AbstractIterator *abstractIterator) {
     SeriesIterator *iter = (SeriesIterator *)abstractIterator;
     Chunk_t *curChunk = iter->currentChunk;
 
+    if (iter->limit == 0) {
+        return NULL;
+    }
+
     if (unlikely(iter->reverse && should_finalize_last_bucket(iter))) {
         goto _handle_latest;
     }
 
+    while (iter->tsFilter.hasValue && curChunk &&
+           iter->series->funcs->GetNumOfSample(curChunk) > 0 &&
+           !ChunkHasFilterTimestamp(iter, curChunk)) {
+        // the chunks past the query range hold no candidate either
+        const bool pastRange =
+            iter->reverse
+                ? iter->series->funcs->GetLastTimestamp(curChunk) < iter->minTimestamp
+                : iter->series->funcs->GetFirstTimestamp(curChunk) > iter->maxTimestamp;
+        if (pastRange || !iter->DictGetNext(iter->dictIter, NULL, (void *)&iter->currentChunk)) {
+            iter->currentChunk = NULL;
+        }
+        curChunk = iter->currentChunk;
+    }
+
     if (!curChunk || iter->series->funcs->GetNumOfSample(curChunk) == 0) {
         if (unlikely(curChunk && iter->series->funcs->GetNumOfSample(curChunk) > 0 &&
                      iter->series->totalSamples == 0)) { // empty chunks are being removed
@@ -100,8 +136,12 @@ EnrichedChunk *SeriesIteratorGetNextChunk(AbstractIterator *abstractIterator) {
     if (n_samples > iter->enrichedChunk->samples.size) {
         ReallocSamplesArray(&iter->enrichedChunk->samples, n_samples);
     }
-    iter->series->funcs->ProcessChunk(
-        curChunk, iter->minTimestamp, iter->maxTimestamp, iter->enrichedChunk, iter->reverse_chunk);
+    iter->series->funcs->ProcessChunk(curChunk,
+                                      iter->minTimestamp,
+                                      iter->maxTimestamp,
+                                      iter->limit,
+                                      iter->enrichedChunk,
+                                      iter->reverse_chunk);
     if (!iter->DictGetNext(iter->dictIter, NULL, (void *)&iter->currentChunk)) {
         iter->currentChunk = NULL;
     }
@@ -134,5 +174,8 @@ _handle_latest:
     iter->latest = false;
 
 _out:
+    if (iter->limit != SIZE_MAX) {
+        iter->limit -= iter->enrichedChunk->samples.num_samples;
+    }
     return iter->enrichedChunk;
 }
@@ -10,6 +10,7 @@
 #include "query_language.h"
 #include "tsdb.h"
 #include "chunk.h"
+#include "query_arena.h"
 
 #ifndef REDIS_TIMESERIES_CLEAN_SERIES_ITERATOR_H
 #define REDIS_TIMESERIES_CLEAN_SERIES_ITERATOR_H
@@ -24,17 +25,26 @@ typedef struct SeriesIterator
     EnrichedChunk *enrichedChunkAux; // auxiliary chunk to represent reverse chunk
     api_timestamp_t maxTimestamp;
     api_timestamp_t minTimestamp;
+    size_t limit; // remaining samples to produce, SIZE_MAX when unbounded
+    FilterByTSArgs tsFilter; // chunks without any of these timestamps are skipped, borrowed
     bool reverse;
     bool reverse_chunk;
     bool latest;
     void *(*DictGetNext)(RedisModuleDictIter *di, size_t *keylen, void **dataptr);
 } SeriesIterator;
 
+// limit bounds the number of samples produced, counted in the query direction. It requires the
+// chunks to be produced in that direction (rev_chunk == rev).
+// tsFilter, when not NULL, lets the iterator skip the chunks holding none of its timestamps without
+// decoding them. The samples of the other chunks still have to be filtered by the caller.
 struct AbstractIterator *SeriesIterator_New(Series *series,
                                             timestamp_t start_ts,
                                             timestamp_t end_ts,
+                                            size_t limit,
+                                            const FilterByTSArgs *tsFilter,
                                             bool rev,
                                             bool rev_chunk,
-                                            bool latest);
+                                            bool latest,
+                                            QueryArena *arena);
 
 #endif // REDIS_TIMESERIES_CLEAN_SERIES_ITERATOR_H
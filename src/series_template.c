@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "series_template.h"
+
+#include "common.h"
+#include "compaction.h"
+#include "consts.h"
+#include "indexer.h"
+#include "load_io_error_macros.h"
+#include "module.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include "rmutil/alloc.h"
+#include "rmutil/util.h"
+
+static RedisModuleDict *templates = NULL;
+
+void SeriesTemplate_Init() {
+    if (templates == NULL) {
+        templates = RedisModule_CreateDict(NULL);
+    }
+}
+
+static void buildRuleLabels(SeriesTemplate *tmpl) {
+    tmpl->ruleLabels = calloc(tmpl->rulesCount * 2, sizeof *tmpl->ruleLabels);
+    for (uint64_t i = 0; i < tmpl->rulesCount; i++) {
+        const char *aggString = AggTypeEnumToString(tmpl->rules[i].aggType);
+        tmpl->ruleLabels[i * 2].key = RedisModule_CreateStringPrintf(NULL, "aggregation");
+        tmpl->ruleLabels[i * 2].value =
+            RedisModule_CreateString(NULL, aggString, strlen(aggString));
+        tmpl->ruleLabels[i * 2 + 1].key = RedisModule_CreateStringPrintf(NULL, "time_bucket");
+        tmpl->ruleLabels[i * 2 + 1].value =
+            RedisModule_CreateStringPrintf(NULL, "%" PRIu64, tmpl->rules[i].bucketDuration);
+    }
+}
+
+SeriesTemplate *SeriesTemplate_Parse(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
+    SeriesTemplate *tmpl = calloc(1, sizeof *tmpl);
+    if (parseCreateArgs(ctx, argv, argc, &tmpl->cCtx) != REDISMODULE_OK) {
+        free(tmpl);
+        return NULL;
+    }
+
+    // LABELS must be last, so a label named RULES is not mistaken for the policy
+    int labelsPos = RMUtil_ArgIndex("LABELS", argv, argc);
+    int rulesPos = RMUtil_ArgIndex("RULES", argv, labelsPos < 0 ? argc : labelsPos);
+    if (rulesPos > 0) {
+        if (rulesPos + 1 >= argc) {
+            RedisModule_WrongArity(ctx);
+            goto err;
+        }
+        size_t len;
+        const char *policy = RedisModule_StringPtrLen(argv[rulesPos + 1], &len);
+        if (!ParseCompactionPolicy(policy, len, &tmpl->rules, &tmpl->rulesCount)) {
+            RTS_ReplyGeneralError(ctx, "TSDB: Couldn't parse RULES");
+            goto err;
+        }
+    } else if (TSGlobalConfig.compactionRulesCount > 0) {
+        // without RULES the template takes the compaction policy in effect now
+        tmpl->rulesCount = TSGlobalConfig.compactionRulesCount;
+        tmpl->rules = malloc(tmpl->rulesCount * sizeof *tmpl->rules);
+        memcpy(tmpl->rules,
+               TSGlobalConfig.compactionRules,
+               tmpl->rulesCount * sizeof *tmpl->rules);
+    }
+    buildRuleLabels(tmpl);
+
+    tmpl->name = RedisModule_CreateStringFromString(NULL, argv[1]);
+    return tmpl;
+
+err:
+    SeriesTemplate_Free(tmpl);
+    return NULL;
+}
+
+void SeriesTemplate_Free(SeriesTemplate *tmpl) {
+    if (tmpl->name) {
+        RedisModule_FreeString(NULL, tmpl->name);
+    }
+    if (tmpl->cCtx.labels) {
+        FreeLabels(tmpl->cCtx.labels, tmpl->cCtx.labelsCount);
+    }
+    if (tmpl->ruleLabels) {
+        FreeLabels(tmpl->ruleLabels, tmpl->rulesCount * 2);
+    }
+    free(tmpl->rules);
+    free(tmpl);
+}
+
+SeriesTemplate *SeriesTemplate_Get(RedisModuleString *name) {
+    size_t len;
+    const char *nameStr = RedisModule_StringPtrLen(name, &len);
+    return RedisModule_DictGetC(templates, (void *)nameStr, len, NULL);
+}
+
+int SeriesTemplate_Add(SeriesTemplate *tmpl) {
+    size_t len;
+    const char *nameStr = RedisModule_StringPtrLen(tmpl->name, &len);
+    return RedisModule_DictSetC(templates, (void *)nameStr, len, tmpl);
+}
+
+int SeriesTemplate_Del(RedisModuleString *name) {
+    size_t len;
+    const char *nameStr = RedisModule_StringPtrLen(name, &len);
+    SeriesTemplate *tmpl = NULL;
+    if (RedisModule_DictDelC(templates, (void *)nameStr, len, &tmpl) != REDISMODULE_OK) {
+        return REDISMODULE_ERR;
+    }
+    SeriesTemplate_Free(tmpl);
+    return REDISMODULE_OK;
+}
+
+size_t SeriesTemplate_Count() {
+    return RedisModule_DictSize(templates);
+}
+
+static void SeriesTemplate_Clear() {
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(templates, "^", NULL, 0);
+    SeriesTemplate *tmpl;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&tmpl) != NULL) {
+        SeriesTemplate_Free(tmpl);
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeDict(NULL, templates);
+    templates = RedisModule_CreateDict(NULL);
+}
+
+int SeriesTemplate_CreateSeries(RedisModuleCtx *ctx,
+                                const SeriesTemplate *tmpl,
+                                RedisModuleString *keyName,
+                                Label *labels,
+                                size_t labelsCount,
+                                Series **series,
+                                RedisModuleKey **key) {
+    CreateCtx cCtx = tmpl->cCtx;
+    cCtx.labelsCount = tmpl->cCtx.labelsCount + labelsCount;
+    cCtx.labels = calloc(cCtx.labelsCount, sizeof *cCtx.labels);
+    for (size_t i = 0; i < tmpl->cCtx.labelsCount; i++) {
+        cCtx.labels[i].key = RedisModule_HoldString(NULL, tmpl->cCtx.labels[i].key);
+        cCtx.labels[i].value = RedisModule_HoldString(NULL, tmpl->cCtx.labels[i].value);
+    }
+    if (labelsCount > 0) {
+        memcpy(cCtx.labels + tmpl->cCtx.labelsCount, labels, labelsCount * sizeof *labels);
+        free(labels);
+    }
+
+    if (CreateTsKey(ctx, keyName, &cCtx, series, key) != TSDB_OK) {
+        // the series wasn't stored in the key, it owns the merged labels
+        FreeSeries(*series);
+        *series = NULL;
+        return TSDB_ERROR;
+    }
+    SeriesCreateRules(ctx,
+                      keyName,
+                      *series,
+                      cCtx.labels,
+                      cCtx.labelsCount,
+                      tmpl->rules,
+                      tmpl->rulesCount,
+                      tmpl->ruleLabels,
+                      tmpl->cCtx.chunkSizeBytes,
+                      tmpl->cCtx.options);
+    return TSDB_OK;
+}
+
+void SeriesTemplate_AuxSave(RedisModuleIO *io) {
+    RedisModule_SaveUnsigned(io, SeriesTemplate_Count());
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(templates, "^", NULL, 0);
+    SeriesTemplate *tmpl;
+    while (RedisModule_DictNextC(iter, NULL, (void **)&tmpl) != NULL) {
+        const CreateCtx *cCtx = &tmpl->cCtx;
+        RedisModule_SaveString(io, tmpl->name);
+        RedisModule_SaveUnsigned(io, cCtx->retentionTime);
+        RedisModule_SaveUnsigned(io, cCtx->chunkSizeBytes);
+        RedisModule_SaveUnsigned(io, cCtx->options);
+        RedisModule_SaveUnsigned(io, cCtx->duplicatePolicy);
+        RedisModule_SaveUnsigned(io, cCtx->ignoreMaxTimeDiff);
+        RedisModule_SaveDouble(io, cCtx->ignoreMaxValDiff);
+        RedisModule_SaveUnsigned(io, cCtx->labelsCount);
+        for (size_t i = 0; i < cCtx->labelsCount; i++) {
+            RedisModule_SaveString(io, cCtx->labels[i].key);
+            RedisModule_SaveString(io, cCtx->labels[i].value);
+        }
+        RedisModule_SaveUnsigned(io, tmpl->rulesCount);
+        for (uint64_t i = 0; i < tmpl->rulesCount; i++) {
+            RedisModule_SaveUnsigned(io, tmpl->rules[i].aggType);
+            RedisModule_SaveUnsigned(io, tmpl->rules[i].bucketDuration);
+            RedisModule_SaveUnsigned(io, tmpl->rules[i].retentionSizeMillisec);
+            RedisModule_SaveUnsigned(io, tmpl->rules[i].timestampAlignment);
+        }
+    }
+    RedisModule_DictIteratorStop(iter);
+}
+
+static SeriesTemplate *loadTemplate(RedisModuleIO *io) {
+    bool err = false;
+    SeriesTemplate *tmpl = calloc(1, sizeof *tmpl);
+    errdefer(err, SeriesTemplate_Free(tmpl));
+
+    tmpl->name = LoadString_IOError(io, err, NULL);
+    CreateCtx *cCtx = &tmpl->cCtx;
+    cCtx->retentionTime = LoadUnsigned_IOError(io, err, NULL);
+    cCtx->chunkSizeBytes = LoadUnsigned_IOError(io, err, NULL);
+    cCtx->options = LoadUnsigned_IOError(io, err, NULL);
+    cCtx->duplicatePolicy = LoadUnsigned_IOError(io, err, NULL);
+    cCtx->ignoreMaxTimeDiff = LoadUnsigned_IOError(io, err, NULL);
+    cCtx->ignoreMaxValDiff = LoadDouble_IOError(io, err, NULL);
+    const uint64_t labelsCount = LoadUnsigned_IOError(io, err, NULL);
+    cCtx->labels = calloc(labelsCount, sizeof *cCtx->labels);
+    for (uint64_t i = 0; i < labelsCount; i++) {
+        // count only the loaded labels, so an error frees just those
+        cCtx->labels[i].key = LoadString_IOError(io, err, NULL);
+        cCtx->labelsCount = i + 1;
+        cCtx->labels[i].value = LoadString_IOError(io, err, NULL);
+    }
+    const uint64_t rulesCount = LoadUnsigned_IOError(io, err, NULL);
+    tmpl->rules = calloc(rulesCount, sizeof *tmpl->rules);
+    for (uint64_t i = 0; i < rulesCount; i++) {
+        tmpl->rules[i].aggType = LoadUnsigned_IOError(io, err, NULL);
+        tmpl->rules[i].bucketDuration = LoadUnsigned_IOError(io, err, NULL);
+        tmpl->rules[i].retentionSizeMillisec = LoadUnsigned_IOError(io, err, NULL);
+        tmpl->rules[i].timestampAlignment = LoadUnsigned_IOError(io, err, NULL);
+    }
+    tmpl->rulesCount = rulesCount;
+    buildRuleLabels(tmpl);
+    return tmpl;
+}
+
+int SeriesTemplate_AuxLoad(RedisModuleIO *io) {
+    // the loaded dataset replaces the current templates
+    SeriesTemplate_Clear();
+    uint64_t count = RedisModule_LoadUnsigned(io);
+    if (RedisModule_IsIOError(io)) {
+        return REDISMODULE_ERR;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        SeriesTemplate *tmpl = loadTemplate(io);
+        if (tmpl == NULL) {
+            return REDISMODULE_ERR;
+        }
+        if (SeriesTemplate_Add(tmpl) != REDISMODULE_OK) {
+            SeriesTemplate_Free(tmpl);
+        }
+    }
+    return REDISMODULE_OK;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef SERIES_TEMPLATE_H
+#define SERIES_TEMPLATE_H
+
+#include "parse_policies.h"
+#include "query_language.h"
+#include "tsdb.h"
+
+#include "RedisModulesSDK/redismodule.h"
+
+#define TEMPLATE_ARG "TEMPLATE"
+
+// A pre-parsed set of creation arguments, used to auto-create series on their first write
+// without parsing the arguments and building the compaction rules labels again.
+// All the strings are immutable and shared with the series created from the template.
+typedef struct SeriesTemplate
+{
+    RedisModuleString *name;
+    CreateCtx cCtx; // the template owns cCtx.labels
+    SimpleCompactionRule *rules;
+    uint64_t rulesCount;
+    Label *ruleLabels; // `aggregation` and `time_bucket` of every rule
+} SeriesTemplate;
+
+void SeriesTemplate_Init();
+
+// Parses TS.TEMPLATE.CREATE arguments, replies with an error and returns NULL on failure
+SeriesTemplate *SeriesTemplate_Parse(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+void SeriesTemplate_Free(SeriesTemplate *tmpl);
+
+SeriesTemplate *SeriesTemplate_Get(RedisModuleString *name);
+// Takes ownership of the template, fails if a template with the same name exists
+int SeriesTemplate_Add(SeriesTemplate *tmpl);
+int SeriesTemplate_Del(RedisModuleString *name);
+size_t SeriesTemplate_Count();
+
+// Creates the series `keyName` from the template. `labels` are added after the template labels
+// and are owned by the series from now on, they are freed if the key can't be set.
+int SeriesTemplate_CreateSeries(RedisModuleCtx *ctx,
+                                const SeriesTemplate *tmpl,
+                                RedisModuleString *keyName,
+                                Label *labels,
+                                size_t labelsCount,
+                                Series **series,
+                                RedisModuleKey **key);
+
+// Parts of the series type aux data, not aux callbacks themselves: series_aux_save and
+// series_aux_load (rdb.c) have the SDK signatures, filter on `when` and call these
+void SeriesTemplate_AuxSave(RedisModuleIO *io);
+int SeriesTemplate_AuxLoad(RedisModuleIO *io);
+
+#endif
@@ -9,15 +9,21 @@
 
 #include "indexer.h"
 
-extern RedisModuleDict *labelsIndex;  // maps label to it's ts keys.
-extern RedisModuleDict *tsLabelIndex; // maps ts_key to it's dict in labelsIndex
+extern RedisModuleDict *labelsIndex;     // maps label to the ids of its series
+extern RedisModuleDict *tsLabelIndex;    // maps ts_key to its IndexedSeries
+extern SeriesIdTable seriesIds;          // maps series id to its IndexedSeries
+extern RedisModuleDict *labelStatsIndex; // maps label name to its LabelStats
 
-RedisModuleDict *labelsIndex_bkup;  // backup of labelsIndex
-RedisModuleDict *tsLabelIndex_bkup; // backup of tsLabelIndex
+RedisModuleDict *labelsIndex_bkup;     // backup of labelsIndex
+RedisModuleDict *tsLabelIndex_bkup;    // backup of tsLabelIndex
+SeriesIdTable seriesIds_bkup;          // backup of seriesIds
+RedisModuleDict *labelStatsIndex_bkup; // backup of labelStatsIndex
 
 void Backup_Globals() {
     labelsIndex_bkup = labelsIndex;
     tsLabelIndex_bkup = tsLabelIndex;
+    seriesIds_bkup = seriesIds;
+    labelStatsIndex_bkup = labelStatsIndex;
 
     IndexInit();
 }
@@ -32,14 +38,27 @@ void Restore_Globals() {
     RedisModule_FreeDict(NULL, tsLabelIndex);
     tsLabelIndex = tsLabelIndex_bkup;
     tsLabelIndex_bkup = NULL;
+
+    seriesIds = seriesIds_bkup;
+    seriesIds_bkup = (SeriesIdTable){ 0 };
+
+    RedisModule_FreeDict(NULL, labelStatsIndex);
+    labelStatsIndex = labelStatsIndex_bkup;
+    labelStatsIndex_bkup = NULL;
+
+    IndexRebuildNumericLabels();
 }
 
 void Discard_Globals_Backup() {
-    RemoveAllIndexedMetrics_generic(labelsIndex_bkup, &tsLabelIndex_bkup);
+    RemoveAllIndexedMetrics_generic(
+        labelsIndex_bkup, &tsLabelIndex_bkup, &seriesIds_bkup, labelStatsIndex_bkup);
 
     RedisModule_FreeDict(NULL, labelsIndex_bkup);
     labelsIndex_bkup = NULL;
 
     RedisModule_FreeDict(NULL, tsLabelIndex_bkup);
     tsLabelIndex_bkup = NULL;
+
+    RedisModule_FreeDict(NULL, labelStatsIndex_bkup);
+    labelStatsIndex_bkup = NULL;
 }
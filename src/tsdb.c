@@ -12,6 +12,7 @@
 #include "consts.h"
 #include "endianconv.h"
 #include "filter_iterator.h"
+#include "fused_aggregation.h"
 #include "indexer.h"
 #include "module.h"
 #include "series_iterator.h"
@@ -19,6 +20,7 @@
 #include "multiseries_sample_iterator.h"
 #include "multiseries_agg_dup_sample_iterator.h"
 #include "rdb.h"
+#include "rollup_routing.h"
 #include "libmr_integration.h"
 
 #include <inttypes.h>
@@ -184,6 +186,7 @@ Series *NewSeries(RedisModuleString *keyName, const CreateCtx *cCtx) {
     newSeries->ignoreMaxTimeDiff = cCtx->ignoreMaxTimeDiff;
     newSeries->ignoreMaxValDiff = cCtx->ignoreMaxValDiff;
     newSeries->in_ram = true;
+    newSeries->indexId = INDEX_NO_SERIES_ID;
 
     if (newSeries->options & SERIES_OPT_UNCOMPRESSED) {
         newSeries->options |= SERIES_OPT_UNCOMPRESSED;
@@ -204,6 +207,37 @@ Series *NewSeries(RedisModuleString *keyName, const CreateCtx *cCtx) {
     return newSeries;
 }
 
+// Publishes the exact time range of the samples to the label index
+static void SeriesRefreshIndexedTimeRange(Series *series) {
+    if (series->indexId == INDEX_NO_SERIES_ID) {
+        return;
+    }
+    timestamp_t first = UINT64_MAX, last = 0;
+    if (series->totalSamples > 0) {
+        Chunk_t *firstChunk;
+        RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(series->chunks, "^", NULL, 0);
+        RedisModule_DictNextC(iter, NULL, (void *)&firstChunk);
+        RedisModule_DictIteratorStop(iter);
+        first = series->funcs->GetFirstTimestamp(firstChunk);
+        last = series->lastTimestamp;
+    }
+    IndexSetTimeRange(series->indexId, series->keyName, first, last);
+}
+
+static inline void SeriesExtendIndexedTimeRange(Series *series,
+                                                timestamp_t first,
+                                                timestamp_t last) {
+    if (series->indexId != INDEX_NO_SERIES_ID) {
+        IndexExtendTimeRange(series->indexId, series->keyName, first, last);
+    }
+}
+
+void SeriesIndexTimeRange(Series *series) {
+    series->indexId =
+        series->labelsCount > 0 ? IndexedSeriesId(series->keyName) : INDEX_NO_SERIES_ID;
+    SeriesRefreshIndexedTimeRange(series);
+}
+
 void SeriesTrim(Series *series, timestamp_t startTs, timestamp_t endTs) {
     // if not causedByRetention, caused by ts.del
     if (series->retentionTime == 0) {
@@ -221,6 +255,7 @@ void SeriesTrim(Series *series, timestamp_t startTs, timestamp_t endTs) {
                                    : 0;
 
     const ChunkFuncs *funcs = series->funcs;
+    bool trimmed = false;
     while ((currentKey = RedisModule_DictNextC(iter, &keyLen, (void *)&currentChunk))) {
         if (funcs->GetLastTimestamp(currentChunk) >= minTimestamp) {
             break;
@@ -233,9 +268,14 @@ void SeriesTrim(Series *series, timestamp_t startTs, timestamp_t endTs) {
 
         series->totalSamples -= funcs->GetNumOfSample(currentChunk);
         funcs->FreeChunk(currentChunk);
+        trimmed = true;
     }
 
     RedisModule_DictIteratorStop(iter);
+
+    if (trimmed) {
+        SeriesRefreshIndexedTimeRange(series);
+    }
 }
 
 // Encode timestamps as bigendian to allow correct lexical sorting
@@ -266,6 +306,7 @@ void RestoreKey(RedisModuleCtx *ctx, RedisModuleString *keyname) {
         RemoveIndexedMetric(keyname);
     }
     IndexMetric(keyname, series->labels, series->labelsCount);
+    SeriesIndexTimeRange(series);
 
     if (last_rdb_load_version < TS_REPLICAOF_SUPPORT_VER) {
         // In versions greater than TS_REPLICAOF_SUPPORT_VER we delete the reference on the dump
@@ -301,6 +342,12 @@ void IndexMetricFromName(RedisModuleCtx *ctx, RedisModuleString *keyname) {
         goto cleanup;
     }
 
+    // the index restored from the rdb already holds the key with these labels
+    if (IndexConfirmRestoredSeries(_keyname, series->labels, series->labelsCount)) {
+        SeriesIndexTimeRange(series);
+        goto cleanup;
+    }
+
     if (unlikely(IsKeyIndexed(_keyname))) {
         // when loading from rdb file the key shouldn't exist.
         RedisModule_Log(ctx, "warning", "Trying to load rdb a key which is already in index");
@@ -308,6 +355,7 @@ void IndexMetricFromName(RedisModuleCtx *ctx, RedisModuleString *keyname) {
     }
 
     IndexMetric(_keyname, series->labels, series->labelsCount);
+    SeriesIndexTimeRange(series);
 
 cleanup:
     if (key) {
@@ -389,6 +437,7 @@ void RenameSeriesTo(RedisModuleCtx *ctx, RedisModuleString *keyTo) {
     RedisModule_FreeString(NULL, series->keyName);
     RedisModule_RetainString(NULL, keyTo);
     series->keyName = keyTo;
+    SeriesIndexTimeRange(series);
 
 cleanup:
     if (key) {
@@ -437,6 +486,7 @@ void *CopySeries(RedisModuleString *fromkey, RedisModuleString *tokey, const voi
     if (dst->labelsCount > 0) {
         IndexMetric(tokey, dst->labels, dst->labelsCount);
     }
+    SeriesIndexTimeRange(dst);
 
     dst->in_ram = src->in_ram;
     return dst;
@@ -612,58 +662,87 @@ static bool RuleSeriesUpsertSample(RedisModuleCtx *ctx,
     // Wake any TS.READ waiters parked on the destination key, so a
     // compaction-rule bucket landing here triggers them just like a direct
     // write would.
-    RedisModule_SignalKeyAsReady(ctx, rule->destKey);
+    WriteCtx_Event(ctx, WriteEvent_KeyReady, rule->destKey);
     RedisModule_CloseKey(key);
 
     return true;
 }
 
+// Recalculate the bucket of `rule` which contains `upsertTimestamp` after an out-of-order write
+static void upsertRuleCompaction(Series *series,
+                                 CompactionRule *rule,
+                                 timestamp_t upsertTimestamp) {
+    const timestamp_t ruleTimebucket = rule->bucketDuration;
+    const timestamp_t curAggWindowStart =
+        CalcBucketStart(series->lastTimestamp, ruleTimebucket, rule->timestampAlignment);
+    const timestamp_t curAggWindowStartNormalized = BucketStartNormalize(curAggWindowStart);
+    if (upsertTimestamp >= curAggWindowStartNormalized) {
+        // upsert in latest timebucket
+        const int rv = SeriesCalcRange(series,
+                                       curAggWindowStartNormalized,
+                                       curAggWindowStart + ruleTimebucket - 1,
+                                       rule,
+                                       NULL,
+                                       NULL);
+        if (rv == TSDB_ERROR) {
+            RedisModule_Log(
+                rts_staticCtx, "verbose", "%s", "Failed to calculate range for downsample");
+        }
+        return;
+    }
+
+    const timestamp_t start =
+        CalcBucketStart(upsertTimestamp, ruleTimebucket, rule->timestampAlignment);
+    const timestamp_t startNormalized = BucketStartNormalize(start);
+    // ensure last include/exclude
+    double val = 0;
+    const int rv =
+        SeriesCalcRange(series, startNormalized, start + ruleTimebucket - 1, rule, &val, NULL);
+    if (rv == TSDB_ERROR) {
+        RedisModule_Log(rts_staticCtx, "verbose", "%s", "Failed to calculate range for downsample");
+        return;
+    }
+
+    RuleSeriesUpsertSample(rts_staticCtx, series, rule, startNormalized, val);
+}
+
 static void upsertCompaction(Series *series, UpsertCtx *uCtx) {
     if (series->rules == NULL) {
         return;
     }
     const GetSeriesFlags flags = GetSeriesFlags_SilentOperation | GetSeriesFlags_CheckForAcls;
     deleteReferenceToDeletedSeries(rts_staticCtx, series, flags);
-    CompactionRule *rule = series->rules;
-    const timestamp_t upsertTimestamp = uCtx->sample.timestamp;
-    const timestamp_t seriesLastTimestamp = series->lastTimestamp;
-    while (rule != NULL) {
-        const timestamp_t ruleTimebucket = rule->bucketDuration;
-        const timestamp_t curAggWindowStart =
-            CalcBucketStart(seriesLastTimestamp, ruleTimebucket, rule->timestampAlignment);
-        const timestamp_t curAggWindowStartNormalized = BucketStartNormalize(curAggWindowStart);
-        if (upsertTimestamp >= curAggWindowStartNormalized) {
-            // upsert in latest timebucket
-            const int rv = SeriesCalcRange(series,
-                                           curAggWindowStartNormalized,
-                                           curAggWindowStart + ruleTimebucket - 1,
-                                           rule,
-                                           NULL,
-                                           NULL);
-            if (rv == TSDB_ERROR) {
-                RedisModule_Log(
-                    rts_staticCtx, "verbose", "%s", "Failed to calculate range for downsample");
-                continue;
-            }
-        } else {
-            const timestamp_t start =
-                CalcBucketStart(upsertTimestamp, ruleTimebucket, rule->timestampAlignment);
-            const timestamp_t startNormalized = BucketStartNormalize(start);
-            // ensure last include/exclude
-            double val = 0;
-            const int rv = SeriesCalcRange(
-                series, startNormalized, start + ruleTimebucket - 1, rule, &val, NULL);
-            if (rv == TSDB_ERROR) {
-                RedisModule_Log(
-                    rts_staticCtx, "verbose", "%s", "Failed to calculate range for downsample");
+    for (CompactionRule *rule = series->rules; rule != NULL; rule = rule->nextRule) {
+        upsertRuleCompaction(series, rule, uCtx->sample.timestamp);
+    }
+}
+
+// Same as upsertCompaction for a sorted batch, every touched bucket is recalculated only once
+static void upsertCompactionBatch(Series *series,
+                                  const Sample *samples,
+                                  const ChunkResult *results,
+                                  size_t count) {
+    if (series->rules == NULL) {
+        return;
+    }
+    const GetSeriesFlags flags = GetSeriesFlags_SilentOperation | GetSeriesFlags_CheckForAcls;
+    deleteReferenceToDeletedSeries(rts_staticCtx, series, flags);
+    for (CompactionRule *rule = series->rules; rule != NULL; rule = rule->nextRule) {
+        bool first = true;
+        timestamp_t lastBucket = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (results[i] != CR_OK) {
                 continue;
             }
-
-            if (!RuleSeriesUpsertSample(rts_staticCtx, series, rule, startNormalized, val)) {
+            const timestamp_t bucket = CalcBucketStart(
+                samples[i].timestamp, rule->bucketDuration, rule->timestampAlignment);
+            if (!first && bucket == lastBucket) {
                 continue;
             }
+            first = false;
+            lastBucket = bucket;
+            upsertRuleCompaction(series, rule, samples[i].timestamp);
         }
-        rule = rule->nextRule;
     }
 }
 
@@ -737,6 +816,7 @@ int SeriesUpsertSample(Series *series,
         if (timestamp == series->lastTimestamp) {
             series->lastValue = uCtx.sample.value;
         }
+        SeriesExtendIndexedTimeRange(series, timestamp, timestamp);
         timestamp_t chunkFirstTSAfterOp = funcs->GetFirstTimestamp(uCtx.inChunk);
         if (chunkFirstTSAfterOp != chunkFirstTS) {
             update_chunk_in_dict(series->chunks, uCtx.inChunk, chunkFirstTS, chunkFirstTSAfterOp);
@@ -747,6 +827,136 @@ int SeriesUpsertSample(Series *series,
     return rv;
 }
 
+// Find the chunk `timestamp` belongs to, and the first timestamp of the chunk after it
+static Chunk_t *SeriesFindChunk(Series *series, timestamp_t timestamp, timestamp_t *nextChunkTS) {
+    const ChunkFuncs *funcs = series->funcs;
+    *nextChunkTS = UINT64_MAX;
+    if (timestamp >= funcs->GetFirstTimestamp(series->lastChunk) ||
+        RedisModule_DictSize(series->chunks) == 1) {
+        return series->lastChunk;
+    }
+
+    Chunk_t *chunk = NULL, *nextChunk = NULL;
+    timestamp_t rax_key;
+    seriesEncodeTimestamp(&rax_key, timestamp);
+    RedisModuleDictIter *dictIter =
+        RedisModule_DictIteratorStartC(series->chunks, "<=", &rax_key, sizeof(rax_key));
+    if (RedisModule_DictNextC(dictIter, NULL, (void *)&chunk) == NULL) {
+        RedisModule_DictIteratorReseekC(dictIter, "^", NULL, 0);
+        RedisModule_DictNextC(dictIter, NULL, (void *)&chunk);
+    }
+    if (RedisModule_DictNextC(dictIter, NULL, (void *)&nextChunk) != NULL) {
+        *nextChunkTS = funcs->GetFirstTimestamp(nextChunk);
+    }
+    RedisModule_DictIteratorStop(dictIter);
+    return chunk;
+}
+
+// Split `chunk` until all of its parts are below chunkSizeBytes * SPLIT_FACTOR
+static void SeriesSplitOversizedChunk(Series *series, Chunk_t *chunk) {
+    const ChunkFuncs *funcs = series->funcs;
+    while (funcs->GetChunkSize(chunk, false) > series->chunkSizeBytes * SPLIT_FACTOR &&
+           funcs->GetNumOfSample(chunk) > 1) {
+        Chunk_t *newChunk = funcs->SplitChunk(chunk);
+        if (newChunk == NULL) {
+            return;
+        }
+        dictOperator(series->chunks, newChunk, funcs->GetFirstTimestamp(newChunk), DICT_OP_SET);
+        if (chunk == series->lastChunk) { // split of latest chunk
+            series->lastChunk = newChunk;
+        }
+        SeriesSplitOversizedChunk(series, newChunk);
+    }
+}
+
+typedef struct SampleOrder
+{
+    timestamp_t timestamp;
+    size_t pos;
+} SampleOrder;
+
+static int cmpSampleOrder(const void *a, const void *b) {
+    const SampleOrder *x = a, *y = b;
+    if (x->timestamp != y->timestamp) {
+        return x->timestamp < y->timestamp ? -1 : 1;
+    }
+    return x->pos < y->pos ? -1 : (x->pos > y->pos);
+}
+
+size_t SeriesUpsertSamples(Series *series,
+                           const Sample *samples,
+                           size_t count,
+                           ChunkResult *results,
+                           DuplicatePolicy dp_policy) {
+    if (count == 0) {
+        return 0;
+    }
+
+    // stable sort by timestamp, so duplicates are resolved in arrival order
+    SampleOrder *order = malloc(count * sizeof(*order));
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = (SampleOrder){ .timestamp = samples[i].timestamp, .pos = i };
+    }
+    qsort(order, count, sizeof(*order), cmpSampleOrder);
+    Sample *sorted = malloc(count * sizeof(*sorted));
+    ChunkResult *sortedResults = malloc(count * sizeof(*sortedResults));
+    for (size_t i = 0; i < count; ++i) {
+        sorted[i] = samples[order[i].pos];
+    }
+
+    const ChunkFuncs *funcs = series->funcs;
+    size_t start = 0;
+    while (start < count) {
+        timestamp_t nextChunkTS;
+        Chunk_t *chunk = SeriesFindChunk(series, sorted[start].timestamp, &nextChunkTS);
+        size_t end = start + 1;
+        while (end < count && sorted[end].timestamp < nextChunkTS) {
+            ++end;
+        }
+
+        const timestamp_t chunkFirstTS = funcs->GetFirstTimestamp(chunk);
+        UpsertBatchCtx uCtx = {
+            .samples = &sorted[start],
+            .results = &sortedResults[start],
+            .count = end - start,
+            .inChunk = chunk,
+        };
+        int size = 0;
+        funcs->UpsertSamples(&uCtx, &size, dp_policy);
+        series->totalSamples += size;
+
+        const timestamp_t chunkFirstTSAfterOp = funcs->GetFirstTimestamp(chunk);
+        if (chunkFirstTSAfterOp != chunkFirstTS) {
+            update_chunk_in_dict(series->chunks, chunk, chunkFirstTS, chunkFirstTSAfterOp);
+        }
+        if (chunk == series->lastChunk) {
+            series->lastValue = funcs->GetLastValue(chunk);
+        }
+        SeriesSplitOversizedChunk(series, chunk);
+        start = end;
+    }
+
+    upsertCompactionBatch(series, sorted, sortedResults, count);
+
+    size_t accepted = 0;
+    timestamp_t firstAccepted = UINT64_MAX, lastAccepted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        results[order[i].pos] = sortedResults[i];
+        if (sortedResults[i] == CR_OK) {
+            firstAccepted = min(firstAccepted, sorted[i].timestamp);
+            lastAccepted = sorted[i].timestamp;
+            accepted++;
+        }
+    }
+    if (accepted > 0) {
+        SeriesExtendIndexedTimeRange(series, firstAccepted, lastAccepted);
+    }
+    free(sortedResults);
+    free(sorted);
+    free(order);
+    return accepted;
+}
+
 void SeriesAddSample(Series *series, api_timestamp_t timestamp, double value) {
     // backfilling or update
     Sample sample = {
@@ -767,6 +977,7 @@ void SeriesAddSample(Series *series, api_timestamp_t timestamp, double value) {
     series->lastTimestamp = timestamp;
     series->lastValue = value;
     series->totalSamples++;
+    SeriesExtendIndexedTimeRange(series, timestamp, timestamp);
 }
 
 static int ContinuousDeletion(RedisModuleCtx *ctx,
@@ -1078,6 +1289,10 @@ size_t SeriesDelRange(Series *series, timestamp_t start_ts, timestamp_t end_ts)
         RedisModule_DictIteratorStop(iter);
     }
 
+    if (deletedSamples > 0) {
+        SeriesRefreshIndexedTimeRange(series);
+    }
+
     CompactionDelRange(series, start_ts, end_ts, last_ts_before_deletion);
 
     return deletedSamples;
@@ -1106,15 +1321,20 @@ CompactionRule *SeriesAddRule(RedisModuleCtx *ctx,
     return rule;
 }
 
-void SeriesCreateRulesFromGlobalConfig(RedisModuleCtx *ctx,
-                                       RedisModuleString *keyName,
-                                       Series *series,
-                                       Label *labels,
-                                       size_t labelsCount) {
+void SeriesCreateRules(RedisModuleCtx *ctx,
+                       RedisModuleString *keyName,
+                       Series *series,
+                       Label *labels,
+                       size_t labelsCount,
+                       const SimpleCompactionRule *rules,
+                       uint64_t rulesCount,
+                       const Label *ruleLabels,
+                       long long chunkSizeBytes,
+                       int options) {
     const size_t compactedRuleLabelCount = labelsCount + 2;
 
-    for (int i = 0; i < TSGlobalConfig.compactionRulesCount; i++) {
-        SimpleCompactionRule *rule = TSGlobalConfig.compactionRules + i;
+    for (int i = 0; i < rulesCount; i++) {
+        const SimpleCompactionRule *rule = rules + i;
         const char *aggString = AggTypeEnumToString(rule->aggType);
         RedisModuleString *destKey;
         if (rule->timestampAlignment != 0) {
@@ -1151,28 +1371,38 @@ void SeriesCreateRulesFromGlobalConfig(RedisModuleCtx *ctx,
             continue;
         }
 
+        // label strings are immutable, so the compacted series share them with the source
         Label *compactedLabels = calloc(compactedRuleLabelCount, sizeof *compactedLabels);
-        // todo: deep copy labels function
         for (int l = 0; l < labelsCount; l++) {
-            compactedLabels[l].key = RedisModule_CreateStringFromString(NULL, labels[l].key);
-            compactedLabels[l].value = RedisModule_CreateStringFromString(NULL, labels[l].value);
+            compactedLabels[l].key = RedisModule_HoldString(NULL, labels[l].key);
+            compactedLabels[l].value = RedisModule_HoldString(NULL, labels[l].value);
         }
 
         // For every aggregated key create 2 labels: `aggregation` and `time_bucket`.
-        compactedLabels[labelsCount].key = RedisModule_CreateStringPrintf(NULL, "aggregation");
-        compactedLabels[labelsCount].value =
-            RedisModule_CreateString(NULL, aggString, strlen(aggString));
-        compactedLabels[labelsCount + 1].key = RedisModule_CreateStringPrintf(NULL, "time_bucket");
-        compactedLabels[labelsCount + 1].value =
-            RedisModule_CreateStringPrintf(NULL, "%" PRIu64, rule->bucketDuration);
-
-        int rules_options = TSGlobalConfig.options;
+        if (ruleLabels) {
+            for (int l = 0; l < 2; l++) {
+                compactedLabels[labelsCount + l].key =
+                    RedisModule_HoldString(NULL, ruleLabels[i * 2 + l].key);
+                compactedLabels[labelsCount + l].value =
+                    RedisModule_HoldString(NULL, ruleLabels[i * 2 + l].value);
+            }
+        } else {
+            compactedLabels[labelsCount].key = RedisModule_CreateStringPrintf(NULL, "aggregation");
+            compactedLabels[labelsCount].value =
+                RedisModule_CreateString(NULL, aggString, strlen(aggString));
+            compactedLabels[labelsCount + 1].key =
+                RedisModule_CreateStringPrintf(NULL, "time_bucket");
+            compactedLabels[labelsCount + 1].value =
+                RedisModule_CreateStringPrintf(NULL, "%" PRIu64, rule->bucketDuration);
+        }
+
+        int rules_options = options;
         rules_options &= ~SERIES_OPT_DEFAULT_COMPRESSION;
         rules_options &= SERIES_OPT_UNCOMPRESSED;
 
         CreateCtx cCtx = {
             .retentionTime = rule->retentionSizeMillisec,
-            .chunkSizeBytes = TSGlobalConfig.chunkSizeBytes,
+            .chunkSizeBytes = chunkSizeBytes,
             .labelsCount = compactedRuleLabelCount,
             .labels = compactedLabels,
             .options = rules_options,
@@ -1190,6 +1420,23 @@ void SeriesCreateRulesFromGlobalConfig(RedisModuleCtx *ctx,
     }
 }
 
+void SeriesCreateRulesFromGlobalConfig(RedisModuleCtx *ctx,
+                                       RedisModuleString *keyName,
+                                       Series *series,
+                                       Label *labels,
+                                       size_t labelsCount) {
+    SeriesCreateRules(ctx,
+                      keyName,
+                      series,
+                      labels,
+                      labelsCount,
+                      TSGlobalConfig.compactionRules,
+                      TSGlobalConfig.compactionRulesCount,
+                      NULL,
+                      TSGlobalConfig.chunkSizeBytes,
+                      TSGlobalConfig.options);
+}
+
 CompactionRule *NewRule(RedisModuleString *destKey,
                         int aggType,
                         uint64_t bucketDuration,
@@ -1360,50 +1607,111 @@ timestamp_t getFirstValidTimestamp(Series *series, long long *skipped) {
     return sample.timestamp;
 }
 
-AbstractIterator *SeriesQuery(Series *series,
+static timestamp_t SeriesQueryStart(const Series *series,
+                                    const RangeArgs *args,
+                                    bool check_retention) {
+    // In case a retention is set shouldn't return chunks older than the retention
+    if (check_retention && series->retentionTime > 0 &&
+        series->lastTimestamp > series->retentionTime) {
+        return max(args->startTimestamp, series->lastTimestamp - series->retentionTime);
+    }
+    return args->startTimestamp;
+}
+
+static timestamp_t SeriesQueryAlignment(const RangeArgs *args) {
+    switch (args->alignment) {
+        case StartAlignment:
+            // args-startTimestamp can hold an older timestamp than what we currently have or just 0
+            return args->startTimestamp;
+        case EndAlignment:
+            return args->endTimestamp;
+        case TimestampAlignment:
+            return args->timestampAlignment;
+        default:
+            return 0;
+    }
+}
+
+AbstractIterator *SeriesQuery(RedisModuleCtx *ctx,
+                              Series *series,
                               const RangeArgs *args,
                               bool reverse,
-                              bool check_retention) {
-    // In case a retention is set shouldn't return chunks older than the retention
-    timestamp_t startTimestamp = args->startTimestamp;
-    if (check_retention && series->retentionTime > 0) {
-        startTimestamp =
-            series->lastTimestamp > series->retentionTime
-                ? max(args->startTimestamp, series->lastTimestamp - series->retentionTime)
-                : args->startTimestamp;
+                              bool check_retention,
+                              QueryArena *arena) {
+    if (ctx && TSGlobalConfig.rollupRouting && series->rules &&
+        args->aggregationArgs.numClasses > 0 && !args->skipAggregation) {
+        const timestamp_t startTimestamp = SeriesQueryStart(series, args, check_retention);
+        AbstractIterator *routed = RollupRouting_Query(
+            ctx, series, args, reverse, startTimestamp, SeriesQueryAlignment(args));
+        if (routed) {
+            return routed;
+        }
+    }
+    return SeriesQueryDirect(series, args, reverse, check_retention, arena);
+}
+
+AbstractIterator *SeriesQueryDirect(Series *series,
+                                    const RangeArgs *args,
+                                    bool reverse,
+                                    bool check_retention,
+                                    QueryArena *arena) {
+    const timestamp_t startTimestamp = SeriesQueryStart(series, args, check_retention);
+    const timestamp_t timestampAlignment = SeriesQueryAlignment(args);
+
+    // Common single aggregation queries are aggregated while decoding the chunks
+    if (args->aggregationArgs.numClasses > 0 && !args->skipAggregation &&
+        FusedAggregation_Supported(series, args, reverse)) {
+        return FusedAggregationIterator_New(series,
+                                            startTimestamp,
+                                            args->endTimestamp,
+                                            args->aggregationArgs.classes[0],
+                                            args->aggregationArgs.timeDelta,
+                                            timestampAlignment,
+                                            args->aggregationArgs.bucketTS,
+                                            arena);
     }
 
     // When there is a TS filter because we wanted the logic to be one for both reverse and non
     // reverse chunk, if the requested range should be reverse, we reverse it after the filter, and
     // should_reverse_chunk point it out.
     bool should_reverse_chunk = reverse && (!args->filterByTSArgs.hasValue);
-    AbstractIterator *chain = SeriesIterator_New(
-        series, startTimestamp, args->endTimestamp, reverse, should_reverse_chunk, args->latest);
+    // COUNT bounds the samples read when they are replied as is (internal queries leave count 0 or
+    // -1). The outermost iterator producing raw samples carries the bound, so the chunks past it
+    // are neither fetched nor decoded.
+    const size_t limit = (args->count > 0 && args->aggregationArgs.numClasses == 0)
+                             ? (size_t)args->count
+                             : SIZE_MAX;
+    const bool filtered = args->filterByTSArgs.hasValue || args->filterByValueArgs.hasValue;
+    // only the chunks between the first and the last FILTER_BY_TS timestamps are read
+    timestamp_t seriesStart = startTimestamp, seriesEnd = args->endTimestamp;
+    if (args->filterByTSArgs.hasValue) {
+        seriesStart = max(seriesStart, args->filterByTSArgs.values[0]);
+        seriesEnd = min(seriesEnd, args->filterByTSArgs.values[args->filterByTSArgs.count - 1]);
+    }
+    AbstractIterator *chain = SeriesIterator_New(series,
+                                                 seriesStart,
+                                                 seriesEnd,
+                                                 filtered ? SIZE_MAX : limit,
+                                                 args->filterByTSArgs.hasValue
+                                                     ? &args->filterByTSArgs
+                                                     : NULL,
+                                                 reverse,
+                                                 should_reverse_chunk,
+                                                 args->latest,
+                                                 arena);
 
     if (args->filterByTSArgs.hasValue) {
-        chain =
-            (AbstractIterator *)SeriesFilterTSIterator_New(chain, args->filterByTSArgs, reverse);
+        chain = (AbstractIterator *)SeriesFilterTSIterator_New(
+            chain,
+            args->filterByTSArgs,
+            args->filterByValueArgs.hasValue ? SIZE_MAX : limit,
+            reverse,
+            arena);
     }
 
     if (args->filterByValueArgs.hasValue) {
-        chain = (AbstractIterator *)SeriesFilterValIterator_New(chain, args->filterByValueArgs);
-    }
-
-    timestamp_t timestampAlignment;
-    switch (args->alignment) {
-        case StartAlignment:
-            // args-startTimestamp can hold an older timestamp than what we currently have or just 0
-            timestampAlignment = args->startTimestamp;
-            break;
-        case EndAlignment:
-            timestampAlignment = args->endTimestamp;
-            break;
-        case TimestampAlignment:
-            timestampAlignment = args->timestampAlignment;
-            break;
-        default:
-            timestampAlignment = 0;
-            break;
+        chain = (AbstractIterator *)SeriesFilterValIterator_New(
+            chain, args->filterByValueArgs, limit, arena);
     }
 
     if (args->aggregationArgs.numClasses > 0 && !args->skipAggregation) {
@@ -1419,7 +1727,8 @@ AbstractIterator *SeriesQuery(Series *series,
                                                             args->startTimestamp,
                                                             args->endTimestamp,
                                                             args->filterByValueArgs,
-                                                            args->filterByTSArgs);
+                                                            args->filterByTSArgs,
+                                                            arena);
     }
 
     return chain;
@@ -1429,7 +1738,7 @@ AbstractSampleIterator *SeriesCreateSampleIterator(Series *series,
                                                    const RangeArgs *args,
                                                    bool reverse,
                                                    bool check_retention) {
-    AbstractIterator *chain = SeriesQuery(series, args, reverse, check_retention);
+    AbstractIterator *chain = SeriesQuery(NULL, series, args, reverse, check_retention, NULL);
     return (AbstractSampleIterator *)SeriesSampleIterator_New(chain);
 }
 
@@ -1499,3 +1808,65 @@ __out:
         RedisModule_CloseKey(srcKey);
     }
 }
+
+Series *SeriesSnapshot(const Series *series,
+                       timestamp_t startTimestamp,
+                       timestamp_t endTimestamp,
+                       bool latest) {
+    CreateCtx cCtx = { 0 };
+    cCtx.retentionTime = series->retentionTime;
+    cCtx.chunkSizeBytes = series->chunkSizeBytes;
+    cCtx.options = series->options;
+    cCtx.duplicatePolicy = series->duplicatePolicy;
+    cCtx.skipChunkCreation = true;
+    Series *snapshot =
+        NewSeries(RedisModule_CreateStringFromString(NULL, series->keyName), &cCtx);
+    snapshot->lastTimestamp = series->lastTimestamp;
+    snapshot->lastValue = series->lastValue;
+    snapshot->labelsCount = series->labelsCount;
+    snapshot->labels = calloc(series->labelsCount, sizeof(Label));
+    for (size_t i = 0; i < series->labelsCount; i++) {
+        snapshot->labels[i].key = RedisModule_CreateStringFromString(NULL, series->labels[i].key);
+        snapshot->labels[i].value =
+            RedisModule_CreateStringFromString(NULL, series->labels[i].value);
+    }
+
+    // chunks that fell out of the retention window are never queried
+    if (series->retentionTime > 0 && series->lastTimestamp > series->retentionTime) {
+        startTimestamp = max(startTimestamp, series->lastTimestamp - series->retentionTime);
+    }
+
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(series->chunks, "^", NULL, 0);
+    Chunk_t *chunk = NULL;
+    while (RedisModule_DictNextC(iter, NULL, (void *)&chunk)) {
+        if (series->funcs->GetNumOfSample(chunk) == 0) {
+            break;
+        }
+        if (series->funcs->GetLastTimestamp(chunk) < startTimestamp) {
+            continue;
+        }
+        if (series->funcs->GetFirstTimestamp(chunk) > endTimestamp) {
+            break;
+        }
+        Chunk_t *clone = series->funcs->CloneChunk(chunk);
+        snapshot->totalSamples += series->funcs->GetNumOfSample(clone);
+        dictOperator(snapshot->chunks, clone, series->funcs->GetFirstTimestamp(clone), DICT_OP_SET);
+        snapshot->lastChunk = clone;
+    }
+    RedisModule_DictIteratorStop(iter);
+
+    // the snapshot has no source key, so the open bucket of a compaction is stored as a sample
+    if (should_finalize_last_bucket_get(latest, series) && endTimestamp > series->lastTimestamp) {
+        Sample sample;
+        Sample *sample_ptr = &sample;
+        calculate_latest_sample(&sample_ptr, series);
+        if (sample_ptr && sample.timestamp <= endTimestamp) {
+            Chunk_t *latestChunk = series->funcs->NewChunk(128);
+            series->funcs->AddSample(latestChunk, &sample);
+            snapshot->totalSamples++;
+            dictOperator(snapshot->chunks, latestChunk, sample.timestamp, DICT_OP_SET);
+            snapshot->lastChunk = latestChunk;
+        }
+    }
+    return snapshot;
+}
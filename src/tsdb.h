@@ -14,6 +14,7 @@
 #include "consts.h"
 #include "generic_chunk.h"
 #include "indexer.h"
+#include "query_arena.h"
 #include "query_language.h"
 
 #include "RedisModulesSDK/redismodule.h"
@@ -77,7 +78,8 @@ typedef struct Series
     DuplicatePolicy duplicatePolicy;
     long long ignoreMaxTimeDiff;
     double ignoreMaxValDiff;
-    bool in_ram; // false if the key is on flash (relevant only for RoF)
+    bool in_ram;      // false if the key is on flash (relevant only for RoF)
+    uint32_t indexId; // id of the series in the label index, INDEX_NO_SERIES_ID if not indexed
 } Series;
 
 // process C's modulo result to translate from a negative modulo to a positive
@@ -120,10 +122,21 @@ GetSeriesResult GetSeries(RedisModuleCtx *ctx,
                           int mode,
                           const GetSeriesFlags flags);
 
-AbstractIterator *SeriesQuery(Series *series,
+// Reads the query from a compaction rule destination when ts-rollup-routing allows it, the
+// destinations are opened with ctx (the client's db and user), NULL disables the routing.
+// The iterators are allocated from arena, the heap when NULL.
+AbstractIterator *SeriesQuery(RedisModuleCtx *ctx,
+                              Series *series,
                               const RangeArgs *args,
                               bool reserve,
-                              bool check_retention);
+                              bool check_retention,
+                              QueryArena *arena);
+// SeriesQuery on the series itself, without rollup routing
+AbstractIterator *SeriesQueryDirect(Series *series,
+                                    const RangeArgs *args,
+                                    bool reverse,
+                                    bool check_retention,
+                                    QueryArena *arena);
 AbstractSampleIterator *SeriesCreateSampleIterator(Series *series,
                                                    const RangeArgs *args,
                                                    bool reverse,
@@ -150,6 +163,13 @@ int SeriesUpsertSample(Series *series,
                        api_timestamp_t timestamp,
                        double value,
                        DuplicatePolicy dp_override);
+// Upsert a batch of samples older than the series' last sample, every touched chunk is rewritten
+// once. `results` receives the per sample outcome in input order, returns the accepted count.
+size_t SeriesUpsertSamples(Series *series,
+                           const Sample *samples,
+                           size_t count,
+                           ChunkResult *results,
+                           DuplicatePolicy dp_policy);
 
 bool SeriesDeleteRule(Series *series, RedisModuleString *destKey);
 void SeriesSetSrcRule(RedisModuleCtx *ctx, Series *series, RedisModuleString *srcKeyName);
@@ -161,6 +181,18 @@ CompactionRule *SeriesAddRule(RedisModuleCtx *ctx,
                               int aggType,
                               uint64_t bucketDuration,
                               timestamp_t timestampAlignment);
+// Creates a compacted series and a rule for each of `rules`. `ruleLabels`, when not NULL, holds
+// the prebuilt `aggregation` and `time_bucket` labels of every rule (2 per rule).
+void SeriesCreateRules(RedisModuleCtx *ctx,
+                       RedisModuleString *keyName,
+                       Series *series,
+                       Label *labels,
+                       size_t labelsCount,
+                       const SimpleCompactionRule *rules,
+                       uint64_t rulesCount,
+                       const Label *ruleLabels,
+                       long long chunkSizeBytes,
+                       int options);
 void SeriesCreateRulesFromGlobalConfig(RedisModuleCtx *ctx,
                                        RedisModuleString *keyName,
                                        Series *series,
@@ -170,6 +202,9 @@ size_t SeriesGetNumSamples(const Series *series);
 
 const char *SeriesGetCStringLabelValue(const Series *series, const char *labelKey, size_t *len);
 size_t SeriesDelRange(Series *series, timestamp_t start_ts, timestamp_t end_ts);
+// Binds the series to its label index entry and publishes the time range of its samples there,
+// called once the series is indexed under its key name
+void SeriesIndexTimeRange(Series *series);
 
 int SeriesCalcRange(Series *series,
                     timestamp_t start_ts,
@@ -202,4 +237,12 @@ void seriesEncodeTimestamp(void *buf, timestamp_t timestamp);
 
 void calculate_latest_sample(Sample **sample, const Series *series);
 
+// Detached copy of the chunks overlapping [startTimestamp, endTimestamp] within the retention
+// window, with the LATEST sample of a compaction added as a chunk of its own. The copy can be
+// queried and freed with FreeSeries without holding the GIL.
+Series *SeriesSnapshot(const Series *series,
+                       timestamp_t startTimestamp,
+                       timestamp_t endTimestamp,
+                       bool latest);
+
 #endif /* TSDB_H */
@@ -10,11 +10,37 @@
 #include "arch_features.h"
 
 static X86Features g_features = { 0, 0 };
+static Aarch64Features g_aarch64_features = { 0 };
+static int g_allowedISAs = ARCH_ISA_ALL;
 
 const X86Features *getArchitectureOptimization() {
 #ifdef CPU_FEATURES_ARCH_X86_64
     g_features = GetX86Info().features;
+    if (!(g_allowedISAs & ARCH_ISA_AVX2)) {
+        g_features.avx2 = 0;
+    }
+    if (!(g_allowedISAs & ARCH_ISA_AVX512F)) {
+        g_features.avx512f = 0;
+    }
     return &g_features;
 #endif // CPU_FEATURES_ARCH_X86_64
     return (X86Features *)0;
 }
+
+const Aarch64Features *getAarch64ArchitectureOptimization() {
+#ifdef CPU_FEATURES_ARCH_AARCH64
+    g_aarch64_features = GetAarch64Info().features;
+    if (!(g_allowedISAs & ARCH_ISA_NEON)) {
+        g_aarch64_features.asimd = 0;
+    }
+    if (!(g_allowedISAs & ARCH_ISA_SVE)) {
+        g_aarch64_features.sve = 0;
+    }
+    return &g_aarch64_features;
+#endif // CPU_FEATURES_ARCH_AARCH64
+    return (Aarch64Features *)0;
+}
+
+void restrictArchitectureOptimization(int allowedISAs) {
+    g_allowedISAs = allowedISAs;
+}
@@ -22,6 +22,38 @@ typedef struct X86Features
 
 #endif
 
+#ifdef CPU_FEATURES_ARCH_AARCH64
+#include "cpu_features/include/cpuinfo_aarch64.h"
+#else
+typedef struct Aarch64Features
+{
+    int asimd; // NEON
+    int sve;
+} Aarch64Features;
+
+#endif
+
+// Instruction sets the vector kernels may be dispatched to, see initGlobalCompactionFunctions
+typedef enum ArchISA
+{
+    ARCH_ISA_AVX2 = 1 << 0,
+    ARCH_ISA_AVX512F = 1 << 1,
+    ARCH_ISA_NEON = 1 << 2,
+    ARCH_ISA_SVE = 1 << 3,
+} ArchISA;
+
+#define ARCH_ISA_ALL (ARCH_ISA_AVX2 | ARCH_ISA_AVX512F | ARCH_ISA_NEON | ARCH_ISA_SVE)
+
+// NULL when not running on x86_64
 const X86Features *getArchitectureOptimization();
 
+// NULL when not running on aarch64
+const Aarch64Features *getAarch64ArchitectureOptimization();
+
+// Masks out the detected features of the ISAs missing from allowedISAs (a mask of ArchISA),
+// so the unit tests can force each implementation on a machine that supports all of them.
+// Features the CPU lacks are never reported. initGlobalCompactionFunctions must be called again
+// for the change to take effect.
+void restrictArchitectureOptimization(int allowedISAs);
+
 #endif // ARCH_FEATURES_H
@@ -34,6 +34,14 @@ void RTS_UnblockClient(RedisModuleBlockedClient *bc, void *privdata) {
     RedisModule_UnblockClient(bc, privdata);
 }
 
+// The context is freed in the main thread cause there is a bug in RoF when calling
+// RedisModule_FreeThreadSafeContext from thread which is not the main one, see:
+// https://redislabs.atlassian.net/browse/RED-68772 . It should be fixed in redis 7
+void RTS_FreeThreadSafeCtx(RedisModuleCtx *rctx, void *privateData) {
+    RedisModuleCtx *_rctx = privateData;
+    RedisModule_FreeThreadSafeContext(_rctx);
+}
+
 RedisModuleBlockedClient *RTS_BlockClientOnKey(RedisModuleCtx *ctx,
                                                RedisModuleCmdFunc reply_callback,
                                                RedisModuleCmdFunc timeout_callback,
@@ -16,6 +16,9 @@ RedisModuleBlockedClient *RTS_BlockClient(RedisModuleCtx *ctx,
 // unblock blocked client and report end time
 void RTS_UnblockClient(RedisModuleBlockedClient *bc, void *privdata);
 
+// free_privdata callback for blocked clients that are unblocked with their thread safe context
+void RTS_FreeThreadSafeCtx(RedisModuleCtx *rctx, void *privateData);
+
 /**
  * @brief Block the calling client on a single key.
  *
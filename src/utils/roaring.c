@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "roaring.h"
+
+#include "../consts.h"
+#include "rmutil/alloc.h"
+
+#include <string.h>
+
+#define ROARING_HIGH(value) ((uint16_t)((value) >> 16))
+#define ROARING_LOW(value) ((uint16_t)((value) & 0xFFFF))
+#define ROARING_BIT_SET(words, low) (((words)[(low) >> 6] >> ((low) & 63)) & 1)
+
+static inline uint32_t popcountWords(const uint64_t *words) {
+    uint32_t cardinality = 0;
+    for (size_t i = 0; i < ROARING_BITSET_WORDS; i++) {
+        cardinality += __builtin_popcountll(words[i]);
+    }
+    return cardinality;
+}
+
+// First index of values[0..n) which isn't smaller than low
+static inline uint32_t arrayLowerBound(const uint16_t *values, uint32_t n, uint16_t low) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+        if (values[mid] < low) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static inline bool containerContains(const RoaringContainer *c, uint16_t low) {
+    if (c->type == RoaringContainer_Bitset) {
+        return ROARING_BIT_SET(c->words, low);
+    }
+    const uint32_t at = arrayLowerBound(c->values, c->cardinality, low);
+    return at < c->cardinality && c->values[at] == low;
+}
+
+static void arrayToBitset(RoaringContainer *c) {
+    uint64_t *words = calloc(ROARING_BITSET_WORDS, sizeof(uint64_t));
+    for (uint32_t i = 0; i < c->cardinality; i++) {
+        words[c->values[i] >> 6] |= 1ULL << (c->values[i] & 63);
+    }
+    free(c->values);
+    c->words = words;
+    c->type = RoaringContainer_Bitset;
+    c->capacity = 0;
+}
+
+static void bitsetToArray(RoaringContainer *c) {
+    uint16_t *values = malloc(max(c->cardinality, 1) * sizeof(uint16_t));
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+        uint64_t word = c->words[w];
+        while (word) {
+            values[n++] = (uint16_t)(w * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    free(c->words);
+    c->values = values;
+    c->type = RoaringContainer_Array;
+    c->capacity = max(c->cardinality, 1);
+}
+
+// Bitsets which became sparse go back to arrays
+static inline void containerShrink(RoaringContainer *c) {
+    if (c->type == RoaringContainer_Bitset && c->cardinality <= ROARING_ARRAY_MAX) {
+        bitsetToArray(c);
+    }
+}
+
+static void containerCopy(RoaringContainer *dst, const RoaringContainer *src) {
+    *dst = *src;
+    if (src->type == RoaringContainer_Bitset) {
+        dst->words = malloc(ROARING_BITSET_WORDS * sizeof(uint64_t));
+        memcpy(dst->words, src->words, ROARING_BITSET_WORDS * sizeof(uint64_t));
+    } else {
+        dst->capacity = max(src->cardinality, 1);
+        dst->values = malloc(dst->capacity * sizeof(uint16_t));
+        memcpy(dst->values, src->values, src->cardinality * sizeof(uint16_t));
+    }
+}
+
+static inline void containerFree(RoaringContainer *c) {
+    if (c->type == RoaringContainer_Bitset) {
+        free(c->words);
+    } else {
+        free(c->values);
+    }
+}
+
+// Index of the container of key, or where it belongs when found is false
+static uint32_t findContainer(const Roaring *r, uint16_t key, bool *found) {
+    uint32_t lo = 0, hi = r->count;
+    while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+        if (r->containers[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = lo < r->count && r->containers[lo].key == key;
+    return lo;
+}
+
+static RoaringContainer *insertContainer(Roaring *r, uint32_t at, uint16_t key) {
+    if (r->count == r->capacity) {
+        r->capacity = r->capacity ? r->capacity * 2 : 4;
+        r->containers = realloc(r->containers, r->capacity * sizeof(RoaringContainer));
+    }
+    memmove(&r->containers[at + 1],
+            &r->containers[at],
+            (r->count - at) * sizeof(RoaringContainer));
+    r->count++;
+    RoaringContainer *c = &r->containers[at];
+    c->key = key;
+    c->type = RoaringContainer_Array;
+    c->cardinality = 0;
+    c->capacity = 0;
+    c->values = NULL;
+    return c;
+}
+
+static void removeContainer(Roaring *r, uint32_t at) {
+    containerFree(&r->containers[at]);
+    memmove(&r->containers[at],
+            &r->containers[at + 1],
+            (r->count - at - 1) * sizeof(RoaringContainer));
+    r->count--;
+}
+
+// Drops the emptied containers and sums the cardinality after a set operation
+static void compactContainers(Roaring *r) {
+    uint32_t kept = 0;
+    uint64_t cardinality = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        RoaringContainer *c = &r->containers[i];
+        if (c->cardinality == 0) {
+            containerFree(c);
+            continue;
+        }
+        cardinality += c->cardinality;
+        r->containers[kept++] = *c;
+    }
+    r->count = kept;
+    r->cardinality = cardinality;
+}
+
+Roaring *Roaring_New() {
+    Roaring *r = malloc(sizeof(Roaring));
+    r->containers = NULL;
+    r->count = 0;
+    r->capacity = 0;
+    r->cardinality = 0;
+    return r;
+}
+
+void Roaring_Free(Roaring *r) {
+    if (!r) {
+        return;
+    }
+    for (uint32_t i = 0; i < r->count; i++) {
+        containerFree(&r->containers[i]);
+    }
+    free(r->containers);
+    free(r);
+}
+
+Roaring *Roaring_Copy(const Roaring *r) {
+    Roaring *copy = malloc(sizeof(Roaring));
+    copy->count = r->count;
+    copy->capacity = max(r->count, 1);
+    copy->cardinality = r->cardinality;
+    copy->containers = malloc(copy->capacity * sizeof(RoaringContainer));
+    for (uint32_t i = 0; i < r->count; i++) {
+        containerCopy(&copy->containers[i], &r->containers[i]);
+    }
+    return copy;
+}
+
+void Roaring_Clear(Roaring *r) {
+    for (uint32_t i = 0; i < r->count; i++) {
+        containerFree(&r->containers[i]);
+    }
+    r->count = 0;
+    r->cardinality = 0;
+}
+
+bool Roaring_Add(Roaring *r, uint32_t value) {
+    const uint16_t low = ROARING_LOW(value);
+    bool found;
+    const uint32_t at = findContainer(r, ROARING_HIGH(value), &found);
+    RoaringContainer *c = found ? &r->containers[at] : insertContainer(r, at, ROARING_HIGH(value));
+
+    if (c->type == RoaringContainer_Bitset) {
+        if (ROARING_BIT_SET(c->words, low)) {
+            return false;
+        }
+        c->words[low >> 6] |= 1ULL << (low & 63);
+    } else {
+        const uint32_t pos = arrayLowerBound(c->values, c->cardinality, low);
+        if (pos < c->cardinality && c->values[pos] == low) {
+            return false;
+        }
+        if (c->cardinality == ROARING_ARRAY_MAX) {
+            arrayToBitset(c);
+            c->words[low >> 6] |= 1ULL << (low & 63);
+        } else {
+            if (c->cardinality == c->capacity) {
+                c->capacity = min(ROARING_ARRAY_MAX, c->capacity ? c->capacity * 2 : 4);
+                c->values = realloc(c->values, c->capacity * sizeof(uint16_t));
+            }
+            memmove(&c->values[pos + 1],
+                    &c->values[pos],
+                    (c->cardinality - pos) * sizeof(uint16_t));
+            c->values[pos] = low;
+        }
+    }
+    c->cardinality++;
+    r->cardinality++;
+    return true;
+}
+
+bool Roaring_Remove(Roaring *r, uint32_t value) {
+    const uint16_t low = ROARING_LOW(value);
+    bool found;
+    const uint32_t at = findContainer(r, ROARING_HIGH(value), &found);
+    if (!found) {
+        return false;
+    }
+    RoaringContainer *c = &r->containers[at];
+
+    if (c->type == RoaringContainer_Bitset) {
+        if (!ROARING_BIT_SET(c->words, low)) {
+            return false;
+        }
+        c->words[low >> 6] &= ~(1ULL << (low & 63));
+        c->cardinality--;
+        containerShrink(c);
+    } else {
+        const uint32_t pos = arrayLowerBound(c->values, c->cardinality, low);
+        if (pos == c->cardinality || c->values[pos] != low) {
+            return false;
+        }
+        memmove(&c->values[pos],
+                &c->values[pos + 1],
+                (c->cardinality - pos - 1) * sizeof(uint16_t));
+        c->cardinality--;
+    }
+    r->cardinality--;
+    if (c->cardinality == 0) {
+        removeContainer(r, at);
+    }
+    return true;
+}
+
+bool Roaring_Contains(const Roaring *r, uint32_t value) {
+    bool found;
+    const uint32_t at = findContainer(r, ROARING_HIGH(value), &found);
+    return found && containerContains(&r->containers[at], ROARING_LOW(value));
+}
+
+// c = c & o, or c & ~o when negate
+static void containerIntersect(RoaringContainer *c, const RoaringContainer *o, bool negate) {
+    if (c->type == RoaringContainer_Array) {
+        uint32_t kept = 0;
+        if (o->type == RoaringContainer_Bitset) {
+            for (uint32_t i = 0; i < c->cardinality; i++) {
+                const uint16_t low = c->values[i];
+                if (ROARING_BIT_SET(o->words, low) != negate) {
+                    c->values[kept++] = low;
+                }
+            }
+        } else {
+            // merge of the two sorted arrays
+            uint32_t j = 0;
+            for (uint32_t i = 0; i < c->cardinality; i++) {
+                const uint16_t low = c->values[i];
+                while (j < o->cardinality && o->values[j] < low) {
+                    j++;
+                }
+                const bool in = j < o->cardinality && o->values[j] == low;
+                if (in != negate) {
+                    c->values[kept++] = low;
+                }
+            }
+        }
+        c->cardinality = kept;
+        return;
+    }
+
+    if (o->type == RoaringContainer_Bitset) {
+        for (size_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+            c->words[w] &= negate ? ~o->words[w] : o->words[w];
+        }
+        c->cardinality = popcountWords(c->words);
+    } else if (negate) {
+        for (uint32_t i = 0; i < o->cardinality; i++) {
+            const uint16_t low = o->values[i];
+            c->cardinality -= ROARING_BIT_SET(c->words, low);
+            c->words[low >> 6] &= ~(1ULL << (low & 63));
+        }
+    } else {
+        // at most o->cardinality values are left, so c becomes an array
+        uint16_t *values = malloc(max(o->cardinality, 1) * sizeof(uint16_t));
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < o->cardinality; i++) {
+            if (ROARING_BIT_SET(c->words, o->values[i])) {
+                values[kept++] = o->values[i];
+            }
+        }
+        free(c->words);
+        c->values = values;
+        c->type = RoaringContainer_Array;
+        c->capacity = max(o->cardinality, 1);
+        c->cardinality = kept;
+        return;
+    }
+    containerShrink(c);
+}
+
+static void containerUnion(RoaringContainer *c, const RoaringContainer *o) {
+    if (c->type == RoaringContainer_Array && o->type == RoaringContainer_Array &&
+        c->cardinality + o->cardinality <= ROARING_ARRAY_MAX) {
+        uint16_t *values = malloc((c->cardinality + o->cardinality) * sizeof(uint16_t));
+        uint32_t i = 0, j = 0, n = 0;
+        while (i < c->cardinality && j < o->cardinality) {
+            if (c->values[i] < o->values[j]) {
+                values[n++] = c->values[i++];
+            } else if (c->values[i] > o->values[j]) {
+                values[n++] = o->values[j++];
+            } else {
+                values[n++] = c->values[i++];
+                j++;
+            }
+        }
+        memcpy(&values[n], &c->values[i], (c->cardinality - i) * sizeof(uint16_t));
+        n += c->cardinality - i;
+        memcpy(&values[n], &o->values[j], (o->cardinality - j) * sizeof(uint16_t));
+        n += o->cardinality - j;
+        free(c->values);
+        c->values = values;
+        c->capacity = c->cardinality + o->cardinality;
+        c->cardinality = n;
+        return;
+    }
+
+    if (c->type == RoaringContainer_Array) {
+        arrayToBitset(c);
+    }
+    if (o->type == RoaringContainer_Bitset) {
+        for (size_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+            c->words[w] |= o->words[w];
+        }
+        c->cardinality = popcountWords(c->words);
+    } else {
+        for (uint32_t i = 0; i < o->cardinality; i++) {
+            const uint16_t low = o->values[i];
+            c->cardinality += !ROARING_BIT_SET(c->words, low);
+            c->words[low >> 6] |= 1ULL << (low & 63);
+        }
+    }
+    // two arrays of more than ROARING_ARRAY_MAX values together may overlap
+    containerShrink(c);
+}
+
+void Roaring_And(Roaring *r, const Roaring *other) {
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        RoaringContainer *c = &r->containers[i];
+        while (j < other->count && other->containers[j].key < c->key) {
+            j++;
+        }
+        if (j < other->count && other->containers[j].key == c->key) {
+            containerIntersect(c, &other->containers[j], false);
+        } else {
+            c->cardinality = 0;
+        }
+    }
+    compactContainers(r);
+}
+
+void Roaring_AndNot(Roaring *r, const Roaring *other) {
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        RoaringContainer *c = &r->containers[i];
+        while (j < other->count && other->containers[j].key < c->key) {
+            j++;
+        }
+        if (j < other->count && other->containers[j].key == c->key) {
+            containerIntersect(c, &other->containers[j], true);
+        }
+    }
+    compactContainers(r);
+}
+
+void Roaring_Or(Roaring *r, const Roaring *other) {
+    uint32_t i = 0;
+    for (uint32_t j = 0; j < other->count; j++) {
+        const RoaringContainer *o = &other->containers[j];
+        while (i < r->count && r->containers[i].key < o->key) {
+            i++;
+        }
+        if (i < r->count && r->containers[i].key == o->key) {
+            containerUnion(&r->containers[i], o);
+        } else {
+            RoaringContainer *c = insertContainer(r, i, o->key);
+            containerCopy(c, o);
+        }
+        i++;
+    }
+    compactContainers(r);
+}
+
+size_t Roaring_MemUsage(const Roaring *r) {
+    size_t size = sizeof(Roaring) + r->capacity * sizeof(RoaringContainer);
+    for (uint32_t i = 0; i < r->count; i++) {
+        const RoaringContainer *c = &r->containers[i];
+        size += c->type == RoaringContainer_Bitset ? ROARING_BITSET_WORDS * sizeof(uint64_t)
+                                                   : c->capacity * sizeof(uint16_t);
+    }
+    return size;
+}
+
+// The serialized form is little endian, so it can be loaded on any architecture
+#define ROARING_HEADER_SIZE 4
+#define ROARING_CONTAINER_HEADER_SIZE 8
+
+static inline char *putLE(char *buf, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        *buf++ = (char)(value >> (8 * i));
+    }
+    return buf;
+}
+
+static inline uint64_t getLE(const char *buf, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)(uint8_t)buf[i] << (8 * i);
+    }
+    return value;
+}
+
+static inline size_t containerSerializedSize(const RoaringContainer *c) {
+    return ROARING_CONTAINER_HEADER_SIZE +
+           (c->type == RoaringContainer_Bitset ? ROARING_BITSET_WORDS * sizeof(uint64_t)
+                                               : c->cardinality * sizeof(uint16_t));
+}
+
+size_t Roaring_SerializedSize(const Roaring *r) {
+    size_t size = ROARING_HEADER_SIZE;
+    for (uint32_t i = 0; i < r->count; i++) {
+        size += containerSerializedSize(&r->containers[i]);
+    }
+    return size;
+}
+
+void Roaring_Serialize(const Roaring *r, char *buf) {
+    buf = putLE(buf, r->count, 4);
+    for (uint32_t i = 0; i < r->count; i++) {
+        const RoaringContainer *c = &r->containers[i];
+        buf = putLE(buf, c->key, 2);
+        buf = putLE(buf, c->type, 2);
+        buf = putLE(buf, c->cardinality, 4);
+        if (c->type == RoaringContainer_Bitset) {
+            for (size_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+                buf = putLE(buf, c->words[w], 8);
+            }
+        } else {
+            for (uint32_t v = 0; v < c->cardinality; v++) {
+                buf = putLE(buf, c->values[v], 2);
+            }
+        }
+    }
+}
+
+// Reads the container at buf, false if it breaks the invariants of the bitmap
+static bool containerDeserialize(RoaringContainer *c, const char *buf, size_t len) {
+    if (c->type == RoaringContainer_Bitset) {
+        if (len < ROARING_BITSET_WORDS * sizeof(uint64_t) || c->cardinality <= ROARING_ARRAY_MAX) {
+            return false;
+        }
+        c->words = malloc(ROARING_BITSET_WORDS * sizeof(uint64_t));
+        for (size_t w = 0; w < ROARING_BITSET_WORDS; w++) {
+            c->words[w] = getLE(buf + w * sizeof(uint64_t), 8);
+        }
+        return popcountWords(c->words) == c->cardinality;
+    }
+    if (len < c->cardinality * sizeof(uint16_t) || c->cardinality == 0 ||
+        c->cardinality > ROARING_ARRAY_MAX) {
+        return false;
+    }
+    c->capacity = c->cardinality;
+    c->values = malloc(c->capacity * sizeof(uint16_t));
+    for (uint32_t v = 0; v < c->cardinality; v++) {
+        c->values[v] = getLE(buf + v * sizeof(uint16_t), 2);
+        if (v > 0 && c->values[v] <= c->values[v - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Roaring *Roaring_Deserialize(const char *buf, size_t len) {
+    if (len < ROARING_HEADER_SIZE) {
+        return NULL;
+    }
+    const char *end = buf + len;
+    const uint32_t count = getLE(buf, 4);
+    buf += ROARING_HEADER_SIZE;
+    if (count > (size_t)(end - buf) / ROARING_CONTAINER_HEADER_SIZE) {
+        return NULL;
+    }
+
+    Roaring *r = Roaring_New();
+    r->capacity = max(count, 1);
+    r->containers = malloc(r->capacity * sizeof(RoaringContainer));
+    for (uint32_t i = 0; i < count; i++) {
+        if ((size_t)(end - buf) < ROARING_CONTAINER_HEADER_SIZE) {
+            Roaring_Free(r);
+            return NULL;
+        }
+        RoaringContainer *c = &r->containers[r->count++];
+        c->key = getLE(buf, 2);
+        c->type = getLE(buf + 2, 2);
+        c->cardinality = getLE(buf + 4, 4);
+        c->capacity = 0;
+        c->values = NULL;
+        buf += ROARING_CONTAINER_HEADER_SIZE;
+        const bool valid = (c->type == RoaringContainer_Array ||
+                            c->type == RoaringContainer_Bitset) &&
+                           (i == 0 || c->key > r->containers[i - 1].key);
+        if (!valid) {
+            c->type = RoaringContainer_Array; // nothing to free
+        }
+        if (!valid || !containerDeserialize(c, buf, end - buf)) {
+            Roaring_Free(r);
+            return NULL;
+        }
+        buf += containerSerializedSize(c) - ROARING_CONTAINER_HEADER_SIZE;
+        r->cardinality += c->cardinality;
+    }
+    if (buf != end) {
+        Roaring_Free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void RoaringIterator_Init(RoaringIterator *iter, const Roaring *r) {
+    iter->bitmap = r;
+    iter->container = 0;
+    iter->pos = 0;
+}
+
+void RoaringIterator_Seek(RoaringIterator *iter, uint32_t value) {
+    bool found;
+    iter->container = findContainer(iter->bitmap, ROARING_HIGH(value), &found);
+    iter->pos = 0;
+    if (!found) { // the next container has greater values
+        return;
+    }
+    const RoaringContainer *c = &iter->bitmap->containers[iter->container];
+    iter->pos = c->type == RoaringContainer_Array
+                    ? arrayLowerBound(c->values, c->cardinality, ROARING_LOW(value))
+                    : ROARING_LOW(value);
+}
+
+bool RoaringIterator_Next(RoaringIterator *iter, uint32_t *value) {
+    while (iter->container < iter->bitmap->count) {
+        const RoaringContainer *c = &iter->bitmap->containers[iter->container];
+        if (c->type == RoaringContainer_Array) {
+            if (iter->pos < c->cardinality) {
+                *value = ((uint32_t)c->key << 16) | c->values[iter->pos++];
+                return true;
+            }
+        } else {
+            while (iter->pos < 65536) {
+                // the bits of the word from pos on
+                const uint64_t word = c->words[iter->pos >> 6] >> (iter->pos & 63);
+                if (word) {
+                    iter->pos += __builtin_ctzll(word);
+                    *value = ((uint32_t)c->key << 16) | iter->pos++;
+                    return true;
+                }
+                iter->pos = (iter->pos | 63) + 1;
+            }
+        }
+        iter->container++;
+        iter->pos = 0;
+    }
+    return false;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// An array container holds at most ROARING_ARRAY_MAX values, a denser one is a bitset
+#define ROARING_ARRAY_MAX 4096
+#define ROARING_BITSET_WORDS (65536 / 64)
+
+typedef enum
+{
+    RoaringContainer_Array = 0,
+    RoaringContainer_Bitset,
+} RoaringContainerType;
+
+// The values sharing their high 16 bits, the container stores the low 16 bits
+typedef struct RoaringContainer
+{
+    uint16_t key;
+    uint16_t type;
+    uint32_t cardinality;
+    uint32_t capacity; // allocated values of an array container
+    union
+    {
+        uint16_t *values; // ascending
+        uint64_t *words;  // ROARING_BITSET_WORDS
+    };
+} RoaringContainer;
+
+/*
+ * Compressed bitmap of 32 bit values (roaring bitmap with array and bitset containers). Sparse
+ * values cost 2 bytes each and dense ones a bit each, and the set operations work a container
+ * at a time.
+ */
+typedef struct Roaring
+{
+    RoaringContainer *containers; // ascending keys, none is empty
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t cardinality;
+} Roaring;
+
+typedef struct RoaringIterator
+{
+    const Roaring *bitmap;
+    uint32_t container;
+    uint32_t pos; // index of an array container, bit of a bitset container
+} RoaringIterator;
+
+Roaring *Roaring_New();
+void Roaring_Free(Roaring *r);
+Roaring *Roaring_Copy(const Roaring *r);
+
+// Return whether the bitmap changed
+bool Roaring_Add(Roaring *r, uint32_t value);
+bool Roaring_Remove(Roaring *r, uint32_t value);
+
+bool Roaring_Contains(const Roaring *r, uint32_t value);
+void Roaring_Clear(Roaring *r);
+
+// In place r = r & other, r | other and r & ~other
+void Roaring_And(Roaring *r, const Roaring *other);
+void Roaring_Or(Roaring *r, const Roaring *other);
+void Roaring_AndNot(Roaring *r, const Roaring *other);
+
+static inline uint64_t Roaring_Cardinality(const Roaring *r) {
+    return r->cardinality;
+}
+
+size_t Roaring_MemUsage(const Roaring *r);
+
+// The size of the portable serialized form of r, which Roaring_Serialize writes to buf
+size_t Roaring_SerializedSize(const Roaring *r);
+void Roaring_Serialize(const Roaring *r, char *buf);
+// Reads a bitmap written by Roaring_Serialize, NULL if buf isn't a valid one
+Roaring *Roaring_Deserialize(const char *buf, size_t len);
+
+// Yields the values in ascending order, r must not change meanwhile
+void RoaringIterator_Init(RoaringIterator *iter, const Roaring *r);
+bool RoaringIterator_Next(RoaringIterator *iter, uint32_t *value);
+// Moves the iterator so it yields the values from value on
+void RoaringIterator_Seek(RoaringIterator *iter, uint32_t value);
+
+#endif // ROARING_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+
+#include "thread_pool.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef struct ThreadPoolJob
+{
+    RTS_ThreadPoolJobFunc func;
+    void *arg;
+    struct ThreadPoolJob *next;
+} ThreadPoolJob;
+
+struct RTS_ThreadPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t hasJobs;
+    ThreadPoolJob *head;
+    ThreadPoolJob *tail;
+    size_t numThreads;
+};
+
+static void *ThreadPoolWorker(void *arg) {
+    RTS_ThreadPool *pool = arg;
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->head) {
+            pthread_cond_wait(&pool->hasJobs, &pool->lock);
+        }
+        ThreadPoolJob *job = pool->head;
+        pool->head = job->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        job->func(job->arg);
+        free(job);
+    }
+    return NULL;
+}
+
+RTS_ThreadPool *RTS_ThreadPoolCreate(size_t numThreads) {
+    assert(numThreads > 0);
+
+    RTS_ThreadPool *pool = calloc(1, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->hasJobs, NULL);
+
+    for (size_t i = 0; i < numThreads; i++) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        int rc = pthread_create(&thread, &attr, ThreadPoolWorker, pool);
+        pthread_attr_destroy(&attr);
+        if (rc != 0) {
+            break;
+        }
+        pool->numThreads++;
+    }
+
+    if (pool->numThreads == 0) {
+        pthread_cond_destroy(&pool->hasJobs);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void RTS_ThreadPoolAddJob(RTS_ThreadPool *pool, RTS_ThreadPoolJobFunc func, void *arg) {
+    ThreadPoolJob *job = malloc(sizeof(*job));
+    job->func = func;
+    job->arg = arg;
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) {
+        pool->tail->next = job;
+    } else {
+        pool->head = job;
+    }
+    pool->tail = job;
+    pthread_cond_signal(&pool->hasJobs);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+size_t RTS_ThreadPoolSize(const RTS_ThreadPool *pool) {
+    return pool->numThreads;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+typedef struct RTS_ThreadPool RTS_ThreadPool;
+
+typedef void (*RTS_ThreadPoolJobFunc)(void *arg);
+
+// Starts numThreads detached workers that run the queued jobs in FIFO order
+RTS_ThreadPool *RTS_ThreadPoolCreate(size_t numThreads);
+
+// Queues a job, never blocks
+void RTS_ThreadPoolAddJob(RTS_ThreadPool *pool, RTS_ThreadPoolJobFunc func, void *arg);
+
+size_t RTS_ThreadPoolSize(const RTS_ThreadPool *pool);
+
+#endif
@@ -0,0 +1,139 @@
+import pytest
+import time
+import redis
+from includes import *
+
+
+def test_backfill():
+    with Env().getClusterConnectionIfNeeded() as r:
+        for encoding in ['COMPRESSED', 'UNCOMPRESSED']:
+            key = 'backfill_' + encoding
+            r.execute_command('ts.create', key, 'ENCODING', encoding, 'CHUNK_SIZE', 128)
+            for ts in range(1000, 2000, 10):
+                r.execute_command('ts.add', key, ts, ts)
+
+            samples = []
+            for ts in range(1993, 0, -5):
+                samples += [ts, -ts]
+            # also extends the series
+            samples += [2500, 1, 2600, 2]
+            assert r.execute_command('ts.backfill', key, *samples) == 401
+
+            res = r.execute_command('ts.range', key, '-', '+')
+            expected = {ts: ts for ts in range(1000, 2000, 10)}
+            expected.update({ts: -ts for ts in range(1993, 0, -5)})
+            expected.update({2500: 1, 2600: 2})
+            assert res == [[ts, str(expected[ts]).encode()] for ts in sorted(expected)]
+            info = r.execute_command("ts.info", key)
+            assert info[1] == len(expected)
+            assert r.execute_command('ts.get', key) == [2600, b'2']
+
+
+def test_backfill_duplicate_policy():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'tester', 'DUPLICATE_POLICY', 'BLOCK')
+        r.execute_command('ts.add', 'tester', 100, 1)
+        r.execute_command('ts.add', 'tester', 200, 2)
+
+        # duplicates are rejected with BLOCK and don't count as written
+        assert r.execute_command('ts.backfill', 'tester', 100, 5, 150, 3, 150, 4) == 1
+        assert r.execute_command('ts.range', 'tester', '-', '+') == [[100, b'1'], [150, b'3'], [200, b'2']]
+
+        # ON_DUPLICATE overrides the series policy, duplicates are resolved in argument order
+        assert r.execute_command('ts.backfill', 'tester', 'ON_DUPLICATE', 'SUM', 100, 5, 150, 3, 150, 4) == 3
+        assert r.execute_command('ts.range', 'tester', '-', '+') == [[100, b'6'], [150, b'10'], [200, b'2']]
+
+
+def test_backfill_compaction():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'tester{a}')
+        r.execute_command('ts.create', 'tester_agg{a}')
+        r.execute_command('ts.createrule', 'tester{a}', 'tester_agg{a}', 'AGGREGATION', 'count', 100)
+        for ts in range(0, 1000, 50):
+            r.execute_command('ts.add', 'tester{a}', ts, 1)
+
+        samples = []
+        for ts in range(5, 900, 10):
+            samples += [ts, 1]
+        assert r.execute_command('ts.backfill', 'tester{a}', *samples) == 90
+        res = r.execute_command('ts.range', 'tester_agg{a}', '-', '+')
+        assert res == [[ts, b'12'] for ts in range(0, 900, 100)]
+
+
+def test_backfill_retention():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'tester', 'RETENTION', 100)
+        r.execute_command('ts.add', 'tester', 1000, 1)
+        assert r.execute_command('ts.backfill', 'tester', 850, 1, 950, 2) == 1
+        assert r.execute_command('ts.range', 'tester', '-', '+') == [[950, b'2'], [1000, b'1']]
+
+
+def test_backfill_errors():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'tester')
+        r.execute_command('set', 'not_ts', 'value')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', 1)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', 1, 2, 3)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', 'ON_DUPLICATE', 'LAST')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', 'ON_DUPLICATE', 'bad', 1, 2)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', '*', 2)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', -1, 2)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', 1, 'nan_value')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'not_ts', 1, 2)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'missing', 1, 2)
+        # a parse error leaves the series untouched
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.backfill', 'tester', 1, 2, 3, 'x')
+        assert r.execute_command('ts.range', 'tester', '-', '+') == []
+
+
+def test_backfill_replication():
+    env = Env()
+    if not env.useSlaves:
+        env.skip()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('ts.create', 'tester', 'DUPLICATE_POLICY', 'BLOCK', 'RETENTION', 1000)
+        r.execute_command('ts.add', 'tester', 2000, 1)
+        r.execute_command('ts.add', 'tester', 1500, 2)
+        # the duplicate and the sample out of the retention aren't replicated
+        assert r.execute_command('ts.backfill', 'tester', 1500, 3, 500, 4, 1600, 5) == 1
+        assert r.execute_command('ts.backfill', 'tester', 'ON_DUPLICATE', 'SUM', 1600, 1, 100, 1) == 1
+        assert r.execute_command('ts.backfill', 'tester', 1500, 7, 200, 8) == 0
+        assert r.execute_command('ts.backfill', 'tester', 2500, 6) == 1
+        r.execute_command('wait', 1, 0)
+        expected = r.execute_command('ts.range', 'tester', '-', '+')
+        assert expected == [[1500, b'2'], [1600, b'6'], [2000, b'1'], [2500, b'6']]
+    with env.getSlaveConnection() as r:
+        assert r.execute_command('ts.range', 'tester', '-', '+') == expected
+
+
+def test_backfill_keyspace_notification():
+    env = Env()
+    env.skipOnCluster()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        r.execute_command('config', 'set', 'notify-keyspace-events', 'KEA')
+        r.execute_command('ts.create', 'tester', 'DUPLICATE_POLICY', 'BLOCK')
+        r.execute_command('ts.add', 'tester', 100, 1)
+        pubsub = r.pubsub()
+        pubsub.psubscribe('__keyspace*')
+        time.sleep(1)
+        assert pubsub.get_message(timeout=1)['type'] == 'psubscribe'
+
+        # nothing is written, nothing is notified
+        assert r.execute_command('ts.backfill', 'tester', 100, 2) == 0
+        assert pubsub.get_message(timeout=1) is None
+
+        assert r.execute_command('ts.backfill', 'tester', 50, 2) == 1
+        msg = pubsub.get_message(timeout=1)
+        assert msg['type'] == 'pmessage' and msg['channel'].endswith(b':tester')
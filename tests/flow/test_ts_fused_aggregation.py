@@ -0,0 +1,70 @@
+import math
+from includes import *
+
+
+AGGREGATIONS = ['min', 'max', 'sum', 'avg', 'count', 'first', 'last']
+
+
+def fill(r, key, encoding):
+    r.execute_command('TS.CREATE', key, 'ENCODING', encoding, 'CHUNK_SIZE', 128)
+    for i in range(2000):
+        ts = 1000 + i * 7
+        if i % 97 == 0:
+            value = 'nan'
+        elif 500 <= i < 520:
+            # a whole bucket of NaN samples is not reported
+            value = 'nan'
+        else:
+            value = str((i * 37) % 101 - 50 + i / 8.0)
+        r.execute_command('TS.ADD', key, ts, value)
+
+
+def same(a, b):
+    if a == b:
+        return True
+    return math.isclose(float(a), float(b), rel_tol=1e-12)
+
+
+def assert_same_result(fused, expected, query):
+    assert len(fused) == len(expected), query
+    for f, e in zip(fused, expected):
+        assert f[0] == e[0], query
+        assert same(f[1], e[1]), (query, f, e)
+
+
+def test_fused_aggregation_matches_general_path():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r:
+        for encoding in ['COMPRESSED', 'UNCOMPRESSED']:
+            key = 'fused_{}{{a}}'.format(encoding)
+            fill(r, key, encoding)
+            for agg in AGGREGATIONS:
+                for extra in [[], ['ALIGN', 'start'], ['ALIGN', 13], ['BUCKETTIMESTAMP', 'mid'],
+                              ['BUCKETTIMESTAMP', 'end']]:
+                    for start, end, bucket in [('-', '+', 100), (1003, 12000, 333), (5000, 5001, 10),
+                                               (2500, 2500, 1), ('-', '+', 1000000)]:
+                        query = ['TS.RANGE', key, start, end] + extra + ['AGGREGATION', agg, bucket]
+                        fused = r.execute_command(*query)
+
+                        # multiple aggregations and reverse ranges use AggregationIterator
+                        general = r.execute_command(*(query[:-2] + [agg + ',std.p', bucket]))
+                        assert_same_result(fused, [[s[0], s[1]] for s in general], query)
+                        rev = r.execute_command('TS.REVRANGE', *query[1:])
+                        assert_same_result(fused, rev[::-1], query)
+
+
+def test_fused_aggregation_retention_and_count():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r:
+        r.execute_command('TS.CREATE', 'fused_ret{a}', 'RETENTION', 100, 'CHUNK_SIZE', 48)
+        for ts in range(1, 1001):
+            r.execute_command('TS.ADD', 'fused_ret{a}', ts, ts)
+        res = r.execute_command('TS.RANGE', 'fused_ret{a}', '-', '+', 'AGGREGATION', 'count', 50)
+        assert res == [[900, b'50'], [950, b'51']]
+        res = r.execute_command('TS.RANGE', 'fused_ret{a}', '-', '+', 'COUNT', 1,
+                                'AGGREGATION', 'sum', 50)
+        assert res == [[900, b'46225']]
+        assert r.execute_command('TS.RANGE', 'fused_ret{a}', 0, 10, 'AGGREGATION', 'max', 5) == []
+
+        r.execute_command('TS.CREATE', 'fused_empty{a}')
+        assert r.execute_command('TS.RANGE', 'fused_empty{a}', '-', '+', 'AGGREGATION', 'avg', 5) == []
@@ -0,0 +1,163 @@
+import pytest
+import redis
+from includes import *
+
+
+def as_dict(res):
+    return {k.decode(): v for k, v in zip(res[::2], res[1::2])}
+
+
+def index_stats(r, *label):
+    return as_dict(r.execute_command('TS.INDEXSTATS', *label))
+
+
+def test_indexstats():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        assert index_stats(r) == {'series': 0, 'labels': 0, 'postingLists': 0, 'labelStats': []}
+
+        for i in range(30):
+            r.execute_command('TS.CREATE', 'is{}'.format(i), 'LABELS',
+                              'host', 'h{}'.format(i % 7 if i < 21 else 0), 'dc', 'eu' if i % 3 else 'us')
+        r.execute_command('TS.CREATE', 'is_nolabels')
+
+        stats = index_stats(r)
+        assert stats['series'] == 30
+        assert stats['labels'] == 2
+        # a posting list per label and per value
+        assert stats['postingLists'] == 2 + 7 + 2
+        assert [as_dict(x) for x in stats['labelStats']] == [
+            {'label': b'dc', 'series': 30, 'distinctValues': 2},
+            {'label': b'host', 'series': 30, 'distinctValues': 7}]
+
+        host = index_stats(r, 'host')
+        assert host['label'] == b'host' and host['series'] == 30 and host['distinctValues'] == 7
+        # h0 has 12 series, the others 3 each, ties by value
+        assert host['topValues'] == [[b'h0', 12], [b'h1', 3], [b'h2', 3], [b'h3', 3], [b'h4', 3],
+                                     [b'h5', 3], [b'h6', 3]]
+        assert index_stats(r, 'dc')['topValues'] == [[b'eu', 20], [b'us', 10]]
+
+        # the stats follow deletes and relabeling
+        for i in range(1, 21, 7):
+            r.execute_command('DEL', 'is{}'.format(i))
+        r.execute_command('TS.ALTER', 'is0', 'LABELS', 'dc', 'us')
+        host = index_stats(r, 'host')
+        assert host['series'] == 26 and host['distinctValues'] == 6
+        assert [b'h1', 3] not in host['topValues']
+        assert host['topValues'][0] == [b'h0', 11]
+        assert index_stats(r, 'dc')['series'] == 27
+
+        unknown = index_stats(r, 'unknown')
+        assert unknown == {'label': b'unknown', 'series': 0, 'distinctValues': 0, 'topValues': []}
+
+        info = r.execute_command('INFO', 'timeseries_index')
+        assert info['timeseries_index_series'] == 27
+        assert info['timeseries_index_labels'] == 2
+
+        r.execute_command('FLUSHALL')
+        assert index_stats(r) == {'series': 0, 'labels': 0, 'postingLists': 0, 'labelStats': []}
+
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('TS.INDEXSTATS', 'host', 'dc')
+
+
+def test_indexstats_top_values_limit():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        for i in range(40):
+            # value v{k} has k + 1 series
+            for k in range(10, 14):
+                if i <= k:
+                    r.execute_command('TS.CREATE', 'tv{}_{}'.format(k, i), 'LABELS', 'v', 'v{}'.format(k))
+            r.execute_command('TS.CREATE', 'tv_single{}'.format(i), 'LABELS', 'v', 'single{}'.format(i))
+
+        stats = index_stats(r, 'v')
+        assert stats['distinctValues'] == 44
+        assert len(stats['topValues']) == 10
+        assert stats['topValues'][:4] == [[b'v13', 14], [b'v12', 13], [b'v11', 12], [b'v10', 11]]
+        assert all(count == 1 for _, count in stats['topValues'][4:])
+
+
+def test_regex_planned_after_selective_predicate():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        for i in range(50):
+            r.execute_command('TS.CREATE', 'rp{}'.format(i), 'LABELS', 'host', 'web-{}'.format(i),
+                              'role', 'leader' if i == 7 else 'follower')
+        # the regex is resolved after the single leader, in any predicate order
+        assert r1.execute_command('TS.QUERYINDEX', 'host=~web-[0-9]+', 'role=leader') == [b'rp7']
+        assert r1.execute_command('TS.QUERYINDEX', 'role=leader', 'host=~web-[0-9]+') == [b'rp7']
+        assert r1.execute_command('TS.QUERYINDEX', 'host=~web-.*', 'role=none') == []
+        assert r1.execute_command('TS.QUERYINDEX', 'role=leader', 'nolabel^=x') == []
+
+
+def test_index_rdb_reload():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'rl_tmpl', 'LABELS', 'tmpl', 'yes')
+        for i in range(40):
+            r.execute_command('TS.CREATE', 'rl{}'.format(i), 'LABELS', 'host', 'h{}'.format(i % 5),
+                              'dc', 'eu' if i % 4 else 'us')
+            r.execute_command('TS.ADD', 'rl{}'.format(i), 1000 + i, i)
+        r.execute_command('TS.ADD', 'rl_tmpl1', 1000, 1, 'TEMPLATE', 'rl_tmpl')
+        r.execute_command('TS.CREATE', 'rl_nolabels')
+        for i in range(0, 40, 9):
+            r.execute_command('DEL', 'rl{}'.format(i))
+        queries = [['host=h1'], ['dc=us', 'host!=h2'], ['tmpl=yes'], ['host=~h[0-2]', 'dc=eu']]
+        expected = [sorted(r.execute_command('TS.QUERYINDEX', *q)) for q in queries]
+        stats = index_stats(r)
+
+        env.dumpAndReload()
+        assert [sorted(r.execute_command('TS.QUERYINDEX', *q)) for q in queries] == expected
+        assert index_stats(r) == stats
+        # the time ranges of the restored series are known again once their keys are loaded
+        assert r.execute_command('TS.MRANGE', 1030, 1035, 'EXCLUDEEMPTY', 'FILTER', 'dc=eu', 'host=h1') == \
+            [[b'rl31', [], [[1031, b'31']]]]
+
+        # the restored index keeps following the keyspace
+        r.execute_command('DEL', 'rl1')
+        r.execute_command('TS.ALTER', 'rl6', 'LABELS', 'host', 'h9')
+        r.execute_command('TS.CREATE', 'rl_new', 'LABELS', 'host', 'h1')
+        assert sorted(r.execute_command('TS.QUERYINDEX', 'host=h1')) == \
+            sorted(set(expected[0]) - {b'rl1', b'rl6'} | {b'rl_new'})
+        assert r.execute_command('TS.QUERYINDEX', 'host=h9') == [b'rl6']
+
+
+def test_index_rdb_reload_label_with_equal_sign():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        # the index isn't saved then, it's rebuilt from the keys
+        r.execute_command('TS.CREATE', 'eq1', 'LABELS', 'a=b', 'c', 'a', 'x')
+        r.execute_command('TS.CREATE', 'eq2', 'LABELS', 'a', 'b=c')
+        env.dumpAndReload()
+        assert r.execute_command('TS.QUERYINDEX', 'a=x') == [b'eq1']
+        assert index_stats(r)['labels'] == 2
+
+
+def test_index_rdb_reload_bulk_build():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        # the '=' keeps the index out of the rdb, so the loaded series are indexed in bulk
+        r.execute_command('TS.CREATE', 'bb_eq', 'LABELS', 'k=v', 'x')
+        for i in range(300):
+            r.execute_command('TS.CREATE', 'bb{}'.format(i), 'LABELS', 'host', 'h{}'.format(i % 17),
+                              'dc', 'd{}'.format(i % 3), 'id', i)
+        queries = [['host=h3'], ['dc=d1', 'host!=h2'], ['id=7'], ['dc=(d0,d2)', 'host=~h1.*']]
+        expected = [sorted(r.execute_command('TS.QUERYINDEX', *q)) for q in queries]
+        stats = index_stats(r)
+        host = index_stats(r, 'host')
+
+        env.dumpAndReload()
+        assert [sorted(r.execute_command('TS.QUERYINDEX', *q)) for q in queries] == expected
+        assert index_stats(r) == stats
+        assert index_stats(r, 'host') == host
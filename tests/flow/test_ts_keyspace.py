@@ -148,3 +148,43 @@ def test_keyspace_rules_send():
 
         assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.incrby')
         assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'tester_src{2}')
+
+
+def test_keyspace_madd_coalesced():
+    Env().skipOnCluster()
+    Env().skipOnVersionSmaller("6.2.0")
+    skip_on_rlec()
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r:
+        r.execute_command('TS.CREATE', 'madd_src{2}')
+        r.execute_command('TS.CREATE', 'madd_dest{2}')
+        r.execute_command('TS.CREATE', 'madd_other{2}')
+        r.execute_command('TS.CREATERULE', 'madd_src{2}', 'madd_dest{2}', 'AGGREGATION', 'MAX', 1)
+        r.execute_command('config', 'set', 'notify-keyspace-events', 'KEA')
+
+        pubsub = r.pubsub()
+        pubsub.psubscribe('__key*')
+
+        time.sleep(1)
+        env.assertEqual('psubscribe', pubsub.get_message(timeout=1)['type'])
+
+        # every key is notified once per command, no matter how many of its samples were written
+        r.execute_command('ts.madd', 'madd_src{2}', 100, 1, 'madd_src{2}', 101, 2, 'madd_other{2}', 100, 3,
+                          'madd_src{2}', 102, 4, 'madd_src{2}', 103, 5, 'madd_other{2}', 99, 6)
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.add:dest')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'madd_dest{2}')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.add')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'madd_src{2}')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.add')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'madd_other{2}')
+        env.assertEqual(None, pubsub.get_message(timeout=1))
+        assert r.execute_command('ts.range', 'madd_dest{2}', '-', '+') == [[100, b'1'], [101, b'2'], [102, b'4']]
+
+        r.execute_command('ts.maddrow', 104, 'madd_src{2}', 6, 'madd_other{2}', 7, 'madd_src{2}', 8)
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.add:dest')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'madd_dest{2}')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.add')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'madd_src{2}')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'ts.add')
+        assert_msg(env, pubsub.get_message(timeout=1), 'pmessage', b'madd_other{2}')
+        env.assertEqual(None, pubsub.get_message(timeout=1))
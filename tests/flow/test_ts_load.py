@@ -0,0 +1,225 @@
+import os
+import tempfile
+import time
+
+import pytest
+import redis
+from test_helper_classes import _get_ts_info
+from includes import *
+
+
+def write_file(content):
+    fd, path = tempfile.mkstemp(suffix='.txt')
+    with os.fdopen(fd, 'w') as f:
+        f.write(content)
+    return path
+
+
+def load_status(r):
+    res = r.execute_command('ts.load.status')
+    status = dict(zip(res[::2], res[1::2]))
+    return {k.decode(): v for k, v in status.items()}
+
+
+def wait_for_load(r, timeout=30):
+    deadline = time.time() + timeout
+    status = load_status(r)
+    while status['state'] == b'running':
+        assert time.time() < deadline
+        time.sleep(0.05)
+        status = load_status(r)
+    return status
+
+
+def test_load_csv():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        path = write_file('# key,timestamp,value,labels\n'
+                          'cpu1,1000,1.5,host=h1,metric=cpu\n'
+                          'cpu1,3000,3\n'
+                          'cpu1,2000,2\r\n'
+                          '\n'
+                          'cpu2,1000,10,host=h2,metric=cpu\n'
+                          'cpu2,bad,10\n'
+                          'cpu2,2000\n'
+                          'cpu2,2000,20')
+        try:
+            assert r.execute_command('ts.load', path, 'FORMAT', 'csv') == b'OK'
+            status = wait_for_load(r)
+        finally:
+            os.remove(path)
+
+        assert status['state'] == b'done'
+        assert status['format'] == b'csv'
+        assert status['lines'] == 7
+        assert status['samples'] == 5
+        assert status['errors'] == 2
+        assert status['seriesCreated'] == 2
+        assert status['bytesRead'] == status['bytesTotal']
+
+        assert r.execute_command('ts.range', 'cpu1', '-', '+') == [[1000, b'1.5'], [2000, b'2'], [3000, b'3']]
+        assert r.execute_command('ts.range', 'cpu2', '-', '+') == [[1000, b'10'], [2000, b'20']]
+        assert _get_ts_info(r, 'cpu1').labels == {b'host': b'h1', b'metric': b'cpu'}
+        assert r.execute_command('ts.queryindex', 'metric=cpu') == [b'cpu1', b'cpu2']
+
+
+def test_load_influx():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        path = write_file('cpu,host=h1 usage=1.5,idle=98i,name="first host" 1000000000\n'
+                          'cpu,host=h1 usage=2.5,idle=97i 2000000000\n'
+                          'cpu,host=h2 usage=7,busy=true 1000000000\n'
+                          'cpu,host=h2 usage=oops 2000000000\n'
+                          'no_fields\n')
+        try:
+            r.execute_command('ts.load', path, 'FORMAT', 'INFLUX')
+            status = wait_for_load(r)
+        finally:
+            os.remove(path)
+
+        assert status['state'] == b'done'
+        assert status['lines'] == 5
+        assert status['samples'] == 6
+        assert status['errors'] == 2
+        assert status['seriesCreated'] == 4
+
+        assert r.execute_command('ts.range', 'cpu,host=h1:usage', '-', '+') == [[1000, b'1.5'], [2000, b'2.5']]
+        assert r.execute_command('ts.range', 'cpu,host=h1:idle', '-', '+') == [[1000, b'98'], [2000, b'97']]
+        assert r.execute_command('ts.range', 'cpu,host=h2:busy', '-', '+') == [[1000, b'1']]
+        assert r.execute_command('exists', 'cpu,host=h1:name') == 0
+        assert _get_ts_info(r, 'cpu,host=h1:usage').labels == \
+               {b'measurement': b'cpu', b'field': b'usage', b'host': b'h1'}
+        assert r.execute_command('ts.queryindex', 'measurement=cpu', 'field=usage') == \
+               [b'cpu,host=h1:usage', b'cpu,host=h2:usage']
+
+
+def test_load_existing_series():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.create', 'existing', 'DUPLICATE_POLICY', 'LAST', 'LABELS', 'a', 'b')
+        r.execute_command('ts.add', 'existing', 2000, 1)
+        r.execute_command('set', 'string', 'value')
+        path = write_file('existing,1000,10,c=d\n'
+                          'existing,2000,20\n'
+                          'existing,3000,30\n'
+                          'string,1000,1\n')
+        try:
+            r.execute_command('ts.load', path, 'FORMAT', 'csv')
+            status = wait_for_load(r)
+        finally:
+            os.remove(path)
+
+        assert status['samples'] == 3
+        assert status['errors'] == 1
+        assert status['seriesCreated'] == 0
+        assert r.execute_command('ts.range', 'existing', '-', '+') == [[1000, b'10'], [2000, b'20'], [3000, b'30']]
+        # the labels of existing series are kept
+        assert _get_ts_info(r, 'existing').labels == {b'a': b'b'}
+
+
+def test_load_template():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'tmpl_load', 'RETENTION', 5000, 'RULES', 'max:1s:1m',
+                          'LABELS', 'source', 'archive')
+        path = write_file('t1,1000,1,host=h1\nt1,1500,5\nt1,2000,2\n')
+        try:
+            r.execute_command('ts.load', path, 'FORMAT', 'csv', 'TEMPLATE', 'tmpl_load')
+            status = wait_for_load(r)
+        finally:
+            os.remove(path)
+
+        assert status['state'] == b'done'
+        assert status['template'] == b'tmpl_load'
+        info = _get_ts_info(r, 't1')
+        assert info.retention_msecs == 5000
+        assert info.labels == {b'source': b'archive', b'host': b'h1'}
+        assert r.execute_command('ts.range', 't1_MAX_1000', '-', '+') == [[1000, b'5']]
+
+
+def test_load_cancel():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        path = write_file(''.join('s{},{},{}\n'.format(i % 100, i, i) for i in range(500000)))
+        try:
+            r.execute_command('ts.load', path, 'FORMAT', 'csv')
+            if load_status(r)['state'] == b'running':
+                # only one load runs at a time
+                with pytest.raises(redis.ResponseError):
+                    r.execute_command('ts.load', path, 'FORMAT', 'csv')
+            try:
+                r.execute_command('ts.load.cancel')
+                cancelled = True
+            except redis.ResponseError:
+                # the load was already done
+                cancelled = False
+            status = wait_for_load(r)
+        finally:
+            os.remove(path)
+
+        assert status['state'] == (b'cancelled' if cancelled else b'done')
+        assert status['samples'] + status['errors'] <= 500000
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.load.cancel')
+
+
+def test_load_errors():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        path = write_file('a,1,1\n')
+        try:
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', path)
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', path, 'FORMAT')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', path, 'FORMAT', 'json')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', path, 'FORMAT', 'csv', 'TEMPLATE')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', path, 'FORMAT', 'csv', 'TEMPLATE', 'missing')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', path + '.missing', 'FORMAT', 'csv')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load', os.path.dirname(path), 'FORMAT', 'csv')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('ts.load.status', 'extra')
+        finally:
+            os.remove(path)
+
+
+def test_load_replication():
+    env = Env()
+    if not env.useSlaves:
+        env.skip()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.create', 'existing')
+        r.execute_command('ts.add', 'existing', 5000, 5)
+        path = write_file('new,3000,0.1,a=b\nnew,1000,1.5\nexisting,1000,1\nexisting,6000,6\n')
+        try:
+            r.execute_command('ts.load', path, 'FORMAT', 'csv')
+            wait_for_load(r)
+        finally:
+            os.remove(path)
+        r.execute_command('wait', 1, 0)
+        expected_new = r.execute_command('ts.range', 'new', '-', '+')
+        expected_existing = r.execute_command('ts.range', 'existing', '-', '+')
+        assert expected_new == [[1000, b'1.5'], [3000, b'0.1']]
+        assert expected_existing == [[1000, b'1'], [5000, b'5'], [6000, b'6']]
+    with env.getSlaveConnection() as r:
+        assert r.execute_command('ts.range', 'new', '-', '+') == expected_new
+        assert r.execute_command('ts.range', 'existing', '-', '+') == expected_existing
+        assert _get_ts_info(r, 'new').labels == {b'a': b'b'}
@@ -62,6 +62,49 @@ def test_ooo_madd():
         assert r.execute_command('ts.range', 'test_key1', '-', '+') == samples
 
 
+def test_madd_ooo_batch():
+    # out-of-order samples are merged per series in one pass, the outcome must match TS.ADD
+    Env().skipOnCluster()
+    skip_on_rlec()
+    with Env().getConnection() as r:
+        for key, encoding in [('ooo_compressed', 'COMPRESSED'), ('ooo_uncompressed', 'UNCOMPRESSED')]:
+            for suffix in ['', '_ref']:
+                r.execute_command('ts.create', key + suffix, 'ENCODING', encoding, 'CHUNK_SIZE', 128,
+                                  'DUPLICATE_POLICY', 'SUM')
+                r.execute_command('ts.create', key + suffix + '_agg')
+                r.execute_command('ts.createrule', key + suffix, key + suffix + '_agg', 'AGGREGATION', 'sum', 100)
+                for ts in range(0, 2000, 10):
+                    r.execute_command('ts.add', key + suffix, ts, 1)
+
+            args = []
+            expected = []
+            for ts in list(range(1995, 0, -7)) + [10, 10, 2500, 20]:
+                args += [key, ts, 2]
+                expected.append(r.execute_command('ts.add', key + '_ref', ts, 2))
+            assert r.execute_command('ts.madd', *args) == expected
+            assert r.execute_command('ts.range', key, '-', '+') == r.execute_command('ts.range', key + '_ref', '-', '+')
+            assert r.execute_command('ts.range', key + '_agg', '-', '+') == \
+                   r.execute_command('ts.range', key + '_ref_agg', '-', '+')
+            assert r.execute_command('ts.info', key)[1] == r.execute_command('ts.info', key + '_ref')[1]
+
+
+def test_madd_ooo_batch_block():
+    Env().skipOnCluster()
+    skip_on_rlec()
+    with Env().getConnection() as r:
+        r.execute_command('ts.create', 'test_key1', 'DUPLICATE_POLICY', 'BLOCK')
+        r.execute_command('ts.create', 'test_key2')
+        r.execute_command('ts.madd', 'test_key1', 100, 1, 'test_key1', 200, 2, 'test_key2', 200, 2)
+        res = r.execute_command('ts.madd', 'test_key1', 150, 3, 'test_key2', 50, 4, 'test_key1', 100, 5,
+                                'test_key1', 120, 6, 'test_key1', 120, 7)
+        assert res[0] == 150 and res[1] == 50 and res[3] == 120
+        assert isinstance(res[2], redis.ResponseError)
+        assert isinstance(res[4], redis.ResponseError)
+        assert r.execute_command('ts.range', 'test_key1', '-', '+') == \
+               [[100, b'1'], [120, b'6'], [150, b'3'], [200, b'2']]
+        assert r.execute_command('ts.range', 'test_key2', '-', '+') == [[50, b'4'], [200, b'2']]
+
+
 def test_partial_madd():
     Env().skipOnCluster()
     skip_on_rlec()
@@ -0,0 +1,88 @@
+import pytest
+import redis
+import time
+from includes import *
+
+
+def test_maddrow():
+    with Env().getClusterConnectionIfNeeded() as r:
+        keys = ['cpu{host1}', 'mem{host1}', 'disk{host1}']
+        for key in keys:
+            r.execute_command('ts.create', key)
+
+        for ts in range(1000, 1100):
+            # the reply holds the timestamp of every key, like TS.MADD
+            assert r.execute_command('ts.maddrow', ts, keys[0], ts, keys[1], ts + 1, keys[2], ts + 2) == [ts] * 3
+
+        for i, key in enumerate(keys):
+            assert r.execute_command('ts.range', key, '-', '+') == \
+                   [[ts, str(ts + i).encode()] for ts in range(1000, 1100)]
+
+
+def test_maddrow_current_time():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'a{1}')
+        r.execute_command('ts.create', 'b{1}')
+        before = int(time.time() * 1000)
+        res = r.execute_command('ts.maddrow', '*', 'a{1}', 1, 'b{1}', 2)
+        ts = res[0]
+        assert ts >= before and res == [ts, ts]
+        # every sample of the row gets the same timestamp
+        assert r.execute_command('ts.get', 'a{1}') == [ts, b'1']
+        assert r.execute_command('ts.get', 'b{1}') == [ts, b'2']
+
+
+def test_maddrow_partial_failure():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'a{1}', 'DUPLICATE_POLICY', 'BLOCK')
+        r.execute_command('ts.create', 'b{1}')
+        r.execute_command('set', 'c{1}', 'value')
+        r.execute_command('ts.add', 'a{1}', 100, 1)
+
+        res = r.execute_command('ts.maddrow', 100, 'a{1}', 2, 'b{1}', 3, 'c{1}', 4, 'b{1}', 'bad', 'd{1}', 5)
+        assert len(res) == 5
+        assert isinstance(res[0], redis.ResponseError)
+        assert res[1] == 100
+        assert isinstance(res[2], redis.ResponseError)
+        assert isinstance(res[3], redis.ResponseError)
+        assert isinstance(res[4], redis.ResponseError)
+        assert r.execute_command('ts.range', 'a{1}', '-', '+') == [[100, b'1']]
+        assert r.execute_command('ts.range', 'b{1}', '-', '+') == [[100, b'3']]
+        assert r.execute_command('exists', 'd{1}') == 0
+
+
+def test_maddrow_errors():
+    with Env().getClusterConnectionIfNeeded() as r:
+        r.execute_command('ts.create', 'a{1}')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.maddrow', 100)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.maddrow', 100, 'a{1}')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.maddrow', 100, 'a{1}', 1, 'a{1}')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.maddrow', 'bad', 'a{1}', 1)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.maddrow', -1, 'a{1}', 1)
+        assert r.execute_command('ts.range', 'a{1}', '-', '+') == []
+
+
+def test_maddrow_replication():
+    env = Env()
+    if not env.useSlaves:
+        env.skip()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('ts.create', 'a', 'DUPLICATE_POLICY', 'BLOCK')
+        r.execute_command('ts.create', 'b')
+        r.execute_command('ts.add', 'a', 100, 1)
+        r.execute_command('ts.maddrow', 100, 'a', 2, 'b', 3)
+        ts = r.execute_command('ts.maddrow', '*', 'a', 4, 'b', 5)[0]
+        r.execute_command('wait', 1, 0)
+        expected_a = r.execute_command('ts.range', 'a', '-', '+')
+        expected_b = r.execute_command('ts.range', 'b', '-', '+')
+        assert expected_a == [[100, b'1'], [ts, b'4']]
+        assert expected_b == [[100, b'3'], [ts, b'5']]
+    with env.getSlaveConnection() as r:
+        assert r.execute_command('ts.range', 'a', '-', '+') == expected_a
+        assert r.execute_command('ts.range', 'b', '-', '+') == expected_b
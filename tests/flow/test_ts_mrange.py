@@ -1328,6 +1328,71 @@ def test_excludeempty_agg_empty_flag_both_sides(env):
         assert all(math.isnan(float(v)) for _, v in samples)
 
 
+def test_excludeempty_indexed_time_range(env):
+    """EXCLUDEEMPTY skips series by the time range kept in the index, which follows every write."""
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        def keys(start, end, *args):
+            return _excl_keys(r1.execute_command(
+                'TS.MRANGE', start, end, *args, 'EXCLUDEEMPTY', 'FILTER', 'g=xetr'))
+
+        for key in ['xetr_empty{1}', 'xetr_old{1}', 'xetr_live{1}']:
+            r.execute_command('TS.CREATE', key, 'LABELS', 'g', 'xetr')
+        for t in range(100, 200, 10):
+            r.execute_command('TS.ADD', 'xetr_old{1}', t, t)
+            r.execute_command('TS.ADD', 'xetr_live{1}', t + 900, t)
+        assert keys(0, 50) == []
+        assert keys(190, 1000) == ['xetr_live{1}', 'xetr_old{1}']
+        assert keys(500, 900) == []
+        assert keys('-', '+') == ['xetr_live{1}', 'xetr_old{1}']
+
+        # out of order samples and batches extend the range
+        r.execute_command('TS.ADD', 'xetr_live{1}', 600, 1)
+        r.execute_command('TS.MADD', 'xetr_empty{1}', 700, 1, 'xetr_empty{1}', 650, 2)
+        assert keys(500, 900) == ['xetr_empty{1}', 'xetr_live{1}']
+
+        # deleting ranges shrinks it
+        r.execute_command('TS.DEL', 'xetr_live{1}', 600, 600)
+        r.execute_command('TS.DEL', 'xetr_empty{1}', 0, 1000)
+        assert keys(500, 900) == []
+        assert keys('-', '+') == ['xetr_live{1}', 'xetr_old{1}']
+        r.execute_command('TS.ADD', 'xetr_empty{1}', 800, 1)
+        assert keys(500, 900) == ['xetr_empty{1}']
+
+        # relabeling and renaming keep it
+        r.execute_command('TS.ALTER', 'xetr_old{1}', 'LABELS', 'g', 'xetr', 'x', 'y')
+        assert keys(150, 160) == ['xetr_old{1}']
+        r.execute_command('RENAME', 'xetr_old{1}', 'xetr_renamed{1}')
+        assert keys(150, 160) == ['xetr_renamed{1}']
+        assert keys(500, 900) == ['xetr_empty{1}']
+
+        # trimming by the retention drops the old chunks
+        r.execute_command('TS.CREATE', 'xetr_retention{1}', 'RETENTION', 100, 'CHUNK_SIZE', 48,
+                          'UNCOMPRESSED', 'LABELS', 'g', 'xetr')
+        for t in range(1, 30):
+            r.execute_command('TS.ADD', 'xetr_retention{1}', t, t)
+        assert keys(1, 2) == ['xetr_retention{1}']
+        for t in range(5000, 5030):
+            r.execute_command('TS.ADD', 'xetr_retention{1}', t, t)
+        assert keys(1, 30) == []
+        assert keys(5000, 5000) == ['xetr_retention{1}']
+
+
+def test_excludeempty_latest_not_skipped(env):
+    """The open bucket of a compaction is reported with LATEST even if it has no sample in the range."""
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        r.execute_command('TS.CREATE', 'xel_src{1}')
+        r.execute_command('TS.CREATE', 'xel_dst{1}', 'LABELS', 'g', 'xel')
+        r.execute_command('TS.CREATERULE', 'xel_src{1}', 'xel_dst{1}', 'AGGREGATION', 'sum', 100)
+        for t in [10, 50, 150]:
+            r.execute_command('TS.ADD', 'xel_src{1}', t, 1)
+
+        res = r1.execute_command('TS.MRANGE', 100, 200, 'EXCLUDEEMPTY', 'FILTER', 'g=xel')
+        assert res == [] or res == {}
+        res = r1.execute_command('TS.MRANGE', 100, 200, 'LATEST', 'EXCLUDEEMPTY', 'FILTER', 'g=xel')
+        assert _excl_keys(res) == ['xel_dst{1}']
+        assert _excl_samples(res, 'xel_dst{1}') == [[100, b'1']]
+
+
 def test_excludeempty_agg_empty_flag_one_side(env):
     """AGGREGATION EMPTY + data on ONE side only: edge buckets dropped → no NaN buckets
     in range → series is EXCLUDED by EXCLUDEEMPTY."""
@@ -1355,3 +1420,35 @@ def test_excludeempty_resp3(env):
         res = r1.execute_command('TS.MRANGE', 1, 100, 'EXCLUDEEMPTY', 'FILTER', 'g=xr3')
         assert isinstance(res, dict)
         assert _excl_keys(res) == ['xr3a']
+
+
+def test_mrange_query_arena_matches_range(env):
+    """MRANGE iterators of consecutive series share an arena and recycled chunk buffers, the
+    replies must not carry samples of the previous series."""
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        for i in range(30):
+            key = 'arena{}'.format(i)
+            r.execute_command('TS.CREATE', key, 'CHUNK_SIZE', 128, 'LABELS', 'g', 'arena')
+            # a different number of samples per series, some none in the range
+            for ts in range(0, 40 * i, 1 + i % 4):
+                r.execute_command('TS.ADD', key, 1000 + ts, (ts * 7 + i) % 23)
+        for extra in [[], ['COUNT', 5], ['FILTER_BY_VALUE', 3, 15], ['FILTER_BY_TS', 1002, 1010, 1300],
+                      ['AGGREGATION', 'avg', 50], ['AGGREGATION', 'max', 20, 'EMPTY'],
+                      ['FILTER_BY_VALUE', 0, 10, 'AGGREGATION', 'sum', 100]]:
+            for cmd in ['TS.RANGE', 'TS.REVRANGE']:
+                multi = 'TS.MRANGE' if cmd == 'TS.RANGE' else 'TS.MREVRANGE'
+                for exclude in [[], ['EXCLUDEEMPTY']]:
+                    res = r1.execute_command(multi, 1000, 1900, *extra, *exclude, 'FILTER', 'g=arena')
+                    got = {item[0]: item[2] for item in res}
+                    for i in range(30):
+                        key = 'arena{}'.format(i)
+                        expected = r.execute_command(cmd, key, 1000, 1900, *extra)
+                        if exclude and not expected:
+                            assert key.encode() not in got
+                        else:
+                            assert got[key.encode()] == expected, (key, extra, exclude)
+
+        if not env.isCluster():
+            info = r1.execute_command('INFO', 'timeseries_query_arena')
+            assert info['timeseries_query_arenas'] > 0
+            assert info['timeseries_query_arena_chunks_recycled'] > 0
@@ -1,4 +1,5 @@
 import pytest
+import random
 import redis
 # from utils import Env
 from includes import *
@@ -59,3 +60,239 @@ def test_large_key_value_pairs():
         for kv_label in kv_labels:
             res = r1.execute_command('TS.QUERYINDEX', kv_label1)
             assert len(res) == number_series
+
+def test_queryindex_matches_scan_after_deletes():
+    env = Env()
+    rnd = random.Random(41)
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        labels = {}
+
+        def create(i):
+            key = 'qi{}'.format(i)
+            labels[key] = {'l{}'.format(k): str(rnd.randint(0, k + 1)) for k in range(4) if rnd.random() < 0.75}
+            args = ['LABELS'] + [x for kv in labels[key].items() for x in kv] if labels[key] else []
+            r.execute_command('TS.CREATE', key, *args)
+
+        def matches(series_labels, predicate):
+            if '!=' in predicate:
+                name, values = predicate.split('!=')
+                negate = True
+            else:
+                name, values = predicate.split('=')
+                negate = False
+            values = values.strip('()').split(',') if values else []
+            if not values:  # 'l=' and 'l!=' test for the label itself
+                return (name in series_labels) == negate
+            return (series_labels.get(name) in values) != negate
+
+        for i in range(600):
+            create(i)
+        for round in range(3):
+            # deleted and recreated series reuse the ids of the index
+            for key in rnd.sample(sorted(labels), 150):
+                r.execute_command('DEL', key)
+                del labels[key]
+            for i in range(600 + round * 100, 700 + round * 100):
+                create(i)
+
+            for _ in range(50):
+                predicates = []
+                for _ in range(rnd.randint(1, 3)):
+                    name = 'l{}'.format(rnd.randint(0, 3))
+                    op = rnd.choice(['=', '!='])
+                    values = [str(rnd.randint(0, 4)) for _ in range(rnd.randint(0, 3))]
+                    value = values[0] if len(values) == 1 else '({})'.format(','.join(values)) if values else ''
+                    predicates.append(name + op + value)
+                if not any('!=' not in p and not p.endswith('=') for p in predicates):
+                    continue  # a query needs a l=v or l=(v1,v2) matcher
+                expected = sorted(key.encode() for key, series_labels in labels.items()
+                                  if series_labels and all(matches(series_labels, p) for p in predicates))
+                assert sorted(r1.execute_command('TS.QUERYINDEX', *predicates)) == expected, predicates
+
+
+def test_queryindex_predicate_order():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        for i in range(40):
+            labels = ['size', 'big' if i % 4 == 0 else 'small', 'color', ['red', 'green', 'blue'][i % 3]]
+            if i % 5 == 0:
+                labels += ['broken', '1']
+            r.execute_command('TS.CREATE', 'po{}'.format(i), 'LABELS', *labels)
+
+        # the least selective inclusion first, the exclusions before and after the inclusions
+        predicates = ['color!=blue', 'size=(big,small)', 'broken=', 'color=(red,green)', 'size!=big']
+        expected = sorted('po{}'.format(i).encode() for i in range(40)
+                          if i % 4 != 0 and i % 3 != 2 and i % 5 != 0)
+        assert len(expected) > 0
+        for start in range(len(predicates)):
+            rotated = predicates[start:] + predicates[:start]
+            assert sorted(r1.execute_command('TS.QUERYINDEX', *rotated)) == expected, rotated
+            assert sorted(r1.execute_command('TS.QUERYINDEX', *reversed(rotated))) == expected, rotated
+
+        # an inclusion without series short-circuits whatever its position
+        assert r1.execute_command('TS.QUERYINDEX', 'size=small', 'color!=red', 'color=purple') == []
+        assert r1.execute_command('TS.QUERYINDEX', 'size=(huge)', 'size=small') == []
+
+
+def test_queryindex_regex_and_prefix():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        hosts = ['web-1', 'web-2', 'web-10', 'db-1', 'db-2', 'webcache', 'cache-web-1']
+        for i, host in enumerate(hosts):
+            r.execute_command('TS.CREATE', 'rx{}'.format(i), 'LABELS', 'host', host, 'dc', 'eu' if i % 2 else 'us')
+        r.execute_command('TS.CREATE', 'rx_nohost', 'LABELS', 'dc', 'us')
+
+        def query(*predicates):
+            return sorted(k.decode() for k in r1.execute_command('TS.QUERYINDEX', *predicates))
+
+        def keys(*names):
+            return sorted('rx{}'.format(hosts.index(n)) for n in names)
+
+        assert query('host^=web-') == keys('web-1', 'web-2', 'web-10')
+        assert query('host^=web') == keys('web-1', 'web-2', 'web-10', 'webcache')
+        assert query('host^=x') == []
+        # the regex matches the whole value
+        assert query('host=~web-.*') == keys('web-1', 'web-2', 'web-10')
+        assert query('host=~web-[0-9]') == keys('web-1', 'web-2')
+        assert query('host=~(db|web)-1') == keys('web-1', 'db-1')
+        assert query('host=~web') == []
+        # the regex may hold the characters of the other operators
+        assert query('host=~.*[=(].*') == []
+        # series without the label don't match a regex but pass a negated one
+        assert query('dc=us', 'host!~web-.*') == sorted(keys('db-2', 'cache-web-1') + ['rx_nohost'])
+        assert query('host^=web', 'host!~.*cache', 'dc=eu') == keys('web-2')
+
+        res = r.execute_command('TS.MGET', 'FILTER', 'host=~db-.*')
+        assert sorted(x[0].decode() for x in res) == keys('db-1', 'db-2')
+
+        # a negated regex alone is no matcher, and invalid regexes are rejected
+        with pytest.raises(redis.ResponseError):
+            r1.execute_command('TS.QUERYINDEX', 'host!~web-.*')
+        with pytest.raises(redis.ResponseError):
+            r1.execute_command('TS.QUERYINDEX', 'host=~web-(')
+        with pytest.raises(redis.ResponseError):
+            r1.execute_command('TS.QUERYINDEX', 'host^=')
+
+
+def test_queryindex_or_groups():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        for i in range(12):
+            r.execute_command('TS.CREATE', 'og{}'.format(i), 'LABELS', 'dc', 'ab'[i % 2],
+                              'role', ['db', 'cache', 'web'][i % 3])
+            r.execute_command('TS.ADD', 'og{}'.format(i), 1000, i)
+
+        def query(*predicates):
+            return sorted(k.decode() for k in r1.execute_command('TS.QUERYINDEX', *predicates))
+
+        def keys(pred):
+            return sorted('og{}'.format(i) for i in range(12) if pred(i))
+
+        db_a = keys(lambda i: i % 2 == 0 and i % 3 == 0)
+        cache_b = keys(lambda i: i % 2 == 1 and i % 3 == 1)
+        assert query('dc=a', 'role=db', 'OR', 'dc=b', 'role=cache') == sorted(db_a + cache_b)
+        # a series matching several groups is returned once
+        assert query('dc=a', 'or', 'role=db') == keys(lambda i: i % 2 == 0 or i % 3 == 0)
+        assert query('role=web', 'dc!=b', 'OR', 'dc=nothing') == keys(lambda i: i % 3 == 2 and i % 2 == 0)
+        assert query('dc=nothing', 'OR', 'role=(db,web)', 'dc=b') == keys(lambda i: i % 3 != 1 and i % 2 == 1)
+
+        res = r.execute_command('TS.MGET', 'FILTER', 'dc=a', 'role=db', 'OR', 'dc=b', 'role=cache')
+        assert sorted(x[0].decode() for x in res) == sorted(db_a + cache_b)
+        res = r.execute_command('TS.MRANGE', '-', '+', 'FILTER', 'dc=a', 'role=db', 'OR', 'dc=b', 'role=cache')
+        assert sorted(x[0].decode() for x in res) == sorted(db_a + cache_b)
+
+        # each group needs a matcher, and OR only separates non empty groups
+        for predicates in [['dc=a', 'OR', 'role!=db'], ['OR', 'dc=a'], ['dc=a', 'OR'], ['dc=a', 'OR', 'OR', 'dc=b']]:
+            with pytest.raises(redis.ResponseError):
+                r1.execute_command('TS.QUERYINDEX', *predicates)
+
+
+def test_queryindex_numeric_ranges():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        for i in range(20):
+            r.execute_command('TS.CREATE', 'nr{}'.format(i), 'LABELS', 'rack', i, 'temp', i / 4, 'dc', 'ab'[i % 2])
+        r.execute_command('TS.CREATE', 'nr_text', 'LABELS', 'rack', 'unknown', 'temp', 'hot', 'dc', 'a')
+
+        def query(*predicates):
+            return sorted(k.decode() for k in r.execute_command('TS.QUERYINDEX', *predicates))
+
+        def keys(pred):
+            return sorted('nr{}'.format(i) for i in range(20) if pred(i))
+
+        # a range on a label that isn't numeric is an equality on a label ending with '<' or '>'
+        assert query('rack>=5') == []
+        r.execute_command('CONFIG', 'SET', 'ts-numeric-labels', 'rack, temp')
+        assert r.execute_command('CONFIG', 'GET', 'ts-numeric-labels') == [b'ts-numeric-labels', b'rack,temp']
+
+        # the values are compared as numbers, the ones that aren't numbers never match
+        assert query('rack>5') == keys(lambda i: i > 5)
+        assert query('rack>=5') == keys(lambda i: i >= 5)
+        assert query('rack<10') == keys(lambda i: i < 10)
+        assert query('rack<=10') == keys(lambda i: i <= 10)
+        assert query('rack>2', 'rack<=4') == keys(lambda i: 2 < i <= 4)
+        assert query('temp>=1.5', 'dc=a', 'rack<12') == keys(lambda i: i / 4 >= 1.5 and i % 2 == 0 and i < 12)
+        assert query('temp<0.6', 'OR', 'rack>18') == keys(lambda i: i / 4 < 0.6 or i > 18)
+        assert query('rack>-1e3') == keys(lambda i: True)
+        assert query('rack>100') == []
+
+        # the index follows new, deleted and relabeled series
+        r.execute_command('TS.CREATE', 'nr_new', 'LABELS', 'rack', '7.5')
+        r.execute_command('DEL', 'nr7')
+        r.execute_command('TS.ALTER', 'nr8', 'LABELS', 'rack', 'none')
+        assert query('rack>=7', 'rack<9') == ['nr_new']
+
+        res = r.execute_command('TS.MGET', 'FILTER', 'rack>17')
+        assert sorted(x[0] for x in res) == [b'nr18', b'nr19']
+        res = r.execute_command('TS.MRANGE', '-', '+', 'FILTER', 'temp<=0.25')
+        assert sorted(x[0] for x in res) == [b'nr0', b'nr1']
+
+        # the numeric labels can't contain operators, and a range needs a number
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('CONFIG', 'SET', 'ts-numeric-labels', 'rack,te=mp')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('TS.QUERYINDEX', 'rack>x')
+
+        r.execute_command('CONFIG', 'SET', 'ts-numeric-labels', '')
+        assert query('rack>5') == []
+
+
+def test_queryindex_count_and_cursor():
+    env = Env()
+    with env.getClusterConnectionIfNeeded() as r, env.getConnection(1) as r1:
+        for i in range(50):
+            r.execute_command('TS.CREATE', 'qc{}'.format(i), 'LABELS', 'kind', 'qc', 'odd', i % 2)
+        keys = sorted(r1.execute_command('TS.QUERYINDEX', 'kind=qc'))
+        assert len(keys) == 50
+
+        assert r1.execute_command('TS.QUERYINDEX', 'COUNT', 'kind=qc') == 50
+        assert r1.execute_command('TS.QUERYINDEX', 'count', 'kind=qc', 'odd=1') == 25
+        assert r1.execute_command('TS.QUERYINDEX', 'COUNT', 'kind=none') == 0
+
+        # the pages cover every series once, whatever the limit
+        for limit in (1, 7, 50, 1000):
+            cursor, seen = 0, []
+            while True:
+                cursor, page = r1.execute_command('TS.QUERYINDEX', 'CURSOR', cursor, 'LIMIT', limit, 'kind=qc')
+                assert len(page) <= limit
+                seen += page
+                if cursor == 0:
+                    break
+            assert sorted(seen) == keys
+
+        # the default limit fits all the series in one page
+        cursor, page = r1.execute_command('TS.QUERYINDEX', 'CURSOR', 0, 'kind=qc', 'odd=0')
+        assert cursor == 0
+        assert sorted(page) == sorted(k for k in keys if int(k[2:]) % 2 == 0)
+        assert r1.execute_command('TS.QUERYINDEX', 'CURSOR', 0, 'kind=none') == [0, []]
+
+        for args in [['COUNT', 'CURSOR', 0], ['CURSOR', 0, 'COUNT'], ['LIMIT', 5], ['COUNT', 'LIMIT', 5],
+                     ['CURSOR', 0, 'LIMIT', 0], ['CURSOR', -1], ['CURSOR', 'x'], ['CURSOR', 0, 'LIMIT', 'x']]:
+            with pytest.raises(redis.ResponseError):
+                r1.execute_command('TS.QUERYINDEX', *args, 'kind=qc')
+        with pytest.raises(redis.ResponseError):
+            r1.execute_command('TS.QUERYINDEX', 'COUNT')
@@ -1,4 +1,5 @@
 import math
+import struct
 
 # import pytest
 # import redis
@@ -219,6 +220,116 @@ def test_range_count():
         assert len(count_results) == math.ceil(samples_count / 3.0)
 
 
+def test_range_count_multi_chunk():
+    with Env().getClusterConnectionIfNeeded() as r:
+        for encoding in ['COMPRESSED', 'UNCOMPRESSED']:
+            key = 'count_{}{{a}}'.format(encoding)
+            r.execute_command('TS.CREATE', key, 'ENCODING', encoding, 'CHUNK_SIZE', 128)
+            r.execute_command('TS.CREATE', key + '_sum')
+            r.execute_command('TS.CREATERULE', key, key + '_sum', 'AGGREGATION', 'sum', 10)
+            for ts in range(1, 1001):
+                r.execute_command('TS.ADD', key, ts, ts % 13)
+            filter_ts = list(range(3, 1001, 7))
+            for start, end in [('-', '+'), (5, 900), (995, '+'), (1001, '+')]:
+                for extra in [[], ['FILTER_BY_VALUE', 2, 8], ['FILTER_BY_TS'] + filter_ts,
+                              ['FILTER_BY_TS'] + filter_ts + ['FILTER_BY_VALUE', 5, 12]]:
+                    query = [key, start, end] + extra
+                    full = r.execute_command('TS.RANGE', *query)
+                    full_rev = r.execute_command('TS.REVRANGE', *query)
+                    for count in [1, 3, 20, 57, 500, 2000]:
+                        assert r.execute_command('TS.RANGE', *query, 'COUNT', count) == full[:count]
+                        assert r.execute_command('TS.REVRANGE', *query, 'COUNT', count) == \
+                            full_rev[:count]
+
+            # the LATEST sample counts against COUNT too
+            full = r.execute_command('TS.RANGE', key + '_sum', '-', '+', 'LATEST')
+            full_rev = r.execute_command('TS.REVRANGE', key + '_sum', '-', '+', 'LATEST')
+            for count in [1, 2, len(full) - 1, len(full), len(full) + 1]:
+                assert r.execute_command('TS.RANGE', key + '_sum', '-', '+', 'LATEST', 'COUNT', count) == \
+                    full[:count]
+                assert r.execute_command('TS.REVRANGE', key + '_sum', '-', '+', 'LATEST', 'COUNT', count) == \
+                    full_rev[:count]
+
+
+def test_range_filter_by_value_matches_scan():
+    with Env().getClusterConnectionIfNeeded() as r:
+        for encoding in ['COMPRESSED', 'UNCOMPRESSED']:
+            key = 'filter_value_{}{{a}}'.format(encoding)
+            r.execute_command('TS.CREATE', key, 'ENCODING', encoding, 'CHUNK_SIZE', 256)
+            rnd = random.Random(39)
+            samples = []
+            for i in range(3000):
+                value = 'nan' if i % 41 == 0 else rnd.randint(-200, 200) / 4
+                r.execute_command('TS.ADD', key, 1000 + i, value)
+                samples.append((1000 + i, float(value)))
+            for low, high in [(-10, 10), (0, 0), (3.5, 7.25), (60, 100), (-1000, 1000), (5, -5)]:
+                expected = [[ts, v] for ts, v in samples if low <= v <= high]
+                res = r.execute_command('TS.RANGE', key, '-', '+', 'FILTER_BY_VALUE', low, high)
+                assert [[ts, float(v)] for ts, v in res] == expected
+                res = r.execute_command('TS.REVRANGE', key, 1500, 3500, 'FILTER_BY_VALUE', low, high,
+                                        'COUNT', 25)
+                assert [[ts, float(v)] for ts, v in res] == \
+                    [s for s in expected if 1500 <= s[0] <= 3500][::-1][:25]
+
+
+def test_range_filter_by_ts_large():
+    with Env().getClusterConnectionIfNeeded() as r:
+        for encoding in ['COMPRESSED', 'UNCOMPRESSED']:
+            key = 'filter_ts_{}{{a}}'.format(encoding)
+            r.execute_command('TS.CREATE', key, 'ENCODING', encoding, 'CHUNK_SIZE', 128)
+            samples = {}
+            for i in range(5000):
+                ts = 1000 + i * 3
+                samples[ts] = i % 17
+                r.execute_command('TS.ADD', key, ts, samples[ts])
+
+            # unsorted, duplicated and partly outside of the series, most of the chunks have no
+            # candidate at all
+            rnd = random.Random(38)
+            filter_ts = [rnd.randrange(0, 30000) for _ in range(3000)] + list(range(9000, 9300))
+            rnd.shuffle(filter_ts)
+            packed = struct.pack('<%dQ' % len(filter_ts), *filter_ts)
+
+            def expected(start, end):
+                return [[ts, str(samples[ts]).encode()] for ts in sorted(set(filter_ts))
+                        if ts in samples and start <= ts <= end]
+
+            for start, end in [(0, 100000), (5000, 12000), (9100, 9101), (20000, 30000)]:
+                exp = expected(start, end)
+                by_ts = r.execute_command('TS.RANGE', key, start, end, 'FILTER_BY_TS', *filter_ts)
+                assert by_ts == exp
+                assert r.execute_command('TS.RANGE', key, start, end, 'FILTER_BY_TS_PACKED', packed) == exp
+                assert r.execute_command('TS.REVRANGE', key, start, end,
+                                         'FILTER_BY_TS_PACKED', packed) == exp[::-1]
+                assert r.execute_command('TS.RANGE', key, start, end, 'FILTER_BY_TS_PACKED', packed,
+                                         'COUNT', 10) == exp[:10]
+                assert r.execute_command('TS.REVRANGE', key, start, end, 'FILTER_BY_TS_PACKED', packed,
+                                         'COUNT', 10) == exp[::-1][:10]
+                # both forms are merged
+                half = len(filter_ts) // 2
+                assert r.execute_command('TS.RANGE', key, start, end, 'FILTER_BY_TS', *filter_ts[:half],
+                                         'FILTER_BY_TS_PACKED', packed[half * 8:]) == exp
+                res = r.execute_command('TS.RANGE', key, start, end, 'FILTER_BY_TS_PACKED', packed,
+                                        'AGGREGATION', 'count', 1000)
+                assert res == r.execute_command('TS.RANGE', key, start, end, 'FILTER_BY_TS', *filter_ts,
+                                                'AGGREGATION', 'count', 1000)
+                assert sum(int(s[1]) for s in res) == len(exp)
+
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('TS.RANGE', key, '-', '+', 'FILTER_BY_TS_PACKED', packed[:-1])
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('TS.RANGE', key, '-', '+', 'FILTER_BY_TS_PACKED')
+            with pytest.raises(redis.ResponseError):
+                r.execute_command('TS.RANGE', key, '-', '+', 'FILTER_BY_TS_PACKED', '')
+
+        r.execute_command('TS.CREATE', 'filter_ts_m{a}', 'LABELS', 'filter_ts', 'yes')
+        for ts in range(100, 2000, 5):
+            r.execute_command('TS.ADD', 'filter_ts_m{a}', ts, ts)
+        packed = struct.pack('<3Q', 105, 1000, 7)
+        res = r.execute_command('TS.MRANGE', '-', '+', 'FILTER_BY_TS_PACKED', packed, 'FILTER', 'filter_ts=yes')
+        assert res == [[b'filter_ts_m{a}', [], [[105, b'105'], [1000, b'1000']]]]
+
+
 def test_agg_min():
     with Env().getClusterConnectionIfNeeded() as r:
         agg_key = _insert_agg_data(r, 'tester{a}', 'min')
@@ -0,0 +1,111 @@
+import pytest
+import redis
+from includes import *
+
+
+QUERIES = [
+    ['ts.range', 'cpu:0', '-', '+'],
+    ['ts.range', 'cpu:0', 1500, 4200, 'COUNT', 10],
+    ['ts.revrange', 'cpu:1', '-', '+', 'AGGREGATION', 'avg', 100],
+    ['ts.range', 'cpu:2', '-', '+', 'FILTER_BY_VALUE', 10, 20, 'AGGREGATION', 'max', 250, 'EMPTY'],
+    ['ts.range', 'cpu:0_sum', '-', '+', 'LATEST'],
+    ['ts.revrange', 'cpu:0_sum', '-', '+', 'LATEST'],
+    ['ts.range', 'retention', '-', '+'],
+    ['ts.mrange', '-', '+', 'FILTER', 'metric=cpu'],
+    ['ts.mrange', 1000, 3000, 'WITHLABELS', 'FILTER', 'metric=cpu', 'AGGREGATION', 'sum', 500],
+    ['ts.mrevrange', '-', '+', 'SELECTED_LABELS', 'host', 'COUNT', 5, 'FILTER', 'metric=cpu'],
+    ['ts.mrange', '-', '+', 'FILTER', 'metric=cpu', 'GROUPBY', 'host', 'REDUCE', 'max'],
+    ['ts.mrange', 9000, '+', 'EXCLUDEEMPTY', 'FILTER', 'metric=cpu'],
+    ['ts.mrange', '-', '+', 'LATEST', 'WITHLABELS', 'FILTER', 'metric=cpu_sum'],
+    ['ts.mrange', '-', '+', 'FILTER', 'metric=missing'],
+]
+
+
+def fill(r):
+    r.execute_command('FLUSHALL')
+    for i in range(3):
+        r.execute_command('ts.create', 'cpu:{}'.format(i), 'CHUNK_SIZE', 64,
+                          'LABELS', 'metric', 'cpu', 'host', 'h{}'.format(i % 2))
+    r.execute_command('ts.create', 'cpu:0_sum', 'LABELS', 'metric', 'cpu_sum')
+    r.execute_command('ts.createrule', 'cpu:0', 'cpu:0_sum', 'AGGREGATION', 'sum', 1000)
+    r.execute_command('ts.create', 'retention', 'RETENTION', 1000)
+    for ts in range(1000, 5000, 10):
+        for i in range(3):
+            r.execute_command('ts.add', 'cpu:{}'.format(i), ts, (ts // 10 + i) % 30)
+        r.execute_command('ts.add', 'retention', ts, ts)
+
+
+def test_offload_same_results():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        fill(r)
+        expected = [r.execute_command(*query) for query in QUERIES]
+
+        r.execute_command('CONFIG', 'SET', 'ts-read-offload', 'range,revrange,mrange,mrevrange')
+        r.execute_command('CONFIG', 'SET', 'ts-read-threads', 2)
+        try:
+            for query, result in zip(QUERIES, expected):
+                assert r.execute_command(*query) == result, query
+
+            # commands that can't block run on the main thread
+            pipe = r.pipeline(transaction=True)
+            for query in QUERIES:
+                pipe.execute_command(*query)
+            assert pipe.execute() == expected
+            assert r.eval("return redis.call('ts.mrange', '-', '+', 'FILTER', 'metric=cpu')", 0) == expected[7]
+        finally:
+            r.execute_command('CONFIG', 'SET', 'ts-read-threads', 0)
+            r.execute_command('CONFIG', 'SET', 'ts-read-offload', 'mrange,mrevrange')
+
+
+def test_offload_concurrent_writes():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        fill(r)
+        r.execute_command('CONFIG', 'SET', 'ts-read-threads', 2)
+        try:
+            for ts in range(5000, 6000, 10):
+                r.execute_command('ts.add', 'cpu:0', ts, 1)
+                res = r.execute_command('ts.mrange', ts, '+', 'FILTER', 'host=h0')
+                assert [x[0] for x in res] == [b'cpu:0', b'cpu:2']
+                assert res[0][2] == [[ts, b'1']]
+                assert res[1][2] == []
+        finally:
+            r.execute_command('CONFIG', 'SET', 'ts-read-threads', 0)
+
+
+def test_offload_config():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        assert r.execute_command('CONFIG', 'GET', 'ts-read-offload') == [b'ts-read-offload', b'mrange,mrevrange']
+        r.execute_command('CONFIG', 'SET', 'ts-read-offload', 'REVRANGE, range')
+        assert r.execute_command('CONFIG', 'GET', 'ts-read-offload')[1] == b'range,revrange'
+        r.execute_command('CONFIG', 'SET', 'ts-read-offload', '')
+        assert r.execute_command('CONFIG', 'GET', 'ts-read-offload')[1] == b''
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('CONFIG', 'SET', 'ts-read-offload', 'mrange,mget')
+        assert r.execute_command('CONFIG', 'GET', 'ts-read-offload')[1] == b''
+        r.execute_command('CONFIG', 'SET', 'ts-read-offload', 'mrange,mrevrange')
+
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('CONFIG', 'SET', 'ts-read-threads', 17)
+
+        # the pool starts on the first offloaded command and can't be resized afterwards
+        r.execute_command('CONFIG', 'SET', 'ts-read-threads', 2)
+        r.execute_command('ts.create', 'config_test', 'LABELS', 'config', 'test')
+        assert r.execute_command('ts.mrange', '-', '+', 'FILTER', 'config=test') == [[b'config_test', [], []]]
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('CONFIG', 'SET', 'ts-read-threads', 3)
+        r.execute_command('CONFIG', 'SET', 'ts-read-threads', 0)
+        r.execute_command('CONFIG', 'SET', 'ts-read-threads', 2)
+        r.execute_command('CONFIG', 'SET', 'ts-read-threads', 0)
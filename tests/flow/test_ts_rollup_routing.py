@@ -0,0 +1,173 @@
+from includes import *
+
+
+RULES = [('sum', 100, 0), ('min', 100, 0), ('max', 50, 0), ('count', 100, 0), ('first', 100, 0),
+         ('last', 100, 0), ('sum', 500, 0), ('max', 100, 30), ('avg', 100, 0), ('std.s', 200, 0),
+         ('twa', 100, 0)]
+
+
+def fill(r):
+    r.execute_command('FLUSHALL')
+    r.execute_command('TS.CREATE', 'rollup{a}', 'CHUNK_SIZE', 128, 'LABELS', 'type', 'raw')
+    r.execute_command('TS.CREATE', 'rollup_ret{a}', 'RETENTION', 3000, 'LABELS', 'type', 'raw')
+    for key in ['rollup{a}', 'rollup_ret{a}']:
+        for agg, bucket, align in RULES:
+            dest = '{}_{}_{}_{}{{a}}'.format(key[:-3], agg, bucket, align)
+            r.execute_command('TS.CREATE', dest)
+            r.execute_command('TS.CREATERULE', key, dest, 'AGGREGATION', agg, bucket, align)
+    for i in range(2500):
+        ts = 1000 + i * 7
+        if i % 89 == 0 or 700 <= i < 730:
+            value = 'nan'
+        else:
+            value = (i * 37) % 101 - 50
+        r.execute_command('TS.ADD', 'rollup{a}', ts, value)
+        r.execute_command('TS.ADD', 'rollup_ret{a}', ts, value)
+
+
+def queries():
+    for key in ['rollup{a}', 'rollup_ret{a}']:
+        for agg in ['sum', 'min', 'max', 'count', 'first', 'last', 'avg', 'std.s', 'twa']:
+            for start, end, bucket in [('-', '+', 100), ('-', '+', 1000), (1003, 12345, 200),
+                                       (2000, 9999, 300), (1000, 18000, 600), (5000, 5100, 100)]:
+                for extra in [[], ['ALIGN', 'start'], ['ALIGN', 130], ['BUCKETTIMESTAMP', 'mid'],
+                              ['COUNT', 3]]:
+                    query = [key, start, end] + extra + ['AGGREGATION', agg, bucket]
+                    yield ['TS.RANGE'] + query
+                    yield ['TS.REVRANGE'] + query
+    yield ['TS.MRANGE', '-', '+', 'AGGREGATION', 'sum', 500, 'FILTER', 'type=raw']
+    yield ['TS.MREVRANGE', 2222, 15000, 'AGGREGATION', 'max', 1000, 'FILTER', 'type=raw']
+    yield ['TS.MRANGE', '-', '+', 'AGGREGATION', 'count', 200, 'FILTER', 'type=raw',
+           'GROUPBY', 'type', 'REDUCE', 'sum']
+
+
+def test_rollup_routing_same_results():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        fill(r)
+        assert r.execute_command('CONFIG', 'GET', 'ts-rollup-routing') == [b'ts-rollup-routing', b'no']
+        expected = [r.execute_command(*query) for query in queries()]
+
+        r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'yes')
+        try:
+            for query, result in zip(queries(), expected):
+                assert r.execute_command(*query) == result, query
+
+            # the unfinalized bucket of the rules is read from the raw series
+            r.execute_command('TS.ADD', 'rollup{a}', 18500, 1000)
+            r.execute_command('TS.ADD', 'rollup{a}', 18550, 'nan')
+            r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'no')
+            expected = r.execute_command('TS.RANGE', 'rollup{a}', '-', '+', 'AGGREGATION', 'sum', 100)
+            r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'yes')
+            assert r.execute_command('TS.RANGE', 'rollup{a}', '-', '+', 'AGGREGATION', 'sum', 100) == expected
+        finally:
+            r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'no')
+
+
+def test_rollup_routing_reads_rule_destination():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        fill(r)
+        # a value that differs from the raw samples proves which series answered
+        r.execute_command('TS.ADD', 'rollup_sum_100_0{a}', 3000, 1000000, 'ON_DUPLICATE', 'LAST')
+        r.execute_command('TS.ADD', 'rollup_sum_500_0{a}', 3000, 2000000, 'ON_DUPLICATE', 'LAST')
+        r.execute_command('TS.ADD', 'rollup_avg_100_0{a}', 3000, 3000000, 'ON_DUPLICATE', 'LAST')
+        r.execute_command('TS.ADD', 'rollup_twa_100_0{a}', 3000, 4000000, 'ON_DUPLICATE', 'LAST')
+        query = ['TS.RANGE', 'rollup{a}', 2000, 4999, 'AGGREGATION', 'sum', 1000]
+        unaligned = query[:4] + ['ALIGN', 50] + query[4:]
+        raw = r.execute_command(*query)
+        raw_unaligned = r.execute_command(*unaligned)
+
+        r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'yes')
+        try:
+            # the rule with the largest bucket duration wins
+            routed = r.execute_command(*query)
+            assert routed[0] == raw[0]
+            assert routed[1][0] == raw[1][0] and float(routed[1][1]) > 1990000
+            assert routed[2] == raw[2]
+
+            # a rule with the requested aggregator and bucket duration answers as is
+            avg = r.execute_command('TS.RANGE', 'rollup{a}', 3000, 3099, 'AGGREGATION', 'avg', 100)
+            assert avg == [[3000, b'3000000']]
+            # but not a TWA, its buckets depend on the samples around them
+            twa = r.execute_command('TS.RANGE', 'rollup{a}', 3000, 3099, 'AGGREGATION', 'twa', 100)
+            assert float(twa[0][1]) < 1000
+
+            # an unaligned query, or one the aggregator can't compose into, uses the raw series
+            assert r.execute_command(*unaligned) == raw_unaligned
+            res = r.execute_command('TS.RANGE', 'rollup{a}', 2000, 4999, 'AGGREGATION', 'avg', 1000)
+            assert all(float(s[1]) < 1000 for s in res)
+            res = r.execute_command('TS.RANGE', 'rollup{a}', 2000, 4999, 'FILTER_BY_VALUE', -1000,
+                                    1000, 'AGGREGATION', 'sum', 1000)
+            assert res == raw
+        finally:
+            r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'no')
+
+
+def test_rollup_routing_rule_on_existing_samples():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('TS.CREATE', 'late{a}')
+        for ts in range(0, 10000, 10):
+            r.execute_command('TS.ADD', 'late{a}', ts, ts % 7)
+        r.execute_command('TS.CREATE', 'late_sum{a}')
+        r.execute_command('TS.CREATERULE', 'late{a}', 'late_sum{a}', 'AGGREGATION', 'sum', 100)
+        for ts in range(10000, 12000, 10):
+            r.execute_command('TS.ADD', 'late{a}', ts, ts % 7)
+        expected = r.execute_command('TS.RANGE', 'late{a}', '-', '+', 'AGGREGATION', 'sum', 500)
+
+        r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'yes')
+        try:
+            # the destination lacks the buckets before the rule was created
+            assert r.execute_command('TS.RANGE', 'late{a}', '-', '+', 'AGGREGATION', 'sum', 500) == expected
+            assert r.execute_command('TS.RANGE', 'late{a}', 10000, '+', 'AGGREGATION', 'sum', 500) == \
+                expected[20:]
+        finally:
+            r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'no')
+
+
+def test_rollup_routing_client_db_and_acl():
+    env = Env()
+    if is_redis_version_lower_than(env, '7.0') or env.isCluster():
+        env.skip()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        # the same keys in two dbs, each destination holds a value that tells which one answered
+        for db, marker in [(0, 1000000), (1, 2000000)]:
+            r.execute_command('SELECT', db)
+            r.execute_command('TS.CREATE', 'raw{a}')
+            r.execute_command('TS.CREATE', 'sum{a}')
+            r.execute_command('TS.CREATERULE', 'raw{a}', 'sum{a}', 'AGGREGATION', 'sum', 100)
+            for ts in range(0, 2000, 10):
+                r.execute_command('TS.ADD', 'raw{a}', ts, db + 1)
+            r.execute_command('TS.ADD', 'sum{a}', 500, marker, 'ON_DUPLICATE', 'LAST')
+        query = ['TS.RANGE', 'raw{a}', 500, 599, 'AGGREGATION', 'sum', 100]
+
+        r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'yes')
+        try:
+            # the destination is read from the client's db
+            assert r.execute_command(*query) == [[500, b'2000000']]
+            r.execute_command('SELECT', 0)
+            assert r.execute_command(*query) == [[500, b'1000000']]
+
+            # a destination the user can't read isn't used
+            r.execute_command('ACL', 'SETUSER', 'rollup_user', 'on', '>pass', '~raw*', '+@all')
+            try:
+                with env.getConnection() as r2:
+                    r2.execute_command('AUTH', 'rollup_user', 'pass')
+                    assert r2.execute_command(*query) == [[500, b'10']]
+            finally:
+                r.execute_command('ACL', 'DELUSER', 'rollup_user')
+        finally:
+            r.execute_command('CONFIG', 'SET', 'ts-rollup-routing', 'no')
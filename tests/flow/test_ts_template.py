@@ -0,0 +1,134 @@
+import pytest
+import redis
+from test_helper_classes import TSInfo, _get_ts_info
+from includes import *
+
+
+def test_template_create_series():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        assert r.execute_command('ts.template.create', 'sensor', 'RETENTION', 5000, 'ENCODING', 'UNCOMPRESSED',
+                                 'CHUNK_SIZE', 128, 'DUPLICATE_POLICY', 'LAST',
+                                 'RULES', 'max:1s:1m;avg:10s:1h', 'LABELS', 'type', 'sensor')
+        assert r.execute_command('ts.add', 'dev1', 1000, 1, 'TEMPLATE', 'sensor', 'LABELS', 'host', 'h1') == 1000
+        assert r.execute_command('ts.add', 'dev1', 1000, 2) == 1000
+
+        info = _get_ts_info(r, 'dev1')
+        assert info.retention_msecs == 5000
+        assert info.chunk_type == b'uncompressed'
+        assert info.chunk_size_bytes == 128
+        assert info.labels == {b'type': b'sensor', b'host': b'h1'}
+        assert info.rules == [[b'dev1_MAX_1000', 1000, b'MAX', 0], [b'dev1_AVG_10000', 10000, b'AVG', 0]]
+        assert r.execute_command('ts.get', 'dev1') == [1000, b'2']
+
+        info = _get_ts_info(r, 'dev1_MAX_1000')
+        assert info.retention_msecs == 60000
+        assert info.sourceKey == b'dev1'
+        assert info.labels == {b'type': b'sensor', b'host': b'h1', b'aggregation': b'MAX', b'time_bucket': b'1000'}
+        assert r.execute_command('ts.queryindex', 'host=h1', 'aggregation=AVG') == [b'dev1_AVG_10000']
+
+        # series created from the same template don't share their labels
+        r.execute_command('ts.add', 'dev2', 1000, 1, 'TEMPLATE', 'sensor', 'LABELS', 'host', 'h2')
+        assert r.execute_command('ts.queryindex', 'type=sensor', 'aggregation=') == [b'dev1', b'dev2']
+        assert _get_ts_info(r, 'dev2').labels == {b'type': b'sensor', b'host': b'h2'}
+
+
+def test_template_existing_series():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'tmpl_existing', 'RETENTION', 5000, 'RULES', '')
+        r.execute_command('ts.create', 'existing')
+        # the template only applies when the series is created
+        r.execute_command('ts.add', 'existing', 1000, 1, 'TEMPLATE', 'tmpl_existing')
+        assert _get_ts_info(r, 'existing').retention_msecs == 0
+        r.execute_command('ts.add', 'new', 1000, 1, 'TEMPLATE', 'tmpl_existing')
+        info = _get_ts_info(r, 'new')
+        assert info.retention_msecs == 5000
+        assert info.rules == []
+
+
+def test_template_default_rules():
+    env = Env(moduleArgs='COMPACTION_POLICY max:1s:1m')
+    env.skipOnCluster()
+    skip_on_rlec()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'tmpl_default', 'LABELS', 'a', 'b')
+        r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE', 'tmpl_default')
+        assert _get_ts_info(r, 't1').rules == [[b't1_MAX_1000', 1000, b'MAX', 0]]
+        assert _get_ts_info(r, 't1_MAX_1000').labels == {b'a': b'b', b'aggregation': b'MAX', b'time_bucket': b'1000'}
+
+
+def test_template_del():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'tmpl_del', 'RULES', 'sum:1s:1m', 'LABELS', 'a', 'b')
+        r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE', 'tmpl_del')
+        assert r.execute_command('ts.template.del', 'tmpl_del')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.del', 'tmpl_del')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.add', 't2', 1000, 1, 'TEMPLATE', 'tmpl_del')
+        assert r.execute_command('exists', 't2') == 0
+
+        # the series keep the labels they got from the deleted template
+        assert _get_ts_info(r, 't1').labels == {b'a': b'b'}
+        assert _get_ts_info(r, 't1_SUM_1000').labels == {b'a': b'b', b'aggregation': b'SUM', b'time_bucket': b'1000'}
+        r.execute_command('ts.template.create', 'tmpl_del', 'LABELS', 'a', 'c')
+        r.execute_command('ts.add', 't2', 1000, 1, 'TEMPLATE', 'tmpl_del')
+        assert _get_ts_info(r, 't2').labels == {b'a': b'c'}
+
+
+def test_template_errors():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'tmpl_errors')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.create', 'tmpl_errors')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.create')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.create', 'bad', 'RULES', 'max:1s')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.create', 'bad', 'RULES')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.create', 'bad', 'RETENTION', -1)
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE', 'missing')
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE', 'tmpl_errors', 'LABELS', 'a', '')
+        # RULES after LABELS is a label
+        r.execute_command('ts.template.create', 'labeled', 'LABELS', 'RULES', 'x')
+        r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE', 'labeled')
+        assert _get_ts_info(r, 't1').labels == {b'RULES': b'x'}
+
+
+def test_template_rdb():
+    env = Env()
+    env.skipOnCluster()
+    with env.getConnection() as r:
+        r.execute_command('FLUSHALL')
+        r.execute_command('ts.template.create', 'tmpl_rdb', 'RETENTION', 5000, 'DUPLICATE_POLICY', 'SUM',
+                          'RULES', 'min:1s:1m', 'LABELS', 'a', 'b')
+        r.execute_command('ts.add', 't1', 1000, 1, 'TEMPLATE', 'tmpl_rdb', 'LABELS', 'c', 'd')
+        env.dumpAndReload()
+        with pytest.raises(redis.ResponseError):
+            r.execute_command('ts.template.create', 'tmpl_rdb')
+        r.execute_command('ts.add', 't2', 1000, 1, 'TEMPLATE', 'tmpl_rdb', 'LABELS', 'c', 'e')
+        r.execute_command('ts.add', 't2', 1000, 2)
+        assert r.execute_command('ts.get', 't2') == [1000, b'3']
+        info = _get_ts_info(r, 't2')
+        assert info.retention_msecs == 5000
+        assert info.labels == {b'a': b'b', b'c': b'e'}
+        assert info.rules == [[b't2_MIN_1000', 1000, b'MIN', 0]]
+        assert _get_ts_info(r, 't1').labels == {b'a': b'b', b'c': b'd'}
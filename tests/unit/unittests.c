@@ -12,9 +12,14 @@
 #include "minunit.h"
 
 #include "parse_policies.h"
+#include "unittests_compaction_vec.c"
 #include "unittests_compressed_chunk.c"
+#include "unittests_filter_by_ts.c"
+#include "unittests_filter_by_value.c"
 #include "unittests_parse_duplicate_policy.c"
 #include "unittests_parse_policies.c"
+#include "unittests_query_arena.c"
+#include "unittests_roaring.c"
 #include "unittests_uncompressed_chunk.c"
 #include "unittests_cmd_info.c"
 #include "unittests_rdb_load_oom.c"
@@ -32,6 +37,11 @@ int main(int argc, char *argv[]) {
     MU_RUN_SUITE(parse_duplicate_policy_test_suite);
     MU_RUN_SUITE(command_info_test_suite);
     MU_RUN_SUITE(rdb_load_oom_test_suite);
+    MU_RUN_SUITE(compaction_vec_test_suite);
+    MU_RUN_SUITE(filter_by_ts_test_suite);
+    MU_RUN_SUITE(filter_by_value_test_suite);
+    MU_RUN_SUITE(query_arena_test_suite);
+    MU_RUN_SUITE(roaring_test_suite);
     MU_REPORT();
     return minunit_fail;
 }
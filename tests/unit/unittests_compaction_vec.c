@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "compaction.h"
+#include "compactions/compaction_avx2.h"
+#include "compactions/compaction_common.h"
+#include "compactions/compaction_neon.h"
+#include "minunit.h"
+#include "utils/arch_features.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define VEC_TEST_MAX_SAMPLES 300
+
+static const TS_AGG_TYPES_T vecAggTypes[] = {
+    TS_AGG_MIN,   TS_AGG_MAX,   TS_AGG_RANGE, TS_AGG_SUM,   TS_AGG_AVG,       TS_AGG_STD_P,
+    TS_AGG_STD_S, TS_AGG_VAR_P, TS_AGG_VAR_S, TS_AGG_COUNT, TS_AGG_COUNT_NAN, TS_AGG_COUNT_ALL,
+};
+
+static bool vec_results_equal(double scalar, double vec) {
+    if (isnan(scalar) || isnan(vec)) {
+        return isnan(scalar) && isnan(vec);
+    }
+    // lane-parallel sums may round differently than the sequential scalar sum
+    return scalar == vec || fabs(scalar - vec) <= 1e-9 * fmax(1, fabs(scalar));
+}
+
+// Appends values[si..ei] once with appendValue and once with appendVec, compares the finalized
+// results
+static void check_vec_against_scalar(AggregationClass *aggClass,
+                                     void (*appendVec)(void *__restrict__,
+                                                       double *__restrict__,
+                                                       size_t,
+                                                       size_t),
+                                     double *values,
+                                     size_t si,
+                                     size_t ei) {
+    void *scalarContext = aggClass->createContext(false);
+    void *vecContext = aggClass->createContext(false);
+    for (size_t i = si; i <= ei; i++) {
+        if (aggClass->isValueValid(values[i])) {
+            aggClass->appendValue(scalarContext, values[i], i);
+        }
+    }
+    appendVec(vecContext, values, si, ei);
+
+    double scalarResult, vecResult;
+    aggClass->finalize(scalarContext, &scalarResult);
+    aggClass->finalize(vecContext, &vecResult);
+    mu_assert(vec_results_equal(scalarResult, vecResult), AggTypeEnumToString(aggClass->type));
+
+    aggClass->freeContext(scalarContext);
+    aggClass->freeContext(vecContext);
+}
+
+// random values with ~10% NaN, values[0] is never NaN so AVG always has a sample
+static void fill_values(double *values, size_t n, double scale) {
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && rand() % 10 == 0) {
+            values[i] = NAN;
+        } else {
+            values[i] = ((double)rand() / RAND_MAX - 0.5) * scale;
+        }
+    }
+}
+
+// Runs the appendValueVec kernels picked by initGlobalCompactionFunctions against appendValue
+static void check_dispatched_kernels(void) {
+    double values[VEC_TEST_MAX_SAMPLES];
+    for (size_t t = 0; t < sizeof(vecAggTypes) / sizeof(vecAggTypes[0]); t++) {
+        AggregationClass *aggClass = GetAggClass(vecAggTypes[t]);
+        mu_check(aggClass->appendValueVec != NULL);
+        for (size_t iter = 0; iter < 200; iter++) {
+            const size_t n = 1 + rand() % VEC_TEST_MAX_SAMPLES;
+            fill_values(values, n, iter % 2 ? 1000 : 1e-3);
+            // unaligned starts and tails shorter than a vector
+            const size_t si = rand() % min(n, 7);
+            check_vec_against_scalar(aggClass, aggClass->appendValueVec, values, 0, n - 1);
+            check_vec_against_scalar(aggClass, aggClass->appendValueVec, values, si, n - 1);
+        }
+    }
+}
+
+MU_TEST(test_appendValueVec_matches_appendValue) {
+    srand(42);
+    initGlobalCompactionFunctions();
+    check_dispatched_kernels();
+}
+
+// Forces each instruction set the build has kernels for. The ones the CPU lacks fall back to the
+// portable kernels, run the suite under QEMU (e.g. qemu-aarch64 -cpu max) to cover them all.
+MU_TEST(test_appendValueVec_each_isa) {
+    const int isas[] = { 0, ARCH_ISA_AVX2, ARCH_ISA_NEON };
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+        srand(42);
+        restrictArchitectureOptimization(isas[i]);
+        initGlobalCompactionFunctions();
+        void (*expectedMax)(void *__restrict__, double *__restrict__, size_t, size_t) =
+            MaxAppendValuesVec;
+#if defined(__x86_64__)
+        const X86Features *features = getArchitectureOptimization();
+        if (features && features->avx2) {
+            expectedMax = MaxAppendValuesAVX2;
+        }
+#elif defined(__aarch64__)
+        const Aarch64Features *features = getAarch64ArchitectureOptimization();
+        if (features && features->asimd) {
+            expectedMax = MaxAppendValuesNEON;
+        }
+#endif
+        mu_check(GetAggClass(TS_AGG_MAX)->appendValueVec == expectedMax);
+        check_dispatched_kernels();
+    }
+    restrictArchitectureOptimization(ARCH_ISA_ALL);
+    initGlobalCompactionFunctions();
+}
+
+MU_TEST(test_appendValueVec_portable_matches_appendValue) {
+    srand(7);
+    initGlobalCompactionFunctions();
+    double values[VEC_TEST_MAX_SAMPLES];
+    struct
+    {
+        TS_AGG_TYPES_T type;
+        void (*appendVec)(void *__restrict__, double *__restrict__, size_t, size_t);
+    } portable[] = {
+        { TS_AGG_MIN, MinAppendValuesVec },
+        { TS_AGG_MAX, MaxAppendValuesVec },
+        { TS_AGG_RANGE, RangeAppendValuesVec },
+        { TS_AGG_SUM, SumAppendValuesVec },
+        { TS_AGG_AVG, AvgAppendValuesVec },
+        { TS_AGG_STD_S, StdAppendValuesVec },
+        { TS_AGG_COUNT, CountAppendValuesVec },
+        { TS_AGG_COUNT_NAN, CountNaNAppendValuesVec },
+        { TS_AGG_COUNT_ALL, CountAllAppendValuesVec },
+    };
+    for (size_t t = 0; t < sizeof(portable) / sizeof(portable[0]); t++) {
+        AggregationClass *aggClass = GetAggClass(portable[t].type);
+        for (size_t iter = 0; iter < 50; iter++) {
+            const size_t n = 1 + rand() % VEC_TEST_MAX_SAMPLES;
+            fill_values(values, n, 1000);
+            check_vec_against_scalar(aggClass, portable[t].appendVec, values, 0, n - 1);
+        }
+    }
+}
+
+MU_TEST(test_appendValueVec_avg_overflow) {
+    initGlobalCompactionFunctions();
+    AggregationClass *aggClass = GetAggClass(TS_AGG_AVG);
+    double values[64];
+    for (size_t i = 0; i < 64; i++) {
+        values[i] = (i % 3 == 0) ? -DBL_MAX / 2 : DBL_MAX / 2;
+    }
+    values[5] = NAN;
+    // the scalar code switches to the running average on overflow, the vector code must too
+    check_vec_against_scalar(aggClass, aggClass->appendValueVec, values, 0, 63);
+    check_vec_against_scalar(aggClass, aggClass->appendValueVec, values, 1, 40);
+}
+
+MU_TEST(test_appendValueVec_nan_only) {
+    initGlobalCompactionFunctions();
+    double values[32];
+    for (size_t i = 0; i < 32; i++) {
+        values[i] = NAN;
+    }
+    const TS_AGG_TYPES_T types[] = { TS_AGG_SUM, TS_AGG_COUNT, TS_AGG_COUNT_NAN, TS_AGG_COUNT_ALL };
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        AggregationClass *aggClass = GetAggClass(types[t]);
+        check_vec_against_scalar(aggClass, aggClass->appendValueVec, values, 0, 31);
+    }
+}
+
+MU_TEST_SUITE(compaction_vec_test_suite) {
+    MU_RUN_TEST(test_appendValueVec_matches_appendValue);
+    MU_RUN_TEST(test_appendValueVec_each_isa);
+    MU_RUN_TEST(test_appendValueVec_portable_matches_appendValue);
+    MU_RUN_TEST(test_appendValueVec_avg_overflow);
+    MU_RUN_TEST(test_appendValueVec_nan_only);
+}
@@ -8,6 +8,8 @@
  */
 #include "compaction.h"
 #include "compressed_chunk.h"
+#include "enriched_chunk.h"
+#include "generic_chunk.h"
 #include "gorilla.h"
 #include "minunit.h"
 #include "parse_policies.h"
@@ -45,6 +47,72 @@ MU_TEST(test_compressed_upsert) {
     }
 }
 
+MU_TEST(test_compressed_upsert_samples) {
+    srand((unsigned int)time(NULL));
+    CompressedChunk *chunk = Compressed_NewChunk(128);
+    CompressedChunk *expected = Compressed_NewChunk(128);
+    int size = 0;
+    // even timestamps are appended, odd ones are merged as one batch
+    for (size_t ts = 0; ts < 1000; ts += 2) {
+        Sample sample = { .timestamp = ts, .value = ts };
+        UpsertCtx uCtx = { .inChunk = chunk, .sample = sample };
+        Compressed_UpsertSample(&uCtx, &size, DP_LAST);
+        uCtx.inChunk = expected;
+        Compressed_UpsertSample(&uCtx, &size, DP_LAST);
+    }
+    Sample batch[501];
+    ChunkResult results[501];
+    for (size_t i = 0; i < 500; i++) {
+        batch[i] = (Sample){ .timestamp = i * 2 + 1, .value = rand() % 100 };
+        UpsertCtx uCtx = { .inChunk = expected, .sample = batch[i] };
+        Compressed_UpsertSample(&uCtx, &size, DP_LAST);
+    }
+    // overwrite of an existing sample
+    batch[500] = (Sample){ .timestamp = 10, .value = -1 };
+    UpsertCtx uCtx = { .inChunk = expected, .sample = batch[500] };
+    Compressed_UpsertSample(&uCtx, &size, DP_LAST);
+
+    UpsertBatchCtx bCtx = { .samples = batch, .results = results, .count = 500, .inChunk = chunk };
+    mu_assert(Compressed_UpsertSamples(&bCtx, &size, DP_LAST) == CR_OK, "upsert samples");
+    mu_assert_int_eq(500, size);
+    bCtx.samples = &batch[500];
+    bCtx.results = &results[500];
+    bCtx.count = 1;
+    mu_assert(Compressed_UpsertSamples(&bCtx, &size, DP_LAST) == CR_OK, "upsert samples");
+    mu_assert_int_eq(0, size);
+    mu_assert(results[500] == CR_OK, "duplicate replaced");
+
+    mu_assert_int_eq(1000, Compressed_ChunkNumOfSample(chunk));
+    ChunkIter_t *iter = Compressed_NewChunkIterator(chunk);
+    ChunkIter_t *expectedIter = Compressed_NewChunkIterator(expected);
+    Sample s1, s2;
+    while (Compressed_ChunkIteratorGetNext(expectedIter, &s2) == CR_OK) {
+        mu_assert(Compressed_ChunkIteratorGetNext(iter, &s1) == CR_OK, "same sample count");
+        mu_assert_int_eq(s2.timestamp, s1.timestamp);
+        mu_assert_double_eq(s2.value, s1.value);
+    }
+    Compressed_FreeChunkIterator(iter);
+    Compressed_FreeChunkIterator(expectedIter);
+
+    // DP_BLOCK rejects both the duplicate of the chunk and the one inside the batch
+    const Sample blocked[] = { { .timestamp = 4, .value = 1 },
+                               { .timestamp = 2000, .value = 1 },
+                               { .timestamp = 2000, .value = 2 } };
+    bCtx.samples = blocked;
+    bCtx.results = results;
+    bCtx.count = 3;
+    mu_assert(Compressed_UpsertSamples(&bCtx, &size, DP_BLOCK) == CR_OK, "upsert samples");
+    mu_assert_int_eq(1, size);
+    mu_assert(results[0] == CR_ERR, "duplicate of chunk blocked");
+    mu_assert(results[1] == CR_OK, "new sample");
+    mu_assert(results[2] == CR_ERR, "duplicate inside the batch blocked");
+    mu_assert_int_eq(2000, Compressed_GetLastTimestamp(chunk));
+    mu_assert_double_eq(1, Compressed_GetLastValue(chunk));
+
+    Compressed_FreeChunk(chunk);
+    Compressed_FreeChunk(expected);
+}
+
 MU_TEST(test_compressed_fail_appendInteger) {
     // either Compressed_UpsertSample or Compressed_SplitChunk
     // ensureAddSample -> Compressed_AddSample -> Compressed_Append -> appendInteger
@@ -261,11 +329,52 @@ MU_TEST(test_nan_mixed_compression) {
     Compressed_FreeChunk(chunk_varying);
 }
 
+// A limited ProcessChunk returns the first samples of the unlimited one, in either direction
+MU_TEST(test_ProcessChunk_limit) {
+    const CHUNK_TYPES_T chunkTypes[] = { CHUNK_REGULAR, CHUNK_COMPRESSED };
+    const size_t limits[] = { 1, 3, 4, 5, 7, 100, 499, 500, 600, SIZE_MAX };
+    const uint64_t ranges[][2] = { { 0, 4990 }, { 15, 3000 }, { 2000, 2000 }, { 4000, 10000 } };
+    const size_t total_samples = 500;
+    EnrichedChunk *full = NewEnrichedChunk();
+    EnrichedChunk *limited = NewEnrichedChunk();
+    ReallocSamplesArray(&full->samples, total_samples);
+    ReallocSamplesArray(&limited->samples, total_samples);
+
+    for (size_t c = 0; c < sizeof(chunkTypes) / sizeof(chunkTypes[0]); c++) {
+        const ChunkFuncs *funcs = GetChunkClass(chunkTypes[c]);
+        Chunk_t *chunk = funcs->NewChunk(32 * total_samples);
+        for (size_t i = 0; i < total_samples; i++) {
+            Sample sample = { .timestamp = i * 10, .value = i % 7 ? i : NAN };
+            mu_assert(funcs->AddSample(chunk, &sample) == CR_OK, "add sample");
+        }
+        for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+            for (int reverse = 0; reverse <= 1; reverse++) {
+                funcs->ProcessChunk(chunk, ranges[r][0], ranges[r][1], SIZE_MAX, full, reverse);
+                for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+                    funcs->ProcessChunk(
+                        chunk, ranges[r][0], ranges[r][1], limits[l], limited, reverse);
+                    const size_t expected = min(limits[l], full->samples.num_samples);
+                    mu_assert_int_eq(expected, limited->samples.num_samples);
+                    for (size_t i = 0; i < expected; i++) {
+                        mu_assert_int_eq(full->samples.timestamps[i],
+                                         limited->samples.timestamps[i]);
+                    }
+                }
+            }
+        }
+        funcs->FreeChunk(chunk);
+    }
+    FreeEnrichedChunk(full);
+    FreeEnrichedChunk(limited);
+}
+
 MU_TEST_SUITE(compressed_chunk_test_suite) {
     MU_RUN_TEST(test_compressed_upsert);
+    MU_RUN_TEST(test_compressed_upsert_samples);
     MU_RUN_TEST(test_compressed_fail_appendInteger);
     MU_RUN_TEST(test_Compressed_SplitChunk_empty);
     MU_RUN_TEST(test_Compressed_SplitChunk_odd);
     MU_RUN_TEST(test_Compressed_SplitChunk_force_realloc);
     MU_RUN_TEST(test_nan_mixed_compression);
+    MU_RUN_TEST(test_ProcessChunk_limit);
 }
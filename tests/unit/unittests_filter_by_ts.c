@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "enriched_chunk.h"
+#include "filter_iterator.h"
+#include "minunit.h"
+
+#include <stdlib.h>
+
+#define FILTER_TEST_CHUNK_SAMPLES 64
+#define FILTER_TEST_CHUNKS 20
+
+// Yields the chunks of `timestamps` in ascending order, or descending order with ascending
+// samples like a SeriesIterator that doesn't reverse the chunks
+typedef struct MockChunksIterator
+{
+    AbstractIterator base;
+    EnrichedChunk *chunk;
+    const timestamp_t *timestamps;
+    size_t numChunks;
+    size_t nextChunk;
+    bool reverse;
+} MockChunksIterator;
+
+static EnrichedChunk *MockChunksIterator_GetNext(AbstractIterator *iter) {
+    MockChunksIterator *self = (MockChunksIterator *)iter;
+    if (self->nextChunk == self->numChunks) {
+        return NULL;
+    }
+    const size_t c = self->reverse ? self->numChunks - 1 - self->nextChunk : self->nextChunk;
+    self->nextChunk++;
+    ResetEnrichedChunk(self->chunk);
+    for (size_t i = 0; i < FILTER_TEST_CHUNK_SAMPLES; i++) {
+        const timestamp_t ts = self->timestamps[c * FILTER_TEST_CHUNK_SAMPLES + i];
+        self->chunk->samples.timestamps[i] = ts;
+        Samples_value_at(&self->chunk->samples, i, 0) = (double)ts / 2;
+    }
+    self->chunk->samples.num_samples = FILTER_TEST_CHUNK_SAMPLES;
+    return self->chunk;
+}
+
+static void MockChunksIterator_Close(AbstractIterator *iter) {
+    MockChunksIterator *self = (MockChunksIterator *)iter;
+    FreeEnrichedChunk(self->chunk);
+    free(self);
+}
+
+static AbstractIterator *MockChunksIterator_New(const timestamp_t *timestamps,
+                                                size_t numChunks,
+                                                bool reverse) {
+    MockChunksIterator *iter = calloc(1, sizeof(MockChunksIterator));
+    iter->base.GetNext = MockChunksIterator_GetNext;
+    iter->base.Close = MockChunksIterator_Close;
+    iter->chunk = NewEnrichedChunk();
+    ReallocSamplesArray(&iter->chunk->samples, FILTER_TEST_CHUNK_SAMPLES);
+    iter->timestamps = timestamps;
+    iter->numChunks = numChunks;
+    iter->reverse = reverse;
+    return (AbstractIterator *)iter;
+}
+
+MU_TEST(test_GallopLowerBound) {
+    timestamp_t values[100];
+    for (size_t i = 0; i < 100; i++) {
+        values[i] = 10 + i * 3;
+    }
+    for (size_t si = 0; si <= 100; si += 7) {
+        for (timestamp_t ts = 0; ts < 320; ts++) {
+            size_t expected = si;
+            while (expected < 100 && values[expected] < ts) {
+                expected++;
+            }
+            mu_assert_int_eq(expected, GallopLowerBound(values, si, 100, ts));
+        }
+    }
+    mu_assert_int_eq(0, GallopLowerBound(values, 0, 0, 5));
+}
+
+// Runs SeriesFilterTSIterator over the chunks and compares with a scan of the filter timestamps
+static void check_filter_by_ts(const timestamp_t *timestamps,
+                               timestamp_t *filter,
+                               size_t filterCount,
+                               size_t limit,
+                               bool reverse) {
+    FilterByTSArgs args = { .hasValue = true, .count = filterCount, .values = filter };
+    AbstractIterator *iter = (AbstractIterator *)SeriesFilterTSIterator_New(
+        MockChunksIterator_New(timestamps, FILTER_TEST_CHUNKS, reverse), args, limit, reverse, NULL);
+
+    // the samples are timestamps[] values, so the expected matches are the filter timestamps
+    // found in timestamps[] in the query direction
+    const size_t total = FILTER_TEST_CHUNKS * FILTER_TEST_CHUNK_SAMPLES;
+    size_t expected = 0, produced = 0;
+    EnrichedChunk *chunk;
+    while ((chunk = iter->GetNext(iter))) {
+        for (size_t i = 0; i < chunk->samples.num_samples; i++) {
+            // skip the filter timestamps which aren't samples
+            for (;;) {
+                mu_check(expected < filterCount);
+                const timestamp_t want = filter[reverse ? filterCount - 1 - expected : expected];
+                expected++;
+                const size_t at = GallopLowerBound(timestamps, 0, total, want);
+                if (at < total && timestamps[at] == want) {
+                    mu_assert_int_eq(want, chunk->samples.timestamps[i]);
+                    mu_check(Samples_value_at(&chunk->samples, i, 0) == (double)want / 2);
+                    break;
+                }
+            }
+            produced++;
+        }
+    }
+    size_t matches = 0;
+    for (size_t i = 0; i < filterCount; i++) {
+        const size_t at = GallopLowerBound(timestamps, 0, total, filter[i]);
+        matches += at < total && timestamps[at] == filter[i];
+    }
+    mu_assert_int_eq(min(matches, limit), produced);
+    iter->Close(iter);
+}
+
+MU_TEST(test_SeriesFilterTSIterator_matches_scan) {
+    srand(38);
+    static timestamp_t timestamps[FILTER_TEST_CHUNKS * FILTER_TEST_CHUNK_SAMPLES];
+    static timestamp_t filter[4000];
+    timestamp_t ts = 100;
+    for (size_t i = 0; i < FILTER_TEST_CHUNKS * FILTER_TEST_CHUNK_SAMPLES; i++) {
+        ts += 1 + rand() % 5;
+        timestamps[i] = ts;
+    }
+
+    for (size_t iter = 0; iter < 100; iter++) {
+        // from a handful of timestamps to denser than the samples, partly outside of the series
+        const size_t count = 1 + rand() % (iter % 2 ? 4000 : 20);
+        timestamp_t f = rand() % 200;
+        for (size_t i = 0; i < count; i++) {
+            f += 1 + rand() % (iter % 3 ? 4 : 100);
+            filter[i] = f;
+        }
+        for (int reverse = 0; reverse <= 1; reverse++) {
+            check_filter_by_ts(timestamps, filter, count, SIZE_MAX, reverse);
+            check_filter_by_ts(timestamps, filter, count, 1 + rand() % 50, reverse);
+        }
+    }
+}
+
+MU_TEST_SUITE(filter_by_ts_test_suite) {
+    MU_RUN_TEST(test_GallopLowerBound);
+    MU_RUN_TEST(test_SeriesFilterTSIterator_matches_scan);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "filters/filter_by_value_avx2.h"
+#include "filters/filter_by_value_avx512f.h"
+#include "filters/filter_by_value_common.h"
+#include "filters/filter_by_value_neon.h"
+#include "minunit.h"
+#include "utils/arch_features.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILTER_VALUE_TEST_MAX_SAMPLES 300
+
+// Runs kernel over random samples and compares with a plain branchy loop
+static void check_filter_by_value_kernel(FilterByValueFunc kernel) {
+    static const double specials[] = { NAN, INFINITY, -INFINITY, 10, -10, 0, -0.0 };
+    timestamp_t timestamps[FILTER_VALUE_TEST_MAX_SAMPLES];
+    double values[FILTER_VALUE_TEST_MAX_SAMPLES];
+    timestamp_t expectedTimestamps[FILTER_VALUE_TEST_MAX_SAMPLES];
+    double expectedValues[FILTER_VALUE_TEST_MAX_SAMPLES];
+
+    for (size_t iter = 0; iter < 500; iter++) {
+        const size_t n = rand() % (FILTER_VALUE_TEST_MAX_SAMPLES + 1);
+        // min == max and min > max are valid ranges too
+        const double min = (iter % 5 == 0) ? 10 : (double)(rand() % 40) - 20;
+        const double max = (iter % 7 == 0) ? min : (double)(rand() % 40) - 15;
+        const int passRate = rand() % 101; // from none to all of the samples
+        for (size_t i = 0; i < n; i++) {
+            timestamps[i] = 1000 + i * 3 + rand() % 3;
+            if (rand() % 10 == 0) {
+                values[i] = specials[rand() % (sizeof(specials) / sizeof(specials[0]))];
+            } else if (rand() % 100 < passRate) {
+                values[i] = min + (max - min) * ((double)rand() / RAND_MAX);
+            } else {
+                values[i] = ((double)rand() / RAND_MAX - 0.5) * 100;
+            }
+        }
+
+        size_t expected = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (values[i] >= min && values[i] <= max) {
+                expectedTimestamps[expected] = timestamps[i];
+                expectedValues[expected] = values[i];
+                expected++;
+            }
+        }
+
+        const size_t count = kernel(timestamps, values, n, min, max);
+        mu_assert_int_eq(expected, count);
+        for (size_t i = 0; i < count; i++) {
+            mu_assert_int_eq(expectedTimestamps[i], timestamps[i]);
+            mu_check(memcmp(&expectedValues[i], &values[i], sizeof(double)) == 0);
+        }
+    }
+}
+
+MU_TEST(test_FilterByValue_scalar) {
+    srand(39);
+    check_filter_by_value_kernel(FilterByValueScalar);
+}
+
+// The kernels of the instruction sets the CPU lacks aren't run, run the suite under QEMU (e.g.
+// qemu-aarch64 -cpu max) to cover them all.
+MU_TEST(test_FilterByValue_each_isa) {
+    srand(39);
+#if defined(__x86_64__)
+    const X86Features *features = getArchitectureOptimization();
+    if (features && features->avx2) {
+        check_filter_by_value_kernel(FilterByValueAVX2);
+    }
+    if (features && features->avx512f) {
+        check_filter_by_value_kernel(FilterByValueAVX512F);
+    }
+#elif defined(__aarch64__)
+    const Aarch64Features *features = getAarch64ArchitectureOptimization();
+    if (features && features->asimd) {
+        check_filter_by_value_kernel(FilterByValueNEON);
+    }
+#endif
+}
+
+MU_TEST_SUITE(filter_by_value_test_suite) {
+    MU_RUN_TEST(test_FilterByValue_scalar);
+    MU_RUN_TEST(test_FilterByValue_each_isa);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "minunit.h"
+#include "query_arena.h"
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+MU_TEST(test_QueryArena_alloc) {
+    QueryArena *arena = QueryArena_New();
+    const QueryArenaStats before = QueryArena_GetStats();
+
+    char *first = QueryArena_Alloc(arena, 3);
+    char *second = QueryArena_Alloc(arena, 40);
+    mu_check((uintptr_t)first % alignof(max_align_t) == 0);
+    mu_check((uintptr_t)second % alignof(max_align_t) == 0);
+    mu_check(second >= first + 3);
+    memset(first, 1, 3);
+    memset(second, 2, 40);
+    mu_check(first[2] == 1);
+
+    // larger than a block, a dedicated block is added
+    char *large = QueryArena_Alloc(arena, QUERY_ARENA_BLOCK_SIZE * 2);
+    memset(large, 3, QUERY_ARENA_BLOCK_SIZE * 2);
+    mu_check(second[39] == 2);
+    mu_assert_int_eq(before.blocks + 1, QueryArena_GetStats().blocks);
+    mu_assert_int_eq(before.allocations + 3, QueryArena_GetStats().allocations);
+
+    // the rewound blocks serve the same allocations again without new blocks
+    QueryArena_Reset(arena);
+    mu_check(QueryArena_Alloc(arena, 3) == first);
+    mu_check(QueryArena_Alloc(arena, 40) == second);
+    mu_check(QueryArena_Alloc(arena, QUERY_ARENA_BLOCK_SIZE * 2) == large);
+    mu_assert_int_eq(before.blocks + 1, QueryArena_GetStats().blocks);
+    QueryArena_Free(arena);
+
+    // without an arena it's the heap
+    void *heap = QueryArena_Alloc(NULL, 10);
+    mu_check(heap);
+    QueryArena_Release(NULL, heap);
+}
+
+MU_TEST(test_QueryArena_recycles_chunks) {
+    QueryArena *arena = QueryArena_New();
+    const QueryArenaStats before = QueryArena_GetStats();
+
+    EnrichedChunk *chunk = QueryArena_NewEnrichedChunk(arena, 1);
+    ReallocSamplesArray(&chunk->samples, 100);
+    chunk->samples.num_samples = 100;
+    QueryArena_FreeEnrichedChunk(arena, chunk);
+    QueryArena_Reset(arena);
+
+    // the buffers of 100 samples hold 33 samples of 3 values
+    EnrichedChunk *reused = QueryArena_NewEnrichedChunk(arena, 3);
+    mu_check(reused == chunk);
+    mu_assert_int_eq(0, reused->samples.num_samples);
+    mu_assert_int_eq(3, reused->samples.values_per_sample);
+    mu_assert_int_eq(33, reused->samples.size);
+    for (size_t i = 0; i < reused->samples.size; i++) {
+        reused->samples.timestamps[i] = i;
+        for (size_t v = 0; v < 3; v++) {
+            Samples_value_at(&reused->samples, i, v) = i * 3 + v;
+        }
+    }
+    QueryArena_FreeEnrichedChunk(arena, reused);
+
+    // and back to a single value per sample keeps the timestamps capacity
+    reused = QueryArena_NewEnrichedChunk(arena, 1);
+    mu_assert_int_eq(33, reused->samples.size);
+
+    // the pool is empty, so the next chunk is new
+    EnrichedChunk *other = QueryArena_NewEnrichedChunk(arena, 1);
+    mu_check(other != reused);
+    mu_assert_int_eq(before.chunksCreated + 2, QueryArena_GetStats().chunksCreated);
+    mu_assert_int_eq(before.chunksRecycled + 2, QueryArena_GetStats().chunksRecycled);
+
+    // chunks left in the pool are freed with the arena
+    QueryArena_FreeEnrichedChunk(arena, reused);
+    QueryArena_FreeEnrichedChunk(arena, other);
+    QueryArena_Free(arena);
+}
+
+MU_TEST_SUITE(query_arena_test_suite) {
+    MU_RUN_TEST(test_QueryArena_alloc);
+    MU_RUN_TEST(test_QueryArena_recycles_chunks);
+}
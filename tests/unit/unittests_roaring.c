@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2006-Present, Redis Ltd.
+ * All rights reserved.
+ *
+ * Licensed under your choice of (a) the Redis Source Available License 2.0
+ * (RSALv2); or (b) the Server Side Public License v1 (SSPLv1); or (c) the
+ * GNU Affero General Public License v3 (AGPLv3).
+ */
+#include "minunit.h"
+#include "utils/roaring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Values over 4 containers, so the containers pass from arrays to bitsets and back
+#define ROARING_TEST_RANGE (4 * 65536)
+
+static bool *roaring_reference(Roaring **r, int density) {
+    bool *ref = calloc(ROARING_TEST_RANGE, sizeof(bool));
+    *r = Roaring_New();
+    // each container has its own density, some containers are left empty
+    for (uint32_t key = 0; key < ROARING_TEST_RANGE / 65536; key++) {
+        const int percent = (density + key * 7) % 20;
+        if (percent == 0) {
+            continue;
+        }
+        for (uint32_t i = 0; i < 65536; i++) {
+            if (rand() % 100 < percent) {
+                const uint32_t value = key * 65536 + i;
+                ref[value] = true;
+                Roaring_Add(*r, value);
+            }
+        }
+    }
+    return ref;
+}
+
+static void check_roaring_equals(const Roaring *r, const bool *ref) {
+    uint64_t cardinality = 0;
+    for (uint32_t value = 0; value < ROARING_TEST_RANGE; value++) {
+        cardinality += ref[value];
+    }
+    mu_assert_int_eq(cardinality, Roaring_Cardinality(r));
+
+    RoaringIterator iter;
+    RoaringIterator_Init(&iter, r);
+    uint32_t value, expected = 0, yielded = 0;
+    while (RoaringIterator_Next(&iter, &value)) {
+        while (!ref[expected]) {
+            expected++;
+        }
+        mu_assert_int_eq(expected, value);
+        expected++;
+        yielded++;
+    }
+    mu_assert_int_eq(cardinality, yielded);
+    for (uint32_t i = 0; i < r->count; i++) {
+        const RoaringContainer *c = &r->containers[i];
+        mu_check(c->cardinality > 0);
+        mu_check((c->type == RoaringContainer_Array) == (c->cardinality <= ROARING_ARRAY_MAX));
+    }
+}
+
+MU_TEST(test_Roaring_add_remove) {
+    srand(41);
+    Roaring *r;
+    bool *ref = roaring_reference(&r, 3);
+    check_roaring_equals(r, ref);
+
+    for (uint32_t value = 0; value < ROARING_TEST_RANGE; value += 1 + rand() % 5) {
+        mu_check(Roaring_Contains(r, value) == ref[value]);
+        mu_check(Roaring_Add(r, value) != ref[value]);
+        mu_check(!Roaring_Add(r, value));
+        ref[value] = true;
+    }
+    check_roaring_equals(r, ref);
+
+    // dense containers shrink back to arrays, then disappear
+    for (uint32_t value = 0; value < ROARING_TEST_RANGE; value++) {
+        if (rand() % 10 != 0 || value < 65536) {
+            mu_check(Roaring_Remove(r, value) == ref[value]);
+            mu_check(!Roaring_Remove(r, value));
+            ref[value] = false;
+        }
+    }
+    check_roaring_equals(r, ref);
+    mu_assert_int_eq(ROARING_TEST_RANGE / 65536 - 1, r->count);
+
+    Roaring_Clear(r);
+    mu_assert_int_eq(0, Roaring_Cardinality(r));
+    mu_check(Roaring_Add(r, UINT32_MAX));
+    mu_check(Roaring_Contains(r, UINT32_MAX));
+    Roaring_Free(r);
+    free(ref);
+}
+
+MU_TEST(test_Roaring_set_operations) {
+    srand(41);
+    bool *expected = malloc(ROARING_TEST_RANGE * sizeof(bool));
+    for (int iter = 0; iter < 12; iter++) {
+        Roaring *a, *b;
+        bool *refA = roaring_reference(&a, iter);
+        bool *refB = roaring_reference(&b, iter * 3 + 1);
+
+        Roaring *and = Roaring_Copy(a);
+        Roaring_And(and, b);
+        for (uint32_t v = 0; v < ROARING_TEST_RANGE; v++) {
+            expected[v] = refA[v] && refB[v];
+        }
+        check_roaring_equals(and, expected);
+
+        Roaring *or = Roaring_Copy(a);
+        Roaring_Or(or, b);
+        for (uint32_t v = 0; v < ROARING_TEST_RANGE; v++) {
+            expected[v] = refA[v] || refB[v];
+        }
+        check_roaring_equals(or, expected);
+
+        Roaring *andNot = Roaring_Copy(a);
+        Roaring_AndNot(andNot, b);
+        for (uint32_t v = 0; v < ROARING_TEST_RANGE; v++) {
+            expected[v] = refA[v] && !refB[v];
+        }
+        check_roaring_equals(andNot, expected);
+
+        // the operands are unchanged and operations with themselves are no-ops
+        check_roaring_equals(a, refA);
+        check_roaring_equals(b, refB);
+        Roaring_And(a, a);
+        Roaring_Or(a, a);
+        check_roaring_equals(a, refA);
+        Roaring_AndNot(a, a);
+        mu_assert_int_eq(0, Roaring_Cardinality(a));
+
+        Roaring_Free(and);
+        Roaring_Free(or);
+        Roaring_Free(andNot);
+        Roaring_Free(a);
+        Roaring_Free(b);
+        free(refA);
+        free(refB);
+    }
+    free(expected);
+}
+
+MU_TEST(test_Roaring_serialize) {
+    srand(41);
+    for (int density = 0; density < 20; density += 3) {
+        Roaring *r;
+        bool *ref = roaring_reference(&r, density);
+        const size_t size = Roaring_SerializedSize(r);
+        char *buf = malloc(size);
+        Roaring_Serialize(r, buf);
+
+        Roaring *loaded = Roaring_Deserialize(buf, size);
+        mu_check(loaded != NULL);
+        check_roaring_equals(loaded, ref);
+        // the loaded bitmap is fully usable
+        mu_check(Roaring_Add(loaded, UINT32_MAX));
+        mu_check(Roaring_Contains(loaded, UINT32_MAX));
+
+        // truncated or extended buffers are rejected
+        mu_check(Roaring_Deserialize(buf, size - 1) == NULL);
+        mu_check(Roaring_Deserialize(buf, 3) == NULL);
+        char *longer = malloc(size + 1);
+        memcpy(longer, buf, size);
+        mu_check(Roaring_Deserialize(longer, size + 1) == NULL);
+        free(longer);
+
+        if (r->count > 0) {
+            // a wrong cardinality of the first container
+            buf[8] ^= 1;
+            mu_check(Roaring_Deserialize(buf, size) == NULL);
+        }
+
+        Roaring_Free(loaded);
+        Roaring_Free(r);
+        free(buf);
+        free(ref);
+    }
+
+    Roaring *empty = Roaring_New();
+    char buf[4];
+    mu_assert_int_eq(4, Roaring_SerializedSize(empty));
+    Roaring_Serialize(empty, buf);
+    Roaring *loaded = Roaring_Deserialize(buf, sizeof(buf));
+    mu_assert_int_eq(0, Roaring_Cardinality(loaded));
+    Roaring_Free(loaded);
+    Roaring_Free(empty);
+}
+
+MU_TEST(test_Roaring_iterator_seek) {
+    srand(41);
+    Roaring *r;
+    bool *ref = roaring_reference(&r, 5);
+    for (int i = 0; i < 2000; i++) {
+        const uint32_t from = rand() % (ROARING_TEST_RANGE + 10);
+        uint32_t expected = from;
+        while (expected < ROARING_TEST_RANGE && !ref[expected]) {
+            expected++;
+        }
+        RoaringIterator iter;
+        RoaringIterator_Init(&iter, r);
+        RoaringIterator_Seek(&iter, from);
+        uint32_t value;
+        if (expected >= ROARING_TEST_RANGE) {
+            mu_check(!RoaringIterator_Next(&iter, &value));
+            continue;
+        }
+        mu_check(RoaringIterator_Next(&iter, &value));
+        mu_assert_int_eq(expected, value);
+        // the iteration goes on from there
+        if (RoaringIterator_Next(&iter, &value)) {
+            mu_check(value > expected && ref[value]);
+        }
+    }
+    Roaring_Free(r);
+    free(ref);
+}
+
+MU_TEST_SUITE(roaring_test_suite) {
+    MU_RUN_TEST(test_Roaring_add_remove);
+    MU_RUN_TEST(test_Roaring_set_operations);
+    MU_RUN_TEST(test_Roaring_serialize);
+    MU_RUN_TEST(test_Roaring_iterator_seek);
+}
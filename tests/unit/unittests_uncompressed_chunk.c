@@ -144,6 +144,57 @@ MU_TEST(test_Uncompressed_Uncompressed_UpsertSample_DuplicatePolicy) {
     Uncompressed_FreeChunk(chunk);
 }
 
+MU_TEST(test_Uncompressed_Uncompressed_UpsertSamples) {
+    const size_t chunk_size = 4096;
+    Chunk *chunk = Uncompressed_NewChunk(chunk_size);
+    // chunk holds 10, 20, ..., 100
+    for (int64_t ts = 10; ts <= 100; ts += 10) {
+        Sample s = { .timestamp = ts, .value = ts * 1.0 };
+        mu_assert(Uncompressed_AddSample(chunk, &s) == CR_OK, "add sample");
+    }
+
+    // new head, a duplicate of an existing sample, two new samples with the same timestamp and a
+    // new sample in the middle
+    const Sample batch[] = {
+        { .timestamp = 5, .value = 0.5 },   { .timestamp = 20, .value = 2.5 },
+        { .timestamp = 25, .value = 1.0 },  { .timestamp = 25, .value = 3.0 },
+        { .timestamp = 55, .value = 5.5 },
+    };
+    ChunkResult results[5];
+    UpsertBatchCtx uCtx = {
+        .samples = batch,
+        .results = results,
+        .count = 5,
+        .inChunk = chunk,
+    };
+    int size = 0;
+    mu_assert(Uncompressed_UpsertSamples(&uCtx, &size, DP_BLOCK) == CR_OK, "upsert samples");
+    mu_assert_int_eq(3, size);
+    mu_assert_int_eq(13, chunk->num_samples);
+    mu_assert(results[0] == CR_OK, "new first sample");
+    mu_assert(results[1] == CR_ERR, "duplicate blocked");
+    mu_assert(results[2] == CR_OK, "new sample");
+    mu_assert(results[3] == CR_ERR, "duplicate inside the batch blocked");
+    mu_assert(results[4] == CR_OK, "new sample");
+    mu_assert_int_eq(5, Uncompressed_GetFirstTimestamp(chunk));
+    mu_assert_int_eq(5, chunk->base_timestamp);
+    mu_assert_double_eq(20.0, chunk->samples[2].value);
+    mu_assert_double_eq(1.0, chunk->samples[3].value);
+    mu_assert_int_eq(55, chunk->samples[7].timestamp);
+    for (size_t i = 1; i < chunk->num_samples; i++) {
+        mu_assert(chunk->samples[i - 1].timestamp < chunk->samples[i].timestamp, "sorted");
+    }
+
+    // DP_SUM folds the duplicates into the existing sample in order
+    const Sample sums[] = { { .timestamp = 30, .value = 1.0 }, { .timestamp = 30, .value = 2.0 } };
+    uCtx.samples = sums;
+    uCtx.count = 2;
+    mu_assert(Uncompressed_UpsertSamples(&uCtx, &size, DP_SUM) == CR_OK, "upsert samples");
+    mu_assert_int_eq(0, size);
+    mu_assert_double_eq(33.0, chunk->samples[4].value);
+    Uncompressed_FreeChunk(chunk);
+}
+
 MU_TEST(test_reverseEnrichedChunk_multi_values_per_sample) {
     EnrichedChunk *ec = NewEnrichedChunk();
     ec->samples.values_per_sample = 2;
@@ -204,6 +255,7 @@ MU_TEST_SUITE(uncompressed_chunk_test_suite) {
     MU_RUN_TEST(test_Uncompressed_Uncompressed_AddSample);
     MU_RUN_TEST(test_Uncompressed_Uncompressed_UpsertSample);
     MU_RUN_TEST(test_Uncompressed_Uncompressed_UpsertSample_DuplicatePolicy);
+    MU_RUN_TEST(test_Uncompressed_Uncompressed_UpsertSamples);
     MU_RUN_TEST(test_reverseEnrichedChunk_multi_values_per_sample);
     MU_RUN_TEST(test_reverseEnrichedChunk_single_value_per_sample);
 }